@@ -65,6 +65,173 @@ void* dlmalloc_sbrk(ptrdiff_t increment)
     return ptr;
 }
 
+#ifndef OE_DLMALLOC_NO_THREAD_CACHE
+
+/*
+**==============================================================================
+**
+** Thread caches:
+**
+**     Every dlmalloc() and dlfree() takes the global lock of dlmalloc, so
+**     enclave threads that allocate concurrently serialize on it. Therefore,
+**     each thread keeps the small blocks that it frees in a cache with one
+**     list per size class, and allocates from there without taking the lock.
+**     An empty list is refilled with a batch of blocks carved out of a single
+**     dlindependent_comalloc() call and an overflowing list returns half of
+**     its blocks with a single dlbulk_free() call.
+**
+**     Cached blocks are still in use from the point of view of dlmalloc. A
+**     freed block goes to the class of its usable size rounded down, so any
+**     block of a class can hold the requests of that class. Enclave threads
+**     only last for an ECALL, so oe_allocator_thread_cleanup() returns the
+**     whole cache to dlmalloc.
+**
+**     Define OE_DLMALLOC_NO_THREAD_CACHE to build dlmalloc without caches.
+**
+**==============================================================================
+*/
+
+#define THREAD_CACHE_GRANULE_SHIFT 4
+
+/* Classes of 16, 32, ..., 512 bytes */
+#define THREAD_CACHE_NUM_CLASSES 32
+#define THREAD_CACHE_MAX_SIZE \
+    ((size_t)THREAD_CACHE_NUM_CLASSES << THREAD_CACHE_GRANULE_SHIFT)
+
+/* Bounds on the number of blocks and bytes held by one list */
+#define THREAD_CACHE_MAX_BLOCKS 64
+#define THREAD_CACHE_MAX_LIST_SIZE 4096
+
+typedef struct _thread_cache_block
+{
+    struct _thread_cache_block* next;
+} thread_cache_block_t;
+
+typedef struct _thread_cache
+{
+    bool enabled;
+    uint8_t num_blocks[THREAD_CACHE_NUM_CLASSES];
+    thread_cache_block_t* blocks[THREAD_CACHE_NUM_CLASSES];
+} thread_cache_t;
+
+static __thread thread_cache_t _thread_cache;
+
+static size_t _thread_cache_class_size(size_t size_class)
+{
+    return (size_class + 1) << THREAD_CACHE_GRANULE_SHIFT;
+}
+
+static size_t _thread_cache_capacity(size_t size_class)
+{
+    size_t capacity =
+        THREAD_CACHE_MAX_LIST_SIZE / _thread_cache_class_size(size_class);
+
+    return capacity < THREAD_CACHE_MAX_BLOCKS ? capacity
+                                              : THREAD_CACHE_MAX_BLOCKS;
+}
+
+static void _thread_cache_push(
+    thread_cache_t* cache,
+    size_t size_class,
+    void* ptr)
+{
+    thread_cache_block_t* block = (thread_cache_block_t*)ptr;
+
+    block->next = cache->blocks[size_class];
+    cache->blocks[size_class] = block;
+    cache->num_blocks[size_class]++;
+}
+
+static void* _thread_cache_pop(thread_cache_t* cache, size_t size_class)
+{
+    thread_cache_block_t* block = cache->blocks[size_class];
+
+    cache->blocks[size_class] = block->next;
+    cache->num_blocks[size_class]--;
+
+    return block;
+}
+
+/* Returns up to count blocks of the given class to dlmalloc */
+static void _thread_cache_flush(
+    thread_cache_t* cache,
+    size_t size_class,
+    size_t count)
+{
+    void* blocks[THREAD_CACHE_MAX_BLOCKS + 1];
+    size_t n = 0;
+
+    while (n < count && cache->blocks[size_class])
+        blocks[n++] = _thread_cache_pop(cache, size_class);
+
+    if (n)
+        dlbulk_free(blocks, n);
+}
+
+static void _thread_cache_flush_all(thread_cache_t* cache)
+{
+    for (size_t i = 0; i < THREAD_CACHE_NUM_CLASSES; i++)
+        _thread_cache_flush(cache, i, THREAD_CACHE_MAX_BLOCKS + 1);
+}
+
+static void* _thread_cache_malloc(size_t size)
+{
+    thread_cache_t* cache = &_thread_cache;
+    size_t size_class = size ? (size - 1) >> THREAD_CACHE_GRANULE_SHIFT : 0;
+
+    if (!cache->enabled || size > THREAD_CACHE_MAX_SIZE)
+        return dlmalloc(size);
+
+    if (!cache->blocks[size_class])
+    {
+        size_t sizes[THREAD_CACHE_MAX_BLOCKS];
+        void* blocks[THREAD_CACHE_MAX_BLOCKS];
+        size_t count = (_thread_cache_capacity(size_class) + 1) / 2;
+
+        for (size_t i = 0; i < count; i++)
+            sizes[i] = _thread_cache_class_size(size_class);
+
+        /* Fall back to a single block when the heap is nearly exhausted */
+        if (!dlindependent_comalloc(count, sizes, blocks))
+            return dlmalloc(size);
+
+        for (size_t i = count; i > 0; i--)
+            _thread_cache_push(cache, size_class, blocks[i - 1]);
+    }
+
+    return _thread_cache_pop(cache, size_class);
+}
+
+static void _thread_cache_free(void* ptr)
+{
+    thread_cache_t* cache = &_thread_cache;
+    size_t size_class;
+
+    if (!cache->enabled || !ptr)
+    {
+        dlfree(ptr);
+        return;
+    }
+
+    size_class = (dlmalloc_usable_size(ptr) >> THREAD_CACHE_GRANULE_SHIFT) - 1;
+
+    if (size_class >= THREAD_CACHE_NUM_CLASSES)
+    {
+        dlfree(ptr);
+        return;
+    }
+
+    _thread_cache_push(cache, size_class, ptr);
+
+    if (cache->num_blocks[size_class] > _thread_cache_capacity(size_class))
+        _thread_cache_flush(
+            cache,
+            size_class,
+            (_thread_cache_capacity(size_class) + 1) / 2);
+}
+
+#endif /* OE_DLMALLOC_NO_THREAD_CACHE */
+
 void oe_allocator_init(void* heap_start_address, void* heap_end_address)
 {
     _heap_start = heap_start_address;
@@ -78,24 +245,53 @@ void oe_allocator_cleanup(void)
 
 void oe_allocator_thread_init(void)
 {
+#ifndef OE_DLMALLOC_NO_THREAD_CACHE
+    _thread_cache.enabled = true;
+#endif
 }
 
 void oe_allocator_thread_cleanup(void)
 {
+#ifndef OE_DLMALLOC_NO_THREAD_CACHE
+    _thread_cache_flush_all(&_thread_cache);
+    _thread_cache.enabled = false;
+#endif
 }
 
 void* oe_allocator_malloc(size_t size)
 {
+#ifndef OE_DLMALLOC_NO_THREAD_CACHE
+    return _thread_cache_malloc(size);
+#else
     return dlmalloc(size);
+#endif
 }
 
 void oe_allocator_free(void* ptr)
 {
+#ifndef OE_DLMALLOC_NO_THREAD_CACHE
+    _thread_cache_free(ptr);
+#else
     dlfree(ptr);
+#endif
 }
 
 void* oe_allocator_calloc(size_t nmemb, size_t size)
 {
+#ifndef OE_DLMALLOC_NO_THREAD_CACHE
+    /* nmemb * size cannot overflow if it is at most THREAD_CACHE_MAX_SIZE */
+    if (_thread_cache.enabled &&
+        (!nmemb || size <= THREAD_CACHE_MAX_SIZE / nmemb))
+    {
+        void* ptr = _thread_cache_malloc(nmemb * size);
+
+        if (ptr)
+            memset(ptr, 0, nmemb * size);
+
+        return ptr;
+    }
+#endif
+
     return dlcalloc(nmemb, size);
 }
 
@@ -123,6 +319,12 @@ oe_result_t oe_allocator_mallinfo(oe_mallinfo_t* info)
 {
     info->max_total_heap_size = _max_heap_size;
 
+#ifndef OE_DLMALLOC_NO_THREAD_CACHE
+    /* Do not count the blocks cached by this thread as allocated. Those
+     * cached by other threads still count until their ECALLs return. */
+    _thread_cache_flush_all(&_thread_cache);
+#endif
+
     struct mallinfo minfo = dlmallinfo();
     // uordblks:  current total allocated space (normal or mmapped)
     info->current_allocated_heap_size = minfo.uordblks;
@@ -27,6 +27,8 @@ bool oe_use_debug_malloc_memset = true;
 bool oe_use_debug_malloc_tracking = false;
 /* Session number to identify the session of local tracking. */
 int32_t oe_debug_malloc_session_number = 0;
+/* Size classes of the blocks that record a backtrace. */
+uint64_t oe_debug_malloc_backtrace_size_classes = OE_UINT64_MAX;
 
 /*
 **==============================================================================
@@ -40,13 +42,22 @@ int32_t oe_debug_malloc_session_number = 0;
 **         (3) Assuming blocks are zero filled (fills new blocks with 0xAA).
 **         (3) Use of free memory (fills freed blocks with 0xDD).
 **
-**     This allocator keeps in-use blocks on a linked list. Each block has the
+**     This allocator keeps in-use blocks on linked lists. Each block has the
 **     following layout.
 **
 **         [padding] [header] [user-data] [footer]
 **
 **     The padding is applied by memalign() when the alignment is non-zero.
 **
+**     The lists are sharded by the address of the block header, and each
+**     shard has its own lock, so that threads allocating at the same time
+**     rarely wait for each other. Each block records a sequence number, so
+**     walks over all blocks can merge the shards from the newest to the
+**     oldest block. Threads take sequence numbers from a global counter in
+**     batches, so the order of blocks that different threads allocated at
+**     about the same time is approximate, and each shard hands out increasing
+**     numbers to keep its list sorted.
+**
 **==============================================================================
 */
 
@@ -83,11 +94,14 @@ struct header
     void* addrs[OE_BACKTRACE_MAX];
     uint64_t num_addrs;
 
+    /* Position of the block in the order of allocation */
+    uint64_t sequence;
+
     /* Option if current object is tracked */
     int32_t session_number;
 
     /* Padding to make header a multiple of 16 */
-    uint8_t padding[4];
+    uint8_t padding[12];
 
     /* Contains HEADER_MAGIC2 */
     uint64_t magic2;
@@ -123,6 +137,21 @@ OE_INLINE footer_t* _get_footer(void* ptr)
     return (footer_t*)((uint8_t*)ptr + rsize);
 }
 
+/* Size class n holds the blocks of more than 2^(n-1) and at most 2^n bytes,
+ * and size class 0 holds the blocks of zero or one byte. */
+OE_INLINE bool _backtrace_enabled(size_t size)
+{
+    uint64_t size_class = 0;
+
+    if (size > 1)
+        size_class = 64 - (uint64_t)__builtin_clzll((uint64_t)size - 1);
+
+    if (size_class > 63)
+        size_class = 63;
+
+    return (oe_debug_malloc_backtrace_size_classes >> size_class) & 1;
+}
+
 /* Use a macro so the function name will not appear in the backtrace */
 #define INIT_BLOCK(HEADER, ALIGNMENT, SIZE)                                    \
     do                                                                         \
@@ -133,7 +162,10 @@ OE_INLINE footer_t* _get_footer(void* ptr)
         HEADER->alignment = ALIGNMENT;                                         \
         HEADER->size = SIZE;                                                   \
         HEADER->num_addrs =                                                    \
-            (uint64_t)oe_backtrace(HEADER->addrs, OE_BACKTRACE_MAX);           \
+            _backtrace_enabled(SIZE)                                           \
+                ? (uint64_t)oe_backtrace(HEADER->addrs, OE_BACKTRACE_MAX)      \
+                : 0;                                                           \
+        HEADER->sequence = 0;                                                  \
         HEADER->session_number =                                               \
             oe_use_debug_malloc_tracking ? oe_debug_malloc_session_number : 0; \
         HEADER->magic2 = HEADER_MAGIC2;                                        \
@@ -207,13 +239,90 @@ typedef struct _list
     header_t* tail;
 } list_t;
 
-static list_t _list = {NULL, NULL};
-static oe_spinlock_t _spin = OE_SPINLOCK_INITIALIZER;
+/* The number of lists that in-use blocks are spread over */
+#ifndef OE_DEBUG_MALLOC_NUM_SHARDS
+#define OE_DEBUG_MALLOC_NUM_SHARDS 64
+#endif
+
+/* Shards are aligned to keep their locks on separate cache lines */
+typedef struct _shard
+{
+    oe_spinlock_t lock;
+    list_t list;
+
+    /* The sequence number of the newest block of the list */
+    uint64_t sequence;
+} OE_ALIGNED(64) shard_t;
+
+static shard_t _shards[OE_DEBUG_MALLOC_NUM_SHARDS];
+
+/* The sequence numbers that a thread takes from _sequence at once, so that
+ * allocating threads rarely write the same cache line */
+#define OE_DEBUG_MALLOC_SEQUENCE_BATCH 64
+
+typedef struct _sequence_batch
+{
+    uint64_t next;
+    uint64_t end;
+} sequence_batch_t;
+
+static uint64_t _sequence;
+static __thread sequence_batch_t _sequence_batch;
+
+/* Guards the state of local tracking */
+static oe_spinlock_t _tracking_spin = OE_SPINLOCK_INITIALIZER;
+
+static shard_t* _get_shard(header_t* header)
+{
+    /* Headers are 16-byte aligned, so the low bits carry no information */
+    uint64_t hash = ((uint64_t)header >> 4) * 0x9e3779b97f4a7c15;
+
+    return &_shards[(hash >> 32) % OE_DEBUG_MALLOC_NUM_SHARDS];
+}
+
+static void _lock_all(void)
+{
+    for (size_t i = 0; i < OE_DEBUG_MALLOC_NUM_SHARDS; i++)
+        oe_spin_lock(&_shards[i].lock);
+}
+
+static void _unlock_all(void)
+{
+    for (size_t i = OE_DEBUG_MALLOC_NUM_SHARDS; i > 0; i--)
+        oe_spin_unlock(&_shards[i - 1].lock);
+}
+
+static uint64_t _next_sequence(void)
+{
+    sequence_batch_t* batch = &_sequence_batch;
+
+    if (batch->next == batch->end)
+    {
+        batch->next = __atomic_fetch_add(
+            &_sequence, OE_DEBUG_MALLOC_SEQUENCE_BATCH, __ATOMIC_RELAXED);
+        batch->end = batch->next + OE_DEBUG_MALLOC_SEQUENCE_BATCH;
+    }
+
+    return batch->next++;
+}
 
-static void _list_insert(list_t* list, header_t* header)
+static void _list_insert(header_t* header)
 {
-    oe_spin_lock(&_spin);
+    shard_t* shard = _get_shard(header);
+    list_t* list = &shard->list;
+    uint64_t sequence = _next_sequence();
+
+    oe_spin_lock(&shard->lock);
     {
+        /* A thread with an older batch may insert after a thread with a
+         * newer one. Never going back keeps each list sorted from the newest
+         * to the oldest block. */
+        if (sequence <= shard->sequence)
+            sequence = shard->sequence + 1;
+
+        shard->sequence = sequence;
+        header->sequence = sequence;
+
         if (list->head)
         {
             header->prev = NULL;
@@ -229,12 +338,15 @@ static void _list_insert(list_t* list, header_t* header)
             list->tail = header;
         }
     }
-    oe_spin_unlock(&_spin);
+    oe_spin_unlock(&shard->lock);
 }
 
-static void _list_remove(list_t* list, header_t* header)
+static void _list_remove(header_t* header)
 {
-    oe_spin_lock(&_spin);
+    shard_t* shard = _get_shard(header);
+    list_t* list = &shard->list;
+
+    oe_spin_lock(&shard->lock);
     {
         if (header->next)
             header->next->prev = header->prev;
@@ -247,7 +359,42 @@ static void _list_remove(list_t* list, header_t* header)
         else if (header == list->tail)
             list->tail = header->prev;
     }
-    oe_spin_unlock(&_spin);
+    oe_spin_unlock(&shard->lock);
+}
+
+/* Walks the blocks of all shards from the newest to the oldest. The caller
+ * must hold the locks of all shards. */
+typedef struct _iterator
+{
+    header_t* next[OE_DEBUG_MALLOC_NUM_SHARDS];
+} iterator_t;
+
+static void _iterator_init(iterator_t* it)
+{
+    for (size_t i = 0; i < OE_DEBUG_MALLOC_NUM_SHARDS; i++)
+        it->next[i] = _shards[i].list.head;
+}
+
+static header_t* _iterator_next(iterator_t* it)
+{
+    header_t* newest = NULL;
+    size_t index = 0;
+
+    for (size_t i = 0; i < OE_DEBUG_MALLOC_NUM_SHARDS; i++)
+    {
+        header_t* p = it->next[i];
+
+        if (p && (!newest || p->sequence > newest->sequence))
+        {
+            newest = p;
+            index = i;
+        }
+    }
+
+    if (newest)
+        it->next[index] = newest->next;
+
+    return newest;
 }
 
 OE_INLINE bool _check_multiply_overflow(size_t x, size_t y)
@@ -267,8 +414,9 @@ static void _malloc_dump(size_t size, void* addrs[], int num_addrs)
 {
     char** symbols = NULL;
 
-    /* Get symbol names for these addresses */
-    if (!(symbols = oe_backtrace_symbols(addrs, num_addrs)))
+    /* Get symbol names for these addresses (blocks of size classes without
+     * backtraces have none) */
+    if (num_addrs && !(symbols = oe_backtrace_symbols(addrs, num_addrs)))
         goto done;
 
     oe_host_printf("%llu bytes\n", OE_LLX(size));
@@ -285,14 +433,15 @@ done:
 static void _dump(bool need_lock)
 {
     bool secure_unserialize_enabled = false;
-    list_t* list = &_list;
+    iterator_t it;
+    header_t* p;
 
     if (need_lock)
-        oe_spin_lock(&_spin);
+        _lock_all();
 
     /* Temporarily disable the oe_edger8r_secure_unserialize (if set)
      * to avoid using malloc in the OCALL marshalling code
-     * that cause deadlock on _spin when debug malloc is enabled. */
+     * that cause deadlock on the shards when debug malloc is enabled. */
     if (oe_edger8r_secure_unserialize)
     {
         secure_unserialize_enabled = true;
@@ -304,7 +453,7 @@ static void _dump(bool need_lock)
         size_t bytes = 0;
 
         /* Count bytes allocated and blocks still in use */
-        for (header_t* p = list->head; p; p = p->next)
+        for (_iterator_init(&it); (p = _iterator_next(&it));)
         {
             blocks++;
             bytes += p->size;
@@ -313,7 +462,7 @@ static void _dump(bool need_lock)
         oe_host_printf(
             "=== %s(): %zu bytes in %zu blocks\n", __FUNCTION__, bytes, blocks);
 
-        for (header_t* p = list->head; p; p = p->next)
+        for (_iterator_init(&it); (p = _iterator_next(&it));)
             _malloc_dump(p->size, p->addrs, (int)p->num_addrs);
 
         oe_host_printf("\n");
@@ -324,7 +473,7 @@ static void _dump(bool need_lock)
         oe_edger8r_secure_unserialize = true;
 
     if (need_lock)
-        oe_spin_unlock(&_spin);
+        _unlock_all();
 }
 
 /*
@@ -352,7 +501,7 @@ void* oe_debug_malloc(size_t size)
     header_t* header = (header_t*)block;
     INIT_BLOCK(header, 0, size);
     _check_block(header);
-    _list_insert(&_list, header);
+    _list_insert(header);
 
     return header->data;
 }
@@ -363,7 +512,7 @@ void oe_debug_free(void* ptr)
     {
         header_t* header = _get_header(ptr);
         _check_block(header);
-        _list_remove(&_list, header);
+        _list_remove(header);
 
         /* Fill the whole block with 0xDD (Deallocated) bytes */
         void* block = _get_block_address(ptr);
@@ -441,7 +590,7 @@ int oe_debug_posix_memalign(void** memptr, size_t alignment, size_t size)
 
     INIT_BLOCK(header, alignment, size);
     _check_block(header);
-    _list_insert(&_list, header);
+    _list_insert(header);
     *memptr = header->data;
 
     return 0;
@@ -462,7 +611,7 @@ void* oe_debug_aligned_alloc(size_t alignment, size_t size)
     header = (header_t*)((uint8_t*)block + padding_size);
     INIT_BLOCK(header, alignment, size);
     _check_block(header);
-    _list_insert(&_list, header);
+    _list_insert(header);
 
     return header->data;
 }
@@ -481,23 +630,28 @@ void oe_debug_malloc_dump(void)
 
 size_t oe_debug_malloc_check(void)
 {
-    list_t* list = &_list;
     size_t count = 0;
 
-    oe_spin_lock(&_spin);
+    _lock_all();
     {
-        for (header_t* p = list->head; p; p = p->next)
-            count++;
+        for (size_t i = 0; i < OE_DEBUG_MALLOC_NUM_SHARDS; i++)
+        {
+            for (header_t* p = _shards[i].list.head; p; p = p->next)
+                count++;
+        }
 
         if (count)
         {
             _dump(false);
 
-            for (header_t* p = list->head; p; p = p->next)
-                _check_block(p);
+            for (size_t i = 0; i < OE_DEBUG_MALLOC_NUM_SHARDS; i++)
+            {
+                for (header_t* p = _shards[i].list.head; p; p = p->next)
+                    _check_block(p);
+            }
         }
     }
-    oe_spin_unlock(&_spin);
+    _unlock_all();
 
     return count;
 }
@@ -690,14 +844,14 @@ oe_result_t oe_debug_malloc_tracking_start(void)
 {
     oe_result_t result = OE_UNEXPECTED;
 
-    oe_spin_lock(&_spin);
+    oe_spin_lock(&_tracking_spin);
     if (!oe_use_debug_malloc_tracking)
     {
         oe_use_debug_malloc_tracking = true;
         ++oe_debug_malloc_session_number;
         result = OE_OK;
     }
-    oe_spin_unlock(&_spin);
+    oe_spin_unlock(&_tracking_spin);
 
     return result;
 }
@@ -706,13 +860,13 @@ oe_result_t oe_debug_malloc_tracking_stop(void)
 {
     oe_result_t result = OE_UNEXPECTED;
 
-    oe_spin_lock(&_spin);
+    oe_spin_lock(&_tracking_spin);
     if (oe_use_debug_malloc_tracking)
     {
         oe_use_debug_malloc_tracking = false;
         result = OE_OK;
     }
-    oe_spin_unlock(&_spin);
+    oe_spin_unlock(&_tracking_spin);
 
     return result;
 }
@@ -726,7 +880,8 @@ static oe_result_t _copy_frames(
     oe_result_t result = OE_FAILURE;
     char** symbols = NULL;
 
-    if (!(symbols = oe_backtrace_symbols(p->addrs, (int)(p->num_addrs))))
+    if (p->num_addrs &&
+        !(symbols = oe_backtrace_symbols(p->addrs, (int)(p->num_addrs))))
     {
         goto done;
     }
@@ -757,6 +912,18 @@ static oe_result_t _copy_frames(
         *index = oe_strlen(*str);
     }
 
+    /* Blocks without frames still need room for the separator */
+    if (*index + 2 > *size)
+    {
+        *size *= 2;
+        *str = oe_realloc(*str, *size);
+        if (*str == NULL)
+        {
+            result = OE_ENOMEM;
+            goto done;
+        }
+    }
+
     (*str)[(*index)++] = '\n';
     (*str)[*index] = '\0';
 
@@ -773,8 +940,11 @@ oe_result_t oe_debug_malloc_tracking_report(
     char** report)
 {
     bool secure_unserialize_enabled = false;
+    bool locked = false;
     oe_result_t result = OE_OK;
     uint64_t count = 0;
+    iterator_t it;
+    header_t* p;
 
     size_t index = 0;
     size_t length = 4096;
@@ -786,12 +956,12 @@ oe_result_t oe_debug_malloc_tracking_report(
     }
     report_string[0] = '\0';
 
-    list_t* list = &_list;
-    oe_spin_lock(&_spin);
+    _lock_all();
+    locked = true;
 
     /* Temporarily disable the oe_edger8r_secure_unserialize (if set)
      * to avoid using malloc in the OCALL marshalling code
-     * that cause deadlock on _spin when debug malloc is enabled. */
+     * that cause deadlock on the shards when debug malloc is enabled. */
     if (oe_edger8r_secure_unserialize)
     {
         secure_unserialize_enabled = true;
@@ -799,7 +969,7 @@ oe_result_t oe_debug_malloc_tracking_report(
     }
 
     {
-        for (header_t* p = list->head; p; p = p->next)
+        for (_iterator_init(&it); (p = _iterator_next(&it));)
         {
             if (p->session_number)
             {
@@ -817,7 +987,8 @@ oe_result_t oe_debug_malloc_tracking_report(
     if (secure_unserialize_enabled)
         oe_edger8r_secure_unserialize = true;
 
-    oe_spin_unlock(&_spin);
+    _unlock_all();
+    locked = false;
 
     length = index + 1;
     report_string = oe_realloc(report_string, length);
@@ -831,6 +1002,8 @@ oe_result_t oe_debug_malloc_tracking_report(
     *report = report_string;
 
 done:
-    oe_spin_unlock(&_spin);
+    if (locked)
+        _unlock_all();
+
     return result;
 }
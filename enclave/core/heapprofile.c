@@ -0,0 +1,480 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include "heapprofile.h"
+#include <openenclave/advanced/allocator.h>
+#include <openenclave/advanced/heapprofile.h>
+#include <openenclave/corelibc/stdarg.h>
+#include <openenclave/corelibc/stdio.h>
+#include <openenclave/corelibc/string.h>
+#include <openenclave/enclave.h>
+#include <openenclave/internal/backtrace.h>
+#include <openenclave/internal/raise.h>
+#include <openenclave/internal/thread.h>
+#include <openenclave/internal/types.h>
+
+/*
+**==============================================================================
+**
+** Sampling heap profiler:
+**
+**     Allocations are sampled as a Poisson process over the bytes allocated.
+**     Each thread counts down a random number of bytes drawn from an
+**     exponential distribution whose mean is the sampling interval, and the
+**     allocation that exhausts the count is sampled. Enclave threads only
+**     last for an ECALL and the exponential distribution is memoryless, so a
+**     thread draws a new count when it first allocates in an ECALL. Other
+**     allocations only update the counter of their thread.
+**
+**     A sampled allocation adds to the bucket of its call stack and goes
+**     into the table of live samples until it is freed. Samples are rare,
+**     so buckets and live samples are kept under a single lock. To avoid
+**     looking up every freed pointer there, a counting filter indexed by the
+**     hash of the pointer tells which pointers may have been sampled.
+**
+**     The lock is never held while calling malloc() or logging, which could
+**     sample and take the lock again. The profiler allocates its own memory
+**     from the allocator directly.
+**
+**     Profiles are written in the legacy text format of pprof (heap_v2).
+**     The header line holds the totals, and each bucket has a line with the
+**     number and bytes of its live samples, the number and bytes of all its
+**     samples, and its call stack:
+**
+**         heap profile: 2: 1024 [5: 4096] @ heap_v2/524288
+**         1: 512 [3: 2048] @ 0x7f0000012345 0x7f0000023456
+**
+**     pprof scales the sampled counts by the sampling interval.
+**
+**==============================================================================
+*/
+
+/* Entries of the counting filter and heads of the tables (powers of 2) */
+#define FILTER_SIZE 8192
+#define NUM_SAMPLE_HEADS 4096
+#define NUM_BUCKET_HEADS 1024
+
+/* The frames of _record_sample() and oe_heap_profile_sample_malloc() */
+#define NUM_SKIPPED_FRAMES 2
+
+/* ln(2) in 16.16 fixed point */
+#define LN2_FIXED 45426
+
+typedef struct _bucket
+{
+    struct _bucket* next;
+    uint64_t hash;
+    uint64_t num_live;
+    uint64_t live_bytes;
+    uint64_t num_sampled;
+    uint64_t sampled_bytes;
+    size_t num_addrs;
+    void* addrs[OE_BACKTRACE_MAX];
+} bucket_t;
+
+typedef struct _sample
+{
+    struct _sample* next;
+    void* ptr;
+    size_t size;
+    bucket_t* bucket;
+} sample_t;
+
+static struct
+{
+    oe_spinlock_t lock;
+
+    /* The sampling interval of the last call to oe_heap_profile_start() */
+    uint64_t sampling_interval;
+
+    /* Allocated by the first call to oe_heap_profile_start() */
+    uint16_t* filter;
+    sample_t** samples;
+    bucket_t** buckets;
+} _profile = {.lock = OE_SPINLOCK_INITIALIZER};
+
+typedef struct _sampler
+{
+    bool initialized;
+    uint64_t random;
+    uint64_t bytes_until_sample;
+} sampler_t;
+
+static __thread sampler_t _sampler;
+
+/* Distinguishes the random sequences of the samplers */
+static uint64_t _num_samplers;
+
+uint64_t oe_heap_profile_sampling_interval;
+uint64_t oe_heap_profile_num_live_samples;
+
+static uint64_t _hash_ptr(const void* ptr)
+{
+    uint64_t hash = (uint64_t)ptr >> 4;
+
+    return hash * 0x9e3779b97f4a7c15;
+}
+
+static uint64_t _hash_stack(void* const* addrs, size_t num_addrs)
+{
+    uint64_t hash = 0xcbf29ce484222325;
+
+    for (size_t i = 0; i < num_addrs; i++)
+        hash = (hash ^ (uint64_t)addrs[i]) * 0x100000001b3;
+
+    return hash;
+}
+
+/* splitmix64 */
+static uint64_t _next_random(uint64_t* state)
+{
+    uint64_t z = (*state += 0x9e3779b97f4a7c15);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+/* Returns -log2(x / 2^32) in 16.16 fixed point, for 0 < x < 2^32 */
+static uint64_t _neg_log2(uint32_t x)
+{
+    int msb = 31 - __builtin_clz(x);
+    uint64_t m = (uint64_t)x << (31 - msb); /* x / 2^msb in 1.31 fixed point */
+    uint64_t fraction = 0;
+
+    /* Each squaring of m yields the next bit of log2(m) */
+    for (int i = 15; i >= 0; i--)
+    {
+        m = (m * m) >> 31;
+
+        if (m >= ((uint64_t)2 << 31))
+        {
+            m >>= 1;
+            fraction |= (uint64_t)1 << i;
+        }
+    }
+
+    return ((uint64_t)(32 - msb) << 16) - fraction;
+}
+
+/* Draws the number of bytes until the next sample from the exponential
+ * distribution with the given mean */
+static uint64_t _pick_bytes_until_sample(sampler_t* sampler, uint64_t mean)
+{
+    uint32_t u = (uint32_t)(_next_random(&sampler->random) >> 32) | 1;
+
+    /* -ln(u) = -log2(u) * ln(2) */
+    return (((mean * _neg_log2(u)) >> 16) * LN2_FIXED >> 16) + 1;
+}
+
+/* Returns the bucket of the given stack, or NULL if out of memory. Called
+ * with the lock held. */
+static bucket_t* _get_bucket(void* const* addrs, size_t num_addrs)
+{
+    uint64_t hash = _hash_stack(addrs, num_addrs);
+    bucket_t** head = &_profile.buckets[hash & (NUM_BUCKET_HEADS - 1)];
+    bucket_t* bucket;
+
+    for (bucket = *head; bucket; bucket = bucket->next)
+    {
+        if (bucket->hash == hash && bucket->num_addrs == num_addrs &&
+            memcmp(bucket->addrs, addrs, num_addrs * sizeof(void*)) == 0)
+            return bucket;
+    }
+
+    if (!(bucket = (bucket_t*)oe_allocator_calloc(1, sizeof(bucket_t))))
+        return NULL;
+
+    bucket->hash = hash;
+    bucket->num_addrs = num_addrs;
+    memcpy(bucket->addrs, addrs, num_addrs * sizeof(void*));
+    bucket->next = *head;
+    *head = bucket;
+
+    return bucket;
+}
+
+OE_NEVER_INLINE
+static void _record_sample(void* ptr, size_t size)
+{
+    void* addrs[OE_BACKTRACE_MAX];
+    int num_addrs = oe_backtrace(addrs, OE_BACKTRACE_MAX);
+    size_t num_skipped = 0;
+    uint64_t hash = _hash_ptr(ptr);
+    sample_t* sample;
+    bucket_t* bucket;
+
+    if (num_addrs > NUM_SKIPPED_FRAMES)
+        num_skipped = NUM_SKIPPED_FRAMES;
+    else if (num_addrs > 0)
+        num_skipped = (size_t)num_addrs;
+
+    if (!(sample = (sample_t*)oe_allocator_malloc(sizeof(sample_t))))
+        return;
+
+    oe_spin_lock(&_profile.lock);
+
+    if (!(bucket = _get_bucket(
+              addrs + num_skipped,
+              (num_addrs > 0 ? (size_t)num_addrs : 0) - num_skipped)))
+    {
+        oe_spin_unlock(&_profile.lock);
+        oe_allocator_free(sample);
+        return;
+    }
+
+    bucket->num_live++;
+    bucket->live_bytes += size;
+    bucket->num_sampled++;
+    bucket->sampled_bytes += size;
+
+    sample->ptr = ptr;
+    sample->size = size;
+    sample->bucket = bucket;
+    sample->next = _profile.samples[hash & (NUM_SAMPLE_HEADS - 1)];
+    _profile.samples[hash & (NUM_SAMPLE_HEADS - 1)] = sample;
+
+    __atomic_add_fetch(
+        &_profile.filter[hash & (FILTER_SIZE - 1)], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&oe_heap_profile_num_live_samples, 1, __ATOMIC_RELEASE);
+
+    oe_spin_unlock(&_profile.lock);
+}
+
+OE_NEVER_INLINE
+void oe_heap_profile_sample_malloc(void* ptr, size_t size)
+{
+    sampler_t* sampler = &_sampler;
+    uint64_t mean =
+        __atomic_load_n(&oe_heap_profile_sampling_interval, __ATOMIC_RELAXED);
+
+    if (!sampler->initialized)
+    {
+        sampler->random =
+            __atomic_add_fetch(&_num_samplers, 1, __ATOMIC_RELAXED) ^
+            (uint64_t)sampler;
+        sampler->bytes_until_sample = _pick_bytes_until_sample(sampler, mean);
+        sampler->initialized = true;
+    }
+
+    if (size < sampler->bytes_until_sample)
+    {
+        sampler->bytes_until_sample -= size;
+        return;
+    }
+
+    sampler->bytes_until_sample = _pick_bytes_until_sample(sampler, mean);
+    _record_sample(ptr, size);
+}
+
+void oe_heap_profile_sample_free(void* ptr)
+{
+    uint64_t hash = _hash_ptr(ptr);
+    uint16_t* count = &_profile.filter[hash & (FILTER_SIZE - 1)];
+    sample_t** link;
+    sample_t* sample = NULL;
+
+    if (!__atomic_load_n(count, __ATOMIC_RELAXED))
+        return;
+
+    oe_spin_lock(&_profile.lock);
+
+    for (link = &_profile.samples[hash & (NUM_SAMPLE_HEADS - 1)]; *link;
+         link = &(*link)->next)
+    {
+        if ((*link)->ptr == ptr)
+        {
+            sample = *link;
+            *link = sample->next;
+            break;
+        }
+    }
+
+    if (sample)
+    {
+        sample->bucket->num_live--;
+        sample->bucket->live_bytes -= sample->size;
+
+        __atomic_sub_fetch(count, 1, __ATOMIC_RELAXED);
+        __atomic_sub_fetch(
+            &oe_heap_profile_num_live_samples, 1, __ATOMIC_RELAXED);
+    }
+
+    oe_spin_unlock(&_profile.lock);
+
+    oe_allocator_free(sample);
+}
+
+oe_result_t oe_heap_profile_start(size_t sampling_interval)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    uint16_t* filter = NULL;
+    sample_t** samples = NULL;
+    bucket_t** buckets = NULL;
+
+    /* Keeps the fixed-point arithmetic of the sampler within 64 bits */
+    if (sampling_interval > OE_UINT32_MAX)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (!sampling_interval)
+        sampling_interval = OE_HEAP_PROFILE_DEFAULT_SAMPLING_INTERVAL;
+
+    if (!__atomic_load_n(&_profile.filter, __ATOMIC_ACQUIRE))
+    {
+        filter = (uint16_t*)oe_allocator_calloc(FILTER_SIZE, sizeof(*filter));
+        samples = (sample_t**)oe_allocator_calloc(
+            NUM_SAMPLE_HEADS, sizeof(*samples));
+        buckets = (bucket_t**)oe_allocator_calloc(
+            NUM_BUCKET_HEADS, sizeof(*buckets));
+
+        if (!filter || !samples || !buckets)
+            OE_RAISE(OE_OUT_OF_MEMORY);
+    }
+
+    oe_spin_lock(&_profile.lock);
+
+    /* Another thread may have set up the tables in the meantime */
+    if (!_profile.filter && filter)
+    {
+        _profile.samples = samples;
+        _profile.buckets = buckets;
+        __atomic_store_n(&_profile.filter, filter, __ATOMIC_RELEASE);
+        filter = NULL;
+        samples = NULL;
+        buckets = NULL;
+    }
+
+    _profile.sampling_interval = sampling_interval;
+    __atomic_store_n(
+        &oe_heap_profile_sampling_interval,
+        sampling_interval,
+        __ATOMIC_RELEASE);
+
+    oe_spin_unlock(&_profile.lock);
+
+    result = OE_OK;
+
+done:
+    oe_allocator_free(filter);
+    oe_allocator_free(samples);
+    oe_allocator_free(buckets);
+
+    return result;
+}
+
+oe_result_t oe_heap_profile_stop(void)
+{
+    oe_result_t result = OE_UNEXPECTED;
+
+    if (!__atomic_load_n(&_profile.filter, __ATOMIC_ACQUIRE))
+        OE_RAISE_NO_TRACE(OE_NOT_FOUND);
+
+    __atomic_store_n(&oe_heap_profile_sampling_interval, 0, __ATOMIC_RELEASE);
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+typedef struct _writer
+{
+    char* buffer;
+    size_t buffer_size;
+    size_t offset;
+} writer_t;
+
+/* Appends to the buffer as far as it fits, and counts the whole output */
+static void _write(writer_t* writer, const char* format, ...)
+{
+    size_t remaining = writer->offset < writer->buffer_size
+                           ? writer->buffer_size - writer->offset
+                           : 0;
+    oe_va_list ap;
+    int n;
+
+    oe_va_start(ap, format);
+    n = oe_vsnprintf(
+        remaining ? writer->buffer + writer->offset : NULL,
+        remaining,
+        format,
+        ap);
+    oe_va_end(ap);
+
+    if (n > 0)
+        writer->offset += (size_t)n;
+}
+
+oe_result_t oe_heap_profile_write(
+    char* buffer,
+    size_t buffer_size,
+    size_t* profile_size)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    writer_t writer = {buffer, buffer_size, 0};
+    uint64_t num_live = 0;
+    uint64_t live_bytes = 0;
+    uint64_t num_sampled = 0;
+    uint64_t sampled_bytes = 0;
+
+    if (!profile_size || (buffer_size && !buffer))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (!__atomic_load_n(&_profile.filter, __ATOMIC_ACQUIRE))
+        OE_RAISE_NO_TRACE(OE_NOT_FOUND);
+
+    /* Do not raise errors below while holding the lock, since tracing
+     * could allocate memory */
+    oe_spin_lock(&_profile.lock);
+
+    for (size_t i = 0; i < NUM_BUCKET_HEADS; i++)
+    {
+        for (bucket_t* b = _profile.buckets[i]; b; b = b->next)
+        {
+            num_live += b->num_live;
+            live_bytes += b->live_bytes;
+            num_sampled += b->num_sampled;
+            sampled_bytes += b->sampled_bytes;
+        }
+    }
+
+    _write(
+        &writer,
+        "heap profile: %llu: %llu [%llu: %llu] @ heap_v2/%llu\n",
+        OE_LLU(num_live),
+        OE_LLU(live_bytes),
+        OE_LLU(num_sampled),
+        OE_LLU(sampled_bytes),
+        OE_LLU(_profile.sampling_interval));
+
+    for (size_t i = 0; i < NUM_BUCKET_HEADS; i++)
+    {
+        for (bucket_t* b = _profile.buckets[i]; b; b = b->next)
+        {
+            _write(
+                &writer,
+                "%llu: %llu [%llu: %llu] @",
+                OE_LLU(b->num_live),
+                OE_LLU(b->live_bytes),
+                OE_LLU(b->num_sampled),
+                OE_LLU(b->sampled_bytes));
+
+            for (size_t j = 0; j < b->num_addrs; j++)
+                _write(&writer, " 0x%llx", OE_LLX((uint64_t)b->addrs[j]));
+
+            _write(&writer, "\n");
+        }
+    }
+
+    oe_spin_unlock(&_profile.lock);
+
+    *profile_size = writer.offset + 1;
+
+    if (writer.offset >= buffer_size)
+        OE_RAISE_NO_TRACE(OE_BUFFER_TOO_SMALL);
+
+    result = OE_OK;
+
+done:
+    return result;
+}
@@ -0,0 +1,37 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#ifndef _OE_CORE_HEAPPROFILE_H
+#define _OE_CORE_HEAPPROFILE_H
+
+#include <openenclave/bits/defs.h>
+#include <openenclave/bits/types.h>
+
+/* The mean number of bytes between two samples, or zero if the heap
+ * profiler does not sample allocations */
+extern uint64_t oe_heap_profile_sampling_interval;
+
+/* The number of sampled allocations that are live */
+extern uint64_t oe_heap_profile_num_live_samples;
+
+void oe_heap_profile_sample_malloc(void* ptr, size_t size);
+
+void oe_heap_profile_sample_free(void* ptr);
+
+/* Called after ptr of size bytes was allocated */
+OE_INLINE void oe_heap_profile_malloc(void* ptr, size_t size)
+{
+    if (__atomic_load_n(&oe_heap_profile_sampling_interval, __ATOMIC_RELAXED) &&
+        ptr)
+        oe_heap_profile_sample_malloc(ptr, size);
+}
+
+/* Called before ptr is freed or reallocated */
+OE_INLINE void oe_heap_profile_free(void* ptr)
+{
+    if (__atomic_load_n(&oe_heap_profile_num_live_samples, __ATOMIC_ACQUIRE) &&
+        ptr)
+        oe_heap_profile_sample_free(ptr);
+}
+
+#endif /* _OE_CORE_HEAPPROFILE_H */
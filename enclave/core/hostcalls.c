@@ -52,7 +52,7 @@ oe_result_t _oe_write_ocall(int device, const char* str, size_t maxlen)
 }
 OE_WEAK_ALIAS(_oe_write_ocall, oe_write_ocall);
 
-void* oe_host_malloc(size_t size)
+void* oe_host_heap_malloc(size_t size)
 {
     uint64_t arg_in = size;
     uint64_t arg_out = 0;
@@ -74,6 +74,18 @@ void* oe_host_malloc(size_t size)
     return (void*)arg_out;
 }
 
+void* oe_host_malloc(size_t size)
+{
+    /* Allocate from the pool of host memory if the host allows it, which
+     * needs no OCALL, and fall back to the host's heap otherwise */
+    void* ptr = NULL;
+
+    if (oe_host_pool_backs_host_malloc())
+        ptr = oe_host_pool_malloc(size);
+
+    return ptr ? ptr : oe_host_heap_malloc(size);
+}
+
 oe_result_t _oe_realloc_ocall(void** retval, void* ptr, size_t size)
 {
     OE_UNUSED(retval);
@@ -91,6 +103,10 @@ void* oe_host_realloc(void* ptr, size_t size)
     if (!ptr)
         return oe_host_malloc(size);
 
+    /* Memory of the pool is reallocated without the host */
+    if (oe_host_pool_realloc(ptr, size, &retval))
+        return retval;
+
     if (oe_realloc_ocall(&retval, ptr, size) != OE_OK)
         return NULL;
 
@@ -105,6 +121,14 @@ void* oe_host_realloc(void* ptr, size_t size)
 
 void oe_host_free(void* ptr)
 {
+    if (!ptr || oe_host_pool_free(ptr))
+        return;
+
+    /* The enclave does not need to wait for the host to release the memory,
+     * so defer the OCALL to the next transition if possible */
+    if (oe_post_ocall(OE_OCALL_FREE, (uint64_t)ptr) == OE_OK)
+        return;
+
     oe_ocall(OE_OCALL_FREE, (uint64_t)ptr, NULL);
 }
 
@@ -10,6 +10,7 @@
 #include <openenclave/internal/raise.h>
 #include <openenclave/internal/safecrt.h>
 #include <openenclave/internal/utils.h>
+#include "heapprofile.h"
 
 static oe_allocation_failure_callback_t _failure_callback;
 
@@ -23,6 +24,8 @@ void* oe_malloc(size_t size)
 {
     void* p = oe_allocator_malloc(size);
 
+    oe_heap_profile_malloc(p, size);
+
     if (!p && size)
     {
         oe_errno = OE_ENOMEM;
@@ -35,6 +38,7 @@ void* oe_malloc(size_t size)
 
 void oe_free(void* ptr)
 {
+    oe_heap_profile_free(ptr);
     oe_allocator_free(ptr);
 }
 
@@ -42,6 +46,8 @@ void* oe_calloc(size_t nmemb, size_t size)
 {
     void* p = oe_allocator_calloc(nmemb, size);
 
+    oe_heap_profile_malloc(p, nmemb * size);
+
     if (!p && nmemb && size)
     {
         oe_errno = OE_ENOMEM;
@@ -54,7 +60,15 @@ void* oe_calloc(size_t nmemb, size_t size)
 
 void* oe_realloc(void* ptr, size_t size)
 {
-    void* p = oe_allocator_realloc(ptr, size);
+    void* p;
+
+    /* Forget a sampled block before the allocator may hand it out again. If
+     * the reallocation fails, the block is no longer tracked. */
+    oe_heap_profile_free(ptr);
+
+    p = oe_allocator_realloc(ptr, size);
+
+    oe_heap_profile_malloc(p, size);
 
     if (!p && size)
     {
@@ -97,6 +111,9 @@ int oe_posix_memalign(void** memptr, size_t alignment, size_t size)
 
     int rc = oe_allocator_posix_memalign(memptr, alignment, size);
 
+    if (rc == 0)
+        oe_heap_profile_malloc(*memptr, size);
+
     if (rc != 0 && size)
     {
         if (_failure_callback)
@@ -117,6 +134,7 @@ void* oe_aligned_alloc(size_t alignment, size_t size)
     else
     {
         ptr = oe_allocator_aligned_alloc(alignment, size);
+        oe_heap_profile_malloc(ptr, size);
         if (!ptr && size)
         {
             if (_failure_callback)
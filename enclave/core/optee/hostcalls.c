@@ -4,6 +4,7 @@
 #include <openenclave/corelibc/stdlib.h>
 #include <openenclave/edger8r/enclave.h>
 #include <openenclave/enclave.h>
+#include <openenclave/internal/calls.h>
 #include <openenclave/internal/safecrt.h>
 #include <openenclave/internal/safemath.h>
 
@@ -25,6 +26,76 @@ void oe_free_ocall_buffer(void* buffer)
     oe_free(buffer);
 }
 
+// OP-TEE has no transition the host could execute posted calls at.
+oe_result_t oe_post_ocall(uint16_t func, uint64_t arg_in)
+{
+    OE_UNUSED(func);
+    OE_UNUSED(arg_in);
+    return OE_UNSUPPORTED;
+}
+
+oe_result_t oe_post_host_function(
+    size_t function_id,
+    const void* input_buffer,
+    size_t input_buffer_size,
+    size_t output_buffer_size)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    size_t buffer_size = 0;
+    uint8_t* buffer = NULL;
+    size_t output_bytes_written = 0;
+
+    if (!input_buffer)
+        return OE_INVALID_PARAMETER;
+
+    if (oe_safe_add_sizet(input_buffer_size, output_buffer_size, &buffer_size))
+        return OE_INVALID_PARAMETER;
+
+    if (!(buffer = (uint8_t*)oe_allocate_ocall_buffer(buffer_size)))
+        return OE_OUT_OF_MEMORY;
+
+    oe_memcpy_s(buffer, buffer_size, input_buffer, input_buffer_size);
+
+    result = oe_call_host_function(
+        function_id,
+        buffer,
+        input_buffer_size,
+        buffer + input_buffer_size,
+        output_buffer_size,
+        &output_bytes_written);
+
+    oe_free_ocall_buffer(buffer);
+
+    return result;
+}
+
+// OP-TEE has no pool of host memory, so oe_host_malloc() always makes an
+// OCALL.
+void* oe_host_pool_malloc(size_t size)
+{
+    OE_UNUSED(size);
+    return NULL;
+}
+
+bool oe_host_pool_backs_host_malloc(void)
+{
+    return false;
+}
+
+bool oe_host_pool_free(void* ptr)
+{
+    OE_UNUSED(ptr);
+    return false;
+}
+
+bool oe_host_pool_realloc(void* ptr, size_t size, void** new_ptr)
+{
+    OE_UNUSED(ptr);
+    OE_UNUSED(size);
+    OE_UNUSED(new_ptr);
+    return false;
+}
+
 // TODO
 void* oe_allocate_arena(size_t capacity)
 {
@@ -3,8 +3,10 @@
 
 #include "arena.h"
 #include <openenclave/bits/sgx/writebarrier.h>
+#include <openenclave/corelibc/stdlib.h>
 #include <openenclave/corelibc/string.h>
 #include <openenclave/edger8r/common.h>
+#include <openenclave/edger8r/enclave.h>
 #include <openenclave/internal/print.h>
 #include <openenclave/internal/raise.h>
 #include <openenclave/internal/safemath.h>
@@ -12,11 +14,54 @@
 #include <openenclave/internal/thread.h>
 #include <openenclave/internal/utils.h>
 
-// Default shared memory arena capacity is 1 mb
+/*
+**==============================================================================
+**
+** Shared memory arena
+**
+**     Each thread allocates switchless ocall buffers from a bump allocator
+**     over a chain of host memory segments. The first segment is small, so
+**     that threads that make few switchless ocalls hold little host memory.
+**     When the newest segment is full, a segment twice its size is chained
+**     to it, until the arena holds _capacity bytes.
+**
+**     Objects are reclaimed in LIFO order: freeing the newest object rolls
+**     back its segment, along with any older objects that were freed out of
+**     order before. Once all objects are freed, only the newest (and
+**     largest) segment is kept.
+**
+**==============================================================================
+*/
+
+struct _oe_shared_memory_segment
+{
+    /* The next older segment */
+    oe_shared_memory_segment_t* prev;
+
+    /* Host memory of the segment */
+    uint8_t* buffer;
+    uint64_t capacity;
+    uint64_t used;
+};
+
+struct _oe_shared_memory_object
+{
+    uint8_t* ptr;
+    oe_shared_memory_segment_t* segment;
+    bool freed;
+};
+
+// Capacity of the first segment of a thread
+static const size_t _initial_capacity = 4 * OE_PAGE_SIZE;
+
+// Default capacity of all segments of a thread is 1 mb
 static size_t _capacity = 1024 * 1024;
 
 static const size_t _max_capacity = 1 << 30;
 
+// The high-water marks and grows of the arenas that have been torn down
+static oe_switchless_arena_statistics_t _statistics;
+
 void* oe_allocate_arena(size_t capacity);
 void oe_deallocate_arena(void* buffer);
 
@@ -36,32 +81,150 @@ bool oe_configure_arena_capacity(size_t cap)
     return true;
 }
 
-void* oe_arena_malloc(size_t size)
+static void _free_segment(
+    oe_shared_memory_arena_t* arena,
+    oe_shared_memory_segment_t* segment)
 {
-    oe_result_t result = OE_UNEXPECTED;
-    size_t total_size = 0;
-    const size_t align = OE_EDGER8R_BUFFER_ALIGNMENT;
-    oe_shared_memory_arena_t* arena = _get_arena();
+    arena->capacity -= segment->capacity;
+    oe_deallocate_arena(segment->buffer);
+    oe_free(segment);
+}
+
+// Free all segments but the newest one. The arena must be empty.
+static void _free_older_segments(oe_shared_memory_arena_t* arena)
+{
+    oe_shared_memory_segment_t* segment = arena->segment;
+    oe_shared_memory_segment_t* prev;
 
-    // Create the arena if it hasn't been created.
-    if (arena->buffer == NULL)
+    if (!segment)
+        return;
+
+    while ((prev = segment->prev))
+    {
+        segment->prev = prev->prev;
+        _free_segment(arena, prev);
+    }
+
+    segment->used = 0;
+    arena->used = 0;
+}
+
+// Add a segment that can hold size bytes, twice as large as the newest one.
+static oe_shared_memory_segment_t* _add_segment(
+    oe_shared_memory_arena_t* arena,
+    size_t size)
+{
+    oe_shared_memory_segment_t* segment = NULL;
+    size_t capacity = _initial_capacity;
+    size_t limit;
+
+    if (arena->segment)
     {
-        arena->capacity = __atomic_load_n(&_capacity, __ATOMIC_SEQ_CST);
-        if (size > arena->capacity)
+        capacity = arena->segment->capacity * 2;
+
+        // An empty arena trades its segment for a larger one.
+        if (arena->num_objects == 0)
         {
-            arena->capacity = oe_round_up_to_multiple(size, OE_PAGE_SIZE);
+            _free_segment(arena, arena->segment);
+            arena->segment = NULL;
         }
+    }
 
-        void* buffer = oe_allocate_arena(arena->capacity);
-        if (buffer == NULL)
-        {
-            arena->capacity = 0;
+    limit = __atomic_load_n(&_capacity, __ATOMIC_SEQ_CST);
+    limit = limit > arena->capacity ? limit - arena->capacity : 0;
+
+    if (capacity > limit)
+        capacity = limit;
+
+    if (capacity < size)
+    {
+        // Only an empty arena may exceed its capacity, to hold one object.
+        if (arena->num_objects != 0 || size > _max_capacity)
             return NULL;
-        }
-        arena->buffer = (uint8_t*)buffer;
-        arena->used = 0;
+
+        capacity = oe_round_up_to_multiple(size, OE_PAGE_SIZE);
+    }
+
+    if (!(segment = (oe_shared_memory_segment_t*)oe_malloc(sizeof(*segment))))
+        return NULL;
+
+    if (!(segment->buffer = (uint8_t*)oe_allocate_arena(capacity)))
+    {
+        oe_free(segment);
+        return NULL;
+    }
+
+    segment->prev = arena->segment;
+    segment->capacity = capacity;
+    segment->used = 0;
+
+    arena->segment = segment;
+    arena->capacity += capacity;
+
+    if (arena->num_objects != 0)
+        arena->num_grows++;
+
+    return segment;
+}
+
+static bool _push_object(
+    oe_shared_memory_arena_t* arena,
+    uint8_t* ptr,
+    oe_shared_memory_segment_t* segment)
+{
+    oe_shared_memory_object_t* object;
+
+    if (arena->num_objects == arena->max_objects)
+    {
+        size_t max_objects = arena->max_objects ? arena->max_objects * 2 : 8;
+        oe_shared_memory_object_t* objects = (oe_shared_memory_object_t*)
+            oe_realloc(arena->objects, max_objects * sizeof(*objects));
+
+        if (!objects)
+            return false;
+
+        arena->objects = objects;
+        arena->max_objects = max_objects;
+    }
+
+    object = &arena->objects[arena->num_objects++];
+    object->ptr = ptr;
+    object->segment = segment;
+    object->freed = false;
+
+    if (arena->num_objects > arena->max_num_objects)
+        arena->max_num_objects = arena->num_objects;
+
+    return true;
+}
+
+// Roll back the segments over the freed objects at the top of the arena.
+static void _pop_freed_objects(oe_shared_memory_arena_t* arena)
+{
+    while (arena->num_objects != 0 &&
+           arena->objects[arena->num_objects - 1].freed)
+    {
+        oe_shared_memory_object_t* object =
+            &arena->objects[--arena->num_objects];
+        oe_shared_memory_segment_t* segment = object->segment;
+        uint64_t used = (uint64_t)(object->ptr - segment->buffer);
+
+        arena->used -= segment->used - used;
+        segment->used = used;
     }
 
+    if (arena->num_objects == 0)
+        _free_older_segments(arena);
+}
+
+void* oe_arena_malloc(size_t size)
+{
+    size_t total_size = 0;
+    const size_t align = OE_EDGER8R_BUFFER_ALIGNMENT;
+    oe_shared_memory_arena_t* arena = _get_arena();
+    oe_shared_memory_segment_t* segment = arena->segment;
+    uint8_t* addr;
+
     // Round up to the nearest alignment size.
     total_size = oe_round_up_to_multiple(size, align);
 
@@ -69,42 +232,25 @@ void* oe_arena_malloc(size_t size)
     if (total_size < size)
         return NULL;
 
-    // check for capacity
-    size_t used_after;
-    OE_CHECK(oe_safe_add_sizet(arena->used, total_size, &used_after));
-
-    // Ok if the incoming malloc puts us below the capacity.
-    if (used_after <= arena->capacity)
+    // Chain a new segment if the newest one is full.
+    if (!segment || segment->capacity - segment->used < total_size)
     {
-        uint8_t* addr = arena->buffer + arena->used;
-        arena->used = used_after;
-        return addr;
-    }
-    else
-    {
-        // If the arena does not contain any objects, then
-        // it is safe to resize the arena.
-        if (arena->used == 0)
-        {
-            void* buffer = arena->buffer;
-            arena->buffer = NULL;
-            oe_deallocate_arena(buffer);
-            arena->capacity = 0;
-            return oe_arena_malloc(size);
-        }
-        else
-        {
-            // Currently there are no scenarios where multiple objects are
-            // allocated in the arena. Hence, control will not reach here.
-            // In case, in future, the area is used for allocating multiple
-            // objects, the control can reach here. In such a case, the current
-            // behavior is preserved and the switchless call will fail.
-            // This can be handled in the future.
-        }
+        if (!(segment = _add_segment(arena, total_size)))
+            return NULL;
     }
 
-done:
-    return NULL;
+    addr = segment->buffer + segment->used;
+
+    if (!_push_object(arena, addr, segment))
+        return NULL;
+
+    segment->used += total_size;
+    arena->used += total_size;
+
+    if (arena->used > arena->max_used)
+        arena->max_used = arena->used;
+
+    return addr;
 }
 
 void* oe_arena_calloc(size_t num, size_t size)
@@ -121,18 +267,97 @@ void* oe_arena_calloc(size_t num, size_t size)
     return ptr;
 }
 
+// Returns false if the object was not allocated from the arena of the
+// current thread. Objects are usually freed in LIFO order, so the search
+// starts from the newest one.
+bool oe_arena_free(void* ptr)
+{
+    oe_shared_memory_arena_t* arena = _get_arena();
+    size_t i = arena->num_objects;
+
+    if (!ptr)
+        return false;
+
+    while (i > 0)
+    {
+        oe_shared_memory_object_t* object = &arena->objects[--i];
+
+        if (object->ptr == (uint8_t*)ptr && !object->freed)
+        {
+            object->freed = true;
+            _pop_freed_objects(arena);
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void oe_arena_free_all()
 {
     oe_shared_memory_arena_t* arena = _get_arena();
-    arena->used = 0;
+    arena->num_objects = 0;
+    _free_older_segments(arena);
 }
 
-// Free the arena in the current thread.
+static void _update_max(uint64_t* max, uint64_t value)
+{
+    uint64_t old = __atomic_load_n(max, __ATOMIC_RELAXED);
+
+    while (value > old &&
+           !__atomic_compare_exchange_n(
+               max, &old, value, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+// Free the arena in the current thread. Its statistics are kept in
+// _statistics, since the arena is reset for the next ECALL.
 void oe_teardown_arena()
 {
     oe_shared_memory_arena_t* arena = _get_arena();
+    oe_shared_memory_segment_t* segment;
+
+    if (arena->max_num_objects)
+    {
+        _update_max(&_statistics.max_used, arena->max_used);
+        _update_max(&_statistics.max_num_objects, arena->max_num_objects);
+        __atomic_fetch_add(
+            &_statistics.num_grows, arena->num_grows, __ATOMIC_RELAXED);
+    }
 
-    if (arena->buffer != NULL)
-        oe_deallocate_arena(arena->buffer);
+    while ((segment = arena->segment))
+    {
+        arena->segment = segment->prev;
+        _free_segment(arena, segment);
+    }
+
+    oe_free(arena->objects);
     memset(arena, 0, sizeof(oe_shared_memory_arena_t));
 }
+
+oe_result_t oe_get_switchless_arena_statistics(
+    oe_switchless_arena_statistics_t* statistics)
+{
+    const oe_shared_memory_arena_t* arena = _get_arena();
+
+    if (!statistics)
+        return OE_INVALID_PARAMETER;
+
+    statistics->max_used =
+        __atomic_load_n(&_statistics.max_used, __ATOMIC_RELAXED);
+    statistics->max_num_objects =
+        __atomic_load_n(&_statistics.max_num_objects, __ATOMIC_RELAXED);
+    statistics->num_grows =
+        __atomic_load_n(&_statistics.num_grows, __ATOMIC_RELAXED);
+
+    // Add the arena of the calling thread, which is still in use.
+    if (arena->max_used > statistics->max_used)
+        statistics->max_used = arena->max_used;
+
+    if (arena->max_num_objects > statistics->max_num_objects)
+        statistics->max_num_objects = arena->max_num_objects;
+
+    statistics->num_grows += arena->num_grows;
+
+    return OE_OK;
+}
@@ -12,6 +12,8 @@ void* oe_arena_malloc(size_t size);
 
 void* oe_arena_calloc(size_t num, size_t size);
 
+bool oe_arena_free(void* ptr);
+
 void oe_arena_free_all();
 
 void oe_teardown_arena();
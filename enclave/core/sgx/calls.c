@@ -3,6 +3,7 @@
 
 #include "../calls.h"
 #include <openenclave/advanced/allocator.h>
+#include <openenclave/advanced/heapprofile.h>
 #include <openenclave/attestation/attester.h>
 #include <openenclave/attestation/verifier.h>
 #include <openenclave/bits/sgx/sgxtypes.h>
@@ -36,6 +37,7 @@
 #include "core_t.h"
 #include "cpuid.h"
 #include "handle_ecall.h"
+#include "hostpool.h"
 #include "init.h"
 #include "openenclave/bits/result.h"
 #include "openenclave/internal/backtrace.h"
@@ -213,6 +215,105 @@ done:
     return result;
 }
 
+/*
+**==============================================================================
+**
+** ECALL marshaling buffers
+**
+**     The input and output parameters of an ECALL are copied into a buffer
+**     in enclave memory. Rather than allocating that buffer for every call,
+**     each thread keeps it in oe_sgx_td_t.ecall_buffer and grows it on
+**     demand. The buffer is detached from the thread data while it is in
+**     use, so a nested call (e.g., a switchless ECALL handled by an enclave
+**     worker thread) allocates a buffer of its own.
+**
+**     The cached buffer is kept across ECALLs, so that it is also reused by
+**     the functions of an ECALL batch and by the switchless ECALLs of an
+**     enclave worker. Its capacity is rounded up to whole pages rather than
+**     to a power of two, and buffers larger than
+**     OE_MAX_CACHED_ECALL_BUFFER_SIZE are not cached, which bounds the
+**     enclave heap held by each thread. The buffers of all threads are freed
+**     by the enclave destructor (see td_register_caches()).
+**
+**==============================================================================
+*/
+
+#define OE_MAX_CACHED_ECALL_BUFFER_SIZE (64 * 1024)
+
+static uint8_t* _get_ecall_buffer(
+    oe_sgx_td_t* td,
+    size_t size,
+    size_t* buffer_size)
+{
+    uint8_t* buffer = NULL;
+    size_t capacity = 0;
+
+    *buffer_size = 0;
+
+    if (size > OE_MAX_CACHED_ECALL_BUFFER_SIZE)
+    {
+        if ((buffer = oe_malloc(size)))
+            *buffer_size = size;
+
+        return buffer;
+    }
+
+    /* Detach the cached buffer from the thread data */
+    buffer = td->ecall_buffer;
+    capacity = td->ecall_buffer_size;
+    td->ecall_buffer = NULL;
+    td->ecall_buffer_size = 0;
+
+    if (!buffer || capacity < size)
+    {
+        oe_free(buffer);
+
+        capacity = oe_round_up_to_page_size(size ? size : 1);
+
+        if (!(buffer = oe_malloc(capacity)))
+            return NULL;
+    }
+
+    *buffer_size = capacity;
+    return buffer;
+}
+
+static void _put_ecall_buffer(
+    oe_sgx_td_t* td,
+    uint8_t* buffer,
+    size_t buffer_size)
+{
+    if (buffer_size > OE_MAX_CACHED_ECALL_BUFFER_SIZE)
+    {
+        oe_free(buffer);
+        return;
+    }
+
+    /* A nested call may have cached its buffer meanwhile. Keep the larger
+     * of the two */
+    if (td->ecall_buffer)
+    {
+        if (td->ecall_buffer_size >= buffer_size)
+        {
+            oe_free(buffer);
+            return;
+        }
+
+        oe_free(td->ecall_buffer);
+    }
+
+    td->ecall_buffer = buffer;
+    td->ecall_buffer_size = buffer_size;
+    td_register_caches(td);
+}
+
+static void _free_ecall_buffer(oe_sgx_td_t* td)
+{
+    oe_free(td->ecall_buffer);
+    td->ecall_buffer = NULL;
+    td->ecall_buffer_size = 0;
+}
+
 /**
  * This is the preferred way to call enclave functions.
  */
@@ -226,8 +327,10 @@ oe_result_t oe_handle_call_enclave_function(uint64_t arg_in)
     uint8_t* input_buffer = NULL;
     uint8_t* output_buffer = NULL;
     size_t buffer_size = 0;
+    size_t buffer_capacity = 0;
     size_t output_bytes_written = 0;
     ecall_table_t ecall_table;
+    oe_sgx_td_t* td = oe_sgx_get_td();
 
     // Ensure that args lies outside the enclave and is 8-byte aligned
     // (against the xAPIC vulnerability).
@@ -284,8 +387,9 @@ oe_result_t oe_handle_call_enclave_function(uint64_t arg_in)
     if (func == NULL)
         OE_RAISE(OE_NOT_FOUND);
 
-    // Allocate buffers in enclave memory
-    buffer = input_buffer = oe_malloc(buffer_size);
+    // Get the buffers in enclave memory
+    buffer = input_buffer =
+        _get_ecall_buffer(td, buffer_size, &buffer_capacity);
     if (buffer == NULL)
         OE_RAISE(OE_OUT_OF_MEMORY);
 
@@ -294,7 +398,9 @@ oe_result_t oe_handle_call_enclave_function(uint64_t arg_in)
 
     // Clear out output buffer.
     // This ensures reproducible behavior if say the function is reading from
-    // output buffer.
+    // output buffer. As the buffer is reused and the whole output region is
+    // copied to the host, this also keeps data of previous ECALLs from
+    // leaking to the host.
     output_buffer = buffer + args.input_buffer_size;
     memset(output_buffer, 0, args.output_buffer_size);
 
@@ -346,8 +452,10 @@ oe_result_t oe_handle_call_enclave_function(uint64_t arg_in)
                     return_args_ptr->deepcopy_out_buffer_size))
                 OE_RAISE(OE_UNEXPECTED);
 
-            void* host_buffer =
-                oe_host_malloc(return_args_ptr->deepcopy_out_buffer_size);
+            /* The host releases the buffer with free(), so it must not come
+             * from the pool of host memory */
+            void* host_buffer = oe_host_heap_malloc(
+                return_args_ptr->deepcopy_out_buffer_size);
 
             /* Copy the deep-copied content to host memory. */
             OE_CHECK(oe_memcpy_s_with_barrier(
@@ -390,8 +498,130 @@ done:
     }
 
     if (buffer)
-        oe_free(buffer);
+        _put_ecall_buffer(td, buffer, buffer_capacity);
+
+    return result;
+}
+
+/*
+**==============================================================================
+**
+** _handle_call_enclave_function_batch()
+**
+**     Handle an OE_ECALL_CALL_ENCLAVE_FUNCTION_BATCH by calling
+**     oe_handle_call_enclave_function() for each of the calls in the batch.
+**     Calls are independent of each other. The result of each call is written
+**     to its own arguments.
+**
+**==============================================================================
+*/
+
+static oe_result_t _handle_call_enclave_function_batch(uint64_t arg_in)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_call_enclave_function_batch_args_t args;
+    oe_call_enclave_function_args_t* calls = NULL;
+    uint64_t calls_size = 0;
+
+    // Ensure that args lies outside the enclave and is 8-byte aligned
+    // (against the xAPIC vulnerability).
+    if (!oe_is_outside_enclave(
+            (void*)arg_in, sizeof(oe_call_enclave_function_batch_args_t)) ||
+        (arg_in % 8) != 0)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    // Copy args to enclave memory to avoid TOCTOU issues.
+    oe_memcpy_aligned(
+        &args, (void*)arg_in, sizeof(oe_call_enclave_function_batch_args_t));
+
+    calls = args.calls;
+
+    // Ensure that the array of calls lies outside the enclave and is 8-byte
+    // aligned, so that the result of each call can be written back. The
+    // elements themselves are validated by oe_handle_call_enclave_function().
+    OE_CHECK(oe_safe_mul_u64(
+        args.num_calls, sizeof(oe_call_enclave_function_args_t), &calls_size));
+
+    if (!oe_is_outside_enclave(calls, calls_size) ||
+        ((uint64_t)calls % 8) != 0)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    for (uint64_t i = 0; i < args.num_calls; i++)
+    {
+        oe_result_t call_result =
+            oe_handle_call_enclave_function((uint64_t)&calls[i]);
+
+        if (call_result != OE_OK)
+            OE_WRITE_VALUE_WITH_BARRIER(&calls[i].result, call_result);
+    }
+
+    result = OE_OK;
+
+done:
+    return result;
+}
 
+/*
+**==============================================================================
+**
+** _handle_get_heap_profile()
+**
+**     Handle an OE_ECALL_GET_HEAP_PROFILE by writing the heap profile to the
+**     host buffer. The profile is staged in enclave memory first, so that a
+**     profile that does not fit is never partially written to the host.
+**
+**==============================================================================
+*/
+
+static oe_result_t _handle_get_heap_profile(uint64_t arg_in)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_get_heap_profile_args_t* args_host = (oe_get_heap_profile_args_t*)arg_in;
+    oe_get_heap_profile_args_t args;
+    char* profile = NULL;
+    size_t capacity = 0;
+    size_t profile_size = 0;
+
+    // Ensure that args lies outside the enclave and is 8-byte aligned
+    // (against the xAPIC vulnerability).
+    if (!oe_is_outside_enclave(args_host, sizeof(*args_host)) ||
+        (arg_in % 8) != 0)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    // Copy args to enclave memory to avoid TOCTOU issues.
+    oe_memcpy_aligned(&args, args_host, sizeof(args));
+
+    if (args.buffer_size &&
+        !oe_is_outside_enclave(args.buffer, args.buffer_size))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    oe_lfence();
+
+    // The profile may grow between measuring and writing it.
+    while ((result = oe_heap_profile_write(profile, capacity, &profile_size)) ==
+           OE_BUFFER_TOO_SMALL)
+    {
+        if (profile_size > args.buffer_size)
+            break;
+
+        oe_allocator_free(profile);
+        capacity = profile_size;
+
+        if (!(profile = (char*)oe_allocator_malloc(capacity)))
+            OE_RAISE(OE_OUT_OF_MEMORY);
+    }
+
+    if (result != OE_OK && result != OE_BUFFER_TOO_SMALL)
+        OE_RAISE(result);
+
+    if (result == OE_OK)
+        OE_CHECK(oe_memcpy_s_with_barrier(
+            args.buffer, args.buffer_size, profile, profile_size));
+
+    OE_WRITE_VALUE_WITH_BARRIER(&args_host->profile_size, profile_size);
+
+done:
+    oe_allocator_free(profile);
     return result;
 }
 
@@ -469,6 +699,12 @@ static oe_result_t _enclave_destructor(void)
         /* Cleanup verifiers */
         oe_verifier_shutdown();
 
+        /* Free the ECALL marshaling buffers that threads keep */
+        td_free_caches(_free_ecall_buffer);
+
+        /* Free the bookkeeping of the pool of host memory */
+        oe_host_pool_cleanup();
+
         /* If memory still allocated, print a trace and return an error */
         OE_CHECK(oe_check_memory_leaks());
 
@@ -495,6 +731,8 @@ done:
 **==============================================================================
 */
 
+static void _release_switchless_calls(oe_sgx_td_t* td);
+
 static void _handle_ecall(
     oe_sgx_td_t* td,
     uint16_t func,
@@ -565,6 +803,11 @@ static void _handle_ecall(
             arg_out = oe_handle_call_enclave_function(arg_in);
             break;
         }
+        case OE_ECALL_CALL_ENCLAVE_FUNCTION_BATCH:
+        {
+            arg_out = _handle_call_enclave_function_batch(arg_in);
+            break;
+        }
         case OE_ECALL_CALL_AT_EXIT_FUNCTIONS:
         {
             _call_at_exit_functions();
@@ -591,6 +834,16 @@ static void _handle_ecall(
             arg_out = _handle_init_enclave(arg_in);
             break;
         }
+        case OE_ECALL_INIT_HOST_MEMORY_POOL:
+        {
+            arg_out = oe_handle_init_host_memory_pool(arg_in);
+            break;
+        }
+        case OE_ECALL_GET_HEAP_PROFILE:
+        {
+            arg_out = _handle_get_heap_profile(arg_in);
+            break;
+        }
         default:
         {
             /* No function found with the number */
@@ -604,6 +857,7 @@ done:
     /* Free shared memory arena before we clear TLS */
     if (td->depth == 1)
     {
+        _release_switchless_calls(td);
         oe_teardown_arena();
     }
 
@@ -856,24 +1110,31 @@ done:
 /*
 **==============================================================================
 **
-** oe_call_host_function_by_table_id()
+** _prepare_host_function_call()
+**
+**     Validate the buffers of a host function call and write its arguments
+**     to host memory. The arguments of switchless calls are allocated from the
+**     arena since oe_post_switchless_ocall() may make a regular OCALL (which
+**     uses the ecall context's arguments) to wake up the host worker. If the
+**     arena is exhausted, *switchless is cleared and the call must be made as
+**     a regular OCALL.
 **
 **==============================================================================
 */
 
-oe_result_t oe_call_host_function_internal(
+static oe_result_t _prepare_host_function_call(
     uint64_t function_id,
     const void* input_buffer,
     size_t input_buffer_size,
     void* output_buffer,
     size_t output_buffer_size,
-    size_t* output_bytes_written,
-    bool switchless)
+    bool* switchless,
+    oe_call_host_function_args_t** args_host_ptr_out)
 {
     oe_result_t result = OE_UNEXPECTED;
     oe_call_host_function_args_t args, *args_host_ptr = NULL;
-    oe_call_function_return_args_t return_args, *return_args_host_ptr = NULL;
-    uint64_t host_result = 0;
+
+    *args_host_ptr_out = NULL;
 
     /* Ensure input buffer is outside the enclave memory and its size is valid
      */
@@ -889,14 +1150,17 @@ oe_result_t oe_call_host_function_internal(
         ((uint64_t)output_buffer % 8) != 0)
         OE_RAISE(OE_INVALID_PARAMETER);
 
-    /*
-     * oe_post_switchless_ocall (below) can make a regular ocall to wake up the
-     * host worker thread, and will end up using the ecall context's args.
-     * Therefore, for switchless calls, allocate args in the arena so that it is
-     * is not overwritten by oe_post_switchless_ocall.
-     */
-    args_host_ptr =
-        (oe_call_host_function_args_t*)(switchless ? oe_arena_malloc(sizeof(*args_host_ptr)) : oe_ecall_context_get_ocall_args());
+    if (*switchless)
+    {
+        args_host_ptr = (oe_call_host_function_args_t*)oe_arena_malloc(
+            sizeof(*args_host_ptr));
+
+        if (!args_host_ptr)
+            *switchless = false;
+    }
+
+    if (!*switchless)
+        args_host_ptr = oe_ecall_context_get_ocall_args();
 
     /* Ensure the args_host_ptr is valid and 8-byte aligned (for xAPIC
      * vulnerability mitigation) */
@@ -921,40 +1185,57 @@ oe_result_t oe_call_host_function_internal(
     OE_CHECK(oe_memcpy_s_with_barrier(
         args_host_ptr, sizeof(*args_host_ptr), &args, sizeof(args)));
 
-    /* Call the host function with this address */
-    if (switchless && oe_is_switchless_initialized())
-    {
-        oe_result_t post_result = oe_post_switchless_ocall(args_host_ptr);
+    *args_host_ptr_out = args_host_ptr;
+    args_host_ptr = NULL;
+    result = OE_OK;
 
-        // Fall back to regular OCALL if host worker threads are unavailable
-        if (post_result == OE_CONTEXT_SWITCHLESS_OCALL_MISSED)
-            OE_CHECK(oe_ocall(
-                OE_OCALL_CALL_HOST_FUNCTION, (uint64_t)args_host_ptr, NULL));
-        else
-        {
-            OE_CHECK(post_result);
-            // Wait until args.result is set by the host worker.
-            while (true)
-            {
-                OE_ATOMIC_MEMORY_BARRIER_ACQUIRE();
+done:
+    if (args_host_ptr && *switchless)
+        oe_arena_free(args_host_ptr);
 
-                /* The member result is alignend given that args_host_ptr is
-                 * aligned and its size is 8-byte (for xAPIC vulnerability
-                 * mitigation). */
-                if (__atomic_load_n(&args_host_ptr->result, __ATOMIC_SEQ_CST) !=
-                    OE_UINT64_MAX)
-                    break;
+    return result;
+}
 
-                /* Yield to CPU */
-                asm volatile("pause");
-            }
-        }
-    }
-    else
-    {
-        OE_CHECK(oe_ocall(
-            OE_OCALL_CALL_HOST_FUNCTION, (uint64_t)args_host_ptr, NULL));
-    }
+/* Whether the host worker has completed a posted switchless call */
+static bool _is_host_function_call_completed(
+    oe_call_host_function_args_t* args_host_ptr)
+{
+    OE_ATOMIC_MEMORY_BARRIER_ACQUIRE();
+
+    /* The member result is alignend given that args_host_ptr is aligned and
+     * its size is 8-byte (for xAPIC vulnerability mitigation). */
+    return __atomic_load_n(&args_host_ptr->result, __ATOMIC_SEQ_CST) !=
+           OE_UINT64_MAX;
+}
+
+/* Wait until the host worker has completed a posted switchless call. The
+ * thread spins for a while, then sleeps in the host until the call has
+ * completed (see oe_wait_switchless_ocall()). */
+static void _wait_host_function_call(
+    oe_call_host_function_args_t* args_host_ptr)
+{
+    oe_wait_switchless_ocall(args_host_ptr);
+}
+
+/*
+**==============================================================================
+**
+** _complete_host_function_call()
+**
+**     Check the result of a host function call that has been performed and
+**     copy its deep-copied outputs into the enclave.
+**
+**==============================================================================
+*/
+
+static oe_result_t _complete_host_function_call(
+    oe_call_host_function_args_t* args_host_ptr,
+    void* output_buffer,
+    size_t* output_bytes_written)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_call_function_return_args_t return_args, *return_args_host_ptr = NULL;
+    uint64_t host_result = 0;
 
     /* Copy the result from the host memory
      * The member result is aligned given that args_host_ptr is aligned
@@ -1066,6 +1347,287 @@ done:
     return result;
 }
 
+/*
+**==============================================================================
+**
+** oe_call_host_function_by_table_id()
+**
+**==============================================================================
+*/
+
+oe_result_t oe_call_host_function_internal(
+    uint64_t function_id,
+    const void* input_buffer,
+    size_t input_buffer_size,
+    void* output_buffer,
+    size_t output_buffer_size,
+    size_t* output_bytes_written,
+    bool switchless)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_call_host_function_args_t* args_host_ptr = NULL;
+
+    /* Make regular calls of host functions that the host promoted as
+     * switchless calls (see oe_is_switchless_ocall_promoted()) */
+    if (!switchless && oe_is_switchless_ocall_promoted(function_id))
+        switchless = true;
+
+    /* Posted calls are performed at the next transition of this thread, which
+     * a switchless call does not make. Make a regular OCALL instead, which
+     * performs them first, so that the calls stay in order */
+    if (switchless && oe_ecall_context_has_posted_calls())
+        switchless = false;
+
+    OE_CHECK(_prepare_host_function_call(
+        function_id,
+        input_buffer,
+        input_buffer_size,
+        output_buffer,
+        output_buffer_size,
+        &switchless,
+        &args_host_ptr));
+
+    /* Call the host function with this address */
+    if (switchless && oe_is_switchless_initialized())
+    {
+        oe_result_t post_result = oe_post_switchless_ocall(args_host_ptr);
+
+        // Fall back to regular OCALL if host worker threads are unavailable
+        if (post_result == OE_CONTEXT_SWITCHLESS_OCALL_MISSED)
+            OE_CHECK(oe_ocall(
+                OE_OCALL_CALL_HOST_FUNCTION, (uint64_t)args_host_ptr, NULL));
+        else
+        {
+            OE_CHECK(post_result);
+            // Wait until args.result is set by the host worker.
+            _wait_host_function_call(args_host_ptr);
+        }
+    }
+    else
+    {
+        OE_CHECK(oe_ocall(
+            OE_OCALL_CALL_HOST_FUNCTION, (uint64_t)args_host_ptr, NULL));
+    }
+
+    OE_CHECK(_complete_host_function_call(
+        args_host_ptr, output_buffer, output_bytes_written));
+
+    result = OE_OK;
+
+done:
+    if (switchless && args_host_ptr)
+        oe_arena_free(args_host_ptr);
+
+    return result;
+}
+
+/*
+**==============================================================================
+**
+** Asynchronous switchless host function calls
+**
+**     oe_switchless_call_host_function_async() posts a host function call to
+**     a host worker thread and returns without waiting for it. The caller
+**     polls the returned handle with oe_switchless_call_test() and must
+**     eventually release it with oe_switchless_call_wait(), which also checks
+**     the result of the call and copies its deep-copied outputs. The input
+**     and output buffers must remain valid until then.
+**
+**     If no host worker is available or calls posted with
+**     oe_post_host_function() are pending, the call is performed
+**     synchronously as a regular OCALL and the returned handle is already
+**     completed.
+**
+**     The arguments of a call live in the arena of the calling thread, which
+**     is torn down when the top-level ECALL returns. Each thread therefore
+**     keeps its outstanding calls in oe_sgx_td_t.switchless_calls. Calls
+**     that are left when the top-level ECALL returns are waited for, so that
+**     the host no longer writes to the arena, and released (see
+**     _release_switchless_calls()). Handles cannot be used by other threads.
+**
+**==============================================================================
+*/
+
+struct _oe_switchless_call
+{
+    /* The thread that started the call and its other outstanding calls */
+    oe_sgx_td_t* td;
+    struct _oe_switchless_call* prev;
+    struct _oe_switchless_call* next;
+
+    /* Arguments in host memory (allocated from the arena) */
+    oe_call_host_function_args_t* args_host_ptr;
+
+    /* The output buffer as passed by the caller. The copy in args_host_ptr
+     * is controlled by the host */
+    void* output_buffer;
+
+    /* Whether the call has been posted to a host worker */
+    bool posted;
+
+    /* The result of the OCALL if the call was performed synchronously */
+    oe_result_t ocall_result;
+};
+
+static void _track_switchless_call(oe_switchless_call_t* call)
+{
+    oe_sgx_td_t* td = oe_sgx_get_td();
+
+    call->td = td;
+    call->prev = NULL;
+    call->next = td->switchless_calls;
+
+    if (call->next)
+        call->next->prev = call;
+
+    td->switchless_calls = call;
+}
+
+static void _untrack_switchless_call(oe_switchless_call_t* call)
+{
+    if (call->prev)
+        call->prev->next = call->next;
+    else
+        call->td->switchless_calls = call->next;
+
+    if (call->next)
+        call->next->prev = call->prev;
+}
+
+/* Wait for and release the calls that the thread has not waited for */
+static void _release_switchless_calls(oe_sgx_td_t* td)
+{
+    while (td->switchless_calls)
+    {
+        oe_switchless_call_t* call = td->switchless_calls;
+
+        if (call->posted)
+            _wait_host_function_call(call->args_host_ptr);
+
+        _untrack_switchless_call(call);
+        oe_arena_free(call->args_host_ptr);
+        oe_free(call);
+    }
+}
+
+oe_result_t oe_switchless_call_host_function_async(
+    size_t function_id,
+    const void* input_buffer,
+    size_t input_buffer_size,
+    void* output_buffer,
+    size_t output_buffer_size,
+    oe_switchless_call_t** call_out)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_switchless_call_t* call = NULL;
+    oe_call_host_function_args_t* args_host_ptr = NULL;
+    bool switchless = true;
+
+    if (call_out)
+        *call_out = NULL;
+
+    if (!call_out)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (!(call = (oe_switchless_call_t*)oe_calloc(1, sizeof(*call))))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    OE_CHECK(_prepare_host_function_call(
+        function_id,
+        input_buffer,
+        input_buffer_size,
+        output_buffer,
+        output_buffer_size,
+        &switchless,
+        &args_host_ptr));
+
+    /* Without a copy in the arena, the arguments would be overwritten by the
+     * next regular OCALL of this thread */
+    if (!switchless)
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    call->args_host_ptr = args_host_ptr;
+    call->output_buffer = output_buffer;
+
+    /* Perform pending posted calls first (see
+     * oe_call_host_function_internal()) */
+    if (oe_is_switchless_initialized() && !oe_ecall_context_has_posted_calls())
+    {
+        oe_result_t post_result = oe_post_switchless_ocall(args_host_ptr);
+
+        if (post_result == OE_OK)
+            call->posted = true;
+        else if (post_result != OE_CONTEXT_SWITCHLESS_OCALL_MISSED)
+            OE_RAISE(post_result);
+    }
+
+    if (!call->posted)
+        call->ocall_result = oe_ocall(
+            OE_OCALL_CALL_HOST_FUNCTION, (uint64_t)args_host_ptr, NULL);
+
+    _track_switchless_call(call);
+    *call_out = call;
+    call = NULL;
+    result = OE_OK;
+
+done:
+    if (call)
+    {
+        if (args_host_ptr)
+            oe_arena_free(args_host_ptr);
+
+        oe_free(call);
+    }
+
+    return result;
+}
+
+oe_result_t oe_switchless_call_test(
+    oe_switchless_call_t* call,
+    bool* completed)
+{
+    if (!call || !completed || call->td != oe_sgx_get_td())
+        return OE_INVALID_PARAMETER;
+
+    *completed =
+        !call->posted || _is_host_function_call_completed(call->args_host_ptr);
+
+    return OE_OK;
+}
+
+oe_result_t oe_switchless_call_wait(
+    oe_switchless_call_t* call,
+    size_t* output_bytes_written)
+{
+    oe_result_t result = OE_UNEXPECTED;
+
+    /* The handle is only released by the thread that started the call */
+    if (!call || call->td != oe_sgx_get_td())
+        return OE_INVALID_PARAMETER;
+
+    /* The host must be done with the arguments before they are freed */
+    if (call->posted)
+        _wait_host_function_call(call->args_host_ptr);
+
+    if (!output_bytes_written)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (!call->posted)
+        OE_CHECK(call->ocall_result);
+
+    OE_CHECK(_complete_host_function_call(
+        call->args_host_ptr, call->output_buffer, output_bytes_written));
+
+    result = OE_OK;
+
+done:
+    _untrack_switchless_call(call);
+    oe_arena_free(call->args_host_ptr);
+    oe_free(call);
+
+    return result;
+}
+
 /*
 **==============================================================================
 **
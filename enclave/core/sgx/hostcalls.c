@@ -3,9 +3,12 @@
 
 #include <openenclave/edger8r/enclave.h>
 #include <openenclave/enclave.h>
+#include <openenclave/internal/calls.h>
+#include <openenclave/internal/raise.h>
 #include <openenclave/internal/safecrt.h>
 #include <openenclave/internal/safemath.h>
 #include <openenclave/internal/sgx/ecall_context.h>
+#include <openenclave/internal/sgx/postedcalls.h>
 #include <openenclave/internal/sgx/td.h>
 #include "td.h"
 
@@ -55,6 +58,176 @@ void* oe_ecall_context_get_ocall_buffer(uint64_t size)
     return NULL;
 }
 
+/**
+ * Append a call to the posted call queue of the ecall context.
+ */
+oe_result_t oe_ecall_context_post_call(
+    uint64_t func,
+    uint64_t arg,
+    const void* input_buffer,
+    uint64_t input_buffer_size,
+    uint64_t output_buffer_size)
+{
+    oe_result_t result = OE_UNSUPPORTED;
+    oe_sgx_td_t* td = oe_sgx_get_td();
+    oe_ecall_context_t* ecall_context = td->host_ecall_context;
+    oe_posted_call_t call;
+    oe_posted_calls_t* queue;
+    uint64_t queue_size;
+    uint64_t capacity;
+    uint64_t used;
+    uint64_t entry_size;
+    uint8_t* entry;
+
+    /* Calls can only be posted from a regular ECALL, whose transitions are
+     * guaranteed to reach the host dispatcher that drains the queue */
+    if (!ecall_context || td->state != OE_TD_STATE_RUNNING)
+        goto done;
+
+    if ((input_buffer_size % OE_EDGER8R_BUFFER_ALIGNMENT) != 0 ||
+        (input_buffer_size && !input_buffer))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    /* Copy to local variables to prevent TOCTOU attacks. The fields are
+     * 8-byte aligned given their statically determined offsets. */
+    queue = (oe_posted_calls_t*)ecall_context->posted_calls;
+    queue_size = ecall_context->posted_calls_size;
+
+    /* The queue must be 16-byte aligned so that all writes below are 8-byte
+     * aligned (for xAPIC vulnerability mitigation) */
+    if (!queue || queue_size < sizeof(*queue) ||
+        ((uint64_t)queue % OE_EDGER8R_BUFFER_ALIGNMENT) != 0 ||
+        !oe_is_outside_enclave(queue, queue_size))
+        goto done;
+
+    capacity = queue_size - sizeof(*queue);
+    entry_size = sizeof(call) + input_buffer_size;
+    used = queue->used;
+
+    if (used > capacity || (used % OE_EDGER8R_BUFFER_ALIGNMENT) != 0 ||
+        input_buffer_size > capacity || entry_size > capacity - used)
+    {
+        result = OE_OUT_OF_MEMORY;
+        goto done;
+    }
+
+    /* Ensure the host cannot bypass the above checks via speculative
+     * execution */
+    oe_lfence();
+
+    call.func = func;
+    call.arg = arg;
+    call.input_buffer_size = input_buffer_size;
+    call.output_buffer_size = output_buffer_size;
+
+    entry = (uint8_t*)(queue + 1) + used;
+    OE_CHECK(oe_memcpy_s_with_barrier(
+        entry, capacity - used, &call, sizeof(call)));
+
+    if (input_buffer_size)
+        OE_CHECK(oe_memcpy_s_with_barrier(
+            entry + sizeof(call),
+            capacity - used - sizeof(call),
+            input_buffer,
+            input_buffer_size));
+
+    /* Publish the entry only after it has been written */
+    OE_WRITE_VALUE_WITH_BARRIER(&queue->used, (uint64_t)(used + entry_size));
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+/**
+ * Whether calls have been posted to the queue of the ecall context that the
+ * host has not performed yet.
+ */
+bool oe_ecall_context_has_posted_calls(void)
+{
+    oe_ecall_context_t* ecall_context = _get_ecall_context();
+    oe_posted_calls_t* queue;
+
+    if (!ecall_context)
+        return false;
+
+    /* The host may lie about the queue, which only affects the order of its
+     * own calls */
+    queue = (oe_posted_calls_t*)ecall_context->posted_calls;
+
+    if (!queue || ((uint64_t)queue % OE_EDGER8R_BUFFER_ALIGNMENT) != 0 ||
+        !oe_is_outside_enclave(queue, sizeof(*queue)))
+        return false;
+
+    return queue->used != 0;
+}
+
+oe_result_t oe_post_ocall(uint16_t func, uint64_t arg_in)
+{
+    if (func != OE_OCALL_FREE)
+        return OE_UNSUPPORTED;
+
+    return oe_ecall_context_post_call(func, arg_in, NULL, 0, 0);
+}
+
+oe_result_t oe_post_host_function(
+    size_t function_id,
+    const void* input_buffer,
+    size_t input_buffer_size,
+    size_t output_buffer_size)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    size_t buffer_size = 0;
+    uint8_t* buffer = NULL;
+    size_t output_bytes_written = 0;
+
+    if (!input_buffer ||
+        input_buffer_size < sizeof(oe_call_function_return_args_t) ||
+        output_buffer_size < sizeof(oe_call_function_return_args_t) ||
+        (input_buffer_size % OE_EDGER8R_BUFFER_ALIGNMENT) != 0 ||
+        (output_buffer_size % OE_EDGER8R_BUFFER_ALIGNMENT) != 0)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    result = oe_ecall_context_post_call(
+        OE_OCALL_CALL_HOST_FUNCTION,
+        function_id,
+        input_buffer,
+        input_buffer_size,
+        output_buffer_size);
+
+    if (result != OE_UNSUPPORTED && result != OE_OUT_OF_MEMORY)
+        goto done;
+
+    /* The queue is unavailable or full. Make the call synchronously, which
+     * also drains the queue first and thereby preserves the order of calls.
+     */
+    OE_CHECK(oe_safe_add_sizet(
+        input_buffer_size, output_buffer_size, &buffer_size));
+
+    if (!(buffer = (uint8_t*)oe_allocate_ocall_buffer(buffer_size)))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    OE_CHECK(oe_memcpy_s_with_barrier(
+        buffer, buffer_size, input_buffer, input_buffer_size));
+
+    OE_CHECK(oe_call_host_function(
+        function_id,
+        buffer,
+        input_buffer_size,
+        buffer + input_buffer_size,
+        output_buffer_size,
+        &output_bytes_written));
+
+    result = OE_OK;
+
+done:
+    if (buffer)
+        oe_free_ocall_buffer(buffer);
+
+    return result;
+}
+
 void* oe_host_calloc(size_t nmemb, size_t size)
 {
     size_t total_size;
@@ -108,6 +281,11 @@ void* oe_allocate_ocall_buffer(size_t size)
         return buffer;
     }
 
+    // Allocate from the pool of host memory if possible, which needs no ocall.
+    // The buffer is released with oe_free_ocall_buffer(), never by the host.
+    if ((buffer = oe_host_pool_malloc(size)))
+        return buffer;
+
     // Perform host allocation by making an ocall.
     return oe_host_malloc(size);
 }
@@ -135,7 +313,9 @@ void oe_free_ocall_buffer(void* buffer)
 
 void* oe_allocate_arena(size_t capacity)
 {
-    return oe_host_malloc(capacity);
+    void* buffer = oe_host_pool_malloc(capacity);
+
+    return buffer ? buffer : oe_host_malloc(capacity);
 }
 
 void oe_deallocate_arena(void* buffer)
@@ -0,0 +1,495 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include "hostpool.h"
+#include <openenclave/bits/sgx/writebarrier.h>
+#include <openenclave/corelibc/stdlib.h>
+#include <openenclave/corelibc/string.h>
+#include <openenclave/edger8r/common.h>
+#include <openenclave/edger8r/enclave.h>
+#include <openenclave/enclave.h>
+#include <openenclave/internal/calls.h>
+#include <openenclave/internal/raise.h>
+#include <openenclave/internal/sgx/td.h>
+#include <openenclave/internal/thread.h>
+#include "td.h"
+
+/*
+**==============================================================================
+**
+** Pool of host memory
+**
+**     The host maps a region of host memory when it creates the enclave and
+**     hands it to the enclave with OE_ECALL_INIT_HOST_MEMORY_POOL. Ocall
+**     buffers that do not fit into the ocall buffer of the thread, segments
+**     of the switchless ocall arena and, if the host allows it, the memory
+**     of oe_host_malloc() are allocated from the region without OCALLs.
+**     oe_host_free() returns memory of the region to the pool.
+**
+**     The region is divided into chunks, each of which holds blocks of one
+**     size class, a power of two from 64 bytes up to the chunk size. A chunk
+**     is assigned to a class when the class runs out of blocks, and blocks
+**     are carved from the newest chunk of the class on demand. Chunks are
+**     never returned to other classes.
+**
+**     All bookkeeping is kept in enclave memory so that the host cannot
+**     tamper with it: the class of each chunk, and a list of free blocks per
+**     class. Each thread caches a few free blocks of every class in its
+**     thread data, so that most allocations and frees take no lock. The
+**     cache is kept across ECALLs, and the enclave destructor returns the
+**     caches of all threads to the free lists before it frees the
+**     bookkeeping.
+**
+**     Requests larger than a chunk, or made while the pool is exhausted, are
+**     left to the caller, which allocates from the host's heap instead.
+**
+**==============================================================================
+*/
+
+#define OE_HOST_POOL_MIN_BLOCK_SHIFT 6 /* 64 bytes */
+#define OE_HOST_POOL_CHUNK_SHIFT 18    /* 256 KB */
+#define OE_HOST_POOL_CHUNK_SIZE ((uint64_t)1 << OE_HOST_POOL_CHUNK_SHIFT)
+#define OE_HOST_POOL_NUM_CLASSES \
+    (OE_HOST_POOL_CHUNK_SHIFT - OE_HOST_POOL_MIN_BLOCK_SHIFT + 1)
+
+/* The bytes and the number of blocks of one class that a thread caches */
+#define OE_HOST_POOL_CACHE_BYTES (64 * 1024)
+#define OE_HOST_POOL_CACHE_BLOCKS 32
+
+/* Class of the chunks that have not been assigned to a class yet */
+#define OE_HOST_POOL_NO_CLASS 0xff
+
+OE_STATIC_ASSERT(OE_HOST_POOL_NUM_CLASSES < OE_HOST_POOL_NO_CLASS);
+OE_STATIC_ASSERT(
+    ((1 << OE_HOST_POOL_MIN_BLOCK_SHIFT) % OE_EDGER8R_BUFFER_ALIGNMENT) == 0);
+
+typedef struct _free_list
+{
+    /* Free blocks, and the capacity of the array */
+    void** blocks;
+    size_t num_blocks;
+    size_t max_blocks;
+
+    /* The rest of the newest chunk of the class */
+    uint8_t* carve_ptr;
+    uint8_t* carve_end;
+} free_list_t;
+
+struct _oe_host_pool_cache
+{
+    size_t num_blocks[OE_HOST_POOL_NUM_CLASSES];
+    void* blocks[OE_HOST_POOL_NUM_CLASSES][OE_HOST_POOL_CACHE_BLOCKS];
+};
+
+static struct
+{
+    uint8_t* base;
+    size_t num_chunks;
+    bool host_malloc;
+
+    /* Chunks [0, next_chunk) have been assigned to a class */
+    size_t next_chunk;
+    uint8_t* chunk_classes;
+
+    free_list_t free_lists[OE_HOST_POOL_NUM_CLASSES];
+    oe_spinlock_t lock;
+} _pool = {.lock = OE_SPINLOCK_INITIALIZER};
+
+/* Set once the fields of _pool that describe the region are published */
+static bool _initialized;
+
+/* Set once the bookkeeping has been freed by oe_host_pool_cleanup() */
+static bool _finalized;
+
+oe_result_t oe_handle_init_host_memory_pool(uint64_t arg_in)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_init_host_memory_pool_args_t* args_host =
+        (oe_init_host_memory_pool_args_t*)arg_in;
+    oe_init_host_memory_pool_args_t args;
+    uint8_t* chunk_classes = NULL;
+    size_t num_chunks;
+    bool locked = false;
+
+    /* The arguments must be 8-byte aligned for mitigating the xAPIC
+     * vulnerability */
+    if (!args_host || (arg_in % 8) != 0 ||
+        !oe_is_outside_enclave(args_host, sizeof(*args_host)))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    /* Copy the arguments to enclave memory to prevent TOCTOU attacks */
+    args = *args_host;
+
+    /* The blocks are aligned to their size within page-aligned chunks */
+    if (!args.base || ((uint64_t)args.base % OE_PAGE_SIZE) != 0 ||
+        args.size < OE_HOST_POOL_CHUNK_SIZE ||
+        !oe_is_outside_enclave(args.base, args.size))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    /* Ensure the host cannot bypass the above checks via speculative
+     * execution */
+    oe_lfence();
+
+    num_chunks = (size_t)(args.size >> OE_HOST_POOL_CHUNK_SHIFT);
+
+    if (!(chunk_classes = (uint8_t*)oe_malloc(num_chunks)))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    memset(chunk_classes, OE_HOST_POOL_NO_CLASS, num_chunks);
+
+    oe_spin_lock(&_pool.lock);
+    locked = true;
+
+    if (__atomic_load_n(&_initialized, __ATOMIC_ACQUIRE) ||
+        __atomic_load_n(&_finalized, __ATOMIC_ACQUIRE))
+        OE_RAISE(OE_ALREADY_INITIALIZED);
+
+    _pool.base = (uint8_t*)args.base;
+    _pool.num_chunks = num_chunks;
+    _pool.host_malloc = args.host_malloc != 0;
+    _pool.next_chunk = 0;
+    _pool.chunk_classes = chunk_classes;
+    chunk_classes = NULL;
+
+    __atomic_store_n(&_initialized, true, __ATOMIC_RELEASE);
+
+    result = OE_OK;
+
+done:
+    if (locked)
+        oe_spin_unlock(&_pool.lock);
+
+    oe_free(chunk_classes);
+
+    return result;
+}
+
+static uint64_t _get_block_size(size_t size_class)
+{
+    return (uint64_t)1 << (size_class + OE_HOST_POOL_MIN_BLOCK_SHIFT);
+}
+
+/* Returns the class of blocks of the given size or OE_HOST_POOL_NO_CLASS if
+ * the size is larger than a chunk */
+static size_t _get_class(size_t size)
+{
+    size_t size_class = 0;
+
+    while (size_class < OE_HOST_POOL_NUM_CLASSES &&
+           _get_block_size(size_class) < size)
+        size_class++;
+
+    return size_class < OE_HOST_POOL_NUM_CLASSES ? size_class
+                                                 : OE_HOST_POOL_NO_CLASS;
+}
+
+/* The number of blocks of the class that each thread caches, which may be 0
+ * for the largest classes */
+static size_t _get_cache_capacity(size_t size_class)
+{
+    uint64_t capacity = OE_HOST_POOL_CACHE_BYTES / _get_block_size(size_class);
+
+    return capacity < OE_HOST_POOL_CACHE_BLOCKS ? (size_t)capacity
+                                                : OE_HOST_POOL_CACHE_BLOCKS;
+}
+
+/* Whether ptr is in the region of the pool */
+static bool _is_in_pool(const void* ptr)
+{
+    if (!__atomic_load_n(&_initialized, __ATOMIC_ACQUIRE))
+        return false;
+
+    return (const uint8_t*)ptr >= _pool.base &&
+           ((uint64_t)((const uint8_t*)ptr - _pool.base) >>
+            OE_HOST_POOL_CHUNK_SHIFT) < _pool.num_chunks;
+}
+
+/* Returns the class of a block of the pool, OE_HOST_POOL_NO_CLASS if ptr is
+ * not in the pool, and aborts if ptr is in the pool but not a block. Must
+ * not be called once the pool is finalized. */
+static size_t _get_block_class(const void* ptr)
+{
+    uint64_t offset;
+    size_t size_class;
+
+    if (!_is_in_pool(ptr))
+        return OE_HOST_POOL_NO_CLASS;
+
+    offset = (uint64_t)((const uint8_t*)ptr - _pool.base);
+    size_class = _pool.chunk_classes[offset >> OE_HOST_POOL_CHUNK_SHIFT];
+
+    if (size_class == OE_HOST_POOL_NO_CLASS ||
+        (offset & (_get_block_size(size_class) - 1)) != 0)
+        oe_abort();
+
+    return size_class;
+}
+
+/* Take up to count free blocks of the class, carving them from a new chunk if
+ * necessary. Returns the number of blocks taken. */
+static size_t _take_blocks(size_t size_class, void** blocks, size_t count)
+{
+    free_list_t* list = &_pool.free_lists[size_class];
+    uint64_t block_size = _get_block_size(size_class);
+    size_t n = 0;
+
+    oe_spin_lock(&_pool.lock);
+
+    while (n < count && list->num_blocks)
+        blocks[n++] = list->blocks[--list->num_blocks];
+
+    while (n < count)
+    {
+        if (list->carve_ptr == list->carve_end)
+        {
+            if (_pool.next_chunk == _pool.num_chunks)
+                break;
+
+            _pool.chunk_classes[_pool.next_chunk] = (uint8_t)size_class;
+            list->carve_ptr =
+                _pool.base + (_pool.next_chunk << OE_HOST_POOL_CHUNK_SHIFT);
+            list->carve_end = list->carve_ptr + OE_HOST_POOL_CHUNK_SIZE;
+            _pool.next_chunk++;
+        }
+
+        blocks[n++] = list->carve_ptr;
+        list->carve_ptr += block_size;
+    }
+
+    oe_spin_unlock(&_pool.lock);
+
+    return n;
+}
+
+/* Return blocks of the class to the free list. If the list cannot grow, the
+ * blocks are leaked rather than lost track of. */
+static void _put_blocks(size_t size_class, void* const* blocks, size_t count)
+{
+    free_list_t* list = &_pool.free_lists[size_class];
+
+    oe_spin_lock(&_pool.lock);
+
+    if (list->max_blocks - list->num_blocks < count)
+    {
+        size_t max_blocks = list->max_blocks ? list->max_blocks * 2 : 64;
+        void** array;
+
+        while (max_blocks - list->num_blocks < count)
+            max_blocks *= 2;
+
+        if ((array = (void**)oe_realloc(
+                 list->blocks, max_blocks * sizeof(*array))))
+        {
+            list->blocks = array;
+            list->max_blocks = max_blocks;
+        }
+    }
+
+    for (size_t i = 0; i < count && list->num_blocks < list->max_blocks; i++)
+        list->blocks[list->num_blocks++] = blocks[i];
+
+    oe_spin_unlock(&_pool.lock);
+}
+
+/* Returns the cache of the calling thread, or NULL if it cannot be
+ * allocated */
+static struct _oe_host_pool_cache* _get_cache(void)
+{
+    oe_sgx_td_t* td = oe_sgx_get_td();
+
+    /* The cache is kept across ECALLs until oe_host_pool_cleanup() */
+    if (!td->host_pool_cache &&
+        (td->host_pool_cache = (struct _oe_host_pool_cache*)oe_calloc(
+             1, sizeof(struct _oe_host_pool_cache))))
+        td_register_caches(td);
+
+    return td->host_pool_cache;
+}
+
+void* oe_host_pool_malloc(size_t size)
+{
+    struct _oe_host_pool_cache* cache;
+    size_t size_class;
+    size_t capacity;
+    void* block = NULL;
+
+    if (!__atomic_load_n(&_initialized, __ATOMIC_ACQUIRE) ||
+        __atomic_load_n(&_finalized, __ATOMIC_ACQUIRE))
+        return NULL;
+
+    if ((size_class = _get_class(size)) == OE_HOST_POOL_NO_CLASS)
+        return NULL;
+
+    capacity = _get_cache_capacity(size_class);
+
+    if (capacity == 0 || !(cache = _get_cache()))
+    {
+        _take_blocks(size_class, &block, 1);
+        goto done;
+    }
+
+    /* Refill half of the cache at once, so that a thread that alternates
+     * between allocating and freeing does not take the lock every time */
+    if (cache->num_blocks[size_class] == 0)
+        cache->num_blocks[size_class] = _take_blocks(
+            size_class, cache->blocks[size_class], (capacity + 1) / 2);
+
+    if (cache->num_blocks[size_class] == 0)
+        return NULL;
+
+    block = cache->blocks[size_class][--cache->num_blocks[size_class]];
+
+done:
+    /* The region was validated when the pool was set up. Check each block
+     * all the same, with the alignment that is required of the host's heap
+     * for mitigating the xAPIC vulnerability. */
+    if (block &&
+        (!oe_is_outside_enclave(block, _get_block_size(size_class)) ||
+         ((uint64_t)block % OE_EDGER8R_BUFFER_ALIGNMENT) != 0))
+        oe_abort();
+
+    return block;
+}
+
+bool oe_host_pool_backs_host_malloc(void)
+{
+    return __atomic_load_n(&_initialized, __ATOMIC_ACQUIRE) &&
+           !__atomic_load_n(&_finalized, __ATOMIC_ACQUIRE) &&
+           _pool.host_malloc;
+}
+
+bool oe_host_pool_free(void* ptr)
+{
+    struct _oe_host_pool_cache* cache;
+    size_t size_class;
+    size_t capacity;
+
+    /* Blocks freed once the pool is finalized are dropped: they must not
+     * be passed to the host's heap, and the pool goes away with the
+     * enclave */
+    if (__atomic_load_n(&_finalized, __ATOMIC_ACQUIRE))
+        return _is_in_pool(ptr);
+
+    if ((size_class = _get_block_class(ptr)) == OE_HOST_POOL_NO_CLASS)
+        return false;
+
+    capacity = _get_cache_capacity(size_class);
+
+    if (capacity == 0 || !(cache = _get_cache()))
+    {
+        _put_blocks(size_class, &ptr, 1);
+        return true;
+    }
+
+    /* Return the older half of a full cache to the free list */
+    if (cache->num_blocks[size_class] == capacity)
+    {
+        size_t count = (capacity + 1) / 2;
+
+        _put_blocks(size_class, cache->blocks[size_class], count);
+        memmove(
+            cache->blocks[size_class],
+            cache->blocks[size_class] + count,
+            (capacity - count) * sizeof(void*));
+        cache->num_blocks[size_class] -= count;
+    }
+
+    cache->blocks[size_class][cache->num_blocks[size_class]++] = ptr;
+
+    return true;
+}
+
+bool oe_host_pool_realloc(void* ptr, size_t size, void** new_ptr)
+{
+    size_t size_class;
+    uint64_t block_size;
+    void* block;
+
+    if (__atomic_load_n(&_finalized, __ATOMIC_ACQUIRE))
+    {
+        if (!_is_in_pool(ptr))
+            return false;
+
+        /* The size of the block is no longer known */
+        *new_ptr = NULL;
+        return true;
+    }
+
+    if ((size_class = _get_block_class(ptr)) == OE_HOST_POOL_NO_CLASS)
+        return false;
+
+    block_size = _get_block_size(size_class);
+
+    if (size == 0)
+    {
+        oe_host_pool_free(ptr);
+        *new_ptr = NULL;
+    }
+    else if (size <= block_size)
+    {
+        *new_ptr = ptr;
+    }
+    else if ((block = oe_host_malloc(size)))
+    {
+        /* Copy with barriers for mitigating the xAPIC vulnerability */
+        if (oe_memcpy_s_with_barrier(block, size, ptr, block_size) != OE_OK)
+            oe_abort();
+
+        oe_host_pool_free(ptr);
+        *new_ptr = block;
+    }
+    else
+    {
+        /* Like realloc(), leave the memory untouched on failure */
+        *new_ptr = NULL;
+    }
+
+    return true;
+}
+
+/* Returns the free blocks that a thread caches to the pool */
+static void _release_cache(oe_sgx_td_t* td)
+{
+    struct _oe_host_pool_cache* cache = td->host_pool_cache;
+
+    if (!cache)
+        return;
+
+    td->host_pool_cache = NULL;
+
+    if (!__atomic_load_n(&_finalized, __ATOMIC_ACQUIRE))
+    {
+        for (size_t i = 0; i < OE_HOST_POOL_NUM_CLASSES; i++)
+        {
+            if (cache->num_blocks[i])
+                _put_blocks(i, cache->blocks[i], cache->num_blocks[i]);
+        }
+    }
+
+    oe_free(cache);
+}
+
+void oe_host_pool_cleanup(void)
+{
+    /* No other thread runs in the enclave anymore */
+    td_free_caches(_release_cache);
+
+    oe_spin_lock(&_pool.lock);
+
+    if (__atomic_load_n(&_initialized, __ATOMIC_ACQUIRE) &&
+        !__atomic_load_n(&_finalized, __ATOMIC_ACQUIRE))
+    {
+        __atomic_store_n(&_finalized, true, __ATOMIC_RELEASE);
+
+        oe_free(_pool.chunk_classes);
+        _pool.chunk_classes = NULL;
+
+        for (size_t i = 0; i < OE_HOST_POOL_NUM_CLASSES; i++)
+        {
+            oe_free(_pool.free_lists[i].blocks);
+            memset(&_pool.free_lists[i], 0, sizeof(_pool.free_lists[i]));
+        }
+    }
+
+    oe_spin_unlock(&_pool.lock);
+}
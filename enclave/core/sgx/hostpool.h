@@ -0,0 +1,17 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#ifndef _OE_HOSTPOOL_H
+#define _OE_HOSTPOOL_H
+
+#include <openenclave/bits/result.h>
+#include <openenclave/bits/types.h>
+
+oe_result_t oe_handle_init_host_memory_pool(uint64_t arg_in);
+
+/* Returns the free blocks that the threads cache to the pool and frees the
+ * caches and the bookkeeping of the pool before the enclave checks for memory
+ * leaks. Blocks of the pool that are freed afterwards are dropped. */
+void oe_host_pool_cleanup(void);
+
+#endif /* _OE_HOSTPOOL_H */
@@ -21,6 +21,28 @@ static size_t _host_worker_count = 0;
 // variables.
 static volatile oe_host_worker_context_t* _host_worker_contexts = NULL;
 
+// The switchless ocall queue in host memory, or NULL if ocalls are posted
+// to the slots of the host worker contexts. Initialized by host through ECALL
+static oe_switchless_queue_t* _ocall_queue = NULL;
+
+// The capacity of the queue and the sleeping flags of the host workers. Kept
+// in enclave memory since the host may change the queue header.
+static uint64_t _ocall_queue_capacity = 0;
+static volatile uint64_t* _ocall_queue_sleeping = NULL;
+
+// The host worker after the one that was woken up last
+static uint64_t _next_worker_to_wake = 0;
+
+// How many times a thread checks whether its switchless ocall has completed
+// before it sleeps in the host. Initialized by host through ECALL
+static uint64_t _ocall_wait_spin_count = 0;
+
+// The bitmap in host memory of the host functions whose regular ocalls are
+// made as switchless ocalls, and its number of host functions, or NULL and 0.
+// Initialized by host through ECALL
+static volatile uint64_t* _promoted_ocalls = NULL;
+static uint64_t _num_promoted_ocalls = 0;
+
 // Flag to denote if switchless calls have already been initialized.
 static bool _is_switchless_initialized = false;
 
@@ -42,6 +64,9 @@ oe_result_t _oe_sgx_wake_switchless_worker_ocall(
     oe_host_worker_context_t* context);
 oe_result_t _oe_sgx_sleep_switchless_worker_ocall(
     oe_enclave_worker_context_t* context);
+oe_result_t _oe_sgx_wait_switchless_ocall_ocall(
+    oe_host_worker_context_t* context,
+    void* args);
 
 /**
  * Make the following OCALLs weak to support the system EDL opt-in.
@@ -70,6 +95,18 @@ OE_WEAK_ALIAS(
     _oe_sgx_sleep_switchless_worker_ocall,
     oe_sgx_sleep_switchless_worker_ocall);
 
+oe_result_t _oe_sgx_wait_switchless_ocall_ocall(
+    oe_host_worker_context_t* context,
+    void* args)
+{
+    OE_UNUSED(context);
+    OE_UNUSED(args);
+    return OE_UNSUPPORTED;
+}
+OE_WEAK_ALIAS(
+    _oe_sgx_wait_switchless_ocall_ocall,
+    oe_sgx_wait_switchless_ocall_ocall);
+
 /*
 **==============================================================================
 **
@@ -89,6 +126,30 @@ bool oe_is_switchless_initialized()
     return is_initialized;
 }
 
+/*
+**==============================================================================
+**
+** oe_is_switchless_ocall_promoted
+**
+** Return whether the host has promoted the regular ocalls of the host function
+** to switchless ocalls (see host/sgx/switchless.c).
+**
+**==============================================================================
+*/
+bool oe_is_switchless_ocall_promoted(uint64_t function_id)
+{
+    uint64_t word;
+
+    if (!_promoted_ocalls || function_id >= _num_promoted_ocalls)
+        return false;
+
+    /* Read the whole aligned word against the xAPIC vulnerability */
+    word = __atomic_load_n(
+        &_promoted_ocalls[function_id / 64], __ATOMIC_RELAXED);
+
+    return (word >> (function_id % 64)) & 1;
+}
+
 /*
 **==============================================================================
 **
@@ -101,10 +162,15 @@ bool oe_is_switchless_initialized()
 */
 oe_result_t oe_sgx_init_context_switchless_ecall(
     oe_host_worker_context_t* host_worker_contexts,
-    uint64_t num_host_workers)
+    uint64_t num_host_workers,
+    void* ocall_queue,
+    uint64_t ocall_wait_spin_count,
+    void* promoted_ocalls,
+    uint64_t num_ocalls)
 {
     oe_result_t result = OE_UNEXPECTED;
     uint64_t contexts_size = 0;
+    uint64_t queue_capacity = 0;
 
     if (!oe_atomic_compare_and_swap(
             &_switchless_init_in_progress, (int64_t) false, (int64_t) true))
@@ -128,12 +194,60 @@ oe_result_t oe_sgx_init_context_switchless_ecall(
         OE_RAISE(OE_INVALID_PARAMETER);
     }
 
+    if (ocall_queue)
+    {
+        /* Read the capacity once so that the host cannot change it after it
+         * has been validated. Ensure the queue, its cells and the sleeping
+         * flags are outside of enclave and 8-byte aligned against the xAPIC
+         * vulnerability */
+        volatile oe_switchless_queue_t* queue = ocall_queue;
+        queue_capacity = queue->capacity;
+
+        if (queue_capacity == 0 ||
+            queue_capacity > OE_SWITCHLESS_QUEUE_MAX_CAPACITY ||
+            (queue_capacity & (queue_capacity - 1)) != 0 ||
+            num_host_workers > OE_SWITCHLESS_QUEUE_MAX_CAPACITY ||
+            ((uint64_t)ocall_queue % 8) != 0 ||
+            !oe_is_outside_enclave(
+                ocall_queue,
+                oe_switchless_queue_size(queue_capacity, num_host_workers)))
+        {
+            OE_RAISE(OE_INVALID_PARAMETER);
+        }
+    }
+
+    /* Ensure the bitmap of promoted ocalls is outside of enclave and 8-byte
+     * aligned against the xAPIC vulnerability */
+    if (promoted_ocalls &&
+        (num_ocalls == 0 || num_ocalls > OE_UINT32_MAX ||
+         ((uint64_t)promoted_ocalls % 8) != 0 ||
+         !oe_is_outside_enclave(
+             promoted_ocalls, oe_switchless_promoted_ocalls_size(num_ocalls))))
+    {
+        OE_RAISE(OE_INVALID_PARAMETER);
+    }
+
     /* lfence after checks. */
     oe_lfence();
 
     // Stash host worker information in enclave memory.
     _host_worker_count = num_host_workers;
     _host_worker_contexts = host_worker_contexts;
+    _ocall_wait_spin_count = ocall_wait_spin_count;
+
+    if (promoted_ocalls)
+    {
+        _promoted_ocalls = (volatile uint64_t*)promoted_ocalls;
+        _num_promoted_ocalls = num_ocalls;
+    }
+
+    if (ocall_queue)
+    {
+        _ocall_queue = (oe_switchless_queue_t*)ocall_queue;
+        _ocall_queue_capacity = queue_capacity;
+        _ocall_queue_sleeping =
+            oe_switchless_queue_sleeping(_ocall_queue, queue_capacity);
+    }
 
     for (uint64_t i = 0; i < _host_worker_count; i++)
     {
@@ -159,13 +273,119 @@ done:
     return result;
 }
 
+/*
+**==============================================================================
+**
+** _enqueue_switchless_ocall()
+**
+**  Append the function call (wrapped in args) to the switchless ocall queue
+**  and wake up a sleeping host worker, if any. Fails only if the queue is
+**  full. The queue lives in host memory, so all of its fields other than the
+**  cells' contents may be changed by the host at any time. The number of
+**  attempts is bounded so that the host cannot keep the enclave thread
+**  spinning.
+**
+**==============================================================================
+*/
+static oe_result_t _enqueue_switchless_ocall(oe_call_host_function_args_t* args)
+{
+    oe_switchless_queue_cell_t* cells = oe_switchless_queue_cells(_ocall_queue);
+    const uint64_t mask = _ocall_queue_capacity - 1;
+    uint64_t pos = __atomic_load_n(&_ocall_queue->tail, __ATOMIC_ACQUIRE);
+    oe_switchless_queue_cell_t* cell = NULL;
+
+    for (uint64_t tries = 0; tries < _ocall_queue_capacity; tries++)
+    {
+        oe_switchless_queue_cell_t* next = &cells[pos & mask];
+        uint64_t sequence =
+            __atomic_load_n(&next->sequence, __ATOMIC_ACQUIRE);
+        int64_t diff = (int64_t)(sequence - pos);
+
+        if (diff == 0)
+        {
+            // The cell is free. Claim it by advancing the tail. If another
+            // thread advanced it first, pos is updated to the current tail.
+            bool weak = false;
+
+            if (__atomic_compare_exchange_n(
+                    &_ocall_queue->tail,
+                    &pos,
+                    pos + 1,
+                    weak,
+                    __ATOMIC_ACQ_REL,
+                    __ATOMIC_ACQUIRE))
+            {
+                cell = next;
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            // The cell still holds a call from the previous lap: full.
+            break;
+        }
+        else
+        {
+            // Another thread claimed the cell; reload the tail.
+            pos = __atomic_load_n(&_ocall_queue->tail, __ATOMIC_ACQUIRE);
+        }
+    }
+
+    if (!cell)
+        return OE_CONTEXT_SWITCHLESS_OCALL_MISSED;
+
+    // Publish the call. The barriers also order the publication before the
+    // load of num_sleeping below, which pairs with the host worker
+    // incrementing num_sleeping before it checks the queue a last time.
+    OE_WRITE_VALUE_WITH_BARRIER(&cell->call_arg, (uint64_t)args);
+    OE_WRITE_VALUE_WITH_BARRIER(&cell->sequence, pos + 1);
+
+    if (__atomic_load_n(&_ocall_queue->num_sleeping, __ATOMIC_SEQ_CST) == 0)
+        return OE_OK;
+
+    // Wake up one sleeping worker, starting after the one woken up last so
+    // that the calls are spread over all workers.
+    uint64_t start =
+        __atomic_fetch_add(&_next_worker_to_wake, 1, __ATOMIC_RELAXED);
+
+    for (uint64_t i = 0; i < _host_worker_count; i++)
+    {
+        uint64_t index = (start + i) % _host_worker_count;
+        int64_t oldval = 0;
+        int64_t newval = 1;
+        bool weak = false;
+
+        if (!_ocall_queue_sleeping[index])
+            continue;
+
+        // See oe_post_switchless_ocall() for the event protocol. If the
+        // event is already 1, the worker has a pending wake notification
+        // and checks the queue before it goes to sleep.
+        if (__atomic_compare_exchange_n(
+                &_host_worker_contexts[index].event,
+                &oldval,
+                newval,
+                weak,
+                __ATOMIC_ACQ_REL,
+                __ATOMIC_ACQUIRE))
+        {
+            oe_sgx_wake_switchless_worker_ocall(
+                (oe_host_worker_context_t*)&_host_worker_contexts[index]);
+        }
+
+        break;
+    }
+
+    return OE_OK;
+}
+
 /*
 **==============================================================================
 **
 ** oe_post_switchless_ocall()
 **
-**  Post the function call (wrapped in args) to a free host worker thread
-**  by writing to its context.
+**  Post the function call (wrapped in args) to the switchless ocall queue, or
+**  to a free host worker thread by writing to its context.
 **
 **==============================================================================
 */
@@ -178,6 +398,9 @@ oe_result_t oe_post_switchless_ocall(oe_call_host_function_args_t* args)
     // Set the result to indicate that the call hasn't been processed
     OE_WRITE_VALUE_WITH_BARRIER(&args->result, OE_UINT64_MAX);
 
+    if (_ocall_queue)
+        return _enqueue_switchless_ocall(args);
+
     // Cycle through the worker contexts until we find a free worker.
     size_t tries = _host_worker_count;
     while (tries--)
@@ -197,6 +420,11 @@ oe_result_t oe_post_switchless_ocall(oe_call_host_function_args_t* args)
                     NULL,
                     args))
             {
+                __atomic_fetch_add(
+                    &_host_worker_contexts[tries].num_posts,
+                    1,
+                    __ATOMIC_RELAXED);
+
                 // The worker thread has been marked to execute this switchless
                 // call. Determine if it needs to be woken up or not.
                 //
@@ -243,6 +471,43 @@ oe_result_t oe_post_switchless_ocall(oe_call_host_function_args_t* args)
     return result;
 }
 
+/*
+**==============================================================================
+**
+** oe_wait_switchless_ocall()
+**
+**  Wait until the host worker has completed the switchless ocall posted with
+**  args. Spin for _ocall_wait_spin_count checks, then sleep in the host until
+**  the call completes, so that a long-running host function (e.g., a
+**  blocking recv) does not keep the enclave thread spinning. The host may
+**  return from the sleep early, so the result is checked again.
+**
+**==============================================================================
+*/
+void oe_wait_switchless_ocall(oe_call_host_function_args_t* args)
+{
+    uint64_t spin_count = 0;
+
+    while (
+        __atomic_load_n(&args->result, __ATOMIC_SEQ_CST) == OE_UINT64_MAX)
+    {
+        if (spin_count < _ocall_wait_spin_count)
+        {
+            spin_count++;
+
+            /* Yield to CPU */
+            asm volatile("pause");
+            continue;
+        }
+
+        // Keep spinning for another round if the host cannot park threads.
+        if (oe_sgx_wait_switchless_ocall_ocall(
+                (oe_host_worker_context_t*)_host_worker_contexts, args) !=
+            OE_OK)
+            spin_count = 0;
+    }
+}
+
 /*
 **==============================================================================
 **
@@ -269,33 +534,159 @@ oe_result_t oe_switchless_call_host_function(
         true /* switchless */);
 }
 
+/*
+**==============================================================================
+**
+** Switchless ecalls
+**
+**  Host threads post switchless ecalls to the ecall queue in host memory
+**  (see oe_switchless_queue_t) and the enclave workers take them from it.
+**  Each worker validates the queue once and keeps its capacity in enclave
+**  memory. Before a worker sleeps, it sets its sleeping flag and increments
+**  num_sleeping, and then checks the queue a last time, so a host thread that
+**  posts a call afterwards wakes it up.
+**
+**==============================================================================
+*/
+
+typedef struct _ecall_queue
+{
+    oe_switchless_queue_t* queue;
+    uint64_t capacity;
+    volatile uint64_t* sleeping;
+} ecall_queue_t;
+
+/*
+** Take the oldest call from the ecall queue. Returns NULL if the queue is
+** empty. The number of attempts is bounded so that the host cannot keep the
+** worker spinning here.
+*/
+static oe_call_enclave_function_args_t* _dequeue_switchless_ecall(
+    const ecall_queue_t* q)
+{
+    oe_switchless_queue_cell_t* cells = oe_switchless_queue_cells(q->queue);
+    const uint64_t mask = q->capacity - 1;
+    uint64_t pos = __atomic_load_n(&q->queue->head, __ATOMIC_ACQUIRE);
+
+    for (uint64_t tries = 0; tries < q->capacity; tries++)
+    {
+        oe_switchless_queue_cell_t* cell = &cells[pos & mask];
+        uint64_t sequence =
+            __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        int64_t diff = (int64_t)(sequence - (pos + 1));
+
+        if (diff == 0)
+        {
+            // The cell holds a call. Claim it by advancing the head. If
+            // another worker advanced it first, pos is updated to the
+            // current head.
+            bool weak = false;
+
+            if (__atomic_compare_exchange_n(
+                    &q->queue->head,
+                    &pos,
+                    pos + 1,
+                    weak,
+                    __ATOMIC_ACQ_REL,
+                    __ATOMIC_ACQUIRE))
+            {
+                oe_call_enclave_function_args_t* args =
+                    (oe_call_enclave_function_args_t*)cell->call_arg;
+
+                // Free the cell for the enqueue one lap later.
+                OE_WRITE_VALUE_WITH_BARRIER(&cell->sequence, pos + mask + 1);
+                return args;
+            }
+        }
+        else if (diff < 0)
+        {
+            // The cell has not been written yet: empty.
+            return NULL;
+        }
+        else
+        {
+            pos = __atomic_load_n(&q->queue->head, __ATOMIC_ACQUIRE);
+        }
+    }
+
+    return NULL;
+}
+
+static bool _is_ecall_queue_empty(const ecall_queue_t* q)
+{
+    uint64_t pos = __atomic_load_n(&q->queue->head, __ATOMIC_SEQ_CST);
+    oe_switchless_queue_cell_t* cell =
+        &oe_switchless_queue_cells(q->queue)[pos & (q->capacity - 1)];
+
+    return __atomic_load_n(&cell->sequence, __ATOMIC_SEQ_CST) != pos + 1;
+}
+
+/*
+** Handle a switchless ecall and let the host thread that posted it know that
+** the enclave is done with its arguments
+*/
+static void _handle_switchless_ecall(oe_call_enclave_function_args_t* args)
+{
+    oe_result_t result;
+
+    // Ensure that args lies outside the enclave and is 8-byte aligned
+    // (against the xAPIC vulnerability) before writing the result.
+    if (!oe_is_outside_enclave(args, sizeof(*args)) ||
+        ((uint64_t)args % 8) != 0)
+        return;
+
+    result = oe_handle_call_enclave_function((uint64_t)args);
+
+    // On success, the result has been set already.
+    if (result != OE_OK)
+        OE_WRITE_VALUE_WITH_BARRIER(&args->result, result);
+}
+
 void oe_sgx_switchless_enclave_worker_thread_ecall(
-    oe_enclave_worker_context_t* context)
+    oe_enclave_worker_context_t* context,
+    void* ecall_queue,
+    uint64_t worker_index,
+    uint64_t num_workers)
 {
+    ecall_queue_t q = {ecall_queue, 0, NULL};
+
     // Ensure that the context lies in host memory.
-    if (!oe_is_outside_enclave(context, sizeof(*context)))
+    if (!oe_is_outside_enclave(context, sizeof(*context)) ||
+        ((uint64_t)context % 8) != 0)
+        return;
+
+    // Read the capacity once so that the host cannot change it after it has
+    // been validated. Ensure the queue, its cells and the sleeping flags are
+    // outside of enclave and 8-byte aligned against the xAPIC vulnerability.
+    if (!ecall_queue || ((uint64_t)ecall_queue % 8) != 0 ||
+        !oe_is_outside_enclave(ecall_queue, sizeof(oe_switchless_queue_t)))
+        return;
+
+    q.capacity = ((volatile oe_switchless_queue_t*)ecall_queue)->capacity;
+
+    if (q.capacity == 0 || q.capacity > OE_SWITCHLESS_QUEUE_MAX_CAPACITY ||
+        (q.capacity & (q.capacity - 1)) != 0 ||
+        num_workers > OE_SWITCHLESS_QUEUE_MAX_CAPACITY ||
+        worker_index >= num_workers ||
+        !oe_is_outside_enclave(
+            ecall_queue, oe_switchless_queue_size(q.capacity, num_workers)))
         return;
 
     // Prevent speculative execution.
     oe_lfence();
 
-    const uint64_t spin_count_threshold = context->spin_count_threshold;
+    q.sleeping = oe_switchless_queue_sleeping(q.queue, q.capacity);
+
     while (!context->is_stopping)
     {
-        volatile oe_call_enclave_function_args_t* local_call_arg = NULL;
-        if ((local_call_arg = context->call_arg) != NULL)
-        {
-            // Handle the switchless call, but do not clear the slot yet. Since
-            // the slot is not empty, any new incoming switchless call request
-            // will be scheduled in another available work thread and get
-            // handled immediately.
-            oe_handle_call_enclave_function((uint64_t)local_call_arg);
+        oe_call_enclave_function_args_t* args = _dequeue_switchless_ecall(&q);
 
-            // After handling the switchless call, mark this worker thread
-            // as free by clearing the slot.
-            OE_ATOMIC_MEMORY_BARRIER_RELEASE();
+        if (args != NULL)
+        {
+            _handle_switchless_ecall(args);
 
-            OE_WRITE_VALUE_WITH_BARRIER(&context->call_arg, NULL);
+            OE_WRITE_VALUE_WITH_BARRIER(
+                &context->num_calls, context->num_calls + 1);
 
             // Reset spin count for next message.
             OE_WRITE_VALUE_WITH_BARRIER(
@@ -307,11 +698,11 @@ void oe_sgx_switchless_enclave_worker_thread_ecall(
         else
         {
             // If there is no message, increment spin count until threshold is
-            // reached.
+            // reached. The host adapts the threshold while the worker sleeps.
             OE_WRITE_VALUE_WITH_BARRIER(
                 &context->spin_count, context->spin_count + 1);
 
-            if (context->spin_count >= spin_count_threshold)
+            if (context->spin_count >= context->spin_count_threshold)
             {
                 // Reset spin count and return to host to sleep.
                 OE_WRITE_VALUE_WITH_BARRIER(
@@ -320,8 +711,20 @@ void oe_sgx_switchless_enclave_worker_thread_ecall(
 
                 OE_WRITE_VALUE_WITH_BARRIER(&context->spin_count, (uint64_t)0);
 
+                // Announce the sleep before the last look at the queue.
+                OE_WRITE_VALUE_WITH_BARRIER(
+                    &q.sleeping[worker_index], (uint64_t)1);
+                __atomic_fetch_add(
+                    &q.queue->num_sleeping, 1, __ATOMIC_SEQ_CST);
+
                 // Make an ocall to sleep until messages arrive.
-                oe_sgx_sleep_switchless_worker_ocall(context);
+                if (_is_ecall_queue_empty(&q))
+                    oe_sgx_sleep_switchless_worker_ocall(context);
+
+                OE_WRITE_VALUE_WITH_BARRIER(
+                    &q.sleeping[worker_index], (uint64_t)0);
+                __atomic_fetch_sub(
+                    &q.queue->num_sleeping, 1, __ATOMIC_SEQ_CST);
             }
 
             // In Release builds, the following pause has been observed to be
@@ -333,21 +736,29 @@ void oe_sgx_switchless_enclave_worker_thread_ecall(
 }
 
 // Function used by oeedger8r for allocating switchless ocall buffers.
-// Preallocate a pool of shared memory per thread for switchless ocalls
-// and then allocate memory from that pool. Since OE does not support
-// reentrant ecalls in the same thread, there can at most be one ecall
-// and one ocall active in a thread. Although an enclave function can
-// make multiple OCALLs, the OCALLs are serialized. So the allocation
-// for one OCALL doesn't interfere with the allocation for the next OCALL.
-// A stack-based allocation scheme is the most efficient in this case.
+// Allocate memory from a per-thread pool of shared memory, which grows on
+// demand (see enclave/core/sgx/arena.c). A thread can have several buffers
+// outstanding, e.g., for asynchronous switchless ocalls that have not
+// completed yet (see oe_switchless_call_host_function_async()). Buffers
+// are reclaimed in LIFO order. If the pool is exhausted, fall back to
+// the pool of host memory of the enclave and then to allocating host memory
+// with an OCALL.
 void* oe_allocate_switchless_ocall_buffer(size_t size)
 {
-    return oe_arena_malloc(size);
+    void* buffer = oe_arena_malloc(size);
+
+    if (!buffer)
+        buffer = oe_host_pool_malloc(size);
+
+    if (!buffer)
+        buffer = oe_host_malloc(size);
+
+    return buffer;
 }
 
 // Function used by oeedger8r for freeing ocall buffers.
 void oe_free_switchless_ocall_buffer(void* buffer)
 {
-    OE_UNUSED(buffer);
-    oe_arena_free_all();
+    if (!oe_arena_free(buffer))
+        oe_host_free(buffer);
 }
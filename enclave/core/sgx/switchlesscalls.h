@@ -8,6 +8,10 @@
 
 bool oe_is_switchless_initialized();
 
+bool oe_is_switchless_ocall_promoted(uint64_t function_id);
+
 oe_result_t oe_post_switchless_ocall(oe_call_host_function_args_t* args);
 
+void oe_wait_switchless_ocall(oe_call_host_function_args_t* args);
+
 #endif // _OE_SWITCHLESSCALLS_H
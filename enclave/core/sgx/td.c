@@ -496,3 +496,43 @@ bool td_initialized(oe_sgx_td_t* td)
 
     return false;
 }
+
+/*
+**==============================================================================
+**
+** td_register_caches()
+** td_free_caches()
+**
+**     Some caches of a thread (e.g., oe_sgx_td_t.ecall_buffer) are kept
+**     across ECALLs, so they are still allocated when the enclave is
+**     destroyed. Threads that create such a cache register themselves here,
+**     so that the enclave destructor can free the caches of all threads
+**     before it checks for memory leaks.
+**
+**==============================================================================
+*/
+
+static oe_sgx_td_t* _cached_tds;
+static oe_spinlock_t _cached_tds_lock = OE_SPINLOCK_INITIALIZER;
+
+void td_register_caches(oe_sgx_td_t* td)
+{
+    if (td->caches_registered)
+        return;
+
+    oe_spin_lock(&_cached_tds_lock);
+    td->next_cached_td = _cached_tds;
+    _cached_tds = td;
+    td->caches_registered = 1;
+    oe_spin_unlock(&_cached_tds_lock);
+}
+
+void td_free_caches(void (*free_caches)(oe_sgx_td_t* td))
+{
+    oe_spin_lock(&_cached_tds_lock);
+
+    for (oe_sgx_td_t* td = _cached_tds; td; td = td->next_cached_td)
+        free_caches(td);
+
+    oe_spin_unlock(&_cached_tds_lock);
+}
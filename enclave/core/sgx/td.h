@@ -82,6 +82,10 @@ void* td_to_tcs(const oe_sgx_td_t* td);
 
 bool td_initialized(oe_sgx_td_t* td);
 
+void td_register_caches(oe_sgx_td_t* td);
+
+void td_free_caches(void (*free_caches)(oe_sgx_td_t* td));
+
 /*
 **==============================================================================
 **
@@ -3,6 +3,7 @@
 
 #include <openenclave/host.h>
 #include <openenclave/internal/raise.h>
+#include <openenclave/internal/safemath.h>
 
 #include "calls.h"
 #include "ecall_ids.h"
@@ -109,3 +110,89 @@ oe_result_t oe_call_enclave_function(
 done:
     return result;
 }
+
+/*
+**==============================================================================
+**
+** oe_call_enclave_function_batch()
+**
+** Call several enclave functions with one OE_ECALL_CALL_ENCLAVE_FUNCTION_BATCH.
+**
+**==============================================================================
+*/
+
+oe_result_t oe_call_enclave_function_batch(
+    oe_enclave_t* enclave,
+    oe_enclave_function_call_t* calls,
+    size_t num_calls)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_call_enclave_function_batch_args_t batch_args;
+    oe_call_enclave_function_args_t* args = NULL;
+    size_t size = 0;
+
+    /* Reject invalid parameters */
+    if (!enclave || !calls || !num_calls)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    OE_CHECK(oe_safe_mul_sizet(num_calls, sizeof(*args), &size));
+
+    if (!(args = (oe_call_enclave_function_args_t*)malloc(size)))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    /* Initialize the call_enclave_args structures */
+    for (size_t i = 0; i < num_calls; i++)
+    {
+        oe_enclave_function_call_t* call = &calls[i];
+        uint64_t function_id = OE_UINT64_MAX;
+
+        /* A call whose function is not found is still passed on so that
+         * the enclave rejects it, but keeps the result of the lookup */
+        call->output_bytes_written = 0;
+        call->result =
+            oe_get_ecall_ids(enclave, call->name, call->global_id, &function_id);
+
+        args[i].function_id = function_id;
+        args[i].input_buffer = call->input_buffer;
+        args[i].input_buffer_size = call->input_buffer_size;
+        args[i].output_buffer = call->output_buffer;
+        args[i].output_buffer_size = call->output_buffer_size;
+        args[i].output_bytes_written = 0;
+        args[i].result = OE_UNEXPECTED;
+    }
+
+    batch_args.calls = args;
+    batch_args.num_calls = num_calls;
+
+    /* Perform the ECALL */
+    {
+        uint64_t arg_out = 0;
+
+        OE_CHECK(oe_ecall(
+            enclave,
+            OE_ECALL_CALL_ENCLAVE_FUNCTION_BATCH,
+            (uint64_t)&batch_args,
+            &arg_out));
+        OE_CHECK((oe_result_t)arg_out);
+    }
+
+    /* Collect the results */
+    for (size_t i = 0; i < num_calls; i++)
+    {
+        oe_enclave_function_call_t* call = &calls[i];
+
+        if (call->result != OE_OK)
+            continue;
+
+        call->result = args[i].result;
+
+        if (call->result == OE_OK)
+            call->output_bytes_written = args[i].output_bytes_written;
+    }
+
+    result = OE_OK;
+
+done:
+    free(args);
+    return result;
+}
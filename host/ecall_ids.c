@@ -2,74 +2,210 @@
 // Licensed under the MIT License.
 
 #include "ecall_ids.h"
+#include <openenclave/internal/atomic.h>
 #include <openenclave/internal/raise.h>
 #include <stdlib.h>
+#include <string.h>
 #include "hostthread.h"
 
-// Initial size of ecall table mapping ecall names to global id.
-// Most enclaves in OE SDK repo have fewer than 16 ecalls.
-#define OE_ECALL_TABLE_INITIAL_SIZE 16
+/*
+**==============================================================================
+**
+** Global ECALL id table
+**
+**     Every distinct ECALL name used by the process is assigned a global id,
+**     which indexes the per-enclave ecall id tables. The names are kept in an
+**     open-addressing hash table that is read without locking: a name is
+**     published by storing a pointer to its immutable record into an empty
+**     slot, and a full table is replaced by a larger copy instead of being
+**     resized in place. Replaced tables are kept until the program exits, so
+**     that concurrent readers can still scan them. A reader that misses a
+**     name (e.g., because it scanned a replaced table) takes the lock and
+**     looks it up again before assigning a new id.
+**
+**==============================================================================
+*/
+
+// Initial number of slots of the ecall table. Most enclaves in OE SDK repo
+// have fewer than 16 ecalls. The table is kept at most 3/4 full.
+#define OE_ECALL_TABLE_INITIAL_CAPACITY 32
+
+typedef struct _ecall_name
+{
+    const char* name;
+    uint64_t hash;
+    uint64_t global_id;
+} ecall_name_t;
+
+typedef struct _ecall_table
+{
+    /* The smaller table that this table replaced */
+    struct _ecall_table* replaced;
+
+    /* Number of slots, a power of two */
+    uint64_t capacity;
+
+    /* The slots, which follow this header in the same allocation */
+    ecall_name_t* volatile* slots;
+} ecall_table_t;
 
-/* The maximum numer of different ecalls that an application can make is
- * bounded. */
-static const char** _ecall_table;
-static uint32_t _ecall_table_capacity;
-static uint32_t _ecall_table_size;
+static ecall_table_t* volatile _ecall_table;
 
-/* Mutex for assigning/looking up global ids in a thread-safe manner. */
+/* Number of names in the table, which is also the next global id. Only
+ * accessed with the lock held. */
+static uint64_t _ecall_table_size;
+
+/* Mutex for assigning new global ids in a thread-safe manner. */
 static oe_mutex _lock = OE_H_MUTEX_INITIALIZER;
 
 /* Cleanup memory during program terminaton */
 static void _free_ecall_table(void)
 {
-    oe_free((void*)_ecall_table);
+    ecall_table_t* table = _ecall_table;
+
+    if (!table)
+        return;
+
+    for (uint64_t i = 0; i < table->capacity; i++)
+        oe_free(table->slots[i]);
+
+    while (table)
+    {
+        ecall_table_t* replaced = table->replaced;
+        oe_free(table);
+        table = replaced;
+    }
 }
 
-/* Get the global ecall id from the _ecall_table. Locking must be done by
- * caller. */
-static oe_result_t _get_global_id(const char* name, uint64_t* global_id)
+/* 64-bit FNV-1a hash of the ecall name */
+static uint64_t _hash_name(const char* name)
 {
-    oe_result_t result = OE_NOT_FOUND;
-    if (!name || !global_id)
-        OE_RAISE(OE_INVALID_PARAMETER);
+    uint64_t hash = 14695981039346656037ULL;
 
-    /* Search for id assigned for given name. */
-    for (uint64_t i = 0; i < _ecall_table_size; i++)
+    for (const unsigned char* p = (const unsigned char*)name; *p; p++)
     {
-        if (strcmp(_ecall_table[i], name) == 0)
+        hash ^= *p;
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+/* Look up the global id of the given name without locking. */
+static bool _find_global_id(
+    const char* name,
+    uint64_t hash,
+    uint64_t* global_id)
+{
+    ecall_table_t* table = _ecall_table;
+
+    if (!table)
+        return false;
+
+    for (uint64_t i = hash & (table->capacity - 1);;
+         i = (i + 1) & (table->capacity - 1))
+    {
+        const ecall_name_t* entry = table->slots[i];
+
+        if (!entry)
+            return false;
+
+        if (entry->hash == hash && strcmp(entry->name, name) == 0)
         {
-            *global_id = i;
-            break;
+            *global_id = entry->global_id;
+            return true;
         }
     }
+}
 
-    /* If the name is not found, adding it to the table. */
-    if (*global_id == OE_GLOBAL_ECALL_ID_NULL)
+/* Store the entry into the first empty slot of its probe sequence. */
+static void _insert_entry(ecall_table_t* table, ecall_name_t* entry)
+{
+    uint64_t i = entry->hash & (table->capacity - 1);
+
+    while (table->slots[i])
+        i = (i + 1) & (table->capacity - 1);
+
+    oe_atomic_compare_and_swap_ptr(
+        (void* volatile*)&table->slots[i], NULL, entry);
+}
+
+/* Replace a table that is 3/4 full by one twice its size. Locking must be
+ * done by caller. */
+static oe_result_t _grow_ecall_table(void)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    ecall_table_t* table = _ecall_table;
+    ecall_table_t* new_table = NULL;
+    uint64_t capacity = OE_ECALL_TABLE_INITIAL_CAPACITY;
+
+    if (table)
+    {
+        if ((_ecall_table_size + 1) * 4 <= table->capacity * 3)
+            return OE_OK;
+
+        capacity = table->capacity * 2;
+    }
+
+    new_table = (ecall_table_t*)oe_malloc(
+        sizeof(ecall_table_t) + capacity * sizeof(ecall_name_t*));
+    if (!new_table)
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    new_table->replaced = table;
+    new_table->capacity = capacity;
+    new_table->slots = (ecall_name_t* volatile*)(new_table + 1);
+    memset((void*)new_table->slots, 0, capacity * sizeof(ecall_name_t*));
+
+    if (table)
     {
-        // Resize table if needed.
-        if (_ecall_table_size == _ecall_table_capacity)
+        for (uint64_t i = 0; i < table->capacity; i++)
         {
-            if (!_ecall_table)
-            {
-                _ecall_table_capacity = OE_ECALL_TABLE_INITIAL_SIZE;
-                atexit(_free_ecall_table);
-            }
-            else
-            {
-                _ecall_table_capacity *= 2;
-            }
-            _ecall_table = oe_realloc(
-                (void*)_ecall_table, _ecall_table_capacity * sizeof(char*));
-            if (!_ecall_table)
-                OE_RAISE(OE_OUT_OF_MEMORY);
+            if (table->slots[i])
+                _insert_entry(new_table, table->slots[i]);
         }
-
-        _ecall_table[_ecall_table_size] = name;
-        *global_id = _ecall_table_size;
-        _ecall_table_size++;
+    }
+    else
+    {
+        atexit(_free_ecall_table);
     }
 
+    oe_atomic_compare_and_swap_ptr(
+        (void* volatile*)&_ecall_table, table, new_table);
     result = OE_OK;
+
+done:
+    return result;
+}
+
+/* Assign a global id to a name that is not in the table yet. Locking must be
+ * done by caller. */
+static oe_result_t _add_global_id(
+    const char* name,
+    uint64_t hash,
+    uint64_t* global_id)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    ecall_name_t* entry = NULL;
+
+    /* Another thread may have added the name since the caller looked. */
+    if (_find_global_id(name, hash, global_id))
+        return OE_OK;
+
+    OE_CHECK(_grow_ecall_table());
+
+    if (!(entry = (ecall_name_t*)oe_malloc(sizeof(ecall_name_t))))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    entry->name = name;
+    entry->hash = hash;
+    entry->global_id = _ecall_table_size;
+    _insert_entry(_ecall_table, entry);
+
+    *global_id = _ecall_table_size;
+    _ecall_table_size++;
+    result = OE_OK;
+
 done:
     return result;
 }
@@ -78,11 +214,21 @@ oe_result_t oe_get_global_id(const char* name, uint64_t* global_id)
 {
     oe_result_t result = OE_UNEXPECTED;
     bool locked = false;
+    uint64_t hash;
+
+    if (!name || !global_id)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    hash = _hash_name(name);
+
+    if (_find_global_id(name, hash, global_id))
+        return OE_OK;
+
     if (oe_mutex_lock(&_lock) != 0)
         OE_RAISE(OE_FAILURE);
     locked = true;
 
-    result = _get_global_id(name, global_id);
+    result = _add_global_id(name, hash, global_id);
 done:
     if (locked)
         oe_mutex_unlock(&_lock);
@@ -149,25 +295,22 @@ oe_result_t oe_register_ecalls(
     oe_ecall_id_t* ecall_id_table = NULL;
     uint64_t max_global_id = 0;
     uint64_t ecall_id_table_size = 0;
-    bool locked = false;
 
     /* Validate parameters */
     if (!enclave || !ecall_info_table || !num_ecalls)
         OE_RAISE(OE_INVALID_PARAMETER);
 
-    if (oe_mutex_lock(&_lock) != 0)
-        OE_RAISE(OE_FAILURE);
-    locked = true;
-
     /* Iterate through the ecalls and assign global ids.
-     * Also find out the maximum global id for the enclave. */
+     * Also find out the maximum global id for the enclave.
+     * Global ids never change once assigned, so the lock is only taken
+     * for names that have not been seen before. */
     for (uint32_t i = 0; i < num_ecalls; i++)
     {
         uint64_t global_id = OE_GLOBAL_ECALL_ID_NULL;
         const char* name = ecall_info_table[i].name;
 
-        /* Assign a proper global id based on the global __ecall_table. */
-        OE_CHECK(_get_global_id(name, &global_id));
+        /* Assign a proper global id based on the global ecall table. */
+        OE_CHECK(oe_get_global_id(name, &global_id));
         if (global_id > max_global_id)
             max_global_id = global_id;
     }
@@ -189,7 +332,7 @@ oe_result_t oe_register_ecalls(
         const char* name = ecall_info_table[i].name;
         uint64_t local_id = i;
 
-        OE_CHECK(_get_global_id(name, &global_id));
+        OE_CHECK(oe_get_global_id(name, &global_id));
         ecall_id_table[global_id].id = local_id;
     }
 
@@ -199,8 +342,5 @@ oe_result_t oe_register_ecalls(
     result = OE_OK;
 
 done:
-    if (locked)
-        oe_mutex_unlock(&_lock);
-
     return result;
 }
@@ -102,6 +102,42 @@ oe_thread_t oe_thread_self(void);
  */
 int oe_thread_equal(oe_thread_t thread1, oe_thread_t thread2);
 
+/**
+ * Restricts the calling thread to a set of CPUs.
+ *
+ * This function sets the CPU affinity of the calling thread, so that the
+ * scheduler only runs it on the given CPUs from then on.
+ *
+ * @param cpus The numbers of the CPUs.
+ * @param num_cpus The number of entries of cpus, which must not be zero.
+ *
+ * @returns Returns zero on success.
+ */
+int oe_thread_set_affinity(const uint32_t* cpus, size_t num_cpus);
+
+/**
+ * Returns the NUMA node that the calling thread runs on.
+ *
+ * The scheduler may move the thread to another node later, unless its
+ * affinity prevents it.
+ *
+ * @returns Returns the number of the node, or -1 if it is unknown.
+ */
+int oe_thread_get_numa_node(void);
+
+/**
+ * Gets the CPUs of a NUMA node.
+ *
+ * @param node The number of the node, as returned by oe_thread_get_numa_node().
+ * @param cpus The array of CPU numbers to fill.
+ * @param num_cpus On input, the number of entries of cpus. On output, the
+ * number of CPUs of the node.
+ *
+ * @returns Returns zero on success. Returns non-zero if the node is unknown,
+ * or if cpus is too small, in which case num_cpus is set all the same.
+ */
+int oe_get_numa_node_cpus(int node, uint32_t* cpus, size_t* num_cpus);
+
 /**
  * Calls the given function exactly once.
  *
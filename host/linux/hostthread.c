@@ -3,8 +3,15 @@
 
 #include "../hostthread.h"
 #include <assert.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
 #include <openenclave/host.h>
 #include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 /*
 **==============================================================================
@@ -33,6 +40,120 @@ int oe_thread_equal(oe_thread_t thread1, oe_thread_t thread2)
     return pthread_equal((pthread_t)thread1, (pthread_t)thread2);
 }
 
+/*
+**==============================================================================
+**
+** CPU affinity and NUMA nodes
+**
+**==============================================================================
+*/
+
+int oe_thread_set_affinity(const uint32_t* cpus, size_t num_cpus)
+{
+    cpu_set_t set;
+
+    if (!cpus || num_cpus == 0)
+        return EINVAL;
+
+    CPU_ZERO(&set);
+    for (size_t i = 0; i < num_cpus; i++)
+    {
+        if (cpus[i] >= CPU_SETSIZE)
+            return EINVAL;
+
+        CPU_SET(cpus[i], &set);
+    }
+
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+int oe_thread_get_numa_node(void)
+{
+    char path[64];
+    DIR* dir;
+    struct dirent* entry;
+    int cpu = sched_getcpu();
+    int node = -1;
+
+    if (cpu < 0)
+        return -1;
+
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+    if (!(dir = opendir(path)))
+        return -1;
+
+    // The directory of the CPU links to its node as nodeN.
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if (strncmp(entry->d_name, "node", 4) == 0 &&
+            isdigit((unsigned char)entry->d_name[4]))
+        {
+            node = atoi(entry->d_name + 4);
+            break;
+        }
+    }
+
+    closedir(dir);
+    return node;
+}
+
+int oe_get_numa_node_cpus(int node, uint32_t* cpus, size_t* num_cpus)
+{
+    char path[64];
+    char list[4096];
+    FILE* file;
+    const char* p = list;
+    size_t count = 0;
+
+    if (node < 0 || !num_cpus || (*num_cpus && !cpus))
+        return EINVAL;
+
+    snprintf(
+        path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+    if (!(file = fopen(path, "r")))
+        return ENOENT;
+
+    if (!fgets(list, sizeof(list), file))
+    {
+        fclose(file);
+        return EIO;
+    }
+
+    fclose(file);
+
+    // The list holds ranges of CPUs, such as 0-15,32-47.
+    while (isdigit((unsigned char)*p))
+    {
+        char* end;
+        unsigned long first = strtoul(p, &end, 10);
+        unsigned long last = first;
+
+        if (*end == '-')
+            last = strtoul(end + 1, &end, 10);
+
+        if (last >= CPU_SETSIZE)
+            return EINVAL;
+
+        for (unsigned long cpu = first; cpu <= last; cpu++)
+        {
+            if (count < *num_cpus)
+                cpus[count] = (uint32_t)cpu;
+            count++;
+        }
+
+        p = *end == ',' ? end + 1 : end;
+    }
+
+    if (count > *num_cpus)
+    {
+        *num_cpus = count;
+        return ERANGE;
+    }
+
+    *num_cpus = count;
+    return 0;
+}
+
 /*
 **==============================================================================
 **
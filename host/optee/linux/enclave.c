@@ -538,6 +538,28 @@ oe_result_t oe_ecall(
         result = _handle_call_enclave_function(
             enclave, (oe_call_enclave_function_args_t*)arg_in);
     }
+    else if (func == OE_ECALL_CALL_ENCLAVE_FUNCTION_BATCH)
+    {
+        /* There is no batched entry into a TA, so make the calls one by
+         * one */
+        oe_call_enclave_function_batch_args_t* batch_args =
+            (oe_call_enclave_function_batch_args_t*)arg_in;
+
+        if (!batch_args)
+            OE_RAISE(OE_INVALID_PARAMETER);
+
+        for (uint64_t i = 0; i < batch_args->num_calls; i++)
+        {
+            oe_call_enclave_function_args_t* args = &batch_args->calls[i];
+            oe_result_t call_result =
+                _handle_call_enclave_function(enclave, args);
+
+            if (call_result != OE_OK)
+                args->result = call_result;
+        }
+
+        result = OE_OK;
+    }
     else
     {
         result = _handle_call_builtin_function(enclave, func, arg_in, arg_out);
@@ -582,3 +604,65 @@ oe_result_t oe_terminate_enclave(oe_enclave_t* enclave)
 done:
     return result;
 }
+
+oe_result_t oe_enable_call_statistics(oe_enclave_t* enclave, bool enable)
+{
+    OE_UNUSED(enclave);
+    OE_UNUSED(enable);
+    return OE_UNSUPPORTED;
+}
+
+oe_result_t oe_get_call_statistics(
+    oe_enclave_t* enclave,
+    oe_call_statistics_t* statistics,
+    size_t* count)
+{
+    OE_UNUSED(enclave);
+    OE_UNUSED(statistics);
+    OE_UNUSED(count);
+    return OE_UNSUPPORTED;
+}
+
+oe_result_t oe_reset_call_statistics(oe_enclave_t* enclave)
+{
+    OE_UNUSED(enclave);
+    return OE_UNSUPPORTED;
+}
+
+oe_result_t oe_get_switchless_pool_statistics(
+    oe_enclave_t* enclave,
+    oe_switchless_pool_statistics_t* statistics)
+{
+    OE_UNUSED(enclave);
+    OE_UNUSED(statistics);
+    return OE_UNSUPPORTED;
+}
+
+oe_result_t oe_get_switchless_statistics(
+    oe_enclave_t* enclave,
+    oe_switchless_statistics_t* statistics,
+    oe_switchless_worker_statistics_t* workers,
+    size_t* num_workers)
+{
+    OE_UNUSED(enclave);
+    OE_UNUSED(statistics);
+    OE_UNUSED(workers);
+    OE_UNUSED(num_workers);
+    return OE_UNSUPPORTED;
+}
+
+oe_result_t oe_get_heap_profile(
+    oe_enclave_t* enclave,
+    char** profile,
+    size_t* profile_size)
+{
+    OE_UNUSED(enclave);
+    OE_UNUSED(profile);
+    OE_UNUSED(profile_size);
+    return OE_UNSUPPORTED;
+}
+
+void oe_free_heap_profile(char* profile)
+{
+    OE_UNUSED(profile);
+}
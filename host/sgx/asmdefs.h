@@ -56,7 +56,8 @@ int __oe_dispatch_ocall(
     uint64_t* arg1_out,
     uint64_t* arg2_out,
     void* tcs,
-    oe_enclave_t* enclave);
+    oe_enclave_t* enclave,
+    oe_ecall_context_t* ecall_context);
 #endif
 
 #ifndef __ASSEMBLER__
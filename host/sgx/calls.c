@@ -20,12 +20,14 @@
 
 #include <openenclave/bits/sgx/sgxtypes.h>
 #include <openenclave/host.h>
+#include <openenclave/internal/atomic.h>
 #include <openenclave/internal/calls.h>
 #include <openenclave/internal/debugrt/host.h>
 #include <openenclave/internal/raise.h>
 #include <openenclave/internal/registers.h>
 #include <openenclave/internal/safecrt.h>
 #include <openenclave/internal/safemath.h>
+#include <openenclave/internal/sgx/postedcalls.h>
 #include <openenclave/internal/sgx/td.h>
 #include <openenclave/internal/switchless.h>
 #include <openenclave/internal/utils.h>
@@ -50,8 +52,14 @@
 static oe_once_type _thread_binding_once;
 static oe_thread_key _thread_binding_key;
 
+/* The binding last released by the current thread (see _assign_tcs()) */
+static oe_thread_key _binding_cache_key;
+
 static void _create_thread_binding_key(void)
 {
+    /* Create the thread binding key last, so that it remains the most
+     * recently created key (tests/abi relies on this) */
+    oe_thread_key_create(&_binding_cache_key);
     oe_thread_key_create(&_thread_binding_key);
 }
 
@@ -313,7 +321,10 @@ static const char* oe_ecall_str(oe_func_t ecall)
         "INIT_ENCLAVE",
         "CALL_ENCLAVE_FUNCTION",
         "VIRTUAL_EXCEPTION_HANDLER",
-        "CALL_AT_EXIT_FUNCTIONS"
+        "CALL_AT_EXIT_FUNCTIONS",
+        "CALL_ENCLAVE_FUNCTION_BATCH",
+        "INIT_HOST_MEMORY_POOL",
+        "GET_HEAP_PROFILE"
     };
     // clang-format on
 
@@ -361,8 +372,16 @@ static oe_result_t _handle_ocall(
     switch ((oe_func_t)func)
     {
         case OE_OCALL_CALL_HOST_FUNCTION:
-            OE_CHECK(oe_handle_call_host_function(arg_in, enclave));
+        {
+            uint64_t start = oe_start_ocall_profile(enclave);
+            oe_result_t call_result;
+
+            oe_count_switchless_fallback(enclave, (uint64_t)tcs, arg_in);
+            call_result = oe_handle_call_host_function(arg_in, enclave);
+            oe_finish_ocall_profile(enclave, arg_in, start);
+            OE_CHECK(call_result);
             break;
+        }
 
         case OE_OCALL_MALLOC:
             HandleMalloc(arg_in, arg_out);
@@ -398,6 +417,232 @@ done:
     return result;
 }
 
+/*
+**==============================================================================
+**
+** _grow_ocall_buffer()
+**
+**     Called after an OCALL_CALL_HOST_FUNCTION to grow the ocall buffer of
+**     the binding if the parameters of the ocall did not fit into it. In that
+**     case the enclave had to allocate the parameters with oe_host_malloc(),
+**     which costs an OCALL_MALLOC and an OCALL_FREE around the actual ocall.
+**     The new buffer is published through the ecall context before
+**     returning to the enclave, so subsequent ocalls of the same size need a
+**     single transition.
+**
+**     The buffer is only replaced if the binding is not nested (count == 1).
+**     Otherwise the enclave may still be using the current buffer for an
+**     outer ocall.
+**
+**==============================================================================
+*/
+
+static void _grow_ocall_buffer(
+    oe_enclave_t* enclave,
+    void* tcs,
+    uint64_t arg,
+    oe_ecall_context_t* ecall_context)
+{
+    oe_call_host_function_args_t* args = (oe_call_host_function_args_t*)arg;
+    oe_thread_binding_t* binding;
+    uint64_t needed;
+    uint64_t max_size;
+    uint64_t size;
+    void* buffer;
+
+    if (!args || !ecall_context)
+        return;
+
+    binding = oe_get_binding_by_tcs(enclave, (uint64_t)tcs);
+
+    if (!binding || binding->count != 1 || !binding->ocall_buffer)
+        return;
+
+    // The parameters were marshaled into the ocall buffer.
+    if (args->input_buffer == binding->ocall_buffer)
+        return;
+
+    if (oe_safe_add_u64(
+            args->input_buffer_size, args->output_buffer_size, &needed) !=
+        OE_OK)
+        return;
+
+    // The ocall buffer must remain 8-byte aligned in size.
+    max_size = enclave->max_ocall_buffer_size & ~(uint64_t)7;
+
+    if (needed <= binding->ocall_buffer_size || needed > max_size)
+        return;
+
+    // Grow geometrically so that a few differently sized ocalls do not each
+    // cause a reallocation.
+    size = binding->ocall_buffer_size;
+    while (size < needed)
+        size *= 2;
+
+    if (size > max_size)
+        size = max_size;
+
+    if (!(buffer = malloc(size)))
+        return;
+
+    free(binding->ocall_buffer);
+    binding->ocall_buffer = buffer;
+    binding->ocall_buffer_size = size;
+
+    ecall_context->ocall_buffer = buffer;
+    ecall_context->ocall_buffer_size = size;
+}
+
+/*
+**==============================================================================
+**
+** _process_posted_calls()
+**
+**     Execute the calls the enclave has posted to the queue of the binding
+**     since the last transition (see postedcalls.h). This is done before an
+**     OCALL is dispatched and after the ECALL returns, so posted calls are
+**     executed in the order the enclave made them, relative to each other and
+**     to synchronous OCALLs. The queue is also drained when EENTER fails or
+**     the enclave aborts, so it is always empty when the binding is released.
+**
+**     Host functions may call back into the enclave, which may post further
+**     calls to the same queue. The entries are therefore copied out and the
+**     queue is emptied before any of them is executed.
+**
+**==============================================================================
+*/
+
+static void _call_posted_host_function(
+    oe_enclave_t* enclave,
+    const oe_posted_call_t* call)
+{
+    oe_call_host_function_args_t args = {0};
+    void* output_buffer;
+
+    /* The enclave does not read the output, but the host function expects
+     * to be able to write its out parameters and return value. */
+    if (!(output_buffer = malloc(
+              call->output_buffer_size ? call->output_buffer_size
+                                       : OE_EDGER8R_BUFFER_ALIGNMENT)))
+        return;
+
+    args.function_id = call->arg;
+    args.input_buffer = (void*)(call + 1);
+    args.input_buffer_size = call->input_buffer_size;
+    args.output_buffer = output_buffer;
+    args.output_buffer_size = call->output_buffer_size;
+    args.result = OE_UNEXPECTED;
+
+    if (oe_handle_call_host_function((uint64_t)&args, enclave) != OE_OK)
+        OE_TRACE_ERROR("posted host function %llu failed", OE_LLU(call->arg));
+
+    free(output_buffer);
+}
+
+static void _process_posted_calls(
+    oe_enclave_t* enclave,
+    oe_thread_binding_t* binding)
+{
+    oe_posted_calls_t* queue;
+    uint64_t used;
+    uint8_t* entries = NULL;
+    uint64_t offset = 0;
+
+    if (!binding || !(queue = (oe_posted_calls_t*)binding->posted_calls))
+        return;
+
+    if ((used = queue->used) == 0)
+        return;
+
+    if (used <= binding->posted_calls_size - sizeof(*queue))
+        entries = (uint8_t*)malloc(used);
+
+    if (entries)
+        memcpy(entries, queue + 1, used);
+    else
+        OE_TRACE_ERROR("dropping %llu bytes of posted calls", OE_LLU(used));
+
+    queue->used = 0;
+
+    while (entries && used - offset >= sizeof(oe_posted_call_t))
+    {
+        const oe_posted_call_t* call = (oe_posted_call_t*)(entries + offset);
+
+        if (call->input_buffer_size > used - offset - sizeof(*call))
+            break;
+
+        if (call->func == OE_OCALL_FREE)
+            free((void*)call->arg);
+        else if (call->func == OE_OCALL_CALL_HOST_FUNCTION)
+            _call_posted_host_function(enclave, call);
+
+        offset += sizeof(*call) + call->input_buffer_size;
+    }
+
+    free(entries);
+}
+
+/*
+**==============================================================================
+**
+** _record_ecall() / _record_ocall()
+**
+**     Record a call in the call statistics of the binding it was made on
+**     (see callstats.c). EDL calls are recorded by their function id and
+**     all other calls by their internal function number.
+**
+**==============================================================================
+*/
+
+static void _record_ecall(
+    oe_enclave_t* enclave,
+    oe_thread_binding_t* binding,
+    uint16_t func,
+    uint64_t arg,
+    uint64_t start)
+{
+    if (func == OE_ECALL_CALL_ENCLAVE_FUNCTION && arg)
+        oe_record_call(
+            enclave,
+            &binding->call_statistics,
+            OE_CALL_KIND_ECALL,
+            ((oe_call_enclave_function_args_t*)arg)->function_id,
+            start);
+    else
+        oe_record_call(
+            enclave,
+            &binding->call_statistics,
+            OE_CALL_KIND_INTERNAL_ECALL,
+            func,
+            start);
+}
+
+static void _record_ocall(
+    oe_enclave_t* enclave,
+    oe_thread_binding_t* binding,
+    uint16_t func,
+    uint64_t arg,
+    uint64_t start)
+{
+    if (!binding)
+        return;
+
+    if (func == OE_OCALL_CALL_HOST_FUNCTION && arg)
+        oe_record_call(
+            enclave,
+            &binding->call_statistics,
+            OE_CALL_KIND_OCALL,
+            ((oe_call_host_function_args_t*)arg)->function_id,
+            start);
+    else
+        oe_record_call(
+            enclave,
+            &binding->call_statistics,
+            OE_CALL_KIND_INTERNAL_OCALL,
+            func,
+            start);
+}
+
 /*
 **==============================================================================
 **
@@ -426,7 +671,8 @@ int __oe_dispatch_ocall(
     uint64_t* arg1_out,
     uint64_t* arg2_out,
     void* tcs_,
-    oe_enclave_t* enclave)
+    oe_enclave_t* enclave,
+    oe_ecall_context_t* ecall_context)
 {
     const oe_code_t code = oe_get_code_from_call_arg1(arg1);
     const uint16_t func = oe_get_func_from_call_arg1(arg1);
@@ -440,14 +686,31 @@ int __oe_dispatch_ocall(
         // may result in overriding the thread-binding. Therefore,
         // upon return from the OCALL, the binding must be restored.
         oe_thread_binding_t* binding = oe_get_thread_binding();
+        oe_thread_binding_t* tcs_binding =
+            oe_get_binding_by_tcs(enclave, (uint64_t)tcs);
         uint64_t arg_out = 0;
+        uint64_t start = 0;
+
+        // Calls posted by the enclave precede this OCALL.
+        _process_posted_calls(enclave, tcs_binding);
+
+        if (enclave->call_statistics_enabled)
+            start = oe_call_statistics_now();
 
         oe_result_t result = _handle_ocall(enclave, tcs, func, arg, &arg_out);
+
+        if (start)
+            _record_ocall(enclave, tcs_binding, func, arg, start);
+
         *arg1_out = oe_make_call_arg1(OE_CODE_ORET, func, 0, result);
         *arg2_out = arg_out;
 
         // Restore the binding.
         _set_thread_binding(binding);
+
+        if (func == OE_OCALL_CALL_HOST_FUNCTION && result == OE_OK)
+            _grow_ocall_buffer(enclave, tcs, arg, ecall_context);
+
         return 0;
     }
 
@@ -455,6 +718,160 @@ int __oe_dispatch_ocall(
     return 1;
 }
 
+/*
+**==============================================================================
+**
+** Thread binding allocation
+**
+**     Free thread bindings are tracked by the enclave->free_bindings bitmap.
+**     A binding is claimed by atomically clearing its bit and released by
+**     atomically setting it again, so neither ECALL nor ERET takes the
+**     enclave lock.
+**
+**     Each host thread also remembers the binding it released last (see
+**     _binding_cache_key). The next ECALL from the same thread into the same
+**     enclave first tries to reclaim that binding, which keeps host threads
+**     affine to a TCS (and to its ocall buffer) and avoids scanning the
+**     bitmap in the common case.
+**
+**==============================================================================
+*/
+
+static oe_thread_binding_t* _get_cached_binding(void)
+{
+    oe_once(&_thread_binding_once, _create_thread_binding_key);
+    return (oe_thread_binding_t*)oe_thread_getspecific(_binding_cache_key);
+}
+
+static void _set_cached_binding(oe_thread_binding_t* binding)
+{
+    oe_once(&_thread_binding_once, _create_thread_binding_key);
+    oe_thread_setspecific(_binding_cache_key, binding);
+}
+
+/* Whether the binding is one of the bindings of the given enclave. This only
+ * compares addresses and never dereferences the binding, which may be stale
+ * (e.g., cached from an enclave that has since been terminated and whose
+ * memory was reused, so it may even point into the middle of a binding). */
+OE_INLINE bool _is_enclave_binding(
+    const oe_enclave_t* enclave,
+    const oe_thread_binding_t* binding)
+{
+    uint64_t first = (uint64_t)&enclave->bindings[0];
+    uint64_t last = (uint64_t)&enclave->bindings[enclave->num_bindings];
+
+    return (uint64_t)binding >= first && (uint64_t)binding < last &&
+           ((uint64_t)binding - first) % sizeof(*binding) == 0;
+}
+
+OE_INLINE size_t _lowest_set_bit(uint64_t value)
+{
+#if defined(__GNUC__)
+    return (size_t)__builtin_ctzll(value);
+#elif defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanForward64(&index, value);
+    return (size_t)index;
+#endif
+}
+
+static bool _try_claim_binding(oe_enclave_t* enclave, size_t index)
+{
+    volatile uint64_t* word = &enclave->free_bindings[index / 64];
+    const uint64_t mask = 1ULL << (index % 64);
+    uint64_t value;
+
+    while ((value = oe_atomic_load(word)) & mask)
+    {
+        if (oe_atomic_compare_and_swap(
+                (volatile int64_t*)word,
+                (int64_t)value,
+                (int64_t)(value & ~mask)))
+            return true;
+    }
+
+    return false;
+}
+
+static oe_thread_binding_t* _claim_free_binding(oe_enclave_t* enclave)
+{
+    const size_t num_words = (enclave->num_bindings + 63) / 64;
+
+    for (size_t i = 0; i < num_words; i++)
+    {
+        uint64_t value;
+
+        /* Retry within the word until it is either claimed or exhausted */
+        while ((value = oe_atomic_load(&enclave->free_bindings[i])) != 0)
+        {
+            size_t index = i * 64 + _lowest_set_bit(value);
+
+            if (_try_claim_binding(enclave, index))
+                return &enclave->bindings[index];
+        }
+    }
+
+    return NULL;
+}
+
+static void _free_binding(oe_enclave_t* enclave, size_t index)
+{
+    volatile uint64_t* word = &enclave->free_bindings[index / 64];
+    const uint64_t mask = 1ULL << (index % 64);
+    uint64_t value;
+
+    do
+    {
+        value = oe_atomic_load(word);
+    } while (!oe_atomic_compare_and_swap(
+        (volatile int64_t*)word, (int64_t)value, (int64_t)(value | mask)));
+}
+
+void oe_update_thread_binding_flags(
+    oe_thread_binding_t* binding,
+    uint64_t set,
+    uint64_t clear)
+{
+    uint64_t value;
+
+    do
+    {
+        value = oe_atomic_load(&binding->flags);
+    } while (!oe_atomic_compare_and_swap(
+        (volatile int64_t*)&binding->flags,
+        (int64_t)value,
+        (int64_t)((value | set) & ~clear)));
+}
+
+/* Whether the binding is busy and owned by the given thread. The thread is
+ * stored before the binding is marked busy and cleared after it is marked
+ * free, so only the owner can match. */
+static bool _is_owned_binding(
+    oe_thread_binding_t* binding,
+    oe_thread_t thread)
+{
+    return (oe_atomic_load(&binding->flags) & _OE_THREAD_BUSY) &&
+           oe_atomic_load(&binding->thread) == thread;
+}
+
+/* Find the binding of the given enclave that is owned by the calling thread.
+ * Only bindings owned by the calling thread can match, so no lock is
+ * needed. */
+static oe_thread_binding_t* _find_owned_binding(
+    oe_enclave_t* enclave,
+    oe_thread_t thread)
+{
+    for (size_t i = 0; i < enclave->num_bindings; i++)
+    {
+        oe_thread_binding_t* binding = &enclave->bindings[i];
+
+        if (_is_owned_binding(binding, thread))
+            return binding;
+    }
+
+    return NULL;
+}
+
 /*
 **==============================================================================
 **
@@ -465,72 +882,66 @@ int __oe_dispatch_ocall(
 **         - an enclave thread context
 **
 **     If such a binding already exists, the binding's count in incremented.
-**     Else, the calling host thread is bound to the first available enclave
-**     thread context.
+**     Else, the calling host thread is bound to the enclave thread context it
+**     used last (if still available) or to any available one.
+**
+**     The binding is stored in TSD for the duration of the call. The caller
+**     passes the previous value to _release_tcs(), which restores it.
 **
-**     Returns the address of the thread control structure (TCS) corresponding
-**     to the enclave thread context.
+**     Returns the binding, whose tcs field is the address of the thread
+**     control structure (TCS) corresponding to the enclave thread context.
 **
 **==============================================================================
 */
 
-static void* _assign_tcs(oe_enclave_t* enclave)
+static oe_thread_binding_t* _assign_tcs(oe_enclave_t* enclave)
 {
-    void* tcs = NULL;
-    size_t i;
     oe_thread_t thread = oe_thread_self();
+    oe_thread_binding_t* binding = oe_get_thread_binding();
 
-    oe_mutex_lock(&enclave->lock);
+    /* First attempt to find a busy binding owned by this thread. The current
+     * binding is usually the one. If the thread is bound to another enclave,
+     * it may still own a binding of this enclave further up the call stack
+     * (enclave -> host -> other enclave -> host -> enclave). */
+    if (binding)
     {
-        /* First attempt to find a busy oe_sgx_td_t owned by this thread */
-        for (i = 0; i < enclave->num_bindings; i++)
-        {
-            oe_thread_binding_t* binding = &enclave->bindings[i];
-
-            if ((binding->flags & _OE_THREAD_BUSY) && binding->thread == thread)
-            {
-                binding->count++;
-                tcs = (void*)binding->tcs;
-
-                /* Notify the debugger runtime */
-                if (enclave->debug && enclave->debug_enclave != NULL)
-                    oe_debug_push_thread_binding(
-                        enclave->debug_enclave, (sgx_tcs_t*)tcs);
-                break;
-            }
-        }
+        if (!_is_enclave_binding(enclave, binding) ||
+            !_is_owned_binding(binding, thread))
+            binding = _find_owned_binding(enclave, thread);
+    }
 
-        /* If binding not found above, look for an available ThreadBinding */
-        if (!tcs)
+    if (binding)
+    {
+        binding->count++;
+    }
+    else
+    {
+        /* Prefer the binding this thread used last */
+        binding = _get_cached_binding();
+
+        if (!binding || !_is_enclave_binding(enclave, binding) ||
+            !_try_claim_binding(enclave, (size_t)(binding - enclave->bindings)))
         {
-            for (i = 0; i < enclave->num_bindings; i++)
-            {
-                oe_thread_binding_t* binding = &enclave->bindings[i];
-
-                if (!(binding->flags & _OE_THREAD_BUSY))
-                {
-                    binding->flags |= _OE_THREAD_BUSY;
-                    binding->thread = thread;
-                    binding->count = 1;
-
-                    tcs = (void*)binding->tcs;
-
-                    /* Set into TSD so asynchronous exceptions can get it */
-                    _set_thread_binding(binding);
-                    assert(oe_get_thread_binding() == binding);
-
-                    /* Notify the debugger runtime */
-                    if (enclave->debug && enclave->debug_enclave != NULL)
-                        oe_debug_push_thread_binding(
-                            enclave->debug_enclave, (sgx_tcs_t*)tcs);
-                    break;
-                }
-            }
+            if (!(binding = _claim_free_binding(enclave)))
+                return NULL;
         }
+
+        /* Publish the owner before marking the binding busy */
+        oe_atomic_store(&binding->thread, thread);
+        binding->count = 1;
+        oe_update_thread_binding_flags(binding, _OE_THREAD_BUSY, 0);
     }
-    oe_mutex_unlock(&enclave->lock);
 
-    return tcs;
+    /* Set into TSD so asynchronous exceptions can get it */
+    _set_thread_binding(binding);
+    assert(oe_get_thread_binding() == binding);
+
+    /* Notify the debugger runtime */
+    if (enclave->debug && enclave->debug_enclave != NULL)
+        oe_debug_push_thread_binding(
+            enclave->debug_enclave, (sgx_tcs_t*)binding->tcs);
+
+    return binding;
 }
 
 /*
@@ -538,44 +949,41 @@ static void* _assign_tcs(oe_enclave_t* enclave)
 **
 ** _release_tcs()
 **
-**     Decrement the ThreadBinding.count field of the binding associated with
-**     the given TCS. If the field becomes zero, the binding is dissolved.
+**     Decrement the ThreadBinding.count field of the given binding. If the
+**     field becomes zero, the binding is dissolved and returned to the pool
+**     of available bindings. In either case, the binding of the calling
+**     thread in TSD is restored to the one in effect before _assign_tcs()
+**     (e.g., the binding of another enclave that made the OCALL this ECALL
+**     is nested in).
 **
 **==============================================================================
 */
 
-static void _release_tcs(oe_enclave_t* enclave, void* tcs)
+static void _release_tcs(
+    oe_enclave_t* enclave,
+    oe_thread_binding_t* binding,
+    oe_thread_binding_t* previous_binding)
 {
-    size_t i;
+    binding->count--;
+
+    /* Notify the debugger runtime */
+    if (enclave->debug && enclave->debug_enclave != NULL)
+        oe_debug_pop_thread_binding();
+
+    _set_thread_binding(previous_binding);
+    assert(oe_get_thread_binding() == previous_binding);
 
-    oe_mutex_lock(&enclave->lock);
+    if (binding->count == 0)
     {
-        for (i = 0; i < enclave->num_bindings; i++)
-        {
-            oe_thread_binding_t* binding = &enclave->bindings[i];
-
-            if ((binding->flags & _OE_THREAD_BUSY) &&
-                (void*)binding->tcs == tcs)
-            {
-                binding->count--;
-
-                /* Notify the debugger runtime */
-                if (enclave->debug && enclave->debug_enclave != NULL)
-                    oe_debug_pop_thread_binding();
-
-                if (binding->count == 0)
-                {
-                    binding->flags &= (~_OE_THREAD_BUSY);
-                    binding->thread = 0;
-                    memset(&binding->event, 0, sizeof(binding->event));
-                    _set_thread_binding(NULL);
-                    assert(oe_get_thread_binding() == NULL);
-                }
-                break;
-            }
-        }
+        oe_update_thread_binding_flags(binding, 0, _OE_THREAD_BUSY);
+        oe_atomic_store(&binding->thread, 0);
+        memset(&binding->event, 0, sizeof(binding->event));
+
+        /* Remember the binding so that the next ECALL of this thread can
+         * reuse it, and then make it available to other threads. */
+        _set_cached_binding(binding);
+        _free_binding(enclave, (size_t)(binding - enclave->bindings));
     }
-    oe_mutex_unlock(&enclave->lock);
 }
 
 /*
@@ -595,18 +1003,20 @@ oe_result_t oe_ecall(
     uint64_t* arg_out_ptr)
 {
     oe_result_t result = OE_UNEXPECTED;
-    void* tcs = NULL;
+    oe_thread_binding_t* binding = NULL;
+    oe_thread_binding_t* previous_binding = oe_get_thread_binding();
     oe_code_t code = OE_CODE_ECALL;
     oe_code_t code_out = 0;
     uint16_t func_out = 0;
     uint16_t result_out = 0;
     uint64_t arg_out = 0;
+    uint64_t start = 0;
 
     if (!enclave)
         OE_RAISE(OE_INVALID_PARAMETER);
 
     /* Assign a oe_sgx_td_t for this operation */
-    if (!(tcs = _assign_tcs(enclave)))
+    if (!(binding = _assign_tcs(enclave)))
         OE_RAISE(OE_OUT_OF_THREADS);
 
     oe_log(
@@ -614,13 +1024,21 @@ oe_result_t oe_ecall(
         "%s 0x%x %s: %s\n",
         enclave->path,
         enclave->start_address,
-        func == OE_ECALL_CALL_ENCLAVE_FUNCTION ? "EDL_ECALL" : "OE_ECALL",
+        (func == OE_ECALL_CALL_ENCLAVE_FUNCTION ||
+         func == OE_ECALL_CALL_ENCLAVE_FUNCTION_BATCH)
+            ? "EDL_ECALL"
+            : "OE_ECALL",
         oe_ecall_str(func));
 
+    oe_count_switchless_ecall_fallback(enclave, binding->tcs, func, arg);
+
+    if (enclave->call_statistics_enabled)
+        start = oe_call_statistics_now();
+
     /* Perform ECALL or ORET */
     OE_CHECK(_do_eenter(
         enclave,
-        tcs,
+        (void*)binding->tcs,
         OE_AEP_ADDRESS,
         code,
         func,
@@ -630,6 +1048,9 @@ oe_result_t oe_ecall(
         &result_out,
         &arg_out));
 
+    if (start)
+        _record_ecall(enclave, binding, func, arg, start);
+
     /* Process OCALLS */
     if (code_out != OE_CODE_ERET)
         OE_RAISE(OE_UNEXPECTED);
@@ -641,8 +1062,14 @@ oe_result_t oe_ecall(
 
 done:
 
-    if (enclave && tcs)
-        _release_tcs(enclave, tcs);
+    if (enclave && binding)
+    {
+        /* Execute the calls the enclave posted since its last OCALL, even if
+         * the ECALL failed, so that they do not run on the next ECALL that
+         * is assigned this binding */
+        _process_posted_calls(enclave, binding);
+        _release_tcs(enclave, binding, previous_binding);
+    }
 
     /* ATTN: this causes an assertion with call nesting. */
     /* ATTN: make enclave argument a cookie. */
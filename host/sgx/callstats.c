@@ -0,0 +1,284 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include "callstats.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <time.h>
+#elif defined(_WIN32)
+#include <Windows.h>
+#endif
+
+#include <openenclave/host.h>
+#include <openenclave/internal/calls.h>
+#include <openenclave/internal/raise.h>
+#include <openenclave/internal/switchless.h>
+#include "enclave.h"
+
+/*
+**==============================================================================
+**
+** Call statistics
+**
+**     oe_ecall() and the OCALL dispatchers time each call while
+**     enclave->call_statistics_enabled is set and record it in the table of
+**     the calling thread: the table of the thread binding for ECALLs and
+**     regular OCALLs, or the table of the host worker for switchless OCALLs.
+**     A binding is owned by a single thread while it is in use, so the
+**     counters are updated without atomics. oe_get_call_statistics() sums up
+**     all tables.
+**
+**==============================================================================
+*/
+
+uint64_t oe_call_statistics_now(void)
+{
+#if defined(__linux__)
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+#elif defined(_WIN32)
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    if (frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)(
+        (double)counter.QuadPart * 1000000000.0 / (double)frequency.QuadPart);
+#endif
+}
+
+static oe_call_statistics_table_t* _create_table(oe_enclave_t* enclave)
+{
+    oe_call_statistics_table_t* table = NULL;
+    size_t num_entries = 0;
+
+    if (!(table = (oe_call_statistics_table_t*)calloc(1, sizeof(*table))))
+        return NULL;
+
+    table->num[OE_CALL_KIND_ECALL] = enclave->num_ecalls;
+    table->num[OE_CALL_KIND_OCALL] = enclave->num_ocalls;
+    table->num[OE_CALL_KIND_SWITCHLESS_OCALL] = enclave->num_ocalls;
+    table->num[OE_CALL_KIND_INTERNAL_ECALL] = OE_ECALL_MAX;
+    table->num[OE_CALL_KIND_INTERNAL_OCALL] = OE_OCALL_MAX;
+
+    for (size_t kind = 0; kind <= OE_CALL_KIND_INTERNAL_OCALL; kind++)
+    {
+        table->first[kind] = num_entries;
+        num_entries += table->num[kind];
+    }
+
+    table->entries = (oe_call_statistics_t*)calloc(
+        num_entries, sizeof(oe_call_statistics_t));
+
+    if (!table->entries)
+    {
+        free(table);
+        return NULL;
+    }
+
+    table->num_entries = num_entries;
+
+    for (size_t kind = 0; kind <= OE_CALL_KIND_INTERNAL_OCALL; kind++)
+    {
+        for (size_t id = 0; id < table->num[kind]; id++)
+        {
+            oe_call_statistics_t* entry =
+                &table->entries[table->first[kind] + id];
+
+            entry->kind = (oe_call_kind_t)kind;
+            entry->function_id = id;
+        }
+    }
+
+    return table;
+}
+
+static void _reset_table(oe_call_statistics_table_t* table)
+{
+    for (size_t i = 0; i < table->num_entries; i++)
+    {
+        oe_call_statistics_t* entry = &table->entries[i];
+
+        entry->count = 0;
+        entry->total_nsec = 0;
+        entry->max_nsec = 0;
+        memset(entry->histogram, 0, sizeof(entry->histogram));
+    }
+}
+
+static void _add_table(
+    oe_call_statistics_table_t* sum,
+    const oe_call_statistics_table_t* table)
+{
+    /* All tables of an enclave have the same layout */
+    if (!table || table->num_entries != sum->num_entries)
+        return;
+
+    for (size_t i = 0; i < table->num_entries; i++)
+    {
+        const oe_call_statistics_t* entry = &table->entries[i];
+        oe_call_statistics_t* total = &sum->entries[i];
+
+        total->count += entry->count;
+        total->total_nsec += entry->total_nsec;
+
+        if (entry->max_nsec > total->max_nsec)
+            total->max_nsec = entry->max_nsec;
+
+        for (size_t j = 0; j < OE_CALL_STATISTICS_BUCKETS; j++)
+            total->histogram[j] += entry->histogram[j];
+    }
+}
+
+OE_INLINE size_t _get_bucket(uint64_t nsec)
+{
+    size_t bucket = 0;
+
+    while (nsec > 1 && bucket < OE_CALL_STATISTICS_BUCKETS - 1)
+    {
+        nsec >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+void oe_record_call(
+    oe_enclave_t* enclave,
+    oe_call_statistics_table_t** table,
+    oe_call_kind_t kind,
+    uint64_t function_id,
+    uint64_t start)
+{
+    uint64_t nsec = oe_call_statistics_now() - start;
+    oe_call_statistics_t* entry;
+
+    if (!*table && !(*table = _create_table(enclave)))
+        return;
+
+    if (function_id >= (*table)->num[kind])
+        return;
+
+    entry = &(*table)->entries[(*table)->first[kind] + function_id];
+    entry->count++;
+    entry->total_nsec += nsec;
+
+    if (nsec > entry->max_nsec)
+        entry->max_nsec = nsec;
+
+    entry->histogram[_get_bucket(nsec)]++;
+}
+
+void oe_free_call_statistics_table(oe_call_statistics_table_t* table)
+{
+    if (table)
+    {
+        free(table->entries);
+        free(table);
+    }
+}
+
+oe_result_t oe_enable_call_statistics(oe_enclave_t* enclave, bool enable)
+{
+    oe_result_t result = OE_UNEXPECTED;
+
+    if (!enclave || enclave->magic != ENCLAVE_MAGIC)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    enclave->call_statistics_enabled = enable;
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+oe_result_t oe_get_call_statistics(
+    oe_enclave_t* enclave,
+    oe_call_statistics_t* statistics,
+    size_t* count)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_call_statistics_table_t* sum = NULL;
+    oe_switchless_call_manager_t* manager;
+    size_t num_available = 0;
+
+    if (!enclave || enclave->magic != ENCLAVE_MAGIC || !count)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (*count && !statistics)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (!(sum = _create_table(enclave)))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    for (size_t i = 0; i < enclave->num_bindings; i++)
+        _add_table(sum, enclave->bindings[i].call_statistics);
+
+    if ((manager = enclave->switchless_manager) &&
+        manager->host_worker_statistics)
+    {
+        for (size_t i = 0; i < manager->num_host_workers; i++)
+            _add_table(sum, manager->host_worker_statistics[i]);
+    }
+
+    for (size_t i = 0; i < sum->num_entries; i++)
+    {
+        if (sum->entries[i].count == 0)
+            continue;
+
+        if (num_available < *count)
+            statistics[num_available] = sum->entries[i];
+
+        num_available++;
+    }
+
+    if (num_available > *count)
+    {
+        *count = num_available;
+        result = OE_BUFFER_TOO_SMALL;
+        goto done;
+    }
+
+    *count = num_available;
+    result = OE_OK;
+
+done:
+    oe_free_call_statistics_table(sum);
+    return result;
+}
+
+oe_result_t oe_reset_call_statistics(oe_enclave_t* enclave)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_switchless_call_manager_t* manager;
+
+    if (!enclave || enclave->magic != ENCLAVE_MAGIC)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    for (size_t i = 0; i < enclave->num_bindings; i++)
+    {
+        if (enclave->bindings[i].call_statistics)
+            _reset_table(enclave->bindings[i].call_statistics);
+    }
+
+    if ((manager = enclave->switchless_manager) &&
+        manager->host_worker_statistics)
+    {
+        for (size_t i = 0; i < manager->num_host_workers; i++)
+        {
+            if (manager->host_worker_statistics[i])
+                _reset_table(manager->host_worker_statistics[i]);
+        }
+    }
+
+    result = OE_OK;
+
+done:
+    return result;
+}
@@ -0,0 +1,47 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#ifndef _OE_HOST_SGX_CALLSTATS_H
+#define _OE_HOST_SGX_CALLSTATS_H
+
+#include <openenclave/host.h>
+
+OE_EXTERNC_BEGIN
+
+/**
+ * Call statistics of a single thread, i.e., of a thread binding or of a
+ * switchless host worker. Only the owning thread updates the table.
+ */
+typedef struct _oe_call_statistics_table
+{
+    /* Index of the first entry of each kind */
+    size_t first[OE_CALL_KIND_INTERNAL_OCALL + 1];
+
+    /* Number of entries of each kind */
+    size_t num[OE_CALL_KIND_INTERNAL_OCALL + 1];
+
+    size_t num_entries;
+    oe_call_statistics_t* entries;
+} oe_call_statistics_table_t;
+
+/**
+ * Get a monotonic timestamp in nanoseconds for timing a call.
+ */
+uint64_t oe_call_statistics_now(void);
+
+/**
+ * Record a call that started at the given timestamp. The table is created
+ * on first use.
+ */
+void oe_record_call(
+    oe_enclave_t* enclave,
+    oe_call_statistics_table_t** table,
+    oe_call_kind_t kind,
+    uint64_t function_id,
+    uint64_t start);
+
+void oe_free_call_statistics_table(oe_call_statistics_table_t* table);
+
+OE_EXTERNC_END
+
+#endif /* _OE_HOST_SGX_CALLSTATS_H */
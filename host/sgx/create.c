@@ -235,9 +235,12 @@ static oe_result_t _add_control_pages(
             OE_RAISE_MSG(
                 OE_FAILURE, "OE_SGX_MAX_TCS (%d) hit\n", OE_SGX_MAX_TCS);
 
-        enclave->bindings[enclave->num_bindings].enclave = enclave;
-        enclave->bindings[enclave->num_bindings++].tcs =
-            enclave->start_address + *vaddr;
+        size_t index = enclave->num_bindings;
+
+        enclave->bindings[index].enclave = enclave;
+        enclave->bindings[index].tcs = enclave->start_address + *vaddr;
+        enclave->free_bindings[index / 64] |= (1ULL << (index % 64));
+        enclave->num_bindings++;
     }
 
     /* Add the TCS page */
@@ -500,6 +503,12 @@ static oe_result_t _add_data_pages(
             _add_control_pages(context, entry, tls_page_count, vaddr, enclave));
     }
 
+    /* Every thread adds the same number of pages, so the TCSs are evenly
+     * spaced (see oe_get_binding_by_tcs()) */
+    if (enclave->num_bindings > 1)
+        enclave->tcs_stride =
+            enclave->bindings[1].tcs - enclave->bindings[0].tcs;
+
     result = OE_OK;
 
 done:
@@ -576,6 +585,60 @@ done:
     return result;
 }
 
+/*
+**==============================================================================
+**
+** _init_host_memory_pool()
+**
+**     Map the pool of host memory of the enclave and hand it to the enclave,
+**     which allocates ocall buffers from it without OCALLs. The pool only
+**     saves transitions, so the enclave goes without it if it cannot be set
+**     up, e.g., because the enclave was built with an older SDK.
+**
+**==============================================================================
+*/
+
+static void _init_host_memory_pool(oe_enclave_t* enclave)
+{
+    oe_init_host_memory_pool_args_t args;
+    uint64_t result_out = 0;
+    oe_result_t result;
+
+    if (enclave->host_memory_pool_size == 0)
+        return;
+
+    args.size = enclave->host_memory_pool_size;
+    args.host_malloc = enclave->host_memory_pool_host_malloc;
+
+    if (!(args.base = oe_memalign(OE_PAGE_SIZE, args.size)))
+    {
+        OE_TRACE_WARNING(
+            "Cannot allocate the host memory pool of %lu bytes",
+            (unsigned long)args.size);
+        return;
+    }
+
+    result = oe_ecall(
+        enclave,
+        OE_ECALL_INIT_HOST_MEMORY_POOL,
+        (uint64_t)&args,
+        &result_out);
+
+    if (result == OE_OK)
+        result = (oe_result_t)result_out;
+
+    if (result != OE_OK)
+    {
+        OE_TRACE_WARNING(
+            "The enclave does not use a host memory pool: %s",
+            oe_result_str(result));
+        oe_memalign_free(args.base);
+        return;
+    }
+
+    enclave->host_memory_pool = args.base;
+}
+
 /*
 ** _config_enclave()
 **
@@ -588,22 +651,42 @@ static oe_result_t _configure_enclave(
     uint32_t setting_count)
 {
     oe_result_t result = OE_UNEXPECTED;
+    const oe_enclave_setting_context_switchless_t* switchless_setting = NULL;
+    bool start_switchless = false;
 
     for (uint32_t i = 0; i < setting_count; i++)
     {
         switch (settings[i].setting_type)
         {
             // Configure the switchless ocalls, such as the number of workers.
+            // The switchless manager is started after the other settings
+            // are applied, since its enclave workers may take up all TCSs.
             case OE_ENCLAVE_SETTING_CONTEXT_SWITCHLESS:
             {
-                size_t max_host_workers =
-                    settings[i].u.context_switchless_setting->max_host_workers;
-                size_t max_enclave_workers =
-                    settings[i]
-                        .u.context_switchless_setting->max_enclave_workers;
-
-                OE_CHECK(oe_start_switchless_manager(
-                    enclave, max_host_workers, max_enclave_workers));
+                switchless_setting = settings[i].u.context_switchless_setting;
+                start_switchless = true;
+                break;
+            }
+            // Configure the upper bound for growing ocall buffers.
+            case OE_ENCLAVE_SETTING_OCALL_BUFFER:
+            {
+                if (!settings[i].u.ocall_buffer_setting)
+                    OE_RAISE(OE_INVALID_PARAMETER);
+
+                enclave->max_ocall_buffer_size =
+                    settings[i].u.ocall_buffer_setting->max_size;
+                break;
+            }
+            // Configure the size of the pool of host memory.
+            case OE_ENCLAVE_SETTING_HOST_MEMORY_POOL:
+            {
+                if (!settings[i].u.host_memory_pool_setting)
+                    OE_RAISE(OE_INVALID_PARAMETER);
+
+                enclave->host_memory_pool_size =
+                    settings[i].u.host_memory_pool_setting->size;
+                enclave->host_memory_pool_host_malloc =
+                    settings[i].u.host_memory_pool_setting->host_malloc;
                 break;
             }
             case OE_SGX_ENCLAVE_CONFIG_DATA:
@@ -621,6 +704,12 @@ static oe_result_t _configure_enclave(
                 OE_RAISE(OE_INVALID_PARAMETER);
         }
     }
+
+    _init_host_memory_pool(enclave);
+
+    if (start_switchless)
+        OE_CHECK(oe_start_switchless_manager(enclave, switchless_setting));
+
     result = OE_OK;
 
 done:
@@ -916,6 +1005,8 @@ oe_result_t oe_sgx_build_enclave(
 
         enclave->debug = oe_sgx_is_debug_load_context(context);
         enclave->simulate = oe_sgx_is_simulation_load_context(context);
+        enclave->max_ocall_buffer_size = OE_DEFAULT_MAX_OCALL_BUFFER_SIZE;
+        enclave->host_memory_pool_size = OE_DEFAULT_HOST_MEMORY_POOL_SIZE;
     }
 
     /* Initialize the lock */
@@ -1421,6 +1512,9 @@ done:
 
     if (result != OE_OK && enclave)
     {
+        if (enclave->host_memory_pool)
+            oe_memalign_free(enclave->host_memory_pool);
+
         free(enclave);
     }
 
@@ -1502,8 +1596,15 @@ oe_result_t oe_terminate_enclave(oe_enclave_t* enclave)
             CloseHandle(binding->event.handle);
 #endif
             free(binding->ocall_buffer);
+            free(binding->posted_calls);
+            oe_free_call_statistics_table(binding->call_statistics);
         }
 
+        /* The enclave may have handed out host memory of the pool until
+         * now, so it is only released with the enclave */
+        if (enclave->host_memory_pool)
+            oe_memalign_free(enclave->host_memory_pool);
+
         /* Free the path name of the enclave image file */
         free(enclave->path);
     }
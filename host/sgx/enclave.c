@@ -5,30 +5,39 @@
 #include <assert.h>
 #include <openenclave/host.h>
 
-/* Get the event object from the enclave for the given TCS */
-EnclaveEvent* GetEnclaveEvent(oe_enclave_t* enclave, uint64_t tcs)
+/* Get the binding from the enclave for the given TCS.
+ * The binding index is computed from the offset of the TCS relative to the
+ * first TCS, so no lock or scan is needed. */
+oe_thread_binding_t* oe_get_binding_by_tcs(oe_enclave_t* enclave, uint64_t tcs)
 {
-    EnclaveEvent* event = NULL;
+    oe_thread_binding_t* binding = NULL;
+    uint64_t first_tcs;
+    uint64_t index = 0;
+
+    if (!enclave || enclave->num_bindings == 0)
+        return NULL;
+
+    first_tcs = enclave->bindings[0].tcs;
+
+    if (tcs < first_tcs)
+        return NULL;
+
+    if (enclave->tcs_stride)
+        index = (tcs - first_tcs) / enclave->tcs_stride;
 
-    if (!enclave)
+    if (index >= enclave->num_bindings)
         return NULL;
 
-    oe_mutex_lock(&enclave->lock);
-    {
-        size_t i;
+    binding = &enclave->bindings[index];
 
-        for (i = 0; i < enclave->num_bindings; i++)
-        {
-            oe_thread_binding_t* binding = &enclave->bindings[i];
+    /* Reject addresses that are not the start of a TCS page */
+    return (binding->tcs == tcs) ? binding : NULL;
+}
 
-            if (binding->tcs == tcs)
-            {
-                event = &binding->event;
-                break;
-            }
-        }
-    }
-    oe_mutex_unlock(&enclave->lock);
+/* Get the event object from the enclave for the given TCS */
+EnclaveEvent* GetEnclaveEvent(oe_enclave_t* enclave, uint64_t tcs)
+{
+    oe_thread_binding_t* binding = oe_get_binding_by_tcs(enclave, tcs);
 
-    return event;
+    return binding ? &binding->event : NULL;
 }
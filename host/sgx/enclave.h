@@ -15,6 +15,7 @@
 #include "../ecall_ids.h"
 #include "../hostthread.h"
 #include "asmdefs.h"
+#include "callstats.h"
 
 #if defined(_WIN32)
 #include <windows.h>
@@ -97,6 +98,22 @@ typedef struct _thread_binding
     /* Buffer used for ocall parameters */
     void* ocall_buffer;
     uint64_t ocall_buffer_size;
+
+    /* Queue of calls posted by the enclave (see postedcalls.h) */
+    void* posted_calls;
+    uint64_t posted_calls_size;
+
+    /* Statistics of the calls made on this binding (see callstats.c) */
+    oe_call_statistics_table_t* call_statistics;
+
+    /* Switchless ocalls and ecalls made on this binding that missed and fell
+     * back to regular calls (see switchless.c) */
+    uint64_t num_switchless_ocall_misses;
+    uint64_t num_switchless_ecall_misses;
+
+    /* Set by host functions of the switchless machinery during an ocall, so
+     * that they are never promoted to switchless ocalls (see switchless.c) */
+    bool in_internal_ocall;
 } oe_thread_binding_t;
 
 /* Whether this binding is busy */
@@ -108,6 +125,16 @@ typedef struct _thread_binding
 /* Get thread data from thread-specific data (TSD) */
 oe_thread_binding_t* oe_get_thread_binding(void);
 
+/* Atomically set and clear flags of a binding. Other threads read the flags
+ * of bindings they do not own while looking for their own. */
+void oe_update_thread_binding_flags(
+    oe_thread_binding_t* binding,
+    uint64_t set,
+    uint64_t clear);
+
+/* Number of 64-bit words in the free-binding bitmap of an enclave */
+#define OE_THREAD_BINDING_BITMAP_WORDS (OE_SGX_MAX_TCS / 64)
+
 /**
  * Host-side representation of properties associated with each
  * enclave instance.
@@ -135,6 +162,16 @@ typedef struct _oe_enclave
     size_t num_bindings;
     oe_mutex lock;
 
+    /* Bitmap of available thread bindings (a set bit means the binding with
+     * the corresponding index is free). Bindings are claimed and released
+     * with atomic operations so that ECALLs never take the enclave lock */
+    volatile uint64_t free_bindings[OE_THREAD_BINDING_BITMAP_WORDS];
+
+    /* Distance in bytes between the TCSs of consecutive bindings. The control
+     * pages of all threads are laid out at the same stride, which allows
+     * finding the binding of a TCS from its offset in constant time */
+    uint64_t tcs_stride;
+
     /* Hash of enclave (MRENCLAVE) */
     OE_SHA256 hash;
 
@@ -152,6 +189,17 @@ typedef struct _oe_enclave
     oe_debug_enclave_t* debug_enclave;
     oe_debug_module_t* debug_modules;
 
+    /* The max size that the ocall buffer of a binding may grow to */
+    uint64_t max_ocall_buffer_size;
+
+    /* Pool of host memory that the enclave allocates from without OCALLs */
+    void* host_memory_pool;
+    uint64_t host_memory_pool_size;
+    bool host_memory_pool_host_malloc;
+
+    /* Whether calls are timed (see oe_enable_call_statistics()) */
+    volatile bool call_statistics_enabled;
+
     /* Manager for switchless calls */
     oe_switchless_call_manager_t* switchless_manager;
 
@@ -161,6 +209,9 @@ typedef struct _oe_enclave
     size_t num_ecalls;
 } oe_enclave_t;
 
+/* Get the binding for the given TCS */
+oe_thread_binding_t* oe_get_binding_by_tcs(oe_enclave_t* enclave, uint64_t tcs);
+
 /* Get the event for the given TCS */
 EnclaveEvent* GetEnclaveEvent(oe_enclave_t* enclave, uint64_t tcs);
 
@@ -172,6 +223,19 @@ EnclaveEvent* GetEnclaveEvent(oe_enclave_t* enclave, uint64_t tcs);
  */
 #define OE_DEFAULT_OCALL_BUFFER_SIZE (16 * 1024)
 
+/**
+ * Default upper bound for growing the ocall buffer of a binding. Ocalls that
+ * need more than this keep allocating their buffers through the enclave.
+ * Can be changed with the OE_ENCLAVE_SETTING_OCALL_BUFFER setting.
+ */
+#define OE_DEFAULT_MAX_OCALL_BUFFER_SIZE (1024 * 1024)
+
+/**
+ * Default size of the pool of host memory of an enclave. Can be changed with
+ * the OE_ENCLAVE_SETTING_HOST_MEMORY_POOL setting.
+ */
+#define OE_DEFAULT_HOST_MEMORY_POOL_SIZE (32 * 1024 * 1024)
+
 void oe_setup_ecall_context(oe_ecall_context_t* ecall_context);
 
 #endif /* _OE_HOST_ENCLAVE_H */
@@ -3,6 +3,7 @@
 
 #include <assert.h>
 #include <openenclave/host.h>
+#include <openenclave/internal/atomic.h>
 #include <openenclave/internal/queue.h>
 #include <openenclave/internal/trace.h>
 #include "enclave.h"
@@ -16,6 +17,122 @@ typedef struct _enclave_entry
     oe_enclave_t* enclave;
 } EnclaveEntry;
 
+/*
+**==============================================================================
+**
+** Enclave range table
+**
+**     oe_query_enclave_instance() runs on every asynchronous exit (e.g., in
+**     the signal handler), so it must not take locks. Each live enclave is
+**     also recorded in the table below along with its address range. Slots
+**     are only written with oe_enclave_list_lock held. A slot is published
+**     by setting its enclave field last and retired by clearing it first.
+**
+**     Readers register with the slot before reading its enclave field and
+**     keep the registration until they are done with the enclave. A retired
+**     slot is not cleared or reused until its readers have left, so readers
+**     never see a range of another enclave (ABA) and the enclave is not
+**     freed while they use it. Enclaves that do not fit into the table are
+**     still found through the locked list.
+**
+**==============================================================================
+*/
+
+#define OE_MAX_ENCLAVE_RANGES 64
+
+typedef struct _enclave_range
+{
+    volatile uint64_t start;
+    volatile uint64_t end;
+    oe_enclave_t* volatile enclave;
+
+    /* Number of readers that may be using the enclave of this slot */
+    volatile uint64_t readers;
+} EnclaveRange;
+
+static EnclaveRange oe_enclave_ranges[OE_MAX_ENCLAVE_RANGES];
+
+/* Whether the enclave range table is out of free slots. */
+static volatile uint64_t oe_enclave_ranges_overflow;
+
+static void _insert_enclave_range(oe_enclave_t* enclave)
+{
+    for (size_t i = 0; i < OE_MAX_ENCLAVE_RANGES; i++)
+    {
+        EnclaveRange* range = &oe_enclave_ranges[i];
+
+        if (range->enclave == NULL)
+        {
+            range->start = enclave->start_address;
+            range->end = enclave->start_address + enclave->size;
+            oe_atomic_compare_and_swap_ptr(
+                (void* volatile*)&range->enclave, NULL, enclave);
+            return;
+        }
+    }
+
+    oe_atomic_increment(&oe_enclave_ranges_overflow);
+}
+
+static void _remove_enclave_range(oe_enclave_t* enclave)
+{
+    for (size_t i = 0; i < OE_MAX_ENCLAVE_RANGES; i++)
+    {
+        EnclaveRange* range = &oe_enclave_ranges[i];
+
+        if (range->enclave == enclave)
+        {
+            oe_atomic_compare_and_swap_ptr(
+                (void* volatile*)&range->enclave, enclave, NULL);
+
+            /* Wait for the readers that may have seen the enclave. Readers
+             * never block, so this is short. */
+            while (oe_atomic_load(&range->readers) != 0)
+                ;
+
+            range->start = 0;
+            range->end = 0;
+            return;
+        }
+    }
+
+    oe_atomic_decrement(&oe_enclave_ranges_overflow);
+}
+
+/* Returns the enclave of the table that owns the TCS */
+static oe_enclave_t* _lookup_enclave_range(uint64_t tcs)
+{
+    oe_enclave_t* ret = NULL;
+
+    for (size_t i = 0; i < OE_MAX_ENCLAVE_RANGES && !ret; i++)
+    {
+        EnclaveRange* range = &oe_enclave_ranges[i];
+        oe_enclave_t* enclave;
+
+        /* Skip free slots and other ranges without touching the counter */
+        if (range->enclave == NULL || tcs < range->start ||
+            tcs >= range->end)
+            continue;
+
+        /* Register before reading the enclave so that the slot cannot be
+         * retired and reused while the enclave is in use. The range is
+         * checked again as the slot may have changed in between. */
+        oe_atomic_increment(&range->readers);
+
+        enclave = range->enclave;
+
+        if (enclave && tcs >= range->start && tcs < range->end &&
+            oe_get_binding_by_tcs(enclave, tcs))
+        {
+            ret = enclave;
+        }
+
+        oe_atomic_decrement(&range->readers);
+    }
+
+    return ret;
+}
+
 /*
 **==============================================================================
 **
@@ -67,6 +184,9 @@ uint32_t oe_push_enclave_instance(oe_enclave_t* enclave)
     // Insert to the beginning of the list.
     OE_LIST_INSERT_HEAD(&oe_enclave_list_head, new_entry, next_entry);
 
+    // Make the enclave visible to lock-free lookups.
+    _insert_enclave_range(enclave);
+
     // Return success.
     ret = 0;
 
@@ -117,6 +237,7 @@ uint32_t oe_remove_enclave_instance(oe_enclave_t* enclave)
         {
             if (tmp->enclave == enclave)
             {
+                _remove_enclave_range(enclave);
                 OE_LIST_REMOVE(tmp, next_entry);
                 free(tmp);
                 ret = 0;
@@ -158,6 +279,14 @@ oe_enclave_t* oe_query_enclave_instance(void* tcs)
     oe_enclave_t* ret = NULL;
     bool locked = false;
 
+    // Look up the enclave whose address range contains the TCS.
+    if ((ret = _lookup_enclave_range((uint64_t)tcs)))
+        return ret;
+
+    // Only enclaves that did not fit into the range table need the list.
+    if (oe_atomic_load(&oe_enclave_ranges_overflow) == 0)
+        goto cleanup;
+
     // Take the lock.
     if (oe_mutex_lock(&oe_enclave_list_lock) != 0)
     {
@@ -172,20 +301,11 @@ oe_enclave_t* oe_query_enclave_instance(void* tcs)
         EnclaveEntry* tmp;
         OE_LIST_FOREACH(tmp, &oe_enclave_list_head, next_entry)
         {
-            oe_enclave_t* enclave = tmp->enclave;
-
-            oe_mutex_lock(&enclave->lock);
-
-            for (uint32_t i = 0; i < OE_COUNTOF(enclave->bindings); i++)
+            if (oe_get_binding_by_tcs(tmp->enclave, (uint64_t)tcs))
             {
-                if (enclave->bindings[i].tcs == (uint64_t)tcs)
-                {
-                    ret = enclave;
-                    break;
-                }
+                ret = tmp->enclave;
+                break;
             }
-
-            oe_mutex_unlock(&enclave->lock);
         }
     }
 
@@ -69,7 +69,8 @@ uint64_t oe_host_handle_exception(oe_host_exception_context_t* context)
         }
 
         // Set the flag marks this thread is handling an enclave exception.
-        thread_data->flags |= _OE_THREAD_HANDLING_EXCEPTION;
+        oe_update_thread_binding_flags(
+            thread_data, _OE_THREAD_HANDLING_EXCEPTION, 0);
 
         // Pass the faulting address to allow the enclave to simulate
         // #PF in debug mode
@@ -93,7 +94,8 @@ uint64_t oe_host_handle_exception(oe_host_exception_context_t* context)
             enclave, OE_ECALL_VIRTUAL_EXCEPTION_HANDLER, arg_in, &arg_out);
 
         // Reset the flag
-        thread_data->flags &= (~_OE_THREAD_HANDLING_EXCEPTION);
+        oe_update_thread_binding_flags(
+            thread_data, 0, _OE_THREAD_HANDLING_EXCEPTION);
         if (result == OE_OK && arg_out == OE_EXCEPTION_CONTINUE_EXECUTION)
         {
             // This exception has been handled by the enclave. Let's resume.
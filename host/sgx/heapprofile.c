@@ -0,0 +1,128 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openenclave/host.h>
+#include <openenclave/internal/calls.h>
+#include <openenclave/internal/raise.h>
+#include "enclave.h"
+
+/* The initial size of the buffer that the enclave writes its profile to */
+#define INITIAL_PROFILE_SIZE (64 * 1024)
+
+/* Room for samples that are recorded while the buffer is reallocated */
+#define PROFILE_SLACK 4096
+
+/* The memory map that pprof uses to symbolize the enclave addresses. The
+ * enclave image is mapped at the start of the enclave. */
+#define MAPPED_LIBRARIES_FORMAT \
+    "\nMAPPED_LIBRARIES:\n%016llx-%016llx r-xp 00000000 00:00 0 %s\n"
+
+static oe_result_t _get_enclave_profile(
+    oe_enclave_t* enclave,
+    char* buffer,
+    size_t buffer_size,
+    size_t* profile_size)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_get_heap_profile_args_t args;
+    uint64_t result_out = 0;
+
+    args.buffer = buffer;
+    args.buffer_size = buffer_size;
+    args.profile_size = 0;
+
+    OE_CHECK(oe_ecall(
+        enclave, OE_ECALL_GET_HEAP_PROFILE, (uint64_t)&args, &result_out));
+
+    *profile_size = args.profile_size;
+    result = (oe_result_t)result_out;
+
+done:
+    return result;
+}
+
+oe_result_t oe_get_heap_profile(
+    oe_enclave_t* enclave,
+    char** profile,
+    size_t* profile_size)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    char* buffer = NULL;
+    size_t capacity = INITIAL_PROFILE_SIZE;
+    size_t size = 0;
+    int n;
+
+    if (profile)
+        *profile = NULL;
+
+    if (profile_size)
+        *profile_size = 0;
+
+    if (!enclave || !profile || !profile_size)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    for (;;)
+    {
+        free(buffer);
+
+        if (!(buffer = (char*)malloc(capacity)))
+            OE_RAISE(OE_OUT_OF_MEMORY);
+
+        result = _get_enclave_profile(enclave, buffer, capacity, &size);
+
+        if (result != OE_BUFFER_TOO_SMALL)
+            break;
+
+        capacity = size + PROFILE_SLACK;
+    }
+
+    OE_CHECK(result);
+
+    /* Append the memory map behind the profile (size counts its NUL) */
+    n = snprintf(
+        NULL,
+        0,
+        MAPPED_LIBRARIES_FORMAT,
+        (unsigned long long)enclave->start_address,
+        (unsigned long long)(enclave->start_address + enclave->size),
+        enclave->path);
+
+    if (n < 0)
+        OE_RAISE(OE_FAILURE);
+
+    if (size + (size_t)n > capacity)
+    {
+        char* p;
+
+        if (!(p = (char*)realloc(buffer, size + (size_t)n)))
+            OE_RAISE(OE_OUT_OF_MEMORY);
+
+        buffer = p;
+    }
+
+    snprintf(
+        buffer + size - 1,
+        (size_t)n + 1,
+        MAPPED_LIBRARIES_FORMAT,
+        (unsigned long long)enclave->start_address,
+        (unsigned long long)(enclave->start_address + enclave->size),
+        enclave->path);
+
+    *profile = buffer;
+    *profile_size = size - 1 + (size_t)n;
+    buffer = NULL;
+    result = OE_OK;
+
+done:
+    free(buffer);
+    return result;
+}
+
+void oe_free_heap_profile(char* profile)
+{
+    free(profile);
+}
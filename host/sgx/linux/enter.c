@@ -6,6 +6,7 @@
 #include <openenclave/internal/constants_x64.h>
 #include <openenclave/internal/registers.h>
 #include <openenclave/internal/sgx/ecall_context.h>
+#include <openenclave/internal/sgx/postedcalls.h>
 #include "../asmdefs.h"
 #include "../enclave.h"
 #include "../vdso.h"
@@ -93,7 +94,8 @@ int __oe_host_stack_bridge(
         current->previous_rbp = ecall_context->debug_eexit_rbp;
     }
 
-    int ret = __oe_dispatch_ocall(arg1, arg2, arg1_out, arg2_out, tcs, enclave);
+    int ret = __oe_dispatch_ocall(
+        arg1, arg2, arg1_out, arg2_out, tcs, enclave, ecall_context);
 
     if (debug)
     {
@@ -127,6 +129,18 @@ void oe_setup_ecall_context(oe_ecall_context_t* ecall_context)
     ecall_context->ocall_buffer = binding->ocall_buffer;
     ecall_context->ocall_buffer_size = binding->ocall_buffer_size;
 
+    if (binding->posted_calls == NULL)
+    {
+        // Lazily allocate the posted call queue. The queue is empty
+        // whenever the binding is not in use.
+        binding->posted_calls = calloc(1, OE_DEFAULT_POSTED_CALLS_SIZE);
+        if (binding->posted_calls)
+            binding->posted_calls_size = OE_DEFAULT_POSTED_CALLS_SIZE;
+    }
+
+    ecall_context->posted_calls = binding->posted_calls;
+    ecall_context->posted_calls_size = binding->posted_calls_size;
+
     /* Record caller's stack frame if vDSO is used */
     if (oe_sgx_is_vdso_enabled)
     {
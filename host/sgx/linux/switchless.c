@@ -3,8 +3,10 @@
 
 #include <openenclave/internal/switchless.h>
 
+#include <limits.h>
 #include <linux/futex.h>
 #include <sys/syscall.h>
+#include <time.h>
 #include <unistd.h>
 
 static void _worker_wait(volatile int64_t* event)
@@ -69,3 +71,50 @@ void oe_enclave_worker_wake(oe_enclave_worker_context_t* context)
 {
     _worker_wake(&context->event);
 }
+
+bool oe_switchless_event_wait(volatile int64_t* event, uint32_t timeout_msec)
+{
+    int64_t oldval = 1;
+    int64_t newval = 0;
+    struct timespec timeout = {(time_t)(timeout_msec / 1000),
+                               (long)(timeout_msec % 1000) * 1000000};
+
+    // Wait once. Spurious wakes and timeouts alike return false unless the
+    // event has been set in the meantime.
+    if (*event == 0)
+        syscall(__NR_futex, event, FUTEX_WAIT_PRIVATE, 0, &timeout, NULL, 0);
+
+    return __atomic_compare_exchange_n(
+        event, &oldval, newval, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+void oe_switchless_event_wake(volatile int64_t* event)
+{
+    _worker_wake(event);
+}
+
+void oe_switchless_address_wait(
+    volatile int64_t* address,
+    int64_t value,
+    uint32_t timeout_msec)
+{
+    struct timespec timeout = {(time_t)(timeout_msec / 1000),
+                               (long)(timeout_msec % 1000) * 1000000};
+
+    // The futex compares the low 32 bits of *address, which change whenever
+    // the value is incremented.
+    if (*address == value)
+        syscall(
+            __NR_futex,
+            address,
+            FUTEX_WAIT_PRIVATE,
+            (int)value,
+            &timeout,
+            NULL,
+            0);
+}
+
+void oe_switchless_address_wake_all(volatile int64_t* address)
+{
+    syscall(__NR_futex, address, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
@@ -8,21 +8,13 @@
 #include <openenclave/internal/raise.h>
 #include <openenclave/internal/switchless.h>
 #include <openenclave/internal/utils.h>
+#include <string.h>
 #include "../calls.h"
 #include "../hostthread.h"
+#include "../memalign.h"
 #include "enclave.h"
 #include "platform_u.h"
 
-/**
- * Number of iterations an ocall worker thread would spin before going to sleep
- */
-#define OE_HOST_WORKER_SPIN_COUNT_THRESHOLD (4096U)
-
-/**
- * Number of iterations an ecall worker thread would spin before going to sleep
- */
-#define OE_ENCLAVE_WORKER_SPIN_COUNT_THRESHOLD (4096U)
-
 /**
  * Declare the prototypes of the following functions to avoid missing-prototypes
  * warning.
@@ -31,101 +23,1293 @@ OE_UNUSED_FUNC oe_result_t _oe_sgx_init_context_switchless_ecall(
     oe_enclave_t* enclave,
     oe_result_t* _retval,
     oe_host_worker_context_t* host_worker_contexts,
-    uint64_t num_host_workers);
+    uint64_t num_host_workers,
+    void* ocall_queue,
+    uint64_t ocall_wait_spin_count,
+    void* promoted_ocalls,
+    uint64_t num_ocalls);
 OE_UNUSED_FUNC oe_result_t _oe_sgx_switchless_enclave_worker_thread_ecall(
     oe_enclave_t* enclave,
-    oe_enclave_worker_context_t* context);
+    oe_enclave_worker_context_t* context,
+    void* ecall_queue,
+    uint64_t worker_index,
+    uint64_t num_workers);
+
+/**
+ * Make the following ECALLs weak to support the system EDL opt-in.
+ * When the user does not opt into (import) the EDL, the linker will pick
+ * the following default implementations. If the user opts into the EDL,
+ * the implementions (which are also weak) in the oeedger8r-generated code will
+ * be used. This behavior is guaranteed by the linker; i.e., the linker will
+ * pick the symbols defined in the object before those in the library.
+ */
+oe_result_t _oe_sgx_init_context_switchless_ecall(
+    oe_enclave_t* enclave,
+    oe_result_t* _retval,
+    oe_host_worker_context_t* host_worker_contexts,
+    uint64_t num_host_workers,
+    void* ocall_queue,
+    uint64_t ocall_wait_spin_count,
+    void* promoted_ocalls,
+    uint64_t num_ocalls)
+{
+    OE_UNUSED(enclave);
+    OE_UNUSED(host_worker_contexts);
+    OE_UNUSED(num_host_workers);
+    OE_UNUSED(ocall_queue);
+    OE_UNUSED(ocall_wait_spin_count);
+    OE_UNUSED(promoted_ocalls);
+    OE_UNUSED(num_ocalls);
+
+    if (_retval)
+        *_retval = OE_UNSUPPORTED;
+
+    return OE_UNSUPPORTED;
+}
+OE_WEAK_ALIAS(
+    _oe_sgx_init_context_switchless_ecall,
+    oe_sgx_init_context_switchless_ecall);
+
+oe_result_t _oe_sgx_switchless_enclave_worker_thread_ecall(
+    oe_enclave_t* enclave,
+    oe_enclave_worker_context_t* context,
+    void* ecall_queue,
+    uint64_t worker_index,
+    uint64_t num_workers)
+{
+    OE_UNUSED(enclave);
+    OE_UNUSED(context);
+    OE_UNUSED(ecall_queue);
+    OE_UNUSED(worker_index);
+    OE_UNUSED(num_workers);
+    return OE_UNSUPPORTED;
+}
+OE_WEAK_ALIAS(
+    _oe_sgx_switchless_enclave_worker_thread_ecall,
+    oe_sgx_switchless_enclave_worker_thread_ecall);
+
+/*
+** Record a switchless ocall in the call statistics of the host worker that
+** handled it (see callstats.c)
+**
+*/
+static void _record_switchless_ocall(
+    oe_enclave_t* enclave,
+    oe_host_worker_context_t* context,
+    uint64_t function_id,
+    uint64_t start)
+{
+    oe_switchless_call_manager_t* manager = enclave->switchless_manager;
+    size_t index;
+
+    if (!manager || !manager->host_worker_statistics)
+        return;
+
+    index = (size_t)(context - manager->host_worker_contexts);
+    oe_record_call(
+        enclave,
+        &manager->host_worker_statistics[index],
+        OE_CALL_KIND_SWITCHLESS_OCALL,
+        function_id,
+        start);
+}
+
+/*
+** Allocate a switchless ocall or ecall queue (see oe_switchless_queue_t) for
+** num_workers consumers, with room for twice as many calls as there are
+** enclave threads, so that synchronous ocalls never find it full.
+**
+*/
+static oe_switchless_queue_t* _create_queue(
+    oe_enclave_t* enclave,
+    size_t num_workers)
+{
+    oe_switchless_queue_t* queue;
+    oe_switchless_queue_cell_t* cells;
+    uint64_t capacity = OE_SWITCHLESS_QUEUE_MIN_CAPACITY;
+    size_t size;
+
+    while (capacity < 2 * enclave->num_bindings &&
+           capacity < OE_SWITCHLESS_QUEUE_MAX_CAPACITY)
+        capacity *= 2;
+
+    size = oe_switchless_queue_size(capacity, num_workers);
+
+    queue = (oe_switchless_queue_t*)oe_memalign(
+        OE_SWITCHLESS_QUEUE_ALIGNMENT, size);
+    if (!queue)
+        return NULL;
+
+    memset(queue, 0, size);
+    queue->capacity = capacity;
+
+    // A cell is free for the enqueue at position pos if its sequence is pos.
+    cells = oe_switchless_queue_cells(queue);
+    for (uint64_t i = 0; i < capacity; i++)
+        cells[i].sequence = i;
+
+    return queue;
+}
+
+/*
+** Take the oldest call from the switchless ocall queue. Returns NULL if the
+** queue is empty.
+**
+*/
+static oe_call_host_function_args_t* _dequeue_switchless_ocall(
+    oe_switchless_queue_t* queue)
+{
+    oe_switchless_queue_cell_t* cells = oe_switchless_queue_cells(queue);
+    const uint64_t mask = queue->capacity - 1;
+    uint64_t pos = oe_atomic_load(&queue->head);
+
+    for (;;)
+    {
+        oe_switchless_queue_cell_t* cell = &cells[pos & mask];
+        uint64_t sequence = oe_atomic_load(&cell->sequence);
+        int64_t diff = (int64_t)(sequence - (pos + 1));
+
+        if (diff == 0)
+        {
+            // The cell holds a call. Claim it by advancing the head.
+            if (oe_atomic_compare_and_swap(
+                    (int64_t volatile*)&queue->head,
+                    (int64_t)pos,
+                    (int64_t)(pos + 1)))
+            {
+                oe_call_host_function_args_t* args =
+                    (oe_call_host_function_args_t*)cell->call_arg;
+
+                // Free the cell for the enqueue one lap later.
+                OE_ATOMIC_MEMORY_BARRIER_RELEASE();
+                cell->sequence = pos + mask + 1;
+                return args;
+            }
+        }
+        else if (diff < 0)
+        {
+            // The cell has not been written yet: empty.
+            return NULL;
+        }
+
+        pos = oe_atomic_load(&queue->head);
+    }
+}
+
+/* Whether the switchless ocall queue holds a call */
+static bool _is_ocall_queue_empty(oe_switchless_queue_t* queue)
+{
+    uint64_t pos = oe_atomic_load(&queue->head);
+    oe_switchless_queue_cell_t* cell =
+        &oe_switchless_queue_cells(queue)[pos & (queue->capacity - 1)];
+
+    return oe_atomic_load(&cell->sequence) != pos + 1;
+}
+
+/*
+** Put a host worker of the switchless ocall queue to sleep. The worker
+** announces that it sleeps before it checks the queue a last time, so an
+** enclave thread that enqueues a call afterwards sees the announcement and
+** wakes up a worker.
+**
+*/
+static void _wait_for_ocall_queue(
+    oe_switchless_queue_t* queue,
+    oe_host_worker_context_t* context,
+    size_t index)
+{
+    volatile uint64_t* sleeping =
+        oe_switchless_queue_sleeping(queue, queue->capacity);
+
+    sleeping[index] = 1;
+    oe_atomic_increment(&queue->num_sleeping);
+
+    if (_is_ocall_queue_empty(queue))
+        oe_host_worker_wait(context);
+
+    // Clear the flag first: the decrement is a full barrier that orders it
+    // before the worker's next look at the queue (see _retire_host_worker).
+    sleeping[index] = 0;
+    oe_atomic_decrement(&queue->num_sleeping);
+}
+
+/*
+**==============================================================================
+**
+** Adaptive spin policy (see oe_switchless_worker_policy_t)
+**
+**==============================================================================
+*/
+
+static void _init_worker_policy(
+    oe_switchless_worker_policy_t* policy,
+    const oe_enclave_setting_context_switchless_t* setting)
+{
+    policy->min_spin_count = setting->min_spin_count
+                                 ? setting->min_spin_count
+                                 : OE_SWITCHLESS_DEFAULT_MIN_SPIN_COUNT;
+    policy->max_spin_count = setting->max_spin_count
+                                 ? setting->max_spin_count
+                                 : OE_SWITCHLESS_DEFAULT_MAX_SPIN_COUNT;
+
+    if (policy->max_spin_count < policy->min_spin_count)
+        policy->max_spin_count = policy->min_spin_count;
+
+    policy->spin_count_threshold = policy->min_spin_count;
+}
+
+static void _clamp_spin_count_threshold(oe_switchless_worker_policy_t* policy)
+{
+    if (policy->spin_count_threshold < policy->min_spin_count)
+        policy->spin_count_threshold = policy->min_spin_count;
+    else if (policy->spin_count_threshold > policy->max_spin_count)
+        policy->spin_count_threshold = policy->max_spin_count;
+}
+
+/* A call arrived after the worker spun spin_count iterations */
+static void _adapt_to_call(
+    oe_switchless_worker_policy_t* policy,
+    uint64_t spin_count)
+{
+    uint64_t target = 2 * spin_count;
+
+    if (target > policy->spin_count_threshold)
+        policy->spin_count_threshold = target;
+    else
+        policy->spin_count_threshold -=
+            (policy->spin_count_threshold - target) / 16;
+
+    _clamp_spin_count_threshold(policy);
+}
+
+/* The worker was parked for park_nsec after spinning total_spin_count
+ * iterations in spin_nsec over its lifetime */
+static void _adapt_to_park(
+    oe_switchless_worker_policy_t* policy,
+    uint64_t park_nsec,
+    uint64_t total_spin_count,
+    uint64_t spin_nsec)
+{
+    // The iterations that the worker would have needed to catch the call
+    // that ended the park.
+    double missed_by = spin_nsec ? (double)park_nsec *
+                                       (double)total_spin_count /
+                                       (double)spin_nsec
+                                 : 0;
+
+    if (missed_by <= (double)policy->spin_count_threshold)
+        policy->spin_count_threshold *= 2;
+    else
+        policy->spin_count_threshold -=
+            (policy->spin_count_threshold - policy->min_spin_count) / 4;
+
+    _clamp_spin_count_threshold(policy);
+}
+
+static void _trace_worker_policy(
+    const char* kind,
+    size_t index,
+    const oe_switchless_worker_policy_t* policy)
+{
+    OE_TRACE_INFO(
+        "Switchless %s worker thread %d: spin %lu us, park %lu us (%lu times), "
+        "work %lu us, spin count threshold %lu",
+        kind,
+        (int)index,
+        policy->spin_nsec / 1000,
+        policy->park_nsec / 1000,
+        policy->num_parks,
+        policy->work_nsec / 1000,
+        policy->spin_count_threshold);
+}
+
+/*
+**==============================================================================
+**
+** Promotion of hot ocalls
+**
+**     The host measures how often and how long each host function runs in
+**     regular ocalls. A window closes at the first call after
+**     OE_SWITCHLESS_PROMOTION_WINDOW_NSEC. The host function is promoted if it
+**     was called at least OE_SWITCHLESS_PROMOTION_MIN_CALLS times per window
+**     and ran for at most OE_SWITCHLESS_PROMOTION_MAX_NSEC on average, and is
+**     demoted otherwise. The host sets the bit of a promoted host function in
+**     promoted_ocalls, and the enclave makes its regular ocalls of it as
+**     switchless ocalls from then on. Host workers keep measuring promoted
+**     host functions, so that they get demoted once they are called less
+**     often or run longer.
+**
+**     The host functions of the switchless machinery itself mark their calls
+**     as internal and are never promoted. Since promotion takes a full window
+**     of regular calls, they are excluded on their first call.
+**
+**     Concurrent updates of a profile may be lost now and then, which only
+**     delays a decision.
+**
+**==============================================================================
+*/
+
+#define OE_SWITCHLESS_PROMOTION_WINDOW_NSEC (10 * 1000 * 1000)
+#define OE_SWITCHLESS_PROMOTION_MIN_CALLS 10
+#define OE_SWITCHLESS_PROMOTION_MAX_NSEC (20 * 1000)
+
+static void _set_ocall_promoted(
+    oe_switchless_call_manager_t* manager,
+    uint64_t function_id,
+    bool promoted)
+{
+    volatile uint64_t* word = &manager->promoted_ocalls[function_id / 64];
+    uint64_t bit = 1ull << (function_id % 64);
+    uint64_t old_word;
+    uint64_t new_word;
+
+    do
+    {
+        old_word = oe_atomic_load(word);
+        new_word = promoted ? (old_word | bit) : (old_word & ~bit);
+
+        if (new_word == old_word)
+            return;
+    } while (!oe_atomic_compare_and_swap(
+        (int64_t volatile*)word, (int64_t)old_word, (int64_t)new_word));
+}
+
+static bool _is_ocall_promoted(
+    oe_switchless_call_manager_t* manager,
+    uint64_t function_id)
+{
+    return (oe_atomic_load(&manager->promoted_ocalls[function_id / 64]) >>
+            (function_id % 64)) &
+           1;
+}
+
+/* A call of the host function ran from start to end */
+static void _profile_ocall(
+    oe_switchless_call_manager_t* manager,
+    uint64_t function_id,
+    uint64_t start,
+    uint64_t end)
+{
+    oe_switchless_ocall_profile_t* profile =
+        &manager->ocall_profiles[function_id];
+    uint64_t window_nsec;
+    bool promote;
+
+    if (profile->promotion != OE_SWITCHLESS_PROMOTION_AUTO ||
+        profile->is_internal)
+        return;
+
+    profile->window_calls++;
+    profile->window_nsec += end - start;
+
+    window_nsec = end - profile->window_start_nsec;
+    if (window_nsec < OE_SWITCHLESS_PROMOTION_WINDOW_NSEC)
+        return;
+
+    // Scale the calls of a window that closed late to a regular window.
+    promote = profile->window_calls * OE_SWITCHLESS_PROMOTION_WINDOW_NSEC >=
+                  OE_SWITCHLESS_PROMOTION_MIN_CALLS * window_nsec &&
+              profile->window_nsec <=
+                  profile->window_calls * OE_SWITCHLESS_PROMOTION_MAX_NSEC;
+    _set_ocall_promoted(manager, function_id, promote);
+
+    profile->window_start_nsec = end;
+    profile->window_calls = 0;
+    profile->window_nsec = 0;
+}
+
+/* Called by the host functions of the switchless machinery */
+static void _mark_internal_ocall(void)
+{
+    oe_thread_binding_t* binding = oe_get_thread_binding();
+
+    if (binding)
+        binding->in_internal_ocall = true;
+}
+
+uint64_t oe_start_ocall_profile(oe_enclave_t* enclave)
+{
+    oe_switchless_call_manager_t* manager = enclave->switchless_manager;
+
+    return manager && manager->ocall_profiles ? oe_call_statistics_now() : 0;
+}
+
+void oe_finish_ocall_profile(
+    oe_enclave_t* enclave,
+    uint64_t arg,
+    uint64_t start)
+{
+    oe_switchless_call_manager_t* manager = enclave->switchless_manager;
+    oe_thread_binding_t* binding = oe_get_thread_binding();
+    bool is_internal = false;
+    uint64_t function_id;
+
+    if (binding)
+    {
+        is_internal = binding->in_internal_ocall;
+        binding->in_internal_ocall = false;
+    }
+
+    if (!start || !manager || !manager->ocall_profiles || !arg)
+        return;
+
+    function_id = ((oe_call_host_function_args_t*)arg)->function_id;
+    if (function_id >= manager->num_ocall_profiles)
+        return;
+
+    if (is_internal)
+    {
+        manager->ocall_profiles[function_id].is_internal = 1;
+        _set_ocall_promoted(manager, function_id, false);
+        return;
+    }
+
+    _profile_ocall(manager, function_id, start, oe_call_statistics_now());
+}
+
+/*
+** Set up the promotion of hot ocalls for the host functions of the enclave,
+** unless ocall_promotion turns it off for all of them
+**
+*/
+static oe_result_t _init_ocall_promotion(
+    oe_enclave_t* enclave,
+    oe_switchless_call_manager_t* manager,
+    const oe_enclave_setting_context_switchless_t* setting)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    const oe_switchless_ocall_promotion_t* overrides =
+        setting->ocall_promotion_overrides;
+    size_t num_overrides = setting->num_ocall_promotion_overrides;
+    bool enabled = setting->ocall_promotion == OE_SWITCHLESS_PROMOTION_AUTO;
+    size_t size;
+
+    for (size_t i = 0; i < num_overrides; i++)
+    {
+        if (overrides[i].promotion != OE_SWITCHLESS_PROMOTION_NEVER)
+            enabled = true;
+    }
+
+    if (!enabled || enclave->num_ocalls == 0)
+    {
+        result = OE_OK;
+        goto done;
+    }
+
+    size = oe_switchless_promoted_ocalls_size(enclave->num_ocalls);
+    manager->promoted_ocalls =
+        (volatile uint64_t*)oe_memalign(OE_SWITCHLESS_CONTEXT_ALIGNMENT, size);
+    if (manager->promoted_ocalls == NULL)
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    memset((void*)manager->promoted_ocalls, 0, size);
+
+    manager->ocall_profiles =
+        calloc(enclave->num_ocalls, sizeof(oe_switchless_ocall_profile_t));
+    if (manager->ocall_profiles == NULL)
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    manager->num_ocall_profiles = enclave->num_ocalls;
+
+    for (size_t i = 0; i < enclave->num_ocalls; i++)
+        manager->ocall_profiles[i].promotion = setting->ocall_promotion;
+
+    for (size_t i = 0; i < num_overrides; i++)
+    {
+        uint32_t function_id = overrides[i].function_id;
+
+        manager->ocall_profiles[function_id].promotion = overrides[i].promotion;
+
+        if (overrides[i].promotion == OE_SWITCHLESS_PROMOTION_ALWAYS)
+            _set_ocall_promoted(manager, function_id, true);
+    }
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+/*
+**==============================================================================
+**
+** CPU affinity of the workers (see oe_switchless_affinity_t)
+**
+**     Each worker sets its own affinity when it starts. The affinity only
+**     affects performance, so failing to set it is traced rather than
+**     reported.
+**
+**==============================================================================
+*/
+
+#define OE_SWITCHLESS_MAX_NODE_CPUS 4096
+
+static oe_result_t _copy_cpus(
+    const uint32_t* cpus,
+    size_t num_cpus,
+    uint32_t** copy_out)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    uint32_t* copy = NULL;
+
+    *copy_out = NULL;
+
+    if (num_cpus == 0)
+    {
+        result = OE_OK;
+        goto done;
+    }
+
+    if (!(copy = calloc(num_cpus, sizeof(uint32_t))))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    memcpy(copy, cpus, num_cpus * sizeof(uint32_t));
+    *copy_out = copy;
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+static oe_result_t _init_worker_affinity(
+    oe_switchless_call_manager_t* manager,
+    const oe_enclave_setting_context_switchless_t* setting)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    const uint32_t* host_cpus = setting->host_worker_cpus;
+    size_t num_host_cpus = setting->num_host_worker_cpus;
+    const uint32_t* enclave_cpus = setting->enclave_worker_cpus;
+    size_t num_enclave_cpus = setting->num_enclave_worker_cpus;
+    uint32_t* node_cpus = NULL;
+
+    if (setting->worker_affinity == OE_SWITCHLESS_AFFINITY_NONE)
+    {
+        result = OE_OK;
+        goto done;
+    }
+
+    if (setting->worker_affinity == OE_SWITCHLESS_AFFINITY_CREATOR_NODE)
+    {
+        size_t num_node_cpus = OE_SWITCHLESS_MAX_NODE_CPUS;
+        int node = oe_thread_get_numa_node();
+
+        if (!(node_cpus = calloc(num_node_cpus, sizeof(uint32_t))))
+            OE_RAISE(OE_OUT_OF_MEMORY);
+
+        if (node < 0 || oe_get_numa_node_cpus(node, node_cpus, &num_node_cpus))
+        {
+            OE_TRACE_WARNING(
+                "Cannot find the CPUs of the NUMA node of the thread that "
+                "creates the enclave. Switchless workers run on any CPU.");
+            result = OE_OK;
+            goto done;
+        }
+
+        host_cpus = enclave_cpus = node_cpus;
+        num_host_cpus = num_enclave_cpus = num_node_cpus;
+    }
+    else
+    {
+        manager->pin_workers = true;
+    }
+
+    OE_CHECK(_copy_cpus(host_cpus, num_host_cpus, &manager->host_worker_cpus));
+    manager->num_host_worker_cpus = num_host_cpus;
+
+    OE_CHECK(_copy_cpus(
+        enclave_cpus, num_enclave_cpus, &manager->enclave_worker_cpus));
+    manager->num_enclave_worker_cpus = num_enclave_cpus;
+
+    result = OE_OK;
+
+done:
+    free(node_cpus);
+    return result;
+}
+
+static void _set_worker_affinity(
+    const char* kind,
+    size_t index,
+    const uint32_t* cpus,
+    size_t num_cpus,
+    bool pin)
+{
+    if (num_cpus == 0)
+        return;
+
+    if (pin)
+    {
+        cpus += index % num_cpus;
+        num_cpus = 1;
+    }
+
+    if (oe_thread_set_affinity(cpus, num_cpus) != 0)
+        OE_TRACE_WARNING(
+            "Cannot set the CPU affinity of switchless %s worker thread %d",
+            kind,
+            (int)index);
+}
+
+/*
+** Handle a switchless ocall in a host worker
+**
+*/
+static void _handle_switchless_ocall(
+    oe_host_worker_context_t* context,
+    oe_switchless_worker_policy_t* policy,
+    volatile oe_call_host_function_args_t* args)
+{
+    oe_enclave_t* enclave = context->enc;
+    oe_switchless_call_manager_t* manager = enclave->switchless_manager;
+    uint64_t function_id = args->function_id;
+    uint64_t start = 0;
+    bool recorded = enclave->call_statistics_enabled;
+    bool profiled = false;
+
+    // The arguments may be reused by the enclave as soon as the call has
+    // been handled.
+    if (manager->ocall_profiles && function_id < manager->num_ocall_profiles &&
+        _is_ocall_promoted(manager, function_id))
+        profiled = true;
+
+    if (recorded || profiled)
+        start = oe_call_statistics_now();
+
+    oe_handle_call_host_function((uint64_t)args, enclave);
+
+    if (profiled)
+        _profile_ocall(
+            manager, function_id, start, oe_call_statistics_now());
+
+    // Wake up the enclave threads that sleep until their calls complete.
+    // The fence orders the store of the result before the load of
+    // num_parked_callers, which pairs with the increment of
+    // num_parked_callers before a sleeping thread checks its result.
+    oe_atomic_fence();
+    if (oe_atomic_load(&manager->num_parked_callers) != 0)
+    {
+        oe_atomic_increment((volatile uint64_t*)&manager->completion_sequence);
+        oe_switchless_address_wake_all(&manager->completion_sequence);
+    }
+
+    if (recorded)
+        _record_switchless_ocall(enclave, context, function_id, start);
+
+    policy->num_calls++;
+}
+
+/*
+** Hand over the calls of a host worker that is stopping. With slots, the
+** worker closes its slot by replacing NULL with OE_SWITCHLESS_WORKER_RETIRED,
+** after handling a call that was posted to it. With the queue, enclave
+** threads no longer wake the worker once it has cleared its sleeping flag,
+** but it may have been woken for a call that it has not dequeued yet, so it
+** drains the queue.
+**
+*/
+static void _retire_host_worker(
+    oe_host_worker_context_t* context,
+    oe_switchless_worker_policy_t* policy,
+    oe_switchless_queue_t* queue)
+{
+    volatile oe_call_host_function_args_t* args;
+
+    if (queue)
+    {
+        while ((args = _dequeue_switchless_ocall(queue)) != NULL)
+            _handle_switchless_ocall(context, policy, args);
+
+        return;
+    }
+
+    while (!oe_atomic_compare_and_swap_ptr(
+        (void* volatile*)&context->call_arg,
+        NULL,
+        OE_SWITCHLESS_WORKER_RETIRED))
+    {
+        args = context->call_arg;
+        _handle_switchless_ocall(context, policy, args);
+        context->call_arg = NULL;
+    }
+}
+
+/*
+** The thread function that handles switchless ocalls
+**
+*/
+static void* _switchless_ocall_worker(void* arg)
+{
+    oe_host_worker_context_t* context = (oe_host_worker_context_t*)arg;
+
+    // The manager is published before the workers are started.
+    oe_switchless_call_manager_t* manager = context->enc->switchless_manager;
+    oe_switchless_queue_t* queue = manager->ocall_queue;
+    size_t index = (size_t)(context - manager->host_worker_contexts);
+    oe_switchless_worker_policy_t* policy =
+        &manager->host_worker_policies[index];
+    uint64_t phase_start;
+
+    _set_worker_affinity(
+        "host",
+        index,
+        manager->host_worker_cpus,
+        manager->num_host_worker_cpus,
+        manager->pin_workers);
+
+    phase_start = oe_call_statistics_now();
+    policy->start_nsec = phase_start;
+
+    while (!context->is_stopping)
+    {
+        volatile oe_call_host_function_args_t* local_call_arg = NULL;
+        bool from_slot = true;
+
+        if ((local_call_arg = context->call_arg) == NULL && queue)
+        {
+            local_call_arg = _dequeue_switchless_ocall(queue);
+            from_slot = false;
+
+            // Another call is waiting for a worker already.
+            if (local_call_arg && !_is_ocall_queue_empty(queue))
+                policy->num_backlogged++;
+        }
+
+        if (local_call_arg != NULL)
+        {
+            uint64_t now = oe_call_statistics_now();
+
+            policy->spin_nsec += now - phase_start;
+            _adapt_to_call(policy, context->spin_count);
+
+            // Handle the switchless call, but do not clear the slot yet. Since
+            // the slot is not empty, any new incoming switchless call request
+            // will be scheduled in another available work thread and get
+            // handled immediately.
+            _handle_switchless_ocall(context, policy, local_call_arg);
+
+            // After handling the switchless call, mark this worker thread
+            // as free by clearing the slot.
+            if (from_slot)
+                context->call_arg = NULL;
+
+            phase_start = oe_call_statistics_now();
+            policy->work_nsec += phase_start - now;
+
+            // Reset spin count for next message.
+            context->total_spin_count += context->spin_count;
+            context->spin_count = 0;
+        }
+        else
+        {
+            // If there is no message, increment spin count until threshold is
+            // reached.
+            if (++context->spin_count >= policy->spin_count_threshold)
+            {
+                uint64_t now = oe_call_statistics_now();
+
+                // Reset spin count and go to sleep until event is fired.
+                context->total_spin_count += context->spin_count;
+                context->spin_count = 0;
+                policy->spin_nsec += now - phase_start;
+
+                if (queue)
+                    _wait_for_ocall_queue(queue, context, index);
+                else
+                    oe_host_worker_wait(context);
+
+                phase_start = oe_call_statistics_now();
+                policy->park_nsec += phase_start - now;
+                policy->num_parks++;
+                _adapt_to_park(
+                    policy,
+                    phase_start - now,
+                    context->total_spin_count,
+                    policy->spin_nsec);
+            }
+
+            /* Yield CPU */
+            oe_yield_cpu();
+        }
+    }
+
+    _retire_host_worker(context, policy, queue);
+    return NULL;
+}
+
+/*
+**==============================================================================
+**
+** Elastic host worker pool
+**
+**     If min_host_workers is smaller than num_host_workers, only host workers
+**     [0, num_running_host_workers) run. Every OE_SWITCHLESS_POOL_PERIOD_MSEC
+**     the pool thread
+**
+**     - starts the next worker if at least 1 in OE_SWITCHLESS_POOL_GROW_RATIO
+**       switchless ocalls of the period fell back to a regular ocall or had
+**       to wait in the ocall queue, or
+**
+**     - stops the last worker once no ocall has fallen back or waited for
+**       OE_SWITCHLESS_POOL_IDLE_PERIODS periods in a row, and the running
+**       workers would have been at most half busy with one worker fewer.
+**
+**     Enclave threads never wait for the pool. A worker that is not running
+**     has its slot closed and its sleeping flag cleared, so enclave threads
+**     post to the running workers or fall back.
+**
+**==============================================================================
+*/
+
+#define OE_SWITCHLESS_POOL_PERIOD_MSEC 10
+#define OE_SWITCHLESS_POOL_GROW_RATIO 16
+#define OE_SWITCHLESS_POOL_IDLE_PERIODS 100
+
+static oe_result_t _start_host_worker(
+    oe_switchless_call_manager_t* manager,
+    size_t index)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_host_worker_context_t* context = &manager->host_worker_contexts[index];
+
+    OE_TRACE_INFO("Creating switchless host worker thread %d\n", (int)index);
+
+    // The previous thread of the worker, if any, has been joined.
+    context->is_stopping = false;
+    context->event = 0;
+    context->spin_count = 0;
+    context->call_arg = NULL;
+
+    if (oe_thread_create(
+            &manager->host_worker_threads[index],
+            _switchless_ocall_worker,
+            context) != 0)
+    {
+        manager->host_worker_threads[index] = (oe_thread_t)NULL;
+        context->call_arg = OE_SWITCHLESS_WORKER_RETIRED;
+        OE_RAISE(OE_THREAD_CREATE_ERROR);
+    }
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+static oe_result_t _stop_host_worker(
+    oe_switchless_call_manager_t* manager,
+    size_t index)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_host_worker_context_t* context = &manager->host_worker_contexts[index];
+
+    OE_TRACE_INFO("Stopping switchless host worker thread %d\n", (int)index);
+
+    context->is_stopping = true;
+    oe_host_worker_wake(context);
+
+    if (oe_thread_join(manager->host_worker_threads[index]))
+        OE_RAISE(OE_THREAD_JOIN_ERROR);
+
+    manager->host_worker_threads[index] = (oe_thread_t)NULL;
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+/* Sum the switchless calls that missed on each binding of the enclave */
+static void _count_misses(
+    oe_enclave_t* enclave,
+    uint64_t* num_ocall_misses,
+    uint64_t* num_ecall_misses)
+{
+    *num_ocall_misses = 0;
+    *num_ecall_misses = 0;
+
+    for (size_t i = 0; i < enclave->num_bindings; i++)
+    {
+        *num_ocall_misses += enclave->bindings[i].num_switchless_ocall_misses;
+        *num_ecall_misses += enclave->bindings[i].num_switchless_ecall_misses;
+    }
+}
+
+static void* _switchless_pool_thread(void* arg)
+{
+    oe_switchless_call_manager_t* manager = (oe_switchless_call_manager_t*)arg;
+    uint64_t last_calls = 0;
+    uint64_t last_saturated = 0;
+    uint64_t last_work_nsec = 0;
+    uint64_t last_time = oe_call_statistics_now();
+    uint64_t idle_periods = 0;
+
+    while (!manager->pool_is_stopping)
+    {
+        size_t running = (size_t)manager->num_running_host_workers;
+        uint64_t calls;
+        uint64_t saturated;
+        uint64_t ecall_misses;
+        uint64_t work_nsec = 0;
+        uint64_t now;
+
+        oe_switchless_event_wait(
+            &manager->pool_event, OE_SWITCHLESS_POOL_PERIOD_MSEC);
+        if (manager->pool_is_stopping)
+            break;
+
+        now = oe_call_statistics_now();
+        _count_misses(
+            manager->host_worker_contexts[0].enc, &calls, &ecall_misses);
+        saturated = calls;
+        for (size_t i = 0; i < manager->num_host_workers; i++)
+        {
+            calls += manager->host_worker_policies[i].num_calls;
+            saturated += manager->host_worker_policies[i].num_backlogged;
+            work_nsec += manager->host_worker_policies[i].work_nsec;
+        }
+
+        if (saturated > last_saturated)
+        {
+            idle_periods = 0;
+
+            if ((saturated - last_saturated) * OE_SWITCHLESS_POOL_GROW_RATIO >=
+                    calls - last_calls &&
+                running < manager->num_host_workers &&
+                _start_host_worker(manager, running) == OE_OK)
+            {
+                oe_atomic_increment(&manager->num_running_host_workers);
+                oe_atomic_increment(&manager->num_grows);
+            }
+        }
+        else if (
+            running > manager->min_host_workers &&
+            2 * (work_nsec - last_work_nsec) <=
+                (running - 1) * (now - last_time))
+        {
+            if (++idle_periods >= OE_SWITCHLESS_POOL_IDLE_PERIODS &&
+                _stop_host_worker(manager, running - 1) == OE_OK)
+            {
+                oe_atomic_decrement(&manager->num_running_host_workers);
+                oe_atomic_increment(&manager->num_shrinks);
+                idle_periods = 0;
+            }
+        }
+        else
+        {
+            idle_periods = 0;
+        }
+
+        last_calls = calls;
+        last_saturated = saturated;
+        last_work_nsec = work_nsec;
+        last_time = now;
+    }
+
+    return NULL;
+}
+
+/*
+** The switchless calls that missed are counted on the binding that the
+** regular call is made on, which only the thread bound to it writes. The
+** posts are counted where they happen: the tails of the queues advance once
+** for each post, and enclave threads count the posts to the slot of each
+** host worker in its context.
+*/
+void oe_count_switchless_fallback(
+    oe_enclave_t* enclave,
+    uint64_t tcs,
+    uint64_t arg)
+{
+    oe_switchless_call_manager_t* manager = enclave->switchless_manager;
+    oe_thread_binding_t* binding;
 
-/**
- * Make the following ECALLs weak to support the system EDL opt-in.
- * When the user does not opt into (import) the EDL, the linker will pick
- * the following default implementations. If the user opts into the EDL,
- * the implementions (which are also weak) in the oeedger8r-generated code will
- * be used. This behavior is guaranteed by the linker; i.e., the linker will
- * pick the symbols defined in the object before those in the library.
- */
-oe_result_t _oe_sgx_init_context_switchless_ecall(
+    // oe_post_switchless_ocall() marks the call as not handled yet before it
+    // tries to post it, whereas the arguments of a regular ocall carry
+    // OE_UNEXPECTED.
+    if (manager && manager->num_host_workers && arg &&
+        ((oe_call_host_function_args_t*)arg)->result == OE_UINT64_MAX &&
+        (binding = oe_get_binding_by_tcs(enclave, tcs)))
+        binding->num_switchless_ocall_misses++;
+}
+
+void oe_count_switchless_ecall_fallback(
     oe_enclave_t* enclave,
-    oe_result_t* _retval,
-    oe_host_worker_context_t* host_worker_contexts,
-    uint64_t num_host_workers)
+    uint64_t tcs,
+    uint16_t func,
+    uint64_t arg)
 {
-    OE_UNUSED(enclave);
-    OE_UNUSED(host_worker_contexts);
-    OE_UNUSED(num_host_workers);
+    oe_switchless_call_manager_t* manager = enclave->switchless_manager;
+    oe_call_enclave_function_args_t* args =
+        (oe_call_enclave_function_args_t*)arg;
+    oe_thread_binding_t* binding;
 
-    if (_retval)
-        *_retval = OE_UNSUPPORTED;
+    // oe_switchless_call_enclave_function() leaves the result of a call that
+    // missed as it was for the enclave workers.
+    if (!manager || !manager->ecall_queue ||
+        func != OE_ECALL_CALL_ENCLAVE_FUNCTION || !args ||
+        args->result != __OE_RESULT_MAX)
+        return;
 
-    return OE_UNSUPPORTED;
+    if ((binding = oe_get_binding_by_tcs(enclave, tcs)))
+        binding->num_switchless_ecall_misses++;
+
+    args->result = OE_UNEXPECTED;
 }
-OE_WEAK_ALIAS(
-    _oe_sgx_init_context_switchless_ecall,
-    oe_sgx_init_context_switchless_ecall);
 
-oe_result_t _oe_sgx_switchless_enclave_worker_thread_ecall(
+oe_result_t oe_get_switchless_pool_statistics(
     oe_enclave_t* enclave,
-    oe_enclave_worker_context_t* context)
+    oe_switchless_pool_statistics_t* statistics)
 {
-    OE_UNUSED(enclave);
-    OE_UNUSED(context);
-    return OE_UNSUPPORTED;
+    oe_result_t result = OE_UNEXPECTED;
+    oe_switchless_call_manager_t* manager;
+    uint64_t num_ecall_misses;
+
+    if (!enclave || enclave->magic != ENCLAVE_MAGIC || !statistics)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    manager = enclave->switchless_manager;
+    if (!manager || manager->num_host_workers == 0)
+        OE_RAISE(OE_NOT_FOUND);
+
+    memset(statistics, 0, sizeof(*statistics));
+    statistics->min_host_workers = manager->min_host_workers;
+    statistics->max_host_workers = manager->num_host_workers;
+    statistics->num_host_workers = (size_t)manager->num_running_host_workers;
+    statistics->num_grows = manager->num_grows;
+    statistics->num_shrinks = manager->num_shrinks;
+    _count_misses(enclave, &statistics->num_fallbacks, &num_ecall_misses);
+    statistics->num_parked_waits = manager->num_parked_waits;
+
+    for (size_t i = 0; i < manager->num_ocall_profiles; i++)
+    {
+        if (_is_ocall_promoted(manager, i))
+            statistics->num_promoted_ocalls++;
+    }
+
+    for (size_t i = 0; i < manager->num_host_workers; i++)
+    {
+        statistics->num_calls += manager->host_worker_policies[i].num_calls;
+        statistics->num_backlogged +=
+            manager->host_worker_policies[i].num_backlogged;
+    }
+
+    result = OE_OK;
+
+done:
+    return result;
 }
-OE_WEAK_ALIAS(
-    _oe_sgx_switchless_enclave_worker_thread_ecall,
-    oe_sgx_switchless_enclave_worker_thread_ecall);
 
-/*
-** The thread function that handles switchless ocalls
-**
-*/
-static void* _switchless_ocall_worker(void* arg)
+static void _get_worker_statistics(
+    oe_switchless_worker_statistics_t* statistics,
+    const oe_switchless_worker_policy_t* policy,
+    uint64_t num_calls,
+    uint64_t total_spin_count,
+    uint64_t spin_count)
 {
-    oe_host_worker_context_t* context = (oe_host_worker_context_t*)arg;
+    statistics->num_calls = num_calls;
+    statistics->num_spins = total_spin_count + spin_count;
+    statistics->num_parks = policy->num_parks;
+    statistics->num_wakes = policy->num_wakes;
+}
 
-    while (!context->is_stopping)
+oe_result_t oe_get_switchless_statistics(
+    oe_enclave_t* enclave,
+    oe_switchless_statistics_t* statistics,
+    oe_switchless_worker_statistics_t* workers,
+    size_t* num_workers)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_switchless_call_manager_t* manager;
+    size_t num_available;
+
+    if (!enclave || enclave->magic != ENCLAVE_MAGIC || !statistics ||
+        !num_workers)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (*num_workers && !workers)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    manager = enclave->switchless_manager;
+    if (!manager)
+        OE_RAISE(OE_NOT_FOUND);
+
+    memset(statistics, 0, sizeof(*statistics));
+    statistics->num_host_workers = manager->num_host_workers;
+    statistics->num_enclave_workers = manager->num_enclave_workers;
+    _count_misses(
+        enclave,
+        &statistics->num_ocall_misses,
+        &statistics->num_ecall_misses);
+
+    if (manager->ocall_queue)
+        statistics->num_ocall_posts =
+            oe_atomic_load(&manager->ocall_queue->tail);
+
+    if (manager->ecall_queue)
+        statistics->num_ecall_posts =
+            oe_atomic_load(&manager->ecall_queue->tail);
+
+    for (size_t i = 0; i < manager->num_host_workers; i++)
     {
-        volatile oe_call_host_function_args_t* local_call_arg = NULL;
-        if ((local_call_arg = context->call_arg) != NULL)
-        {
-            // Handle the switchless call, but do not clear the slot yet. Since
-            // the slot is not empty, any new incoming switchless call request
-            // will be scheduled in another available work thread and get
-            // handled immediately.
-            oe_handle_call_host_function(
-                (uint64_t)local_call_arg, context->enc);
+        oe_host_worker_context_t* context = &manager->host_worker_contexts[i];
+        oe_switchless_worker_statistics_t worker;
 
-            // After handling the switchless call, mark this worker thread
-            // as free by clearing the slot.
-            context->call_arg = NULL;
+        _get_worker_statistics(
+            &worker,
+            &manager->host_worker_policies[i],
+            manager->host_worker_policies[i].num_calls,
+            context->total_spin_count,
+            context->spin_count);
 
-            // Reset spin count for next message.
-            context->total_spin_count += context->spin_count;
-            context->spin_count = 0;
-        }
-        else
-        {
-            // If there is no message, increment spin count until threshold is
-            // reached.
-            if (++context->spin_count >= OE_HOST_WORKER_SPIN_COUNT_THRESHOLD)
-            {
-                // Reset spin count and go to sleep until event is fired.
-                context->total_spin_count += context->spin_count;
-                context->spin_count = 0;
-                oe_host_worker_wait(context);
-            }
+        if (!manager->ocall_queue)
+            statistics->num_ocall_posts += context->num_posts;
 
-            /* Yield CPU */
-            oe_yield_cpu();
-        }
+        statistics->num_wake_ocalls += worker.num_wakes;
+
+        if (i < *num_workers)
+            workers[i] = worker;
     }
-    return NULL;
+
+    for (size_t i = 0; i < manager->num_enclave_workers; i++)
+    {
+        volatile oe_enclave_worker_context_t* context =
+            &manager->enclave_worker_contexts[i];
+        size_t index = manager->num_host_workers + i;
+        oe_switchless_worker_statistics_t worker;
+
+        _get_worker_statistics(
+            &worker,
+            &manager->enclave_worker_policies[i],
+            context->num_calls,
+            context->total_spin_count,
+            context->spin_count);
+
+
+        if (index < *num_workers)
+            workers[index] = worker;
+    }
+
+    num_available = manager->num_host_workers + manager->num_enclave_workers;
+    if (num_available > *num_workers)
+    {
+        *num_workers = num_available;
+        result = OE_BUFFER_TOO_SMALL;
+        goto done;
+    }
+
+    *num_workers = num_available;
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+/*
+** Attribute the time that host threads waited for switchless ecalls to the
+** enclave workers by the number of calls that each one handled
+**
+*/
+static void _update_enclave_work_nsec(oe_switchless_call_manager_t* manager)
+{
+    uint64_t num_calls = 0;
+
+    for (size_t i = 0; i < manager->num_enclave_workers; i++)
+        num_calls += manager->enclave_worker_contexts[i].num_calls;
+
+    if (num_calls == 0)
+        return;
+
+    for (size_t i = 0; i < manager->num_enclave_workers; i++)
+        manager->enclave_worker_policies[i].work_nsec = (uint64_t)(
+            (double)manager->ecall_nsec *
+            (double)manager->enclave_worker_contexts[i].num_calls /
+            (double)num_calls);
 }
 
 void oe_sgx_sleep_switchless_worker_ocall(oe_enclave_worker_context_t* context)
 {
+    oe_switchless_call_manager_t* manager = context->enc->switchless_manager;
+    oe_switchless_worker_policy_t* policy = NULL;
+    uint64_t start = oe_call_statistics_now();
+    uint64_t end;
+    uint64_t elapsed;
+    uint64_t busy;
+    size_t index;
+
+    _mark_internal_ocall();
+
     // Wait for messages.
     oe_enclave_worker_wait(context);
+    end = oe_call_statistics_now();
+
+    if (!manager)
+        return;
+
+    index = (size_t)(context - manager->enclave_worker_contexts);
+    if (index >= manager->num_enclave_workers)
+        return;
+
+    // The enclave worker spins whenever it neither works nor sleeps.
+    _update_enclave_work_nsec(manager);
+    policy = &manager->enclave_worker_policies[index];
+    elapsed = start - policy->start_nsec;
+    busy = policy->park_nsec + policy->work_nsec;
+    policy->spin_nsec = elapsed > busy ? elapsed - busy : 0;
+    policy->park_nsec += end - start;
+    policy->num_parks++;
+
+    // Hand the adapted threshold to the worker for its next spin.
+    _adapt_to_park(
+        policy, end - start, context->total_spin_count, policy->spin_nsec);
+    context->spin_count_threshold = policy->spin_count_threshold;
+}
+
+/*
+** Sleep until a host worker has completed the switchless ocall of args. The
+** enclave thread calls this once it has checked the call
+** ocall_wait_spin_count times. Host workers wake up all sleeping threads
+** after each call, and each thread goes back to sleep until its own call has
+** completed. Each sleep is bounded, so a thread also rechecks its call if a
+** wake-up gets lost.
+**
+*/
+#define OE_SWITCHLESS_OCALL_WAIT_TIMEOUT_MSEC 100
+
+void oe_sgx_wait_switchless_ocall_ocall(
+    oe_host_worker_context_t* context,
+    void* args)
+{
+    volatile oe_call_host_function_args_t* call = args;
+    oe_switchless_call_manager_t* manager = context->enc->switchless_manager;
+    bool parked = false;
+
+    _mark_internal_ocall();
+
+    if (!manager || !call)
+        return;
+
+    // The atomic increment is a full barrier, so a host worker that
+    // completes the call after the check below sees num_parked_callers.
+    oe_atomic_increment(&manager->num_parked_callers);
+
+    for (;;)
+    {
+        int64_t sequence = (int64_t)oe_atomic_load(
+            (volatile uint64_t*)&manager->completion_sequence);
+
+        if (call->result != OE_UINT64_MAX)
+            break;
+
+        parked = true;
+        oe_switchless_address_wait(
+            &manager->completion_sequence,
+            sequence,
+            OE_SWITCHLESS_OCALL_WAIT_TIMEOUT_MSEC);
+    }
+
+    oe_atomic_decrement(&manager->num_parked_callers);
+
+    if (parked)
+        oe_atomic_increment(&manager->num_parked_waits);
 }
 
 /*
@@ -135,10 +1319,26 @@ void oe_sgx_sleep_switchless_worker_ocall(oe_enclave_worker_context_t* context)
 static void* _switchless_ecall_worker(void* arg)
 {
     oe_enclave_worker_context_t* context = (oe_enclave_worker_context_t*)arg;
+    oe_switchless_call_manager_t* manager = context->enc->switchless_manager;
+    size_t index = (size_t)(context - manager->enclave_worker_contexts);
+
+    _set_worker_affinity(
+        "enclave",
+        index,
+        manager->enclave_worker_cpus,
+        manager->num_enclave_worker_cpus,
+        manager->pin_workers);
+
+    manager->enclave_worker_policies[index].start_nsec =
+        oe_call_statistics_now();
 
     // Enter enclave to process ecall messages.
-    if (oe_sgx_switchless_enclave_worker_thread_ecall(context->enc, context) !=
-        OE_OK)
+    if (oe_sgx_switchless_enclave_worker_thread_ecall(
+            context->enc,
+            context,
+            manager->ecall_queue,
+            index,
+            manager->num_enclave_workers) != OE_OK)
     {
         OE_TRACE_ERROR("Switchless enclave worker thread failed\n");
     }
@@ -149,15 +1349,23 @@ static void* _switchless_ecall_worker(void* arg)
 static oe_result_t oe_stop_worker_threads(oe_switchless_call_manager_t* manager)
 {
     oe_result_t result = OE_UNEXPECTED;
+
+    // Stop the pool thread first so that it no longer starts workers.
+    if (manager->pool_thread != (oe_thread_t)NULL)
+    {
+        manager->pool_is_stopping = true;
+        oe_switchless_event_wake(&manager->pool_event);
+
+        if (oe_thread_join(manager->pool_thread))
+            OE_RAISE(OE_THREAD_JOIN_ERROR);
+
+        manager->pool_thread = (oe_thread_t)NULL;
+    }
+
     for (size_t i = 0; i < manager->num_host_workers; i++)
     {
         manager->host_worker_contexts[i].is_stopping = true;
         oe_host_worker_wake(&manager->host_worker_contexts[i]);
-
-        OE_TRACE_INFO(
-            "Switchless host worker thread %d spun for %lu times",
-            (int)i,
-            manager->host_worker_contexts[i].total_spin_count);
     }
     for (size_t i = 0; i < manager->num_enclave_workers; i++)
     {
@@ -179,17 +1387,42 @@ static oe_result_t oe_stop_worker_threads(oe_switchless_call_manager_t* manager)
                 OE_RAISE(OE_THREAD_JOIN_ERROR);
     }
 
+    for (size_t i = 0; i < manager->num_host_workers; i++)
+        _trace_worker_policy("host", i, &manager->host_worker_policies[i]);
+
+    _update_enclave_work_nsec(manager);
+    for (size_t i = 0; i < manager->num_enclave_workers; i++)
+        _trace_worker_policy(
+            "enclave", i, &manager->enclave_worker_policies[i]);
+
     result = OE_OK;
 done:
     return result;
 }
 
+/*
+** Allocate an array of worker contexts or policies that starts on a cache
+** line, so that each element occupies cache lines of its own.
+**
+*/
+static void* _allocate_contexts(size_t count, size_t context_size)
+{
+    size_t size = (count ? count : 1) * context_size;
+    void* contexts = oe_memalign(OE_SWITCHLESS_CONTEXT_ALIGNMENT, size);
+
+    if (contexts)
+        memset(contexts, 0, size);
+
+    return contexts;
+}
+
 oe_result_t oe_start_switchless_manager(
     oe_enclave_t* enclave,
-    size_t num_host_workers,
-    size_t num_enclave_workers)
+    const oe_enclave_setting_context_switchless_t* setting)
 {
     oe_result_t result = OE_UNEXPECTED;
+    size_t num_host_workers = 0;
+    size_t num_enclave_workers = 0;
     oe_result_t result_out = 0;
     oe_switchless_call_manager_t* manager = NULL;
     oe_host_worker_context_t* host_contexts = NULL;
@@ -197,12 +1430,48 @@ oe_result_t oe_start_switchless_manager(
     oe_enclave_worker_context_t* enclave_contexts = NULL;
     oe_thread_t* enclave_threads = NULL;
 
-    if (enclave == NULL)
+    if (enclave == NULL || setting == NULL ||
+        (setting->ocall_transport != OE_SWITCHLESS_OCALL_TRANSPORT_QUEUE &&
+         setting->ocall_transport != OE_SWITCHLESS_OCALL_TRANSPORT_SLOTS))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (setting->min_spin_count && setting->max_spin_count &&
+        setting->min_spin_count > setting->max_spin_count)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    // Internal ocalls must be observed as regular ocalls to be excluded, so
+    // OE_SWITCHLESS_PROMOTION_ALWAYS is only valid for single host functions.
+    if ((setting->ocall_promotion != OE_SWITCHLESS_PROMOTION_AUTO &&
+         setting->ocall_promotion != OE_SWITCHLESS_PROMOTION_NEVER) ||
+        (setting->num_ocall_promotion_overrides &&
+         !setting->ocall_promotion_overrides))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if ((setting->worker_affinity != OE_SWITCHLESS_AFFINITY_NONE &&
+         setting->worker_affinity != OE_SWITCHLESS_AFFINITY_CPUS &&
+         setting->worker_affinity != OE_SWITCHLESS_AFFINITY_CREATOR_NODE) ||
+        (setting->num_host_worker_cpus && !setting->host_worker_cpus) ||
+        (setting->num_enclave_worker_cpus && !setting->enclave_worker_cpus))
         OE_RAISE(OE_INVALID_PARAMETER);
 
+    for (size_t i = 0; i < setting->num_ocall_promotion_overrides; i++)
+    {
+        const oe_switchless_ocall_promotion_t* entry =
+            &setting->ocall_promotion_overrides[i];
+
+        if (entry->function_id >= enclave->num_ocalls ||
+            (entry->promotion != OE_SWITCHLESS_PROMOTION_AUTO &&
+             entry->promotion != OE_SWITCHLESS_PROMOTION_ALWAYS &&
+             entry->promotion != OE_SWITCHLESS_PROMOTION_NEVER))
+            OE_RAISE(OE_INVALID_PARAMETER);
+    }
+
     if (enclave->switchless_manager != NULL)
         OE_RAISE(OE_UNEXPECTED);
 
+    num_host_workers = setting->max_host_workers;
+    num_enclave_workers = setting->max_enclave_workers;
+
     if (num_host_workers == 0 && num_enclave_workers == 0)
         OE_RAISE(OE_UNEXPECTED);
 
@@ -221,7 +1490,8 @@ oe_result_t oe_start_switchless_manager(
     if (manager == NULL)
         OE_RAISE(OE_OUT_OF_MEMORY);
 
-    host_contexts = calloc(num_host_workers, sizeof(oe_host_worker_context_t));
+    host_contexts = (oe_host_worker_context_t*)_allocate_contexts(
+        num_host_workers, sizeof(oe_host_worker_context_t));
     if (host_contexts == NULL)
         OE_RAISE(OE_OUT_OF_MEMORY);
 
@@ -229,8 +1499,8 @@ oe_result_t oe_start_switchless_manager(
     if (host_threads == NULL)
         OE_RAISE(OE_OUT_OF_MEMORY);
 
-    enclave_contexts =
-        calloc(num_enclave_workers, sizeof(oe_enclave_worker_context_t));
+    enclave_contexts = (oe_enclave_worker_context_t*)_allocate_contexts(
+        num_enclave_workers, sizeof(oe_enclave_worker_context_t));
     if (enclave_contexts == NULL)
         OE_RAISE(OE_OUT_OF_MEMORY);
 
@@ -238,6 +1508,41 @@ oe_result_t oe_start_switchless_manager(
     if (enclave_threads == NULL)
         OE_RAISE(OE_OUT_OF_MEMORY);
 
+    manager->host_worker_statistics =
+        calloc(num_host_workers, sizeof(oe_call_statistics_table_t*));
+    if (manager->host_worker_statistics == NULL)
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    manager->host_worker_policies =
+        (oe_switchless_worker_policy_t*)_allocate_contexts(
+            num_host_workers, sizeof(oe_switchless_worker_policy_t));
+    manager->enclave_worker_policies =
+        (oe_switchless_worker_policy_t*)_allocate_contexts(
+            num_enclave_workers, sizeof(oe_switchless_worker_policy_t));
+    if (!manager->host_worker_policies || !manager->enclave_worker_policies)
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    for (size_t i = 0; i < num_host_workers; i++)
+        _init_worker_policy(&manager->host_worker_policies[i], setting);
+
+    for (size_t i = 0; i < num_enclave_workers; i++)
+        _init_worker_policy(&manager->enclave_worker_policies[i], setting);
+
+    if (num_enclave_workers > 0)
+    {
+        manager->ecall_queue = _create_queue(enclave, num_enclave_workers);
+        if (manager->ecall_queue == NULL)
+            OE_RAISE(OE_OUT_OF_MEMORY);
+    }
+
+    if (num_host_workers > 0 &&
+        setting->ocall_transport == OE_SWITCHLESS_OCALL_TRANSPORT_QUEUE)
+    {
+        manager->ocall_queue = _create_queue(enclave, num_host_workers);
+        if (manager->ocall_queue == NULL)
+            OE_RAISE(OE_OUT_OF_MEMORY);
+    }
+
     manager->num_host_workers = num_host_workers;
     manager->host_worker_contexts = host_contexts;
     manager->host_worker_threads = host_threads;
@@ -245,18 +1550,36 @@ oe_result_t oe_start_switchless_manager(
     manager->enclave_worker_contexts = enclave_contexts;
     manager->enclave_worker_threads = enclave_threads;
 
+    // Each enclave has at most one switchless manager. Publish it before
+    // starting the workers, which look up the ocall queue through it, and
+    // so that oe_stop_switchless_manager() stops them if starting fails.
+    enclave->switchless_manager = manager;
+
+    if (num_host_workers > 0)
+        OE_CHECK(_init_ocall_promotion(enclave, manager, setting));
+
+    // The workers look up their CPUs when they start.
+    OE_CHECK(_init_worker_affinity(manager, setting));
+
+    // An elastic pool starts with its minimum number of workers.
+    manager->min_host_workers = num_host_workers;
+    if (setting->min_host_workers &&
+        setting->min_host_workers < num_host_workers)
+        manager->min_host_workers = setting->min_host_workers;
+
     // Start the host worker threads, and assign each one a private context.
+    // Close the slots of the workers that do not run yet.
     for (size_t i = 0; i < num_host_workers; i++)
     {
-        OE_TRACE_INFO("Creating switchless host worker thread %d\n", (int)i);
         manager->host_worker_contexts[i].enc = enclave;
-        if (oe_thread_create(
-                &manager->host_worker_threads[i],
-                _switchless_ocall_worker,
-                &manager->host_worker_contexts[i]) != 0)
-        {
-            OE_RAISE(OE_THREAD_CREATE_ERROR);
-        }
+        manager->host_worker_contexts[i].call_arg =
+            OE_SWITCHLESS_WORKER_RETIRED;
+    }
+
+    for (size_t i = 0; i < manager->min_host_workers; i++)
+    {
+        OE_CHECK(_start_host_worker(manager, i));
+        manager->num_running_host_workers++;
     }
 
     // Inform the enclave about the switchless manager through an ECALL
@@ -266,8 +1589,21 @@ oe_result_t oe_start_switchless_manager(
             enclave,
             &result_out,
             manager->host_worker_contexts,
-            manager->num_host_workers));
+            manager->num_host_workers,
+            manager->ocall_queue,
+            setting->ocall_wait_spin_count
+                ? setting->ocall_wait_spin_count
+                : OE_SWITCHLESS_DEFAULT_OCALL_WAIT_SPIN_COUNT,
+            (void*)manager->promoted_ocalls,
+            manager->num_ocall_profiles));
         OE_CHECK(result_out);
+
+        if (manager->min_host_workers < num_host_workers &&
+            oe_thread_create(
+                &manager->pool_thread, _switchless_pool_thread, manager) != 0)
+        {
+            OE_RAISE(OE_THREAD_CREATE_ERROR);
+        }
     }
 
     // Start the enclave worker threads, and assign each one a private context.
@@ -278,7 +1614,7 @@ oe_result_t oe_start_switchless_manager(
         OE_TRACE_INFO("Creating switchless enclave worker thread %d\n", (int)i);
         manager->enclave_worker_contexts[i].enc = enclave;
         manager->enclave_worker_contexts[i].spin_count_threshold =
-            OE_ENCLAVE_WORKER_SPIN_COUNT_THRESHOLD;
+            manager->enclave_worker_policies[i].spin_count_threshold;
         if (oe_thread_create(
                 &manager->enclave_worker_threads[i],
                 _switchless_ecall_worker,
@@ -298,9 +1634,6 @@ oe_result_t oe_start_switchless_manager(
         }
     }
 
-    // Each enclave has at most one switchless manager.
-    enclave->switchless_manager = manager;
-
     result = OE_OK;
 
 done:
@@ -331,13 +1664,33 @@ oe_result_t oe_stop_switchless_manager(oe_enclave_t* enclave)
 
         // Free all allocated buffers.
         if (manager->host_worker_contexts != NULL)
-            free(manager->host_worker_contexts);
+            oe_memalign_free(manager->host_worker_contexts);
         if (manager->host_worker_threads != NULL)
             free(manager->host_worker_threads);
         if (manager->enclave_worker_contexts != NULL)
-            free(manager->enclave_worker_contexts);
+            oe_memalign_free(manager->enclave_worker_contexts);
         if (manager->enclave_worker_threads != NULL)
             free(manager->enclave_worker_threads);
+        if (manager->ocall_queue != NULL)
+            oe_memalign_free(manager->ocall_queue);
+        if (manager->ecall_queue != NULL)
+            oe_memalign_free(manager->ecall_queue);
+        if (manager->promoted_ocalls != NULL)
+            oe_memalign_free((void*)manager->promoted_ocalls);
+        if (manager->host_worker_statistics != NULL)
+        {
+            for (size_t i = 0; i < manager->num_host_workers; i++)
+                oe_free_call_statistics_table(
+                    manager->host_worker_statistics[i]);
+            free(manager->host_worker_statistics);
+        }
+        if (manager->host_worker_policies != NULL)
+            oe_memalign_free(manager->host_worker_policies);
+        if (manager->enclave_worker_policies != NULL)
+            oe_memalign_free(manager->enclave_worker_policies);
+        free(manager->ocall_profiles);
+        free(manager->host_worker_cpus);
+        free(manager->enclave_worker_cpus);
         free(manager);
     }
     result = OE_OK;
@@ -347,7 +1700,100 @@ done:
 
 void oe_sgx_wake_switchless_worker_ocall(oe_host_worker_context_t* context)
 {
+    oe_switchless_call_manager_t* manager = context->enc->switchless_manager;
+
+    _mark_internal_ocall();
     oe_host_worker_wake(context);
+
+    if (manager)
+    {
+        size_t index = (size_t)(context - manager->host_worker_contexts);
+
+        if (index < manager->num_host_workers)
+            oe_atomic_increment(
+                &manager->host_worker_policies[index].num_wakes);
+    }
+}
+
+/*
+** Append a switchless ecall to the ecall queue and wake up a sleeping enclave
+** worker, if any. Returns false if the queue is full. An enclave worker sets
+** its sleeping flag and increments num_sleeping before it checks the queue a
+** last time, so publishing the call before looking at num_sleeping ensures
+** that a worker that is going to sleep either sees the call or is woken.
+**
+*/
+static bool _enqueue_switchless_ecall(
+    oe_switchless_call_manager_t* manager,
+    oe_call_enclave_function_args_t* args)
+{
+    oe_switchless_queue_t* queue = manager->ecall_queue;
+    oe_switchless_queue_cell_t* cells = oe_switchless_queue_cells(queue);
+    const uint64_t mask = queue->capacity - 1;
+    volatile uint64_t* sleeping =
+        oe_switchless_queue_sleeping(queue, queue->capacity);
+    uint64_t pos = oe_atomic_load(&queue->tail);
+    oe_switchless_queue_cell_t* cell;
+    uint64_t start;
+
+    for (;;)
+    {
+        cell = &cells[pos & mask];
+        int64_t diff = (int64_t)(oe_atomic_load(&cell->sequence) - pos);
+
+        if (diff == 0)
+        {
+            // The cell is free. Claim it by advancing the tail.
+            if (oe_atomic_compare_and_swap(
+                    (int64_t volatile*)&queue->tail,
+                    (int64_t)pos,
+                    (int64_t)(pos + 1)))
+                break;
+        }
+        else if (diff < 0)
+        {
+            // The cell still holds a call from the previous lap: full.
+            return false;
+        }
+
+        pos = oe_atomic_load(&queue->tail);
+    }
+
+    // Publish the call. The locked compare-and-swap also orders the
+    // publication before the load of num_sleeping below.
+    cell->call_arg = (uint64_t)args;
+    while (!oe_atomic_compare_and_swap(
+        (int64_t volatile*)&cell->sequence, (int64_t)pos, (int64_t)(pos + 1)))
+        ;
+
+    if (oe_atomic_load(&queue->num_sleeping) == 0)
+        return true;
+
+    // Wake up one sleeping worker, starting after the one woken up last.
+    start = oe_atomic_increment(&manager->next_enclave_worker_to_wake);
+    for (size_t i = 0; i < manager->num_enclave_workers; i++)
+    {
+        size_t index = (size_t)((start + i) % manager->num_enclave_workers);
+        oe_enclave_worker_context_t* context =
+            &manager->enclave_worker_contexts[index];
+
+        if (!sleeping[index])
+            continue;
+
+        // If the event was 0, the worker is sleeping or about to: wake it.
+        // If it was 1, the worker has a pending wake notification and
+        // checks the queue before it goes to sleep.
+        if (oe_atomic_compare_and_swap(&context->event, 0, 1))
+        {
+            oe_enclave_worker_wake(context);
+            oe_atomic_increment(
+                &manager->enclave_worker_policies[index].num_wakes);
+        }
+
+        break;
+    }
+
+    return true;
 }
 
 /*
@@ -356,6 +1802,9 @@ void oe_sgx_wake_switchless_worker_ocall(oe_host_worker_context_t* context)
 ** _switchless_call_enclave_function_impl()
 **
 ** Switchlessly call the enclave function specified by the given function-id.
+** The call is posted to the ecall queue, which the enclave workers take calls
+** from without leaving the enclave. The call falls back to a regular ECALL if
+** there are no enclave workers or the queue is full.
 **
 **==============================================================================
 */
@@ -371,14 +1820,14 @@ static oe_result_t _switchless_call_enclave_function_impl(
     oe_result_t result = OE_UNEXPECTED;
     bool switchless_call_posted = false;
     oe_call_enclave_function_args_t args;
-    oe_switchless_call_manager_t* manager = enclave->switchless_manager;
-    oe_enclave_worker_context_t* contexts = NULL;
-    size_t tries = 0;
+    oe_switchless_call_manager_t* manager = NULL;
 
     /* Reject invalid parameters */
     if (!enclave)
         OE_RAISE(OE_INVALID_PARAMETER);
 
+    manager = enclave->switchless_manager;
+
     /* Initialize the call_enclave_args structure */
     {
         args.function_id = function_id;
@@ -390,82 +1839,40 @@ static oe_result_t _switchless_call_enclave_function_impl(
         args.result = OE_UNEXPECTED;
     }
 
-    /* Do the switchless ECALL only if the manager is initialized. */
-    if (manager)
+    /* Do the switchless ECALL only if there are enclave workers. */
+    if (manager && manager->ecall_queue)
     {
-        contexts = manager->enclave_worker_contexts;
-        // Schedule the switchless call.
+        uint64_t start = oe_call_statistics_now();
+
+        // The enclave worker sets the result once it is done with args.
+        args.result = __OE_RESULT_MAX;
         OE_ATOMIC_MEMORY_BARRIER_RELEASE();
-        args.result = __OE_RESULT_MAX; // Means the call hasn't been processed.
 
-        // Cycle through the worker contexts until we find a free worker.
-        tries = manager->num_enclave_workers;
-        while (tries--)
+        if (_enqueue_switchless_ecall(manager, &args))
         {
-            // Check if the worker's slot is free.
-            if (contexts[tries].call_arg == NULL)
+            switchless_call_posted = true;
+
+            // Wait for the call to complete.
+            while (*(volatile oe_result_t*)&args.result == __OE_RESULT_MAX)
             {
-                // Try to atomically grab the slot by placing args in the slot.
-                // If the atomic operation was successful, then the worker
-                // thread will execute this switchless ecall. If the atomic
-                // operation failed, this means that the slot was grabbed by
-                // another switchless ocall and therefore, we must scan for
-                // another worker thread with a free slot.
-                if (oe_atomic_compare_and_swap_ptr(
-                        (void* volatile*)&contexts[tries].call_arg,
-                        NULL,
-                        &args))
-                {
-                    // The worker thread has been marked to execute this
-                    // switchless call. Determine if it needs to be woken up or
-                    // not.
-                    //
-                    // If event is 0, it means that it has gone to sleep. Wake
-                    // it by making an ocall
-                    // (oe_sgx_wake_switchless_worker_ocall). Note: it is
-                    // important to use an atomic cas operation to set the value
-                    // to 1 before making the ocall. Setting the value to 1
-                    // prevents the host worker from simulataneously going to
-                    // sleep. If instead, just a compare operation is used to
-                    // determine if the host thread is sleeping or not, the host
-                    // thread could go to sleep after the enclave has determined
-                    // that the host is not sleeping, causing a deadlock.
-                    //
-                    // If event is 1, that indicates a pending wake
-                    // notification.
-                    int64_t oldval = 0;
-                    int64_t newval = 1;
-                    // Weak operation could sporadically fail.
-                    // We need a strong operation.
-                    if (oe_atomic_compare_and_swap(
-                            &contexts[tries].event, oldval, newval))
-                    {
-                        // The previous value of the event was 0 which means
-                        // that the worker was previously sleeping. Wake it.
-                        oe_enclave_worker_wake(&contexts[tries]);
-                    }
-
-                    switchless_call_posted = true;
-                    // Wait for the  call to complete.
-                    while (true)
-                    {
-                        if (oe_atomic_load(
-                                (uint64_t*)&contexts[tries].call_arg) !=
-                            (uint64_t)&args)
-                            break;
-
-                        /* Yield CPU */
-                        oe_yield_cpu();
-                    }
-                    break;
-                }
+                /* Yield CPU */
+                oe_yield_cpu();
             }
+
+            // Concurrent updates may be lost now and then. That is good
+            // enough for the time split of the workers.
+            manager->ecall_nsec += oe_call_statistics_now() - start;
         }
     }
 
     if (!switchless_call_posted)
     {
-        // Dispatch as normal ecall.
+        // Dispatch as normal ecall. If the call missed, its result is still
+        // __OE_RESULT_MAX, so that oe_ecall() counts the miss on the binding
+        // and resets the result (see oe_count_switchless_ecall_fallback()).
+        if (!manager || !manager->ecall_queue)
+            args.result = OE_UNEXPECTED;
+
         OE_CHECK(oe_ecall(
             enclave, OE_ECALL_CALL_ENCLAVE_FUNCTION, (uint64_t)&args, NULL));
     }
@@ -47,3 +47,34 @@ void oe_enclave_worker_wake(oe_enclave_worker_context_t* context)
 {
     _worker_wake(&context->event);
 }
+
+bool oe_switchless_event_wait(volatile int64_t* event, uint32_t timeout_msec)
+{
+    uint64_t zero = 0;
+
+    // Wait once. Spurious wakes and timeouts alike return false unless the
+    // event has been set in the meantime.
+    if (*event == 0)
+        WaitOnAddress(event, &zero, sizeof(*event), timeout_msec);
+
+    return _InterlockedCompareExchange64(event, 0, 1) == 1;
+}
+
+void oe_switchless_event_wake(volatile int64_t* event)
+{
+    _worker_wake(event);
+}
+
+void oe_switchless_address_wait(
+    volatile int64_t* address,
+    int64_t value,
+    uint32_t timeout_msec)
+{
+    if (*address == value)
+        WaitOnAddress(address, &value, sizeof(*address), timeout_msec);
+}
+
+void oe_switchless_address_wake_all(volatile int64_t* address)
+{
+    WakeByAddressAll((void*)address);
+}
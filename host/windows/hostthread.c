@@ -44,6 +44,76 @@ int oe_thread_equal(oe_thread_t thread1, oe_thread_t thread2)
     return thread1 == thread2;
 }
 
+/*
+**==============================================================================
+**
+** CPU affinity and NUMA nodes
+**
+**     Only the 64 processors of the first processor group are supported.
+**
+**==============================================================================
+*/
+
+int oe_thread_set_affinity(const uint32_t* cpus, size_t num_cpus)
+{
+    DWORD_PTR mask = 0;
+
+    if (!cpus || num_cpus == 0)
+        return OE_EINVAL;
+
+    for (size_t i = 0; i < num_cpus; i++)
+    {
+        if (cpus[i] >= sizeof(mask) * 8)
+            return OE_EINVAL;
+
+        mask |= (DWORD_PTR)1 << cpus[i];
+    }
+
+    return SetThreadAffinityMask(GetCurrentThread(), mask) ? 0 : OE_EINVAL;
+}
+
+int oe_thread_get_numa_node(void)
+{
+    UCHAR node;
+
+    if (!GetNumaProcessorNode((UCHAR)GetCurrentProcessorNumber(), &node) ||
+        node == 0xFF)
+        return -1;
+
+    return (int)node;
+}
+
+int oe_get_numa_node_cpus(int node, uint32_t* cpus, size_t* num_cpus)
+{
+    ULONGLONG mask;
+    size_t count = 0;
+
+    if (node < 0 || node > 0xFF || !num_cpus || (*num_cpus && !cpus))
+        return OE_EINVAL;
+
+    if (!GetNumaNodeProcessorMask((UCHAR)node, &mask))
+        return OE_ENOENT;
+
+    for (uint32_t cpu = 0; cpu < sizeof(mask) * 8; cpu++)
+    {
+        if (!(mask & (1ULL << cpu)))
+            continue;
+
+        if (count < *num_cpus)
+            cpus[count] = cpu;
+        count++;
+    }
+
+    if (count > *num_cpus)
+    {
+        *num_cpus = count;
+        return OE_ERANGE;
+    }
+
+    *num_cpus = count;
+    return 0;
+}
+
 /*
 **==============================================================================
 **
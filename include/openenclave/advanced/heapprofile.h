@@ -0,0 +1,96 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+/**
+ * @file heapprofile.h
+ *
+ * This file defines the programming interface of the sampling heap profiler.
+ *
+ * The profiler records the call stack of about one allocation per sampling
+ * interval of bytes allocated with malloc() and friends, and tracks which of
+ * the sampled allocations are still live. Unsampled allocations only cost a
+ * per-thread counter update, so the profiler can run in release enclaves.
+ * Profiles are written in the legacy text format of pprof (heap_v2).
+ *
+ * Only the enclave can start the profiler. Once it has, the host can read
+ * the profile with oe_get_heap_profile().
+ *
+ */
+
+#ifndef OE_ADVANCED_HEAPPROFILE_H
+#define OE_ADVANCED_HEAPPROFILE_H
+
+#include <openenclave/bits/result.h>
+#include <openenclave/bits/types.h>
+
+/**
+ * @cond IGNORE
+ */
+OE_EXTERNC_BEGIN
+
+/**
+ * @endcond
+ */
+
+/**
+ * The default mean number of bytes allocated between two samples.
+ */
+#define OE_HEAP_PROFILE_DEFAULT_SAMPLING_INTERVAL (512 * 1024)
+
+/**
+ * Start sampling heap allocations.
+ *
+ * May be called again to change the sampling interval. The samples recorded
+ * so far are kept.
+ *
+ * Call stacks are obtained by walking frame pointers, so code compiled
+ * without frame pointers shows up as truncated stacks. Allocations made
+ * with the debug allocator (oedebugmalloc) are not sampled.
+ *
+ * @param[in] sampling_interval The mean number of bytes allocated between
+ * two samples, or zero for OE_HEAP_PROFILE_DEFAULT_SAMPLING_INTERVAL.
+ *
+ * @retval OE_OK The profiler was started.
+ * @retval OE_INVALID_PARAMETER The sampling interval exceeds OE_UINT32_MAX.
+ * @retval OE_OUT_OF_MEMORY There is no memory for the profile.
+ */
+oe_result_t oe_heap_profile_start(size_t sampling_interval);
+
+/**
+ * Stop sampling heap allocations.
+ *
+ * The samples recorded so far are kept and frees of their allocations are
+ * still tracked, so the profile can be written afterwards.
+ *
+ * @retval OE_OK The profiler was stopped.
+ * @retval OE_NOT_FOUND The profiler was never started.
+ */
+oe_result_t oe_heap_profile_stop(void);
+
+/**
+ * Write the heap profile as a null-terminated string in the legacy text
+ * format of pprof.
+ *
+ * The profile lists the sampled allocations that are live and all sampled
+ * allocations by call stack. The addresses are virtual addresses of the
+ * enclave; oe_get_heap_profile() on the host adds the memory map that pprof
+ * needs to symbolize them with the enclave image.
+ *
+ * @param[out] buffer The buffer to write the profile to. May be NULL if
+ * buffer_size is zero.
+ * @param[in] buffer_size The size of buffer.
+ * @param[out] profile_size The size of the profile, including the
+ * terminating null character.
+ *
+ * @retval OE_OK The profile was written.
+ * @retval OE_BUFFER_TOO_SMALL The buffer is too small for the profile.
+ * @retval OE_INVALID_PARAMETER At least one parameter is invalid.
+ * @retval OE_NOT_FOUND The profiler was never started.
+ */
+oe_result_t oe_heap_profile_write(
+    char* buffer,
+    size_t buffer_size,
+    size_t* profile_size);
+
+OE_EXTERNC_END
+
+#endif /* OE_ADVANCED_HEAPPROFILE_H */
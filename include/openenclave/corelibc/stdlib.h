@@ -36,6 +36,14 @@ extern bool oe_use_debug_malloc;
 /* Turn memset of allocated memory on/off. Default = true. */
 extern bool oe_use_debug_malloc_memset;
 
+/* Bitmask of the size classes whose blocks record the backtrace of their
+ * allocation. Bit n covers blocks of more than 2^(n-1) and at most 2^n
+ * bytes (bit 0 covers blocks of zero or one byte, and bit 63 covers all
+ * larger blocks). Leaks of blocks without a backtrace are still reported.
+ * For example, ~0x1fffull only records the backtraces of blocks larger
+ * than 4096 bytes. Default = all bits set. */
+extern uint64_t oe_debug_malloc_backtrace_size_classes;
+
 #endif
 
 void* oe_malloc(size_t size);
@@ -117,6 +117,83 @@ oe_result_t oe_switchless_call_host_function(
     size_t output_buffer_size,
     size_t* output_bytes_written);
 
+/**
+ * Handle of an asynchronous switchless host function call.
+ */
+typedef struct _oe_switchless_call oe_switchless_call_t;
+
+/**
+ * Start a high-level host function call (OCALL) switchlessly without waiting
+ * for it to complete.
+ *
+ * Post the call to a host worker thread and return a handle to it, so that
+ * the calling thread can keep several host function calls in flight. The
+ * handle must be released with oe_switchless_call_wait() by the same thread.
+ * Until then, the input and output buffers must not be freed or modified.
+ * Buffers allocated with oe_allocate_switchless_ocall_buffer() can be
+ * outstanding for several calls at the same time. Calls that are still
+ * outstanding when the top-level ECALL of the thread returns are waited for
+ * and their handles are released, so they must not be used afterwards.
+ *
+ * If no host worker thread is available, the function is called
+ * synchronously and the returned handle is already completed.
+ *
+ * @param function_id The id of the host function that will be called.
+ * @param input_buffer Buffer containing inputs data.
+ * @param input_buffer_size Size of the input data buffer.
+ * @param output_buffer Buffer where the outputs of the host function are
+ * written to.
+ * @param output_buffer_size Size of the output buffer.
+ * @param call The handle of the call.
+ *
+ * @return OE_OK the call was started.
+ * @return OE_INVALID_PARAMETER a parameter is invalid.
+ * @return OE_OUT_OF_MEMORY the arguments of the call could not be allocated.
+ * @return OE_FAILURE the call failed.
+ */
+oe_result_t oe_switchless_call_host_function_async(
+    size_t function_id,
+    const void* input_buffer,
+    size_t input_buffer_size,
+    void* output_buffer,
+    size_t output_buffer_size,
+    oe_switchless_call_t** call);
+
+/**
+ * Check whether an asynchronous switchless host function call has completed.
+ *
+ * @param call The handle returned by oe_switchless_call_host_function_async().
+ * @param completed Set to true if the call has completed.
+ *
+ * @return OE_OK the state of the call was retrieved.
+ * @return OE_INVALID_PARAMETER a parameter is invalid or the call was started
+ * by another thread.
+ */
+oe_result_t oe_switchless_call_test(
+    oe_switchless_call_t* call,
+    bool* completed);
+
+/**
+ * Wait for an asynchronous switchless host function call to complete and
+ * release its handle.
+ *
+ * Note that the return value of this function only indicates the success of
+ * the call and not of the underlying function, as with
+ * oe_switchless_call_host_function().
+ *
+ * @param call The handle returned by oe_switchless_call_host_function_async().
+ * @param output_bytes_written Number of bytes written in the output buffer.
+ *
+ * @return OE_OK the call was successful.
+ * @return OE_NOT_FOUND if the function_id does not correspond to a function.
+ * @return OE_INVALID_PARAMETER a parameter is invalid or the call was started
+ * by another thread, in which case the handle is not released.
+ * @return OE_FAILURE the call failed.
+ */
+oe_result_t oe_switchless_call_wait(
+    oe_switchless_call_t* call,
+    size_t* output_bytes_written);
+
 /**
  * Allocate a buffer of given size for doing an ocall.
  *
@@ -155,6 +232,38 @@ void* oe_allocate_switchless_ocall_buffer(size_t size);
  */
 void oe_free_switchless_ocall_buffer(void* buffer);
 
+/**
+ * Statistics of the arenas that the enclave threads allocate switchless ocall
+ * buffers from.
+ */
+typedef struct _oe_switchless_arena_statistics
+{
+    /** The most bytes that the arena of a thread held at once */
+    uint64_t max_used;
+
+    /** The most buffers that the arena of a thread held at once */
+    uint64_t max_num_objects;
+
+    /** How many times a segment was added to an arena that held buffers */
+    uint64_t num_grows;
+} oe_switchless_arena_statistics_t;
+
+/**
+ * Get the statistics of the switchless ocall buffer arenas of the enclave.
+ *
+ * The arena of a thread is freed when its top-level ECALL returns. The
+ * statistics cover the lifetime of the enclave: the arenas of all threads
+ * that have been freed, and the arena of the calling thread. They can be
+ * used to choose the capacity of the arenas.
+ *
+ * @param statistics The statistics.
+ *
+ * @return OE_OK the statistics were retrieved.
+ * @return OE_INVALID_PARAMETER statistics is NULL.
+ */
+oe_result_t oe_get_switchless_arena_statistics(
+    oe_switchless_arena_statistics_t* statistics);
+
 /**
  * Forward declarations of malloc and free for deep-copy out parameter support.
  */
@@ -76,6 +76,61 @@ oe_result_t oe_call_enclave_function(
     size_t output_buffer_size,
     size_t* output_bytes_written);
 
+/**
+ * Describes one of the calls made by oe_call_enclave_function_batch().
+ */
+typedef struct _oe_enclave_function_call
+{
+    /** The global id of the enclave function that will be called. */
+    uint64_t* global_id;
+
+    /** The name of the function that will be called. */
+    const char* name;
+
+    /** Buffer containing inputs data. */
+    const void* input_buffer;
+
+    /** Size of the input data buffer. */
+    size_t input_buffer_size;
+
+    /** Buffer where the outputs of the function are written to. */
+    void* output_buffer;
+
+    /** Size of the output buffer. */
+    size_t output_buffer_size;
+
+    /** Set to the number of bytes written in the output buffer. */
+    size_t output_bytes_written;
+
+    /** Set to the result of this call (see oe_call_enclave_function()). */
+    oe_result_t result;
+} oe_enclave_function_call_t;
+
+/**
+ * Perform several high-level enclave function calls in a single transition.
+ *
+ * Each element of **calls** is handled as if it was passed to
+ * oe_call_enclave_function(), in order. The calls are independent: a failed
+ * call does not prevent the subsequent ones from being made. The outcome of
+ * each call is stored in its **result** and **output_bytes_written** fields.
+ *
+ * Batching is meant for many small ECALLs, whose cost is dominated by
+ * entering and leaving the enclave.
+ *
+ * @param enclave The instance of the enclave that will be called.
+ * @param calls The array of calls to make.
+ * @param num_calls The number of elements in **calls**.
+ *
+ * @return OE_OK the calls were made. Check the **result** field of each call.
+ * @return OE_INVALID_PARAMETER a parameter is invalid.
+ * @return OE_OUT_OF_MEMORY failed to allocate memory.
+ * @return OE_FAILURE the calls could not be made.
+ */
+oe_result_t oe_call_enclave_function_batch(
+    oe_enclave_t* enclave,
+    oe_enclave_function_call_t* calls,
+    size_t num_calls);
+
 /**
  * Placeholder.
  */
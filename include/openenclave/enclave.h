@@ -128,8 +128,10 @@ bool oe_is_outside_enclave(const void* ptr, size_t size);
  *
  * This function allocates **size** bytes from the host's heap and returns the
  * address of the allocated memory. The implementation performs an OCALL to
- * the host, which calls malloc(). To free the memory, it must be passed to
- * oe_host_free().
+ * the host, which calls malloc(). On SGX, if the host allows it (see
+ * oe_enclave_setting_host_memory_pool_t), the memory is allocated from a pool
+ * of host memory without an OCALL instead. To free the memory, it must be
+ * passed to oe_host_free().
  *
  * @param[in] size The number of bytes to be allocated.
  *
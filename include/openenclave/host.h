@@ -113,12 +113,118 @@ typedef void (*oe_ocall_func_t)(
 typedef enum _oe_enclave_setting_type
 {
     OE_ENCLAVE_SETTING_CONTEXT_SWITCHLESS = 0xdc73a628,
+    OE_ENCLAVE_SETTING_OCALL_BUFFER = 0x3e0a5b1c,
+    OE_ENCLAVE_SETTING_HOST_MEMORY_POOL = 0x7a41c6e3,
 #ifdef OE_WITH_EXPERIMENTAL_EEID
     OE_EXTENDED_ENCLAVE_INITIALIZATION_DATA = 0x976a8f66,
 #endif
     OE_SGX_ENCLAVE_CONFIG_DATA = 0x78b5b41d
 } oe_enclave_setting_type_t;
 
+/**
+ * How enclave threads hand context-switchless ocalls to the host workers.
+ */
+typedef enum _oe_switchless_ocall_transport
+{
+    /**
+     * Enclave threads append their ocalls to a queue in host memory that all
+     * host workers take ocalls from. An ocall only falls back to a regular
+     * ocall when the queue is full. This is the default.
+     */
+    OE_SWITCHLESS_OCALL_TRANSPORT_QUEUE = 0,
+
+    /**
+     * Each host worker has a single slot for an ocall. An ocall falls back
+     * to a regular ocall when the slots of all host workers are taken.
+     */
+    OE_SWITCHLESS_OCALL_TRANSPORT_SLOTS = 1,
+
+    __OE_SWITCHLESS_OCALL_TRANSPORT_MAX = OE_ENUM_MAX,
+} oe_switchless_ocall_transport_t;
+
+/**
+ * Default bounds of the adaptive spin count of switchless workers (see
+ * oe_enclave_setting_context_switchless_t).
+ */
+#define OE_SWITCHLESS_DEFAULT_MIN_SPIN_COUNT 4096
+#define OE_SWITCHLESS_DEFAULT_MAX_SPIN_COUNT (256 * 1024)
+
+/**
+ * Default number of times an enclave thread checks whether its switchless
+ * ocall has completed before it sleeps (see
+ * oe_enclave_setting_context_switchless_t).
+ */
+#define OE_SWITCHLESS_DEFAULT_OCALL_WAIT_SPIN_COUNT (16 * 1024)
+
+/**
+ * Whether regular ocalls of a host function are made as switchless ocalls
+ * (see oe_enclave_setting_context_switchless_t).
+ */
+typedef enum _oe_switchless_promotion
+{
+    /**
+     * Calls are made switchless while the host function is short and called
+     * often. This is the default.
+     */
+    OE_SWITCHLESS_PROMOTION_AUTO = 0,
+
+    /**
+     * Calls are always made switchless. Only valid for host functions of the
+     * enclave's own EDL, not for system OCALLs.
+     */
+    OE_SWITCHLESS_PROMOTION_ALWAYS = 1,
+
+    /**
+     * Calls are only made switchless if the EDL marks the host function
+     * transition_using_threads.
+     */
+    OE_SWITCHLESS_PROMOTION_NEVER = 2,
+
+    __OE_SWITCHLESS_PROMOTION_MAX = OE_ENUM_MAX,
+} oe_switchless_promotion_t;
+
+/**
+ * The promotion of the regular ocalls of one host function.
+ */
+typedef struct _oe_switchless_ocall_promotion
+{
+    /**
+     * The id of the host function, i.e., its index in the ocall table of the
+     * enclave (see <edl>_fcn_id_<function> in the generated <edl>_u.c).
+     */
+    uint32_t function_id;
+
+    /** The promotion of the host function */
+    oe_switchless_promotion_t promotion;
+} oe_switchless_ocall_promotion_t;
+
+/**
+ * Where the switchless worker threads of an enclave run (see
+ * oe_enclave_setting_context_switchless_t). Keeping the workers on the NUMA
+ * node of the threads that post calls to them avoids cross-node cache
+ * traffic on every call.
+ */
+typedef enum _oe_switchless_affinity
+{
+    /** The workers run wherever the OS schedules them. This is the default. */
+    OE_SWITCHLESS_AFFINITY_NONE = 0,
+
+    /**
+     * Each worker runs on one CPU of its list: host worker i on
+     * host_worker_cpus[i % num_host_worker_cpus], and likewise for enclave
+     * workers.
+     */
+    OE_SWITCHLESS_AFFINITY_CPUS = 1,
+
+    /**
+     * The workers run on the CPUs of the NUMA node that the thread that
+     * creates the enclave runs on.
+     */
+    OE_SWITCHLESS_AFFINITY_CREATOR_NODE = 2,
+
+    __OE_SWITCHLESS_AFFINITY_MAX = OE_ENUM_MAX,
+} oe_switchless_affinity_t;
+
 /**
  * The setting for context-switchless calls.
  */
@@ -131,12 +237,117 @@ typedef struct _oe_enclave_setting_context_switchless
      */
     size_t max_host_workers;
     /**
-     * Context-switchless ecalls are not enabled yet. The max number of enclave
-     * workers should be 0.
+     * The max number of worker threads for context-switchless ecalls. The
+     * workers run inside the enclave, each on a TCS of its own, and take the
+     * ecalls marked transition_using_threads from a queue in host memory.
+     * Ecalls fall back to regular ecalls when the queue is full or there are
+     * no enclave workers.
      */
     size_t max_enclave_workers;
+    /**
+     * How enclave threads hand context-switchless ocalls to the host
+     * workers. Defaults to OE_SWITCHLESS_OCALL_TRANSPORT_QUEUE.
+     */
+    oe_switchless_ocall_transport_t ocall_transport;
+    /**
+     * The bounds of the number of iterations that a worker spins waiting for
+     * a call before it sleeps. Each worker adapts its spin count within these
+     * bounds to the gaps between the calls it observes. 0 selects
+     * OE_SWITCHLESS_DEFAULT_MIN_SPIN_COUNT and
+     * OE_SWITCHLESS_DEFAULT_MAX_SPIN_COUNT respectively. Setting both to the
+     * same value gives a fixed spin count.
+     */
+    uint64_t min_spin_count;
+    uint64_t max_spin_count;
+    /**
+     * If non-zero and smaller than max_host_workers, the pool of host workers
+     * is elastic: the host starts min_host_workers workers, adds workers up
+     * to max_host_workers while switchless ocalls miss or have to wait for a
+     * worker, and removes them again after idle periods. 0 starts all
+     * max_host_workers workers for the lifetime of the enclave.
+     */
+    size_t min_host_workers;
+    /**
+     * The number of times an enclave thread checks whether its switchless
+     * ocall has completed before it sleeps in the host until the host worker
+     * completes the call, so that long-running host functions do not keep
+     * the enclave thread spinning. 0 selects
+     * OE_SWITCHLESS_DEFAULT_OCALL_WAIT_SPIN_COUNT, and OE_UINT64_MAX spins
+     * until the call completes.
+     */
+    uint64_t ocall_wait_spin_count;
+    /**
+     * While there are host workers, regular ocalls of host functions that
+     * are short and called often are made as switchless ocalls. The host
+     * measures how often and how long each host function is called and
+     * promotes or demotes it accordingly. ocall_promotion is either
+     * OE_SWITCHLESS_PROMOTION_AUTO (the default) or
+     * OE_SWITCHLESS_PROMOTION_NEVER, which turns the policy off.
+     * ocall_promotion_overrides lists the host functions whose promotion
+     * differs from ocall_promotion, and num_ocall_promotion_overrides is
+     * its number of entries.
+     */
+    oe_switchless_promotion_t ocall_promotion;
+    const oe_switchless_ocall_promotion_t* ocall_promotion_overrides;
+    size_t num_ocall_promotion_overrides;
+    /**
+     * The CPUs that the switchless workers run on (see
+     * oe_switchless_affinity_t). host_worker_cpus and enclave_worker_cpus
+     * list CPU numbers for OE_SWITCHLESS_AFFINITY_CPUS, and
+     * num_host_worker_cpus and num_enclave_worker_cpus are their numbers of
+     * entries. An empty list leaves the affinity of those workers alone.
+     */
+    oe_switchless_affinity_t worker_affinity;
+    const uint32_t* host_worker_cpus;
+    size_t num_host_worker_cpus;
+    const uint32_t* enclave_worker_cpus;
+    size_t num_enclave_worker_cpus;
 } oe_enclave_setting_context_switchless_t;
 
+/**
+ * The setting for the per-thread ocall buffers.
+ *
+ * Each enclave thread starts with a small buffer for marshaling ocall
+ * parameters. When an ocall does not fit, the enclave allocates host memory
+ * for it instead, which costs two additional transitions. The host then grows
+ * the thread's ocall buffer so that later ocalls of that size fit.
+ */
+typedef struct _oe_enclave_setting_ocall_buffer
+{
+    /**
+     * The max size in bytes that an ocall buffer may grow to. If this is
+     * not larger than the initial size of the buffers (16KB), the buffers
+     * are never grown. The default is 1MB.
+     */
+    size_t max_size;
+} oe_enclave_setting_ocall_buffer_t;
+
+/**
+ * The setting for the pool of host memory of an SGX enclave.
+ *
+ * The host maps a region of host memory when it creates the enclave, which
+ * the enclave allocates ocall buffers from without making OCALLs when they
+ * do not fit into the ocall buffer of the thread. Allocations larger than
+ * 256KB, and those made while the pool is exhausted, are still made with an
+ * OCALL to the host's heap.
+ */
+typedef struct _oe_enclave_setting_host_memory_pool
+{
+    /**
+     * The size in bytes of the region. 0 disables the pool. The default is
+     * 32MB.
+     */
+    size_t size;
+    /**
+     * Whether oe_host_malloc(), oe_host_calloc() and oe_host_strndup() in the
+     * enclave allocate from the pool as well. Memory of the pool must be
+     * released with oe_host_free() in the enclave, so only set this if the
+     * host never calls free() on memory that the enclave allocated. The
+     * default is false.
+     */
+    bool host_malloc;
+} oe_enclave_setting_host_memory_pool_t;
+
 /**
  * The setting for config_id/config_svn on Ice Lake platform.
  */
@@ -165,6 +376,8 @@ typedef struct _oe_enclave_setting
     {
         const oe_enclave_setting_context_switchless_t*
             context_switchless_setting;
+        const oe_enclave_setting_ocall_buffer_t* ocall_buffer_setting;
+        const oe_enclave_setting_host_memory_pool_t* host_memory_pool_setting;
 #ifdef OE_WITH_EXPERIMENTAL_EEID
         oe_eeid_t* eeid;
 #endif
@@ -440,6 +653,274 @@ void oe_free_key(
     uint8_t* key_info,
     size_t key_info_size);
 
+/**
+ * Number of buckets of the latency histogram of oe_call_statistics_t.
+ */
+#define OE_CALL_STATISTICS_BUCKETS 32
+
+/**
+ * The kinds of calls that oe_get_call_statistics() reports on.
+ */
+typedef enum _oe_call_kind
+{
+    /** An EDL ECALL. The function id is its enclave function id. */
+    OE_CALL_KIND_ECALL,
+    /** An EDL OCALL made with a transition. The function id is its host
+     * function id. */
+    OE_CALL_KIND_OCALL,
+    /** An EDL OCALL performed by a switchless host worker thread. */
+    OE_CALL_KIND_SWITCHLESS_OCALL,
+    /** An ECALL of the SDK. The function id is an internal ECALL number. */
+    OE_CALL_KIND_INTERNAL_ECALL,
+    /** An OCALL of the SDK. The function id is an internal OCALL number. */
+    OE_CALL_KIND_INTERNAL_OCALL,
+    __OE_CALL_KIND_MAX = OE_ENUM_MAX,
+} oe_call_kind_t;
+
+/**
+ * Number of calls and latency distribution of a function of an enclave.
+ */
+typedef struct _oe_call_statistics
+{
+    /** The kind of the calls */
+    oe_call_kind_t kind;
+
+    /** The id of the function (see oe_call_kind_t) */
+    uint64_t function_id;
+
+    /** The number of completed calls */
+    uint64_t count;
+
+    /** The total and the largest latency of the calls in nanoseconds. The
+     * latency of an ECALL includes the OCALLs it makes. */
+    uint64_t total_nsec;
+    uint64_t max_nsec;
+
+    /** histogram[i] is the number of calls whose latency in nanoseconds was
+     * in [2^i, 2^(i+1)). The first and the last bucket also count shorter
+     * and longer calls respectively. */
+    uint64_t histogram[OE_CALL_STATISTICS_BUCKETS];
+} oe_call_statistics_t;
+
+/**
+ * Enable or disable collecting call statistics for an enclave.
+ *
+ * While enabled, each ECALL and OCALL of the enclave is timed and counted
+ * per function. The counters are kept per enclave thread (and per
+ * switchless worker thread), so threads do not contend on them. Collecting
+ * is disabled by default, which costs a single branch per call.
+ *
+ * @param[in] enclave The enclave handle.
+ * @param[in] enable Whether to collect call statistics.
+ *
+ * @retval OE_OK The setting was changed.
+ * @retval OE_INVALID_PARAMETER The enclave handle is invalid.
+ * @retval OE_UNSUPPORTED Call statistics are not supported by the platform.
+ */
+oe_result_t oe_enable_call_statistics(oe_enclave_t* enclave, bool enable);
+
+/**
+ * Get the call statistics collected for an enclave.
+ *
+ * Fills statistics with one entry for each function that has been called
+ * since statistics were enabled or last reset. Calls that are in progress
+ * on other threads may or may not be included.
+ *
+ * @param[in] enclave The enclave handle.
+ * @param[out] statistics The array of entries to fill. May be NULL if count
+ * is zero.
+ * @param[in,out] count On input, the number of entries of statistics. On
+ * output, the number of entries that are available.
+ *
+ * @retval OE_OK The statistics were retrieved.
+ * @retval OE_BUFFER_TOO_SMALL The statistics array is too small. The
+ * required number of entries is returned in count.
+ * @retval OE_INVALID_PARAMETER At least one parameter is invalid.
+ * @retval OE_OUT_OF_MEMORY There is no memory available.
+ * @retval OE_UNSUPPORTED Call statistics are not supported by the platform.
+ */
+oe_result_t oe_get_call_statistics(
+    oe_enclave_t* enclave,
+    oe_call_statistics_t* statistics,
+    size_t* count);
+
+/**
+ * Reset the call statistics collected for an enclave.
+ *
+ * Calls that are in progress on other threads may or may not be counted
+ * after the reset.
+ *
+ * @param[in] enclave The enclave handle.
+ *
+ * @retval OE_OK The statistics were reset.
+ * @retval OE_INVALID_PARAMETER The enclave handle is invalid.
+ * @retval OE_UNSUPPORTED Call statistics are not supported by the platform.
+ */
+oe_result_t oe_reset_call_statistics(oe_enclave_t* enclave);
+
+/**
+ * Statistics of the pool of switchless host workers of an enclave.
+ */
+typedef struct _oe_switchless_pool_statistics
+{
+    /** The bounds of the pool and the number of workers running now */
+    size_t min_host_workers;
+    size_t max_host_workers;
+    size_t num_host_workers;
+
+    /** How many times a worker was added to and removed from the pool */
+    uint64_t num_grows;
+    uint64_t num_shrinks;
+
+    /** Switchless ocalls handled by host workers */
+    uint64_t num_calls;
+
+    /** Switchless ocalls that fell back to regular ocalls because no worker
+     * was available */
+    uint64_t num_fallbacks;
+
+    /** Switchless ocalls that waited in the ocall queue behind other calls */
+    uint64_t num_backlogged;
+
+    /** Switchless ocalls whose enclave thread stopped spinning and slept
+     * until the call completed (see ocall_wait_spin_count of
+     * oe_enclave_setting_context_switchless_t). The other calls completed
+     * while their enclave thread was spinning. */
+    uint64_t num_parked_waits;
+
+    /** The number of host functions whose regular ocalls are currently made
+     * as switchless ocalls (see ocall_promotion of
+     * oe_enclave_setting_context_switchless_t) */
+    size_t num_promoted_ocalls;
+} oe_switchless_pool_statistics_t;
+
+/**
+ * Get the statistics of the pool of switchless host workers of an enclave.
+ *
+ * The counters cover the lifetime of the enclave. Workers that are being
+ * added or removed while the statistics are collected may or may not be
+ * counted.
+ *
+ * @param[in] enclave The enclave handle.
+ * @param[out] statistics The statistics.
+ *
+ * @retval OE_OK The statistics were retrieved.
+ * @retval OE_INVALID_PARAMETER At least one parameter is invalid.
+ * @retval OE_NOT_FOUND The enclave has no switchless host workers.
+ * @retval OE_UNSUPPORTED Switchless calls are not supported by the platform.
+ */
+oe_result_t oe_get_switchless_pool_statistics(
+    oe_enclave_t* enclave,
+    oe_switchless_pool_statistics_t* statistics);
+
+/**
+ * Statistics of one switchless worker thread of an enclave.
+ */
+typedef struct _oe_switchless_worker_statistics
+{
+    /** Switchless calls handled by the worker */
+    uint64_t num_calls;
+
+    /** Iterations that the worker spun while it waited for calls */
+    uint64_t num_spins;
+
+    /** How many times the worker parked (slept) after spinning */
+    uint64_t num_parks;
+
+    /** How many times a thread that posted a call woke up the parked worker.
+     * For host workers, these are the wake ocalls of enclave threads. */
+    uint64_t num_wakes;
+} oe_switchless_worker_statistics_t;
+
+/**
+ * Statistics of the switchless calls of an enclave.
+ */
+typedef struct _oe_switchless_statistics
+{
+    /** The number of host workers and enclave workers */
+    size_t num_host_workers;
+    size_t num_enclave_workers;
+
+    /** Switchless ocalls that enclave threads posted to host workers,
+     * including those that the workers have not handled yet, and those that
+     * missed and fell back to regular ocalls */
+    uint64_t num_ocall_posts;
+    uint64_t num_ocall_misses;
+
+    /** Ocalls that enclave threads made to wake up parked host workers */
+    uint64_t num_wake_ocalls;
+
+    /** Switchless ecalls that host threads posted to enclave workers,
+     * including those that the workers have not handled yet, and those that
+     * missed and fell back to regular ecalls */
+    uint64_t num_ecall_posts;
+    uint64_t num_ecall_misses;
+} oe_switchless_statistics_t;
+
+/**
+ * Get the statistics of the switchless calls of an enclave.
+ *
+ * Fills workers with one entry for each host worker, followed by one entry
+ * for each enclave worker. The counters cover the lifetime of the enclave.
+ * Each worker keeps its own counters, and the misses are counted on the
+ * thread binding of the caller, so collecting them costs the workers and the
+ * callers nothing. Calls that are in progress may or may not be counted.
+ *
+ * @param[in] enclave The enclave handle.
+ * @param[out] statistics The statistics of the enclave as a whole.
+ * @param[out] workers The array of worker entries to fill. May be NULL if
+ * num_workers is zero.
+ * @param[in,out] num_workers On input, the number of entries of workers. On
+ * output, the number of workers of the enclave.
+ *
+ * @retval OE_OK The statistics were retrieved.
+ * @retval OE_BUFFER_TOO_SMALL The workers array is too small. statistics is
+ * filled in and the required number of entries is returned in num_workers.
+ * @retval OE_INVALID_PARAMETER At least one parameter is invalid.
+ * @retval OE_NOT_FOUND The enclave has no switchless workers.
+ * @retval OE_UNSUPPORTED Switchless calls are not supported by the platform.
+ */
+oe_result_t oe_get_switchless_statistics(
+    oe_enclave_t* enclave,
+    oe_switchless_statistics_t* statistics,
+    oe_switchless_worker_statistics_t* workers,
+    size_t* num_workers);
+
+/**
+ * Get the heap profile of an enclave.
+ *
+ * The enclave must have started its sampling heap profiler with
+ * oe_heap_profile_start(). The host cannot start the profiler. The profile
+ * is a null-terminated string in the legacy text format of pprof, followed
+ * by the memory map of the enclave image, so that it can be symbolized with
+ * the enclave binary, e.g.:
+ *
+ *     pprof --text path/to/enclave profile.heap
+ *
+ * @param[in] enclave The enclave handle.
+ * @param[out] profile The profile, to be released with
+ * oe_free_heap_profile().
+ * @param[out] profile_size The length of the profile, excluding the
+ * terminating null character.
+ *
+ * @retval OE_OK The profile was retrieved.
+ * @retval OE_INVALID_PARAMETER At least one parameter is invalid.
+ * @retval OE_NOT_FOUND The enclave has not started the heap profiler.
+ * @retval OE_OUT_OF_MEMORY There is no memory for the profile.
+ * @retval OE_UNSUPPORTED Heap profiles are not supported by the platform.
+ */
+oe_result_t oe_get_heap_profile(
+    oe_enclave_t* enclave,
+    char** profile,
+    size_t* profile_size);
+
+/**
+ * Release a heap profile returned by oe_get_heap_profile().
+ *
+ * @param[in] profile The profile. May be NULL.
+ */
+void oe_free_heap_profile(char* profile);
+
 OE_EXTERNC_END
 
 #endif /* _OE_HOST_H */
@@ -11,13 +11,16 @@ OE_EXTERNC_BEGIN
 
 #if defined(_MSC_VER)
 #pragma intrinsic(_InterlockedOr64)
+#pragma intrinsic(_InterlockedExchange64)
 #pragma intrinsic(_InterlockedIncrement64)
 #pragma intrinsic(_InterlockedDecrement64)
 #pragma intrinsic(_InterlockedCompareExchange)
 #pragma intrinsic(_InterlockedCompareExchange64)
 #pragma intrinsic(_InterlockedCompareExchangePointer)
 #pragma intrinsic(_mm_pause)
+#pragma intrinsic(_mm_mfence)
 __int64 _InterlockedOr64(__int64 volatile* value, __int64 mask);
+__int64 _InterlockedExchange64(__int64 volatile* target, __int64 value);
 __int64 _InterlockedIncrement64(__int64* lpAddend);
 __int64 _InterlockedDecrement64(__int64* lpAddend);
 long _InterlockedCompareExchange(long volatile* a, long b, long c);
@@ -30,6 +33,7 @@ void* _InterlockedCompareExchangePointer(
     void* newptr,
     void* old);
 void _mm_pause(void);
+void _mm_mfence(void);
 #endif
 
 /* Atomically fetch the value of given variable */
@@ -44,6 +48,18 @@ OE_INLINE uint64_t oe_atomic_load(volatile uint64_t* x)
 #endif
 }
 
+/* Atomically set the value of given variable */
+OE_INLINE void oe_atomic_store(volatile uint64_t* x, uint64_t value)
+{
+#if defined(__GNUC__)
+    __atomic_store_n(x, value, __ATOMIC_SEQ_CST);
+#elif defined(_MSC_VER)
+    _InterlockedExchange64((volatile __int64*)x, (__int64)value);
+#else
+#error "unsupported"
+#endif
+}
+
 /* Atomically increment **x** and return its new value */
 OE_INLINE uint64_t oe_atomic_increment(volatile uint64_t* x)
 {
@@ -119,6 +135,20 @@ bool oe_atomic_compare_and_swap_ptr(
 #endif
 }
 
+/* Order all earlier loads and stores before all later ones, including an
+ * earlier store before a later load */
+OE_INLINE
+void oe_atomic_fence(void)
+{
+#if defined(__GNUC__)
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#elif defined(_MSC_VER)
+    _mm_mfence();
+#else
+#error "unsupported"
+#endif
+}
+
 OE_INLINE
 void oe_yield_cpu(void)
 {
@@ -76,6 +76,9 @@ typedef enum _oe_func
     OE_ECALL_CALL_ENCLAVE_FUNCTION,
     OE_ECALL_VIRTUAL_EXCEPTION_HANDLER,
     OE_ECALL_CALL_AT_EXIT_FUNCTIONS,
+    OE_ECALL_CALL_ENCLAVE_FUNCTION_BATCH,
+    OE_ECALL_INIT_HOST_MEMORY_POOL,
+    OE_ECALL_GET_HEAP_PROFILE,
     /* Caution: always add new ECALL function numbers here */
     OE_ECALL_MAX,
 
@@ -193,6 +196,72 @@ typedef struct _oe_call_enclave_function_args
 
 OE_STATIC_ASSERT((sizeof(oe_call_enclave_function_args_t) % 8) == 0);
 
+/*
+**==============================================================================
+**
+** oe_call_enclave_function_batch_args_t
+**
+**     Argument of OE_ECALL_CALL_ENCLAVE_FUNCTION_BATCH. The enclave handles
+**     each element of the calls array like an OE_ECALL_CALL_ENCLAVE_FUNCTION
+**     and stores the outcome in its result field.
+**
+**==============================================================================
+*/
+
+typedef struct _oe_call_enclave_function_batch_args
+{
+    oe_call_enclave_function_args_t* calls;
+    uint64_t num_calls;
+} oe_call_enclave_function_batch_args_t;
+
+OE_STATIC_ASSERT((sizeof(oe_call_enclave_function_batch_args_t) % 8) == 0);
+
+/*
+**==============================================================================
+**
+** oe_init_host_memory_pool_args_t
+**
+**     Argument of OE_ECALL_INIT_HOST_MEMORY_POOL. The host hands the enclave
+**     a region of host memory that ocall buffers (and optionally
+**     oe_host_malloc()) are allocated from without making OCALLs. The region
+**     stays mapped until the enclave is terminated.
+**
+**==============================================================================
+*/
+
+typedef struct _oe_init_host_memory_pool_args
+{
+    void* base;
+    uint64_t size;
+
+    /* Non-zero if oe_host_malloc() may allocate from the pool as well */
+    uint64_t host_malloc;
+} oe_init_host_memory_pool_args_t;
+
+OE_STATIC_ASSERT((sizeof(oe_init_host_memory_pool_args_t) % 8) == 0);
+
+/*
+**==============================================================================
+**
+** oe_get_heap_profile_args_t
+**
+**     Argument of OE_ECALL_GET_HEAP_PROFILE. The enclave writes its heap
+**     profile to the host buffer if it fits and always sets profile_size.
+**
+**==============================================================================
+*/
+
+typedef struct _oe_get_heap_profile_args
+{
+    char* buffer;
+    uint64_t buffer_size;
+
+    /* The size of the profile, including the terminating null character */
+    uint64_t profile_size;
+} oe_get_heap_profile_args_t;
+
+OE_STATIC_ASSERT((sizeof(oe_get_heap_profile_args_t) % 8) == 0);
+
 /*
 **==============================================================================
 **
@@ -338,6 +407,94 @@ oe_result_t oe_ecall(
  */
 oe_result_t oe_ocall(uint16_t func, uint64_t arg_in, uint64_t* arg_out);
 
+/**
+ * Post an OCALL without waiting for it to complete.
+ *
+ * The host performs posted OCALLs in order at the next transition of the
+ * calling thread, i.e., before it dispatches the next OCALL or when the
+ * current ECALL returns. Only OCALLs without outputs, such as OE_OCALL_FREE,
+ * can be posted.
+ *
+ * @param func The number of the function to be called.
+ * @param arg_in The input argument passed to the function.
+ *
+ * @retval OE_OK The OCALL was posted.
+ * @retval OE_UNSUPPORTED The OCALL cannot be posted.
+ * @retval OE_OUT_OF_MEMORY The queue of posted OCALLs is full.
+ *
+ * In case of an error, the caller should fall back to oe_ocall().
+ */
+oe_result_t oe_post_ocall(uint16_t func, uint64_t arg_in);
+
+/**
+ * Post a high-level host function call without waiting for it.
+ *
+ * Copy the input of the host function with the given function_id to the
+ * queue of posted OCALLs (see oe_post_ocall()) and return immediately. The
+ * input must be marshaled the way oeedger8r marshals the host function, and
+ * its outputs are discarded.
+ *
+ * Posted calls are performed in the order they were made, also relative to
+ * regular OCALLs and to switchless OCALLs, which are made as regular OCALLs
+ * while posted calls are pending. If the queue is full or the call is not
+ * made from within an ECALL, the function is called synchronously instead.
+ *
+ * @param function_id The id of the host function that will be called.
+ * @param input_buffer Buffer containing inputs data.
+ * @param input_buffer_size Size of the input data buffer.
+ * @param output_buffer_size Size of the output buffer the host function
+ * expects.
+ *
+ * @retval OE_OK The call was posted or performed.
+ * @retval OE_INVALID_PARAMETER A parameter is invalid.
+ * @retval OE_OUT_OF_MEMORY The call could not be made synchronously.
+ * @retval OE_FAILURE The synchronous call failed.
+ */
+oe_result_t oe_post_host_function(
+    size_t function_id,
+    const void* input_buffer,
+    size_t input_buffer_size,
+    size_t output_buffer_size);
+
+/**
+ * Allocate host memory from the pool of host memory that the enclave manages
+ * itself (see OE_ECALL_INIT_HOST_MEMORY_POOL), without making an OCALL. The
+ * memory must be released with oe_host_free(), never by the host.
+ *
+ * @returns The memory or NULL if there is no pool, the size is too large for
+ * the pool, or the pool is exhausted.
+ */
+void* oe_host_pool_malloc(size_t size);
+
+/**
+ * Whether the host allows oe_host_malloc() to allocate from the pool, i.e.,
+ * promises not to release memory allocated by the enclave itself.
+ */
+bool oe_host_pool_backs_host_malloc(void);
+
+/**
+ * Return memory allocated by oe_host_pool_malloc() to the pool.
+ *
+ * @returns false if ptr was not allocated from the pool.
+ */
+bool oe_host_pool_free(void* ptr);
+
+/**
+ * Reallocate memory allocated by oe_host_pool_malloc(), like realloc(). The
+ * memory is moved out of the pool if size is too large for it. A size of 0
+ * frees the memory and sets *new_ptr to NULL.
+ *
+ * @returns false if ptr was not allocated from the pool, in which case
+ * *new_ptr is not set.
+ */
+bool oe_host_pool_realloc(void* ptr, size_t size, void** new_ptr);
+
+/**
+ * Allocate memory from the host's heap with an OCALL, bypassing the pool.
+ * Memory that the host releases with free() must be allocated this way.
+ */
+void* oe_host_heap_malloc(size_t size);
+
 OE_EXTERNC_END
 
 #endif /* _OE_CALLS_H */
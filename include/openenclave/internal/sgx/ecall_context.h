@@ -25,6 +25,11 @@ typedef struct _oe_ecall_context
     uint64_t debug_eexit_rip;
     uint64_t debug_eexit_rbp;
     uint64_t debug_eexit_rsp;
+
+    // Queue of calls that the host executes at the next transition. See
+    // openenclave/internal/sgx/postedcalls.h.
+    volatile uint8_t* posted_calls;
+    volatile uint64_t posted_calls_size;
 } oe_ecall_context_t;
 
 OE_STATIC_ASSERT(OE_OFFSETOF(oe_ecall_context_t, ocall_args) == 0);
@@ -35,8 +40,10 @@ OE_STATIC_ASSERT(OE_OFFSETOF(oe_ecall_context_t, debug_eenter_rbp) == 80);
 OE_STATIC_ASSERT(OE_OFFSETOF(oe_ecall_context_t, debug_eexit_rip) == 88);
 OE_STATIC_ASSERT(OE_OFFSETOF(oe_ecall_context_t, debug_eexit_rbp) == 96);
 OE_STATIC_ASSERT(OE_OFFSETOF(oe_ecall_context_t, debug_eexit_rsp) == 104);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_ecall_context_t, posted_calls) == 112);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_ecall_context_t, posted_calls_size) == 120);
 
-OE_STATIC_ASSERT(sizeof(oe_ecall_context_t) == 112);
+OE_STATIC_ASSERT(sizeof(oe_ecall_context_t) == 128);
 
 /**
  * Fetch the ocall_args field if an ecall context has been passed in.
@@ -49,6 +56,24 @@ oe_call_host_function_args_t* oe_ecall_context_get_ocall_args();
  */
 void* oe_ecall_context_get_ocall_buffer(uint64_t size);
 
+/**
+ * Append a call to the posted call queue of the ecall context. Returns
+ * OE_OUT_OF_MEMORY if the queue is full and OE_UNSUPPORTED if there is no
+ * queue, in which case the caller must perform the call synchronously.
+ */
+oe_result_t oe_ecall_context_post_call(
+    uint64_t func,
+    uint64_t arg,
+    const void* input_buffer,
+    uint64_t input_buffer_size,
+    uint64_t output_buffer_size);
+
+/**
+ * Whether calls have been posted to the queue of the ecall context that the
+ * host has not performed yet.
+ */
+bool oe_ecall_context_has_posted_calls(void);
+
 OE_EXTERNC_END
 
 #endif /* _OE_INTERNAL_ECALL_CONTEXT_H */
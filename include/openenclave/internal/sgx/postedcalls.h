@@ -0,0 +1,59 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+#ifndef _OE_INTERNAL_SGX_POSTEDCALLS_H
+#define _OE_INTERNAL_SGX_POSTEDCALLS_H
+
+#include <openenclave/bits/defs.h>
+#include <openenclave/bits/types.h>
+
+OE_EXTERNC_BEGIN
+
+/**
+ * Size of the posted call queue that the host allocates for each thread
+ * binding. Once the queue is full, the enclave performs posted calls
+ * synchronously instead.
+ */
+#define OE_DEFAULT_POSTED_CALLS_SIZE (16 * 1024)
+
+/**
+ * Posted calls are OCALLs whose results the enclave does not wait for, such
+ * as OE_OCALL_FREE. The enclave appends them to a queue in host memory and
+ * the host executes them in order at the next transition of the same thread
+ * binding, i.e., before it dispatches the next OCALL or when the ECALL
+ * returns, even if it failed. The queue is therefore empty whenever the
+ * binding is not in use. The queue starts with an oe_posted_calls_t header,
+ * followed by up to (size - sizeof(oe_posted_calls_t)) bytes of entries.
+ */
+typedef struct _oe_posted_calls
+{
+    /* Number of bytes of entries in the queue. Written by the enclave when
+     * it posts a call and reset to zero by the host once it has drained the
+     * queue. */
+    volatile uint64_t used;
+    uint64_t reserved;
+} oe_posted_calls_t;
+
+OE_STATIC_ASSERT(sizeof(oe_posted_calls_t) == 16);
+
+/**
+ * An entry of the posted call queue. Entries of OE_OCALL_CALL_HOST_FUNCTION
+ * are followed by input_buffer_size bytes of input. The size of each entry
+ * is a multiple of OE_EDGER8R_BUFFER_ALIGNMENT.
+ */
+typedef struct _oe_posted_call
+{
+    /* OE_OCALL_CALL_HOST_FUNCTION or OE_OCALL_FREE */
+    uint64_t func;
+
+    /* The function id or the pointer to free */
+    uint64_t arg;
+
+    uint64_t input_buffer_size;
+    uint64_t output_buffer_size;
+} oe_posted_call_t;
+
+OE_STATIC_ASSERT(sizeof(oe_posted_call_t) == 32);
+
+OE_EXTERNC_END
+
+#endif /* _OE_INTERNAL_SGX_POSTEDCALLS_H */
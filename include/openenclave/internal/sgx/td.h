@@ -81,7 +81,7 @@ oe_thread_data_t* oe_get_thread_data(void);
  * Due to the inability to use OE_OFFSETOF on a struct while defining its
  * members, this value is computed and hard-coded.
  */
-#define OE_THREAD_SPECIFIC_DATA_SIZE (3632)
+#define OE_THREAD_SPECIFIC_DATA_SIZE (3536)
 
 typedef struct _oe_callsite oe_callsite_t;
 
@@ -105,16 +105,37 @@ typedef enum _oe_td_state
 
 /* This structure manages a pool of shared memory (memory visible to both
  * the enclave and the host). An instance of this structure is maintained
- * for each thread. This structure is used in enclave/core/arena.c.
+ * for each thread. This structure is used in enclave/core/sgx/arena.c.
+ *
+ * The pool is a chain of host memory segments. Their headers and the list
+ * of allocated objects are kept in enclave memory so that the host cannot
+ * tamper with them.
  */
+typedef struct _oe_shared_memory_segment oe_shared_memory_segment_t;
+typedef struct _oe_shared_memory_object oe_shared_memory_object_t;
+
 typedef struct _oe_shared_memory_arena_t
 {
-    uint8_t* buffer;
-    uint64_t capacity;
+    /* The newest segment, which is chained to the older ones */
+    oe_shared_memory_segment_t* segment;
+
+    /* Allocated objects in allocation order, and the capacity of the array */
+    oe_shared_memory_object_t* objects;
+    uint64_t num_objects;
+    uint64_t max_objects;
+
+    /* Bytes allocated from and held by all segments */
     uint64_t used;
+    uint64_t capacity;
+
+    /* High-water marks of used and num_objects, and the number of segments
+     * that had to be added to a non-empty arena */
+    uint64_t max_used;
+    uint64_t max_num_objects;
+    uint64_t num_grows;
 } oe_shared_memory_arena_t;
 
-OE_CHECK_SIZE(sizeof(oe_shared_memory_arena_t), 24);
+OE_CHECK_SIZE(sizeof(oe_shared_memory_arena_t), 72);
 
 OE_PACK_BEGIN
 typedef struct _td
@@ -209,7 +230,7 @@ typedef struct _td
     int32_t errnum;
     int32_t padding2;
 
-    /* Thread-specific shared memory pool (see enclave/core/arena.c) */
+    /* Thread-specific shared memory pool (see enclave/core/sgx/arena.c) */
     oe_shared_memory_arena_t arena;
 
     /* TLS atexit functions (see enclave/core/sgx/threadlocal.c) */
@@ -224,6 +245,24 @@ typedef struct _td
     /* The error code for PF and GP exceptions. */
     uint32_t error_code;
 
+    /* Buffer for marshaling ECALL parameters, which is kept across ECALLs
+     * (see enclave/core/sgx/calls.c) */
+    uint8_t* ecall_buffer;
+    uint64_t ecall_buffer_size;
+
+    /* Free blocks of the pool of host memory that this thread caches, which
+     * are kept across ECALLs (see enclave/core/sgx/hostpool.c) */
+    struct _oe_host_pool_cache* host_pool_cache;
+
+    /* Asynchronous switchless calls that this thread has started and not
+     * waited for yet (see enclave/core/sgx/calls.c) */
+    struct _oe_switchless_call* switchless_calls;
+
+    /* Link of the list of threads whose caches above are freed when the
+     * enclave is destroyed (see td_register_caches()) */
+    struct _td* next_cached_td;
+    uint64_t caches_registered;
+
     /* Reserved for thread specific data. */
     uint8_t thread_specific_data[OE_THREAD_SPECIFIC_DATA_SIZE];
 } oe_sgx_td_t;
@@ -10,32 +10,207 @@
 #include <openenclave/internal/calls.h>
 #include <openenclave/internal/thread.h>
 
+/**
+ * Each worker context takes two cache lines: one for the fields that are
+ * polled across the host/enclave boundary and one for the counters that a
+ * spinning worker updates. The layout is not versioned; the host and the
+ * enclave must be built with the same SDK to use switchless calls.
+ */
+#define OE_SWITCHLESS_CONTEXT_ALIGNMENT 64
+
 /**
  * oe_host_worker_context_t is used both by the host (windows/linux) and the
  * enclave (ELF). Lock down the layout.
  */
-OE_STATIC_ASSERT(sizeof(oe_host_worker_context_t) == 48);
+OE_STATIC_ASSERT(sizeof(oe_host_worker_context_t) == 128);
 OE_STATIC_ASSERT(OE_OFFSETOF(oe_host_worker_context_t, call_arg) == 0);
 OE_STATIC_ASSERT(OE_OFFSETOF(oe_host_worker_context_t, enc) == 8);
 OE_STATIC_ASSERT(OE_OFFSETOF(oe_host_worker_context_t, is_stopping) == 16);
 OE_STATIC_ASSERT(OE_OFFSETOF(oe_host_worker_context_t, event) == 24);
-OE_STATIC_ASSERT(OE_OFFSETOF(oe_host_worker_context_t, spin_count) == 32);
-OE_STATIC_ASSERT(OE_OFFSETOF(oe_host_worker_context_t, total_spin_count) == 40);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_host_worker_context_t, num_posts) == 32);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_host_worker_context_t, spin_count) == 64);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_host_worker_context_t, total_spin_count) == 72);
 
 /**
  * oe_enclave_worker_context_t is used both by the host (windows/linux) and the
  * enclave (ELF). Lock down the layout.
  */
-OE_STATIC_ASSERT(sizeof(oe_enclave_worker_context_t) == 56);
+OE_STATIC_ASSERT(sizeof(oe_enclave_worker_context_t) == 128);
 OE_STATIC_ASSERT(OE_OFFSETOF(oe_enclave_worker_context_t, call_arg) == 0);
 OE_STATIC_ASSERT(OE_OFFSETOF(oe_enclave_worker_context_t, enc) == 8);
 OE_STATIC_ASSERT(OE_OFFSETOF(oe_enclave_worker_context_t, is_stopping) == 16);
 OE_STATIC_ASSERT(OE_OFFSETOF(oe_enclave_worker_context_t, event) == 24);
-OE_STATIC_ASSERT(OE_OFFSETOF(oe_enclave_worker_context_t, spin_count) == 32);
 OE_STATIC_ASSERT(
-    OE_OFFSETOF(oe_enclave_worker_context_t, spin_count_threshold) == 40);
+    OE_OFFSETOF(oe_enclave_worker_context_t, spin_count_threshold) == 32);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_enclave_worker_context_t, spin_count) == 64);
 OE_STATIC_ASSERT(
-    OE_OFFSETOF(oe_enclave_worker_context_t, total_spin_count) == 48);
+    OE_OFFSETOF(oe_enclave_worker_context_t, total_spin_count) == 72);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_enclave_worker_context_t, num_calls) == 80);
+
+/**
+ * The queue that enclave threads post switchless ocalls to, unless the host
+ * selected OE_SWITCHLESS_OCALL_TRANSPORT_SLOTS. The same structure with the
+ * roles swapped is the ecall queue, which host threads post switchless
+ * ecalls to and enclave workers take them from. It is a bounded
+ * multi-producer/multi-consumer ring in host memory: enclave threads enqueue
+ * the (host) addresses of their oe_call_host_function_args_t and any host
+ * worker dequeues them. The sequence number of each cell tells producers and
+ * consumers whose turn it is (D. Vyukov's bounded MPMC queue), so a post
+ * only misses when the ring is full.
+ *
+ * The header is followed by capacity cells and then by one sleeping flag per
+ * host worker. A worker sets its flag and increments num_sleeping before it
+ * checks the queue a last time and waits for its event. After enqueuing, the
+ * enclave wakes one of the sleeping workers if num_sleeping is non-zero,
+ * starting its search at the worker after the one it woke last.
+ */
+typedef struct _oe_switchless_queue_cell
+{
+    volatile uint64_t sequence;
+    volatile uint64_t call_arg;
+} oe_switchless_queue_cell_t;
+
+OE_STATIC_ASSERT(sizeof(oe_switchless_queue_cell_t) == 16);
+
+typedef struct _oe_switchless_queue
+{
+    /* Number of cells, a power of two. Read once by the enclave. */
+    uint64_t capacity;
+    uint64_t reserved0[7];
+
+    /* Next position to enqueue at, advanced by enclave threads */
+    volatile uint64_t tail;
+    uint64_t reserved1[7];
+
+    /* Next position to dequeue from, advanced by host workers */
+    volatile uint64_t head;
+    uint64_t reserved2[7];
+
+    /* Number of host workers that are sleeping or about to sleep */
+    volatile uint64_t num_sleeping;
+    uint64_t reserved3[7];
+} oe_switchless_queue_t;
+
+OE_STATIC_ASSERT(sizeof(oe_switchless_queue_t) == 256);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_switchless_queue_t, tail) == 64);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_switchless_queue_t, head) == 128);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_switchless_queue_t, num_sleeping) == 192);
+
+#define OE_SWITCHLESS_QUEUE_MIN_CAPACITY 64
+#define OE_SWITCHLESS_QUEUE_MAX_CAPACITY (64 * 1024)
+#define OE_SWITCHLESS_QUEUE_ALIGNMENT 64
+
+OE_INLINE oe_switchless_queue_cell_t* oe_switchless_queue_cells(
+    oe_switchless_queue_t* queue)
+{
+    return (oe_switchless_queue_cell_t*)(queue + 1);
+}
+
+OE_INLINE volatile uint64_t* oe_switchless_queue_sleeping(
+    oe_switchless_queue_t* queue,
+    uint64_t capacity)
+{
+    return (volatile uint64_t*)(oe_switchless_queue_cells(queue) + capacity);
+}
+
+OE_INLINE size_t
+oe_switchless_queue_size(uint64_t capacity, uint64_t num_workers)
+{
+    return sizeof(oe_switchless_queue_t) +
+           capacity * sizeof(oe_switchless_queue_cell_t) +
+           num_workers * sizeof(uint64_t);
+}
+
+/**
+ * The adaptive spin policy and the time accounting of a switchless worker,
+ * kept by the host for each host and enclave worker. A worker spins for up to
+ * spin_count_threshold iterations before it parks (sleeps on its event). The
+ * host moves the threshold within [min_spin_count, max_spin_count]:
+ *
+ *   - A call that arrives after a worker spun s iterations pulls the
+ *     threshold toward 2 * s, so that gaps like it are still caught.
+ *   - A park that ends before the worker would have spun another
+ *     spin_count_threshold iterations doubles the threshold: the worker
+ *     paid for a sleep and a wake-up that spinning would have saved.
+ *   - A longer park lets the threshold drift back toward min_spin_count, so
+ *     that idle workers do not burn cores.
+ *
+ * Parks are converted into iterations with the spin rate that the worker
+ * achieved so far. Enclave workers park with an OCALL, so the host only
+ * applies the park rules to them and hands them the new threshold through
+ * oe_enclave_worker_context_t.spin_count_threshold.
+ *
+ * The policies are allocated like the worker contexts, so that each one
+ * takes two cache lines of its own and the counters of one worker do not
+ * share a line with those of another worker.
+ */
+typedef struct _oe_switchless_worker_policy
+{
+    uint64_t min_spin_count;
+    uint64_t max_spin_count;
+    uint64_t spin_count_threshold;
+
+    /* When the worker started, to derive the spin time of enclave workers */
+    uint64_t start_nsec;
+
+    /* Time spent spinning, parked and handling calls */
+    uint64_t spin_nsec;
+    uint64_t park_nsec;
+    uint64_t work_nsec;
+    uint64_t num_parks;
+
+    /* Calls handled by a host worker, and those of them that it dequeued
+     * while more calls were waiting in the ocall queue */
+    uint64_t num_calls;
+    uint64_t num_backlogged;
+
+    /* How many times a thread that posted a call woke up the worker */
+    uint64_t num_wakes;
+
+    uint64_t reserved[5];
+} oe_switchless_worker_policy_t;
+
+OE_STATIC_ASSERT(
+    sizeof(oe_switchless_worker_policy_t) ==
+    2 * OE_SWITCHLESS_CONTEXT_ALIGNMENT);
+
+/**
+ * The host functions whose regular ocalls the enclave makes as switchless
+ * ocalls form a bitmap in host memory, with bit (id % 64) of word (id / 64)
+ * set for the host function id. The enclave reads whole aligned words of it.
+ */
+OE_INLINE size_t oe_switchless_promoted_ocalls_size(uint64_t num_ocalls)
+{
+    return (size_t)((num_ocalls + 63) / 64) * sizeof(uint64_t);
+}
+
+/**
+ * How often and how long the host measured a host function to run, in
+ * regular ocalls and in switchless ocalls that it promoted. The host
+ * decides whether to promote the host function at the end of each window
+ * (see host/sgx/switchless.c).
+ */
+typedef struct _oe_switchless_ocall_profile
+{
+    /* The oe_switchless_promotion_t of the host function */
+    uint32_t promotion;
+
+    /* Set once the host function is found to be part of the switchless
+     * machinery itself, which must not be promoted */
+    uint32_t is_internal;
+
+    /* The calls of the current window and their total time */
+    uint64_t window_start_nsec;
+    uint64_t window_calls;
+    uint64_t window_nsec;
+} oe_switchless_ocall_profile_t;
+
+/**
+ * The value of oe_host_worker_context_t.call_arg of a host worker of the
+ * elastic pool that is not running. Enclave threads only post to slots that
+ * are NULL, so they pass over it.
+ */
+#define OE_SWITCHLESS_WORKER_RETIRED ((void*)1)
 
 typedef struct _oe_switchless_call_manager
 {
@@ -46,15 +221,92 @@ typedef struct _oe_switchless_call_manager
     oe_enclave_worker_context_t* enclave_worker_contexts;
     oe_thread_t* enclave_worker_threads;
     size_t num_enclave_workers;
+
+    /* Call statistics of each host worker (see host/sgx/callstats.c) */
+    struct _oe_call_statistics_table** host_worker_statistics;
+
+    /* The switchless ocall queue, or NULL if the host workers use slots */
+    oe_switchless_queue_t* ocall_queue;
+
+    /* The switchless ecall queue, or NULL if there are no enclave workers.
+     * ecall_nsec is the time that host threads waited for switchless ecalls
+     * to complete, which the host attributes to the enclave workers by the
+     * number of calls each one handled. */
+    oe_switchless_queue_t* ecall_queue;
+    volatile uint64_t next_enclave_worker_to_wake;
+    volatile uint64_t ecall_nsec;
+
+    /* The spin policy of each host and enclave worker */
+    oe_switchless_worker_policy_t* host_worker_policies;
+    oe_switchless_worker_policy_t* enclave_worker_policies;
+
+    /* The elastic pool of host workers (see host/sgx/switchless.c). Host
+     * workers [0, num_running_host_workers) are running. The pool thread
+     * only exists if min_host_workers < num_host_workers. */
+    size_t min_host_workers;
+    volatile uint64_t num_running_host_workers;
+    oe_thread_t pool_thread;
+    volatile int64_t pool_event;
+    volatile bool pool_is_stopping;
+    volatile uint64_t num_grows;
+    volatile uint64_t num_shrinks;
+
+    /* Enclave threads that sleep until their switchless ocall completes
+     * (see oe_sgx_wait_switchless_ocall_ocall()). Host workers bump
+     * completion_sequence to wake them up after each call while there are
+     * any. */
+    volatile uint64_t num_parked_callers;
+    volatile int64_t completion_sequence;
+    volatile uint64_t num_parked_waits;
+
+    /* The CPUs that the host and enclave workers run on, if any. If
+     * pin_workers is set, worker i only runs on CPU i % num_cpus of its
+     * list, otherwise on all of them (see host/sgx/switchless.c). */
+    uint32_t* host_worker_cpus;
+    size_t num_host_worker_cpus;
+    uint32_t* enclave_worker_cpus;
+    size_t num_enclave_worker_cpus;
+    bool pin_workers;
+
+    /* The bitmap of promoted host functions, or NULL if ocalls are not
+     * promoted, and the profile of each host function */
+    volatile uint64_t* promoted_ocalls;
+    oe_switchless_ocall_profile_t* ocall_profiles;
+    size_t num_ocall_profiles;
 } oe_switchless_call_manager_t;
 
+struct _oe_enclave_setting_context_switchless;
+
 oe_result_t oe_start_switchless_manager(
     oe_enclave_t* enclave,
-    size_t num_host_workers,
-    size_t num_enclave_workers);
+    const struct _oe_enclave_setting_context_switchless* setting);
 
 oe_result_t oe_stop_switchless_manager(oe_enclave_t* enclave);
 
+/* Count a regular ocall of a host function that is a switchless ocall that
+ * missed, on the binding of tcs (see host/sgx/switchless.c) */
+void oe_count_switchless_fallback(
+    oe_enclave_t* enclave,
+    uint64_t tcs,
+    uint64_t arg);
+
+/* Count a regular ecall that is a switchless ecall that missed, on the
+ * binding of tcs (see host/sgx/switchless.c) */
+void oe_count_switchless_ecall_fallback(
+    oe_enclave_t* enclave,
+    uint64_t tcs,
+    uint16_t func,
+    uint64_t arg);
+
+/* Measure a regular ocall of a host function for its promotion to switchless
+ * ocalls. oe_start_ocall_profile() returns 0 if the ocall is not measured. */
+uint64_t oe_start_ocall_profile(oe_enclave_t* enclave);
+
+void oe_finish_ocall_profile(
+    oe_enclave_t* enclave,
+    uint64_t arg,
+    uint64_t start);
+
 void oe_host_worker_wait(oe_host_worker_context_t* context);
 
 void oe_host_worker_wake(oe_host_worker_context_t* context);
@@ -63,4 +315,20 @@ void oe_enclave_worker_wait(oe_enclave_worker_context_t* context);
 
 void oe_enclave_worker_wake(oe_enclave_worker_context_t* context);
 
+/* Wait up to timeout_msec for *event to become 1 and reset it to 0. Returns
+ * whether the event was set. May return false early. */
+bool oe_switchless_event_wait(volatile int64_t* event, uint32_t timeout_msec);
+
+/* Set *event to 1 and wake up a thread waiting for it */
+void oe_switchless_event_wake(volatile int64_t* event);
+
+/* Wait up to timeout_msec while *address is value. May return early. */
+void oe_switchless_address_wait(
+    volatile int64_t* address,
+    int64_t value,
+    uint32_t timeout_msec);
+
+/* Wake up all threads waiting in oe_switchless_address_wait() on address */
+void oe_switchless_address_wake_all(volatile int64_t* address);
+
 #endif /* _OE_SWITCHLESS_H */
@@ -5,6 +5,7 @@
 #include <openenclave/internal/raise.h>
 #include <openenclave/internal/safemath.h>
 #include <openenclave/internal/thread.h>
+#include <openenclave/internal/types.h>
 #include <openenclave/internal/utils.h>
 #include <stdlib.h>
 
@@ -13,23 +14,472 @@
 #include "openenclave/bits/result.h"
 #include "syscall.h"
 
-static oe_mapping_t* _mappings;
+/*
+**==============================================================================
+**
+** Mapped memory:
+**
+**     Anonymous mappings are carved from page-aligned regions of the enclave
+**     heap. A region is at least OE_MMAN_REGION_SIZE bytes, or one mapping
+**     rounded up to whole pages if that is larger.
+**
+**     The mapped and the free page runs of all regions are kept in two AVL
+**     trees ordered by address. Runs never overlap, so the first mapping that
+**     intersects a range of pages is found in O(log n). Each node of the
+**     free tree also records the longest run in its subtree, so mmap() finds
+**     the lowest free run that is long enough in O(log n), too.
+**
+**     munmap() may unmap any range of pages: mappings are trimmed or split,
+**     and the unmapped pages are merged with adjacent free runs of the same
+**     region. A region whose pages are all free is returned to the heap,
+**     except for one region of the default size that is kept for reuse.
+**
+**     Tree nodes come from slabs that are only released on exit, so that
+**     mapping and unmapping pages does not fragment the heap with small
+**     allocations.
+**
+**==============================================================================
+*/
+
+#define OE_MMAN_REGION_SIZE (1024 * 1024)
+
+/* The number of tree nodes per slab */
+#define NODES_PER_SLAB 64
+
+typedef struct _region
+{
+    uint64_t start;
+    uint64_t end;
+    struct _region* next;
+} region_t;
+
+typedef struct _node
+{
+    uint64_t start;
+    uint64_t end;
+    region_t* region;
+    struct _node* left;
+    struct _node* right;
+
+    /* The length of the longest run in the subtree */
+    uint64_t max_length;
+    int height;
+} node_t;
+
+typedef struct _slab
+{
+    struct _slab* next;
+    node_t nodes[NODES_PER_SLAB];
+} slab_t;
+
+static node_t* _mapped;
+static node_t* _free;
+static region_t* _regions;
+static slab_t* _slabs;
+
+/* Unused nodes, linked through their left pointers */
+static node_t* _unused_nodes;
+
+/* A region of the default size that has no mappings */
+static region_t* _empty_region;
+
 static oe_spinlock_t _lock;
 
+static node_t* _new_node(uint64_t start, uint64_t end, region_t* region)
+{
+    node_t* node;
+
+    if (!_unused_nodes)
+    {
+        slab_t* slab;
+
+        if (!(slab = (slab_t*)malloc(sizeof(slab_t))))
+            return NULL;
+
+        for (size_t i = 0; i < NODES_PER_SLAB; i++)
+        {
+            slab->nodes[i].left = _unused_nodes;
+            _unused_nodes = &slab->nodes[i];
+        }
+
+        slab->next = _slabs;
+        _slabs = slab;
+    }
+
+    node = _unused_nodes;
+    _unused_nodes = node->left;
+
+    node->start = start;
+    node->end = end;
+    node->region = region;
+    node->left = NULL;
+    node->right = NULL;
+    node->max_length = end - start;
+    node->height = 1;
+
+    return node;
+}
+
+static void _delete_node(node_t* node)
+{
+    node->left = _unused_nodes;
+    _unused_nodes = node;
+}
+
+/*
+**==============================================================================
+**
+** AVL trees of page runs, ordered by their start address:
+**
+**==============================================================================
+*/
+
+OE_INLINE int _height(const node_t* node)
+{
+    return node ? node->height : 0;
+}
+
+OE_INLINE uint64_t _max_length(const node_t* node)
+{
+    return node ? node->max_length : 0;
+}
+
+static void _update(node_t* node)
+{
+    int left = _height(node->left);
+    int right = _height(node->right);
+    uint64_t length = node->end - node->start;
+
+    node->height = 1 + (left > right ? left : right);
+
+    if (_max_length(node->left) > length)
+        length = _max_length(node->left);
+
+    if (_max_length(node->right) > length)
+        length = _max_length(node->right);
+
+    node->max_length = length;
+}
+
+static node_t* _rotate_left(node_t* node)
+{
+    node_t* right = node->right;
+
+    node->right = right->left;
+    right->left = node;
+    _update(node);
+    _update(right);
+
+    return right;
+}
+
+static node_t* _rotate_right(node_t* node)
+{
+    node_t* left = node->left;
+
+    node->left = left->right;
+    left->right = node;
+    _update(node);
+    _update(left);
+
+    return left;
+}
+
+static node_t* _balance(node_t* node)
+{
+    int balance = _height(node->left) - _height(node->right);
+
+    if (balance > 1)
+    {
+        if (_height(node->left->left) < _height(node->left->right))
+            node->left = _rotate_left(node->left);
+
+        return _rotate_right(node);
+    }
+
+    if (balance < -1)
+    {
+        if (_height(node->right->right) < _height(node->right->left))
+            node->right = _rotate_right(node->right);
+
+        return _rotate_left(node);
+    }
+
+    _update(node);
+    return node;
+}
+
+/* Inserts the node into the tree. Nodes are always inserted as leaves, so
+ * the node may come from another tree or have a new address. */
+static node_t* _insert(node_t* root, node_t* node)
+{
+    if (!root)
+    {
+        node->left = NULL;
+        node->right = NULL;
+        _update(node);
+        return node;
+    }
+
+    if (node->start < root->start)
+        root->left = _insert(root->left, node);
+    else
+        root->right = _insert(root->right, node);
+
+    return _balance(root);
+}
+
+static node_t* _remove_min(node_t* root, node_t** min)
+{
+    if (!root->left)
+    {
+        *min = root;
+        return root->right;
+    }
+
+    root->left = _remove_min(root->left, min);
+    return _balance(root);
+}
+
+/* Removes the node that starts at the given address from the tree. The
+ * node itself is not deleted. */
+static node_t* _remove(node_t* root, uint64_t start)
+{
+    if (!root)
+        return NULL;
+
+    if (start < root->start)
+        root->left = _remove(root->left, start);
+    else if (start > root->start)
+        root->right = _remove(root->right, start);
+    else
+    {
+        node_t* min;
+
+        if (!root->right)
+            return root->left;
+
+        root->right = _remove_min(root->right, &min);
+        min->left = root->left;
+        min->right = root->right;
+        return _balance(min);
+    }
+
+    return _balance(root);
+}
+
+/* Finds the lowest run that ends after the given address */
+static node_t* _find_end_after(node_t* root, uint64_t addr)
+{
+    node_t* found = NULL;
+
+    while (root)
+    {
+        if (root->end > addr)
+        {
+            found = root;
+            root = root->left;
+        }
+        else
+            root = root->right;
+    }
+
+    return found;
+}
+
+/* Finds the highest run that starts before the given address */
+static node_t* _find_start_before(node_t* root, uint64_t addr)
+{
+    node_t* found = NULL;
+
+    while (root)
+    {
+        if (root->start < addr)
+        {
+            found = root;
+            root = root->right;
+        }
+        else
+            root = root->left;
+    }
+
+    return found;
+}
+
+/* Finds the lowest run of at least the given length */
+static node_t* _find_fit(node_t* root, uint64_t length)
+{
+    while (root && root->max_length >= length)
+    {
+        if (_max_length(root->left) >= length)
+            root = root->left;
+        else if (root->end - root->start >= length)
+            return root;
+        else
+            root = root->right;
+    }
+
+    return NULL;
+}
+
+/*
+**==============================================================================
+**
+** Regions and free page runs:
+**
+**==============================================================================
+*/
+
+static void _release_region(region_t* region)
+{
+    region_t** p = &_regions;
+
+    while (*p != region)
+        p = &(*p)->next;
+
+    *p = region->next;
+    free((void*)region->start);
+    free(region);
+}
+
+/* Returns the given pages to the free runs of their region, using the given
+ * node unless the pages are merged with adjacent free runs */
+static void _free_pages(
+    region_t* region,
+    uint64_t start,
+    uint64_t end,
+    node_t* node)
+{
+    node_t* prev = _find_start_before(_free, start);
+    node_t* next = _find_end_after(_free, start);
+
+    if (prev && prev->end == start && prev->region == region)
+    {
+        _free = _remove(_free, prev->start);
+        start = prev->start;
+        _delete_node(prev);
+    }
+
+    if (next && next->start == end && next->region == region)
+    {
+        _free = _remove(_free, next->start);
+        end = next->end;
+        _delete_node(next);
+    }
+
+    // A region without mappings goes back to the heap, except for one region
+    // of the default size.
+    if (start == region->start && end == region->end)
+    {
+        if (_empty_region || end - start != OE_MMAN_REGION_SIZE)
+        {
+            _release_region(region);
+            _delete_node(node);
+            return;
+        }
+
+        _empty_region = region;
+    }
+
+    node->start = start;
+    node->end = end;
+    node->region = region;
+    _free = _insert(_free, node);
+}
+
+/* Maps length bytes of free pages, from a new region if no free run is long
+ * enough */
+static node_t* _map_pages(uint64_t length)
+{
+    node_t* mapping = NULL;
+    node_t* run = NULL;
+    node_t* rest = NULL;
+    region_t* region = NULL;
+    void* ptr = NULL;
+    uint64_t size = length;
+
+    if (!(mapping = _new_node(0, 0, NULL)))
+        return NULL;
+
+    if ((run = _find_fit(_free, length)))
+    {
+        _free = _remove(_free, run->start);
+        mapping->start = run->start;
+        mapping->region = run->region;
+
+        if (run->region == _empty_region)
+            _empty_region = NULL;
+
+        // The rest of the run stays free.
+        if (run->end - run->start > length)
+        {
+            run->start += length;
+            _free = _insert(_free, run);
+        }
+        else
+            _delete_node(run);
+    }
+    else
+    {
+        if (size < OE_MMAN_REGION_SIZE)
+            size = OE_MMAN_REGION_SIZE;
+
+        if ((size > length && !(rest = _new_node(0, 0, NULL))) ||
+            !(region = (region_t*)malloc(sizeof(region_t))) ||
+            posix_memalign(&ptr, OE_PAGE_SIZE, size) != 0)
+        {
+            free(region);
+
+            if (rest)
+                _delete_node(rest);
+
+            _delete_node(mapping);
+            return NULL;
+        }
+
+        region->start = (uint64_t)ptr;
+        region->end = region->start + size;
+        region->next = _regions;
+        _regions = region;
+        mapping->start = region->start;
+        mapping->region = region;
+
+        if (rest)
+        {
+            rest->start = region->start + length;
+            rest->end = region->end;
+            rest->region = region;
+            _free = _insert(_free, rest);
+        }
+    }
+
+    mapping->end = mapping->start + length;
+    _mapped = _insert(_mapped, mapping);
+
+    return mapping;
+}
+
 static void _clear_mappings(void)
 {
-    oe_mapping_t* m = _mappings;
-    _mappings = 0;
-    while (m)
+    while (_regions)
     {
-        oe_mapping_t* next = m->next;
-        free((void*)m->start);
-        m->start = 0;
-        free(m->status_vector);
-        m->status_vector = NULL;
-        free(m);
-        m = next;
+        region_t* next = _regions->next;
+        free((void*)_regions->start);
+        free(_regions);
+        _regions = next;
     }
+
+    while (_slabs)
+    {
+        slab_t* next = _slabs->next;
+        free(_slabs);
+        _slabs = next;
+    }
+
+    _mapped = NULL;
+    _free = NULL;
+    _unused_nodes = NULL;
+    _empty_region = NULL;
 }
 
 static void _call_atexit(void)
@@ -174,11 +624,7 @@ void* oe_mmap(
     off_t offset)
 {
     oe_result_t result = OE_UNEXPECTED;
-    void* ptr = NULL;
-    void* vector = NULL;
-    oe_mapping_t* m = NULL;
-    size_t vector_length = 0;
-    int ret = 0;
+    node_t* mapping = NULL;
 
     OE_CHECK(_validate_mmap_parameters(addr, length, prot, flags, fd, offset));
 
@@ -186,137 +632,83 @@ void* oe_mmap(
 
     // length is rounded up to nearest page size.
     OE_CHECK(oe_safe_round_up_u64(length, OE_PAGE_SIZE, &length));
-    OE_CHECK(oe_safe_round_up_u64(length / 8, 8, &vector_length));
 
-    // Allocate objects.
-    vector = (uint8_t*)calloc(vector_length, 1);
-    m = (oe_mapping_t*)malloc(sizeof(*m));
-    if (!vector || !m)
-    {
-        oe_errno = OE_ENOMEM;
-        OE_RAISE(OE_OUT_OF_MEMORY);
-    }
+    oe_spin_lock(&_lock);
+    mapping = _map_pages(length);
+    oe_spin_unlock(&_lock);
 
-    if (((ret = posix_memalign(&ptr, OE_PAGE_SIZE, length)) != 0) || !ptr)
+    if (!mapping)
     {
-        // posix_memalign does not set errno (by spec).
-        // Set it ourselves.
-        oe_errno = ret;
+        oe_errno = OE_ENOMEM;
         OE_RAISE_MSG(
-            OE_OUT_OF_MEMORY, "posix_memalign failed with code %d", ret);
-    }
-
-    // Set up mapping.
-    m->start = (uint64_t)ptr;
-    OE_CHECK(oe_safe_add_u64((uint64_t)m->start, length, (uint64_t*)&m->end));
-    m->status_vector = vector;
-    memset(ptr, 0, length);
-
-    // Set relevant bits of status vector to 1.
-    {
-        int bv_idx = 0;
-        uint8_t bit_mask = 0x01;
-        // Since m->end has been rounded to OE_PAGE_SIZE and been validated via
-        // oe_safe_add_u64, it is safe to add OE_PAGE_SIZE to `a` since it won't
-        // overflow.
-        for (uint64_t a = m->start; a < m->end; a += OE_PAGE_SIZE)
-        {
-            m->status_vector[bv_idx] |= bit_mask;
-            bit_mask <<= 1;
-            if (!bit_mask)
-            {
-                // Move to next byte in status vector.
-                ++bv_idx;
-                bit_mask = 0x01;
-            }
-        }
+            OE_OUT_OF_MEMORY, "cannot map %llu bytes", OE_LLU(length));
     }
 
-    // Update mappings list.
-    oe_spin_lock(&_lock);
-    m->next = _mappings;
-    _mappings = m;
-    oe_spin_unlock(&_lock);
+    // Pages that were mapped before may hold stale data.
+    memset((void*)mapping->start, 0, length);
 
     result = OE_OK;
 
 done:
     if (result != OE_OK)
-    {
-        free(vector);
-        free(ptr);
-        free(m);
         return MAP_FAILED;
-    }
-    return ptr;
+
+    return (void*)mapping->start;
 }
 
-static void _munmap(
-    oe_mapping_t* prev,
-    oe_mapping_t* m,
-    uint64_t start,
-    uint64_t end)
+/* Unmaps the pages in [start, end) that are mapped */
+static oe_result_t _unmap_pages(uint64_t start, uint64_t end)
 {
-    while (m)
+    oe_result_t result = OE_UNEXPECTED;
+    node_t* m;
+
+    while ((m = _find_end_after(_mapped, start)) && m->start < end)
     {
-        if (end <= m->start || start >= m->end)
+        region_t* region = m->region;
+        uint64_t unmap_start = start > m->start ? start : m->start;
+        uint64_t unmap_end = end < m->end ? end : m->end;
+        node_t* run = NULL;
+        node_t* right = NULL;
+
+        // Get the nodes before changing the trees, so that running out of
+        // memory leaves the mappings as they were.
+        if (!(run = _new_node(0, 0, NULL)))
+            OE_RAISE_NO_TRACE(OE_OUT_OF_MEMORY);
+
+        // Unmapping the middle of a mapping splits it in two.
+        if (m->start < unmap_start && unmap_end < m->end &&
+            !(right = _new_node(unmap_end, m->end, region)))
         {
-            // Specified address range does not intersect with current mapping.
-            prev = m;
-            m = m->next;
-            continue;
+            _delete_node(run);
+            OE_RAISE_NO_TRACE(OE_OUT_OF_MEMORY);
         }
 
-        // Specified address range intersects with current mapping.
-
-        // Unmap part of address range that lies to the left of current mapping.
-        if (start < m->start)
-            _munmap(m, m->next, start, m->start);
-
-        // Unmap part of address range that lies to the right of current
-        // mapping.
-        if (end > m->end)
-            _munmap(m, m->next, m->end, end);
+        _mapped = _remove(_mapped, m->start);
 
-        bool delete = true;
-        if (start > m->start || end < m->end)
+        if (m->start < unmap_start)
         {
-            // Partial unmapping.
-            uint8_t bit_mask = 1;
-            int bv_idx = 0;
-
-            // Mark all pages in given address range as unmapped.
-            for (uint64_t a = m->start; a < m->end; a += OE_PAGE_SIZE)
-            {
-                // If pages lies in the specified range, unset its status.
-                if (start <= a && a < end)
-                    m->status_vector[bv_idx] &= ~bit_mask;
-
-                bit_mask <<= 1;
-                if (!bit_mask)
-                {
-                    // Retain the mapping if any bit in the vector is set.
-                    delete = delete &&!m->status_vector[bv_idx];
-                    bit_mask = 1;
-                    bv_idx++;
-                }
-            }
-            delete = delete &&!m->status_vector[bv_idx];
+            m->end = unmap_start;
+            _mapped = _insert(_mapped, m);
         }
-
-        if (delete)
+        else if (unmap_end < m->end)
         {
-            if (prev)
-                prev->next = m->next;
-            else
-                _mappings = m->next;
-            free(m->status_vector);
-            free((void*)m->start);
-            free(m);
+            m->start = unmap_end;
+            _mapped = _insert(_mapped, m);
         }
+        else
+            _delete_node(m);
+
+        if (right)
+            _mapped = _insert(_mapped, right);
 
-        break;
+        _free_pages(region, unmap_start, unmap_end, run);
+        start = unmap_end;
     }
+
+    result = OE_OK;
+
+done:
+    return result;
 }
 
 int oe_munmap(void* addr, uint64_t length)
@@ -334,8 +726,15 @@ int oe_munmap(void* addr, uint64_t length)
     }
 
     oe_spin_lock(&_lock);
-    _munmap(NULL, _mappings, start, end);
+    result = _unmap_pages(start, end);
     oe_spin_unlock(&_lock);
+
+    if (result != OE_OK)
+    {
+        oe_errno = OE_ENOMEM;
+        goto done;
+    }
+
     oe_errno = 0;
     result = OE_OK;
 done:
@@ -358,7 +757,27 @@ OE_WEAK_ALIAS(mmap, mmap64);
 OE_WEAK_ALIAS(munmap, __munmap);
 
 // Utility function for tests.
-oe_mapping_t* oe_test_get_mappings(void)
+size_t oe_test_get_mappings(oe_mapping_t* mappings, size_t count)
 {
-    return _mappings;
+    size_t num_mappings = 0;
+    uint64_t addr = 0;
+    node_t* m;
+
+    oe_spin_lock(&_lock);
+
+    while ((m = _find_end_after(_mapped, addr)))
+    {
+        if (num_mappings < count)
+        {
+            mappings[num_mappings].start = m->start;
+            mappings[num_mappings].end = m->end;
+        }
+
+        num_mappings++;
+        addr = m->end;
+    }
+
+    oe_spin_unlock(&_lock);
+
+    return num_mappings;
 }
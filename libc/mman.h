@@ -18,8 +18,8 @@ typedef struct _mapping
 {
     uint64_t start;
     uint64_t end;
-    uint8_t* status_vector;
-    struct _mapping* next;
 } oe_mapping_t;
 
-oe_mapping_t* oe_test_get_mappings(void);
+/* Copies up to count mappings in the order of their addresses and returns
+ * the number of mappings */
+size_t oe_test_get_mappings(oe_mapping_t* mappings, size_t count);
@@ -0,0 +1,27 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/enclave.h>
+#include <openenclave/internal/tests.h>
+#include "call_statistics_t.h"
+
+void enc_ping()
+{
+}
+
+void enc_call_host(uint64_t count)
+{
+    for (uint64_t i = 0; i < count; i++)
+    {
+        OE_TEST(host_pong() == OE_OK);
+        OE_TEST(host_pong_switchless() == OE_OK);
+    }
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,    /* ProductID */
+    1,    /* SecurityVersion */
+    true, /* Debug */
+    1024, /* NumHeapPages */
+    64,   /* NumStackPages */
+    4);   /* NumTCS */
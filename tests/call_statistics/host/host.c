@@ -0,0 +1,174 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/error.h>
+#include <openenclave/internal/tests.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "call_statistics_u.h"
+
+#define NUM_ECALLS 100000
+#define NUM_OCALLS 1000
+#define MAX_STATISTICS 256
+
+static oe_call_statistics_t _statistics[MAX_STATISTICS];
+
+void host_pong()
+{
+}
+
+void host_pong_switchless()
+{
+}
+
+static double _get_msec(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+}
+
+static size_t _get_statistics(oe_enclave_t* enclave)
+{
+    size_t count = MAX_STATISTICS;
+
+    OE_TEST(oe_get_call_statistics(enclave, _statistics, &count) == OE_OK);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const oe_call_statistics_t* entry = &_statistics[i];
+        uint64_t histogram_count = 0;
+
+        for (size_t j = 0; j < OE_CALL_STATISTICS_BUCKETS; j++)
+            histogram_count += entry->histogram[j];
+
+        OE_TEST(entry->count > 0);
+        OE_TEST(histogram_count == entry->count);
+        OE_TEST(entry->max_nsec <= entry->total_nsec);
+    }
+
+    return count;
+}
+
+/* Total number of calls of the given kind */
+static uint64_t _get_count(size_t num_statistics, oe_call_kind_t kind)
+{
+    uint64_t count = 0;
+
+    for (size_t i = 0; i < num_statistics; i++)
+    {
+        if (_statistics[i].kind == kind)
+            count += _statistics[i].count;
+    }
+
+    return count;
+}
+
+static void _test_call_statistics(oe_enclave_t* enclave)
+{
+    size_t count;
+
+    /* Nothing is recorded while disabled */
+    OE_TEST(enc_ping(enclave) == OE_OK);
+    OE_TEST(_get_statistics(enclave) == 0);
+
+    OE_TEST(oe_enable_call_statistics(enclave, true) == OE_OK);
+
+    for (size_t i = 0; i < 10; i++)
+        OE_TEST(enc_ping(enclave) == OE_OK);
+
+    OE_TEST(enc_call_host(enclave, NUM_OCALLS) == OE_OK);
+
+    count = _get_statistics(enclave);
+    OE_TEST(_get_count(count, OE_CALL_KIND_ECALL) == 11);
+
+    /* Switchless OCALLs fall back to regular OCALLs when the worker is busy */
+    OE_TEST(_get_count(count, OE_CALL_KIND_OCALL) >= NUM_OCALLS);
+    OE_TEST(
+        _get_count(count, OE_CALL_KIND_OCALL) +
+            _get_count(count, OE_CALL_KIND_SWITCHLESS_OCALL) ==
+        2 * NUM_OCALLS);
+
+    /* The array is too small */
+    count = 1;
+    OE_TEST(
+        oe_get_call_statistics(enclave, _statistics, &count) ==
+        OE_BUFFER_TOO_SMALL);
+    OE_TEST(count >= 2);
+
+    OE_TEST(oe_enable_call_statistics(enclave, false) == OE_OK);
+    OE_TEST(enc_ping(enclave) == OE_OK);
+    count = _get_statistics(enclave);
+    OE_TEST(_get_count(count, OE_CALL_KIND_ECALL) == 11);
+
+    OE_TEST(oe_reset_call_statistics(enclave) == OE_OK);
+    OE_TEST(_get_statistics(enclave) == 0);
+
+    OE_TEST(oe_get_call_statistics(NULL, NULL, &count) == OE_INVALID_PARAMETER);
+}
+
+static double _time_ecalls(oe_enclave_t* enclave)
+{
+    double start = _get_msec();
+
+    for (size_t i = 0; i < NUM_ECALLS; i++)
+        OE_TEST(enc_ping(enclave) == OE_OK);
+
+    return _get_msec() - start;
+}
+
+static void _benchmark_call_statistics(oe_enclave_t* enclave)
+{
+    double disabled_msec = _time_ecalls(enclave);
+    double enabled_msec;
+
+    OE_TEST(oe_enable_call_statistics(enclave, true) == OE_OK);
+    enabled_msec = _time_ecalls(enclave);
+    OE_TEST(oe_enable_call_statistics(enclave, false) == OE_OK);
+
+    printf(
+        "%d ECALLs: %d msecs without and %d msecs with call statistics\n",
+        NUM_ECALLS,
+        (int)disabled_msec,
+        (int)enabled_msec);
+}
+
+int main(int argc, const char* argv[])
+{
+    oe_result_t result;
+    oe_enclave_t* enclave = NULL;
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s ENCLAVE_PATH\n", argv[0]);
+        return 1;
+    }
+
+    const uint32_t flags = oe_get_create_flags();
+
+    oe_enclave_setting_context_switchless_t switchless_setting = {1, 0};
+    oe_enclave_setting_t settings[] = {
+        {.setting_type = OE_ENCLAVE_SETTING_CONTEXT_SWITCHLESS,
+         .u.context_switchless_setting = &switchless_setting}};
+
+    if ((result = oe_create_call_statistics_enclave(
+             argv[1],
+             OE_ENCLAVE_TYPE_SGX,
+             flags,
+             settings,
+             OE_COUNTOF(settings),
+             &enclave)) != OE_OK)
+        oe_put_err("oe_create_enclave(): result=%u", result);
+
+    _test_call_statistics(enclave);
+    _benchmark_call_statistics(enclave);
+
+    result = oe_terminate_enclave(enclave);
+    OE_TEST(result == OE_OK);
+
+    printf("=== passed all tests (call_statistics)\n");
+
+    return 0;
+}
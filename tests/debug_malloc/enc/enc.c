@@ -1,9 +1,12 @@
 // Copyright (c) Open Enclave SDK contributors.
 // Licensed under the MIT License.
 
+#include <openenclave/corelibc/stdlib.h>
 #include <openenclave/corelibc/string.h>
+#include <openenclave/debugmalloc.h>
 #include <openenclave/enclave.h>
 #include <openenclave/internal/print.h>
+#include <openenclave/internal/tests.h>
 #include <stdlib.h>
 #include "debug_malloc_t.h"
 
@@ -22,6 +25,46 @@ void enc_cleanup_memory()
     free(ptr);
 }
 
+void enc_allocate_memory_without_backtrace()
+{
+    uint64_t size_classes = oe_debug_malloc_backtrace_size_classes;
+    uint64_t count = 0;
+    char* report = NULL;
+
+    // Blocks of size classes without backtraces are tracked all the same.
+    oe_debug_malloc_backtrace_size_classes = 0;
+    OE_TEST(oe_debug_malloc_tracking_start() == OE_OK);
+    ptr = malloc(1024);
+    OE_TEST(oe_debug_malloc_tracking_stop() == OE_OK);
+    oe_debug_malloc_backtrace_size_classes = size_classes;
+
+    OE_TEST(oe_debug_malloc_tracking_report(&count, &report) == OE_OK);
+    OE_TEST(count == 1);
+    free(report);
+}
+
+void enc_copy_buffer(const void* input, void* output, size_t size)
+{
+    memcpy(output, input, size);
+}
+
+void enc_use_host_memory_pool()
+{
+    const size_t sizes[] = {64, 4096, 65536};
+    void* blocks[16];
+
+    // Blocks of the pool of host memory are cached by the thread, and the
+    // pool keeps its bookkeeping in enclave memory.
+    for (size_t i = 0; i < OE_COUNTOF(sizes); i++)
+    {
+        for (size_t j = 0; j < OE_COUNTOF(blocks); j++)
+            OE_TEST((blocks[j] = oe_host_malloc(sizes[i])) != NULL);
+
+        for (size_t j = 0; j < OE_COUNTOF(blocks); j++)
+            oe_host_free(blocks[j]);
+    }
+}
+
 OE_SET_ENCLAVE_SGX(
     1,    /* ProductID */
     1,    /* SecurityVersion */
@@ -7,6 +7,7 @@
 #include <openenclave/internal/tests.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "debug_malloc_u.h"
 
 int main(int argc, const char* argv[])
@@ -47,6 +48,69 @@ int main(int argc, const char* argv[])
         // No leaks will be reported.
         OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
     }
+    {
+        // Create enclave, allocate memory without a backtrace, and do not
+        // free it.
+        if ((result = oe_create_debug_malloc_enclave(
+                 argv[1], OE_ENCLAVE_TYPE_SGX, flags, NULL, 0, &enclave)) !=
+            OE_OK)
+            oe_put_err("oe_create_enclave(): result=%u", result);
+
+        OE_TEST(enc_allocate_memory_without_backtrace(enclave) == OE_OK);
+
+        // Unfreed memory will be reported as a leak.
+        OE_TEST(oe_terminate_enclave(enclave) == OE_MEMORY_LEAK);
+    }
+    {
+        // Create enclave and make ECALLs whose parameters are marshaled into
+        // enclave memory.
+        const size_t size = 64 * 1024;
+        uint8_t* input = (uint8_t*)malloc(size);
+        uint8_t* output = (uint8_t*)malloc(size);
+
+        OE_TEST(input && output);
+
+        for (size_t i = 0; i < size; i++)
+            input[i] = (uint8_t)i;
+
+        if ((result = oe_create_debug_malloc_enclave(
+                 argv[1], OE_ENCLAVE_TYPE_SGX, flags, NULL, 0, &enclave)) !=
+            OE_OK)
+            oe_put_err("oe_create_enclave(): result=%u", result);
+
+        for (size_t n = 1; n <= size; n *= 4)
+        {
+            memset(output, 0, size);
+            OE_TEST(enc_copy_buffer(enclave, input, output, n) == OE_OK);
+            OE_TEST(memcmp(input, output, n) == 0);
+        }
+
+        // The marshaling buffers are not reported as leaks.
+        OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+
+        free(input);
+        free(output);
+    }
+    {
+        // Create enclave whose oe_host_malloc() allocates from the pool of
+        // host memory.
+        oe_enclave_setting_host_memory_pool_t pool = {32 * 1024 * 1024, true};
+        oe_enclave_setting_t setting;
+
+        setting.setting_type = OE_ENCLAVE_SETTING_HOST_MEMORY_POOL;
+        setting.u.host_memory_pool_setting = &pool;
+
+        if ((result = oe_create_debug_malloc_enclave(
+                 argv[1], OE_ENCLAVE_TYPE_SGX, flags, &setting, 1, &enclave)) !=
+            OE_OK)
+            oe_put_err("oe_create_enclave(): result=%u", result);
+
+        OE_TEST(enc_use_host_memory_pool(enclave) == OE_OK);
+        OE_TEST(enc_use_host_memory_pool(enclave) == OE_OK);
+
+        // The bookkeeping of the pool is not reported as a leak.
+        OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+    }
     printf("=== passed all tests (debug_malloc)\n");
 
     return 0;
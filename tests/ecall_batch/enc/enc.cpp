@@ -0,0 +1,41 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/enclave.h>
+#include "ecall_batch_t.h"
+
+static uint64_t _count;
+
+void enc_increment()
+{
+    __atomic_add_fetch(&_count, 1, __ATOMIC_SEQ_CST);
+}
+
+uint64_t enc_get_count()
+{
+    return __atomic_load_n(&_count, __ATOMIC_SEQ_CST);
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,    /* ProductID */
+    1,    /* SecurityVersion */
+    true, /* Debug */
+    128,  /* NumHeapPages */
+    16,   /* NumStackPages */
+    1);   /* NumTCS */
+
+#define TA_UUID                                            \
+    { /* a4e8b3c1-0f62-4d7e-9c15-2b7d6e8f1a40 */           \
+        0xa4e8b3c1, 0x0f62, 0x4d7e,                        \
+        {                                                  \
+            0x9c, 0x15, 0x2b, 0x7d, 0x6e, 0x8f, 0x1a, 0x40 \
+        }                                                  \
+    }
+
+OE_SET_ENCLAVE_OPTEE(
+    TA_UUID,
+    1 * 1024 * 1024,
+    64 * 1024,
+    0,
+    "1.0.0",
+    "ECALL batch test")
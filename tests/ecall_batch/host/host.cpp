@@ -0,0 +1,126 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/edger8r/host.h>
+#include <openenclave/host.h>
+#include <openenclave/internal/error.h>
+#include <openenclave/internal/tests.h>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "ecall_batch_args.h"
+#include "ecall_batch_u.h"
+
+/* Marshaling buffer of enc_increment(), which has neither parameters nor a
+ * return value. Its size must be a multiple of OE_EDGER8R_BUFFER_ALIGNMENT */
+typedef struct _increment_buffer
+{
+    enc_increment_args_t args;
+} OE_ALIGNED(OE_EDGER8R_BUFFER_ALIGNMENT) increment_buffer_t;
+
+static uint64_t _increment_global_id = OE_GLOBAL_ECALL_ID_NULL;
+
+static void _init_calls(
+    std::vector<oe_enclave_function_call_t>& calls,
+    std::vector<increment_buffer_t>& inputs,
+    std::vector<increment_buffer_t>& outputs)
+{
+    for (size_t i = 0; i < calls.size(); i++)
+    {
+        oe_enclave_function_call_t& call = calls[i];
+
+        call.global_id = &_increment_global_id;
+        call.name = "enc_increment";
+        call.input_buffer = &inputs[i];
+        call.input_buffer_size = sizeof(increment_buffer_t);
+        call.output_buffer = &outputs[i];
+        call.output_buffer_size = sizeof(increment_buffer_t);
+        call.output_bytes_written = 0;
+        call.result = OE_UNEXPECTED;
+    }
+}
+
+static uint64_t _get_count(oe_enclave_t* enclave)
+{
+    uint64_t count = 0;
+    OE_TEST(enc_get_count(enclave, &count) == OE_OK);
+    return count;
+}
+
+static void _test_batch(oe_enclave_t* enclave)
+{
+    const size_t batch_size = 16;
+    std::vector<oe_enclave_function_call_t> calls(batch_size);
+    std::vector<increment_buffer_t> inputs(batch_size);
+    std::vector<increment_buffer_t> outputs(batch_size);
+    uint64_t global_id = OE_GLOBAL_ECALL_ID_NULL;
+    uint64_t count = _get_count(enclave);
+
+    _init_calls(calls, inputs, outputs);
+
+    OE_TEST(
+        oe_call_enclave_function_batch(enclave, calls.data(), batch_size) ==
+        OE_OK);
+
+    for (size_t i = 0; i < batch_size; i++)
+        OE_TEST(calls[i].result == OE_OK);
+
+    OE_TEST(_get_count(enclave) == count + batch_size);
+
+    /* A failing call does not affect the other calls of the batch */
+    calls[3].name = "enc_does_not_exist";
+    calls[3].global_id = &global_id;
+    calls[7].input_buffer_size = 0;
+
+    OE_TEST(
+        oe_call_enclave_function_batch(enclave, calls.data(), batch_size) ==
+        OE_OK);
+
+    for (size_t i = 0; i < batch_size; i++)
+    {
+        if (i == 3)
+            OE_TEST(calls[i].result == OE_NOT_FOUND);
+        else if (i == 7)
+            OE_TEST(calls[i].result == OE_INVALID_PARAMETER);
+        else
+            OE_TEST(calls[i].result == OE_OK);
+    }
+
+    OE_TEST(_get_count(enclave) == count + 2 * batch_size - 2);
+
+    OE_TEST(
+        oe_call_enclave_function_batch(enclave, NULL, batch_size) ==
+        OE_INVALID_PARAMETER);
+    OE_TEST(
+        oe_call_enclave_function_batch(enclave, calls.data(), 0) ==
+        OE_INVALID_PARAMETER);
+}
+
+int main(int argc, const char* argv[])
+{
+    oe_result_t result;
+    oe_enclave_t* enclave = NULL;
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s ENCLAVE\n", argv[0]);
+        exit(1);
+    }
+
+    const uint32_t flags = oe_get_create_flags();
+
+    result = oe_create_ecall_batch_enclave(
+        argv[1], OE_ENCLAVE_TYPE_SGX, flags, NULL, 0, &enclave);
+    if (result != OE_OK)
+        oe_put_err("oe_create_ecall_batch_enclave(): result=%u", result);
+
+    _test_batch(enclave);
+
+    result = oe_terminate_enclave(enclave);
+    if (result != OE_OK)
+        oe_put_err("oe_terminate_enclave(): result=%u", result);
+
+    printf("=== passed all tests (ecall_batch)\n");
+
+    return 0;
+}
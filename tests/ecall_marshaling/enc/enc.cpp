@@ -0,0 +1,56 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/enclave.h>
+#include "ecall_marshaling_t.h"
+
+uint64_t enc_read_buffer(const void* buffer, size_t size)
+{
+    const uint8_t* bytes = (const uint8_t*)buffer;
+    uint64_t sum = 0;
+
+    for (size_t i = 0; i < size; i++)
+        sum += bytes[i];
+
+    return sum;
+}
+
+bool enc_write_buffer(void* buffer, size_t size, uint8_t seed)
+{
+    uint8_t* bytes = (uint8_t*)buffer;
+    bool zeroed = true;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        if (bytes[i] != 0)
+            zeroed = false;
+
+        bytes[i] = (uint8_t)(seed + i);
+    }
+
+    return zeroed;
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,    /* ProductID */
+    1,    /* SecurityVersion */
+    true, /* Debug */
+    2048, /* NumHeapPages */
+    16,   /* NumStackPages */
+    2);   /* NumTCS */
+
+#define TA_UUID                                            \
+    { /* 5d1c2f7a-93b4-4e0d-b8a1-6c2e4f0a9d37 */           \
+        0x5d1c2f7a, 0x93b4, 0x4e0d,                        \
+        {                                                  \
+            0xb8, 0xa1, 0x6c, 0x2e, 0x4f, 0x0a, 0x9d, 0x37 \
+        }                                                  \
+    }
+
+OE_SET_ENCLAVE_OPTEE(
+    TA_UUID,
+    8 * 1024 * 1024,
+    64 * 1024,
+    0,
+    "1.0.0",
+    "ECALL marshaling test")
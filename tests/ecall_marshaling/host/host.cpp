@@ -0,0 +1,78 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/error.h>
+#include <openenclave/internal/tests.h>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "ecall_marshaling_u.h"
+
+// Sizes below, at and above the largest buffer that is cached
+static const size_t _payload_sizes[] = {4 * 1024, 64 * 1024, 1024 * 1024};
+
+static void _test_marshaling(oe_enclave_t* enclave)
+{
+    // Alternate between sizes so that the cached marshaling buffer of the
+    // enclave thread is both reused and grown.
+    for (size_t round = 0; round < 3; round++)
+    {
+        for (size_t size : _payload_sizes)
+        {
+            std::vector<uint8_t> buffer(size);
+            uint64_t expected = 0;
+            uint64_t sum = 0;
+            bool zeroed = false;
+            uint8_t seed = (uint8_t)(round + 1);
+
+            for (size_t i = 0; i < size; i++)
+            {
+                buffer[i] = (uint8_t)(i * 7);
+                expected += buffer[i];
+            }
+
+            OE_TEST(
+                enc_read_buffer(enclave, &sum, buffer.data(), size) == OE_OK);
+            OE_TEST(sum == expected);
+
+            // The output buffer must never expose data of previous ECALLs.
+            OE_TEST(
+                enc_write_buffer(
+                    enclave, &zeroed, buffer.data(), size, seed) == OE_OK);
+            OE_TEST(zeroed);
+
+            for (size_t i = 0; i < size; i++)
+                OE_TEST(buffer[i] == (uint8_t)(seed + i));
+        }
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    oe_result_t result;
+    oe_enclave_t* enclave = NULL;
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s ENCLAVE\n", argv[0]);
+        exit(1);
+    }
+
+    const uint32_t flags = oe_get_create_flags();
+
+    result = oe_create_ecall_marshaling_enclave(
+        argv[1], OE_ENCLAVE_TYPE_SGX, flags, NULL, 0, &enclave);
+    if (result != OE_OK)
+        oe_put_err("oe_create_ecall_marshaling_enclave(): result=%u", result);
+
+    _test_marshaling(enclave);
+
+    result = oe_terminate_enclave(enclave);
+    if (result != OE_OK)
+        oe_put_err("oe_terminate_enclave(): result=%u", result);
+
+    printf("=== passed all tests (ecall_marshaling)\n");
+
+    return 0;
+}
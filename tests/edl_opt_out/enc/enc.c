@@ -51,6 +51,7 @@ void enc_edl_opt_out()
     /* sgx/switchless.edl */
     OE_TEST(oe_sgx_sleep_switchless_worker_ocall(NULL) == OE_UNSUPPORTED);
     OE_TEST(oe_sgx_wake_switchless_worker_ocall(NULL) == OE_UNSUPPORTED);
+    OE_TEST(oe_sgx_wait_switchless_ocall_ocall(NULL, NULL) == OE_UNSUPPORTED);
 
     /* sgx/attestation */
     {
@@ -66,12 +66,12 @@ int main(int argc, const char* argv[])
     /* sgx/switchless.edl */
     result = OE_OK;
     OE_TEST(
-        oe_sgx_init_context_switchless_ecall(NULL, &result, NULL, 0) ==
-        OE_UNSUPPORTED);
+        oe_sgx_init_context_switchless_ecall(
+            NULL, &result, NULL, 0, NULL, 0, NULL, 0) == OE_UNSUPPORTED);
     OE_TEST(result == OE_UNSUPPORTED);
     OE_TEST(
-        oe_sgx_switchless_enclave_worker_thread_ecall(NULL, NULL) ==
-        OE_UNSUPPORTED);
+        oe_sgx_switchless_enclave_worker_thread_ecall(
+            NULL, NULL, NULL, 0, 0) == OE_UNSUPPORTED);
 #endif
 
     result = oe_terminate_enclave(enclave);
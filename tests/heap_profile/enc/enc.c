@@ -0,0 +1,68 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/advanced/heapprofile.h>
+#include <openenclave/enclave.h>
+#include <openenclave/internal/tests.h>
+#include <stdlib.h>
+#include <string.h>
+#include "heap_profile_t.h"
+
+#define MAX_BLOCKS 256
+
+static void* _blocks[MAX_BLOCKS];
+static size_t _num_blocks;
+
+oe_result_t enc_heap_profile_start(uint64_t sampling_interval)
+{
+    return oe_heap_profile_start(sampling_interval);
+}
+
+oe_result_t enc_heap_profile_stop(void)
+{
+    return oe_heap_profile_stop();
+}
+
+/* Keep the allocation site in its own frame, so that it shows up as the
+ * innermost address of the sampled stacks */
+OE_NEVER_INLINE static void* _allocate(size_t size)
+{
+    void* p = malloc(size);
+
+    if (p)
+        memset(p, 0xAB, size);
+
+    return p;
+}
+
+oe_result_t enc_allocate(uint64_t num_blocks, uint64_t block_size)
+{
+    if (_num_blocks + num_blocks > MAX_BLOCKS)
+        return OE_INVALID_PARAMETER;
+
+    for (uint64_t i = 0; i < num_blocks; i++)
+    {
+        if (!(_blocks[_num_blocks] = _allocate(block_size)))
+            return OE_OUT_OF_MEMORY;
+
+        _num_blocks++;
+    }
+
+    return OE_OK;
+}
+
+void enc_free(void)
+{
+    for (size_t i = 0; i < _num_blocks; i++)
+        free(_blocks[i]);
+
+    _num_blocks = 0;
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,    /* ProductID */
+    1,    /* SecurityVersion */
+    true, /* Debug */
+    1024, /* NumHeapPages */
+    64,   /* NumStackPages */
+    2);   /* NumTCS */
@@ -0,0 +1,135 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/error.h>
+#include <openenclave/internal/tests.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "heap_profile_u.h"
+
+/* Each block is many times the sampling interval, so that every block is
+ * sampled */
+#define SAMPLING_INTERVAL 1024
+#define NUM_BLOCKS 128
+#define BLOCK_SIZE (16 * 1024)
+
+typedef struct _header
+{
+    unsigned long long num_live;
+    unsigned long long live_bytes;
+    unsigned long long num_sampled;
+    unsigned long long sampled_bytes;
+    unsigned long long sampling_interval;
+} header_t;
+
+/* Gets the profile of the enclave and checks its layout */
+static void _get_profile(
+    oe_enclave_t* enclave,
+    const char* enclave_path,
+    header_t* header)
+{
+    char* profile = NULL;
+    size_t profile_size = 0;
+    const char* maps;
+
+    OE_TEST(oe_get_heap_profile(enclave, &profile, &profile_size) == OE_OK);
+    OE_TEST(profile != NULL);
+    OE_TEST(strlen(profile) == profile_size);
+
+    OE_TEST(
+        sscanf(
+            profile,
+            "heap profile: %llu: %llu [%llu: %llu] @ heap_v2/%llu",
+            &header->num_live,
+            &header->live_bytes,
+            &header->num_sampled,
+            &header->sampled_bytes,
+            &header->sampling_interval) == 5);
+
+    /* The enclave image is mapped behind the stacks */
+    OE_TEST((maps = strstr(profile, "\nMAPPED_LIBRARIES:\n")) != NULL);
+    OE_TEST(strstr(maps, enclave_path) != NULL);
+
+    oe_free_heap_profile(profile);
+}
+
+int main(int argc, const char* argv[])
+{
+    oe_result_t result;
+    oe_enclave_t* enclave = NULL;
+    char* profile = NULL;
+    size_t profile_size = 0;
+    header_t header;
+    unsigned long long num_sampled;
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s ENCLAVE_PATH\n", argv[0]);
+        return 1;
+    }
+
+    if ((result = oe_create_heap_profile_enclave(
+             argv[1],
+             OE_ENCLAVE_TYPE_SGX,
+             oe_get_create_flags(),
+             NULL,
+             0,
+             &enclave)) != OE_OK)
+        oe_put_err("oe_create_heap_profile_enclave(): result=%u", result);
+
+    /* The host cannot read a profile that the enclave has not started */
+    OE_TEST(
+        oe_get_heap_profile(enclave, &profile, &profile_size) == OE_NOT_FOUND);
+    OE_TEST(profile == NULL);
+    OE_TEST(
+        oe_get_heap_profile(enclave, NULL, &profile_size) ==
+        OE_INVALID_PARAMETER);
+    OE_TEST(enc_heap_profile_stop(enclave, &result) == OE_OK);
+    OE_TEST(result == OE_NOT_FOUND);
+
+    OE_TEST(enc_heap_profile_start(enclave, &result, 1ull << 40) == OE_OK);
+    OE_TEST(result == OE_INVALID_PARAMETER);
+
+    OE_TEST(
+        enc_heap_profile_start(enclave, &result, SAMPLING_INTERVAL) == OE_OK);
+    OE_TEST(result == OE_OK);
+
+    /* Live blocks are in the profile */
+    OE_TEST(enc_allocate(enclave, &result, NUM_BLOCKS, BLOCK_SIZE) == OE_OK);
+    OE_TEST(result == OE_OK);
+
+    _get_profile(enclave, argv[1], &header);
+    OE_TEST(header.sampling_interval == SAMPLING_INTERVAL);
+    OE_TEST(header.num_live >= NUM_BLOCKS);
+    OE_TEST(header.live_bytes >= NUM_BLOCKS * BLOCK_SIZE);
+    OE_TEST(header.num_sampled >= header.num_live);
+    OE_TEST(header.sampled_bytes >= header.live_bytes);
+
+    /* Freed blocks leave the live samples but stay in the totals */
+    OE_TEST(enc_free(enclave) == OE_OK);
+
+    _get_profile(enclave, argv[1], &header);
+    OE_TEST(header.live_bytes < NUM_BLOCKS * BLOCK_SIZE);
+    OE_TEST(header.sampled_bytes >= NUM_BLOCKS * BLOCK_SIZE);
+
+    /* No more samples are recorded once the profiler is stopped */
+    OE_TEST(enc_heap_profile_stop(enclave, &result) == OE_OK);
+    OE_TEST(result == OE_OK);
+
+    num_sampled = header.num_sampled;
+
+    OE_TEST(enc_allocate(enclave, &result, NUM_BLOCKS, BLOCK_SIZE) == OE_OK);
+    OE_TEST(result == OE_OK);
+    OE_TEST(enc_free(enclave) == OE_OK);
+
+    _get_profile(enclave, argv[1], &header);
+    OE_TEST(header.num_sampled == num_sampled);
+
+    OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+
+    printf("=== passed all tests (heap_profile)\n");
+
+    return 0;
+}
@@ -4,6 +4,7 @@
 #include <openenclave/corelibc/string.h>
 #include <openenclave/enclave.h>
 #include <openenclave/internal/tests.h>
+#include <stdlib.h>
 #include "hostcalls_t.h"
 
 void test_host_malloc(size_t in_size, void_ptr* out_ptr)
@@ -71,6 +72,47 @@ void test_host_free(void_ptr in_ptr)
     oe_host_free(in_ptr);
 }
 
+/* Allocates num_blocks blocks of host memory at once, which may come from
+ * the pool of host memory or from the host's heap, and checks that they do
+ * not overlap and keep their contents when they grow. */
+void test_host_memory_pool(size_t block_size, size_t num_blocks)
+{
+    uint8_t** blocks = (uint8_t**)calloc(num_blocks, sizeof(uint8_t*));
+
+    OE_TEST(blocks != NULL);
+
+    for (size_t i = 0; i < num_blocks; i++)
+    {
+        blocks[i] = (uint8_t*)oe_host_malloc(block_size);
+        OE_TEST(blocks[i] != NULL);
+        OE_TEST(oe_is_outside_enclave(blocks[i], block_size));
+        OE_TEST(((uint64_t)blocks[i] % 8) == 0);
+        memset(blocks[i], (int)(i & 0xff), block_size);
+    }
+
+    for (size_t i = 0; i < num_blocks; i++)
+    {
+        for (size_t j = 0; j < block_size; j++)
+            OE_TEST(blocks[i][j] == (uint8_t)(i & 0xff));
+
+        blocks[i] = (uint8_t*)oe_host_realloc(blocks[i], 2 * block_size + 1);
+        OE_TEST(blocks[i] != NULL);
+        OE_TEST(oe_is_outside_enclave(blocks[i], 2 * block_size + 1));
+
+        for (size_t j = 0; j < block_size; j++)
+            OE_TEST(blocks[i][j] == (uint8_t)(i & 0xff));
+    }
+
+    /* Free in a different order than allocated */
+    for (size_t i = 0; i < num_blocks; i += 2)
+        oe_host_free(blocks[i]);
+
+    for (size_t i = 1; i < num_blocks; i += 2)
+        oe_host_free(blocks[i]);
+
+    free(blocks);
+}
+
 OE_SET_ENCLAVE_SGX(
     1,    /* ProductID */
     1,    /* SecurityVersion */
@@ -181,6 +181,63 @@ static void _test_host_strndup(oe_enclave_t* enclave)
     OE_TEST(test_host_free(enclave, out_str) == OE_OK);
 }
 
+static oe_enclave_t* _create_enclave(
+    const char* path,
+    const oe_enclave_setting_host_memory_pool_t* pool_setting)
+{
+    oe_result_t result;
+    oe_enclave_t* enclave = NULL;
+    oe_enclave_setting_t setting;
+
+    setting.setting_type = OE_ENCLAVE_SETTING_HOST_MEMORY_POOL;
+    setting.u.host_memory_pool_setting = pool_setting;
+
+    if ((result = oe_create_hostcalls_enclave(
+             path,
+             OE_ENCLAVE_TYPE_SGX,
+             oe_get_create_flags(),
+             pool_setting ? &setting : NULL,
+             pool_setting ? 1 : 0,
+             &enclave)) != OE_OK)
+        oe_put_err("oe_create_enclave(): result=%u", result);
+
+    return enclave;
+}
+
+static void _test_host_memory_pool(const char* path)
+{
+    const size_t block_sizes[] = {1, 64, 100, 4096, 65536, 300000};
+    oe_enclave_setting_host_memory_pool_t pool = {32 * 1024 * 1024, true};
+    oe_enclave_setting_host_memory_pool_t small_pool = {1024 * 1024, true};
+    oe_enclave_setting_host_memory_pool_t no_pool = {0, true};
+    oe_enclave_t* enclave;
+
+    /* Blocks of the pool, and too large for it */
+    enclave = _create_enclave(path, &pool);
+
+    for (size_t size : block_sizes)
+        OE_TEST(test_host_memory_pool(enclave, size, 16) == OE_OK);
+
+    OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+
+    /* Exhaust a small pool, after which blocks come from the host's heap */
+    enclave = _create_enclave(path, &small_pool);
+    OE_TEST(test_host_memory_pool(enclave, 65536, 64) == OE_OK);
+    OE_TEST(test_host_memory_pool(enclave, 64, 8192) == OE_OK);
+    OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+
+    /* Without a pool, all blocks come from the host's heap */
+    enclave = _create_enclave(path, &no_pool);
+    OE_TEST(test_host_memory_pool(enclave, 64, 64) == OE_OK);
+    OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+
+    /* A pool that is too small to hold a single chunk is not used */
+    small_pool.size = 4096;
+    enclave = _create_enclave(path, &small_pool);
+    OE_TEST(test_host_memory_pool(enclave, 64, 64) == OE_OK);
+    OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+}
+
 int main(int argc, const char* argv[])
 {
     oe_result_t result;
@@ -205,6 +262,8 @@ int main(int argc, const char* argv[])
 
     oe_terminate_enclave(enclave);
 
+    _test_host_memory_pool(argv[1]);
+
     printf("=== passed all tests (%s)\n", argv[0]);
 
     return 0;
@@ -5,6 +5,7 @@
 #include <openenclave/internal/tests.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/mman.h>
 #include "../../../libc/mman.h"
 #include "mman_t.h"
@@ -12,6 +13,17 @@
 
 const uint64_t chunk_size = 1024;
 
+#define MAX_MAPPINGS 16
+
+static oe_mapping_t _mappings[MAX_MAPPINGS];
+
+static size_t _get_mappings(void)
+{
+    size_t n = oe_test_get_mappings(_mappings, MAX_MAPPINGS);
+    OE_TEST(n <= MAX_MAPPINGS);
+    return n;
+}
+
 static void _test_basic()
 {
     // Test whether memory can be mmaped and unmapped.
@@ -29,9 +41,13 @@ static void _test_basic()
     for (uint64_t i = 0; i < chunk_size; ++i)
         OE_TEST(ptr[i] == 0);
 
+    OE_TEST(_get_mappings() == 1);
+    OE_TEST(_mappings[0].start == (uint64_t)ptr);
+    OE_TEST(_mappings[0].end == (uint64_t)ptr + OE_PAGE_SIZE);
+
     OE_TEST(munmap(ptr, chunk_size) == 0);
     OE_TEST(errno == 0);
-    OE_TEST(oe_test_get_mappings() == NULL);
+    OE_TEST(_get_mappings() == 0);
 }
 
 static void _test_partial_unmapping(void)
@@ -46,9 +62,9 @@ static void _test_partial_unmapping(void)
         0);
     uint64_t p1_end = p1_start + p1_length;
 
-    oe_mapping_t* m = oe_test_get_mappings();
-    OE_TEST(m->start == p1_start);
-    OE_TEST(m->end == p1_end);
+    OE_TEST(_get_mappings() == 1);
+    OE_TEST(_mappings[0].start == p1_start);
+    OE_TEST(_mappings[0].end == p1_end);
 
     uint64_t p2_length = 3 * OE_PAGE_SIZE;
     uint64_t p2_start = (uint64_t)mmap(
@@ -59,12 +75,9 @@ static void _test_partial_unmapping(void)
         -1,
         0);
     uint64_t p2_end = p2_start + p2_length;
-    m = oe_test_get_mappings();
-    OE_TEST(m->start == p2_start);
-    OE_TEST(m->end == p2_end);
+    OE_TEST(_get_mappings() == 2);
 
     // Swap p1 and p2 if p2 lies before p1.
-    bool swapped = false;
     if (p2_start < p1_start)
     {
         uint64_t t = p1_start;
@@ -74,62 +87,42 @@ static void _test_partial_unmapping(void)
         t = p1_end;
         p1_end = p2_end;
         p2_end = t;
-        swapped = true;
     }
 
-    // Do an unmap that starts within p1 and ends within p2.
+    // Mappings are listed in the order of their addresses.
+    OE_TEST(_mappings[0].start == p1_start);
+    OE_TEST(_mappings[0].end == p1_end);
+    OE_TEST(_mappings[1].start == p2_start);
+    OE_TEST(_mappings[1].end == p2_end);
+
+    // Do an unmap that starts within p1 and ends within p2. Partial
+    // unmapping trims the mappings.
     uint64_t start = p1_end - OE_PAGE_SIZE;
     uint64_t end = p2_end - OE_PAGE_SIZE;
     OE_TEST(munmap((void*)start, end - start) == 0);
     OE_TEST(errno == 0);
-
-    // Partial unmapping only changes the status vectors and not the bounds.
-    m = oe_test_get_mappings();
-    if (swapped)
-    {
-        OE_TEST(m->start == p1_start);
-        OE_TEST(m->end == p1_end);
-        m = m->next;
-        OE_TEST(m->start == p2_start);
-        OE_TEST(m->end == p2_end);
-    }
-    else
-    {
-        OE_TEST(m->start == p2_start);
-        OE_TEST(m->end == p2_end);
-        m = m->next;
-        OE_TEST(m->start == p1_start);
-        OE_TEST(m->end == p1_end);
-    }
+    OE_TEST(_get_mappings() == 2);
+    OE_TEST(_mappings[0].start == p1_start);
+    OE_TEST(_mappings[0].end == start);
+    OE_TEST(_mappings[1].start == end);
+    OE_TEST(_mappings[1].end == p2_end);
 
     // Do another partial unmap.
     start -= OE_PAGE_SIZE;
     OE_TEST(munmap((void*)start, end - start) == 0);
     OE_TEST(errno == 0);
-    m = oe_test_get_mappings();
-    if (swapped)
-    {
-        OE_TEST(m->start == p1_start);
-        OE_TEST(m->end == p1_end);
-        m = m->next;
-        OE_TEST(m->start == p2_start);
-        OE_TEST(m->end == p2_end);
-    }
-    else
-    {
-        OE_TEST(m->start == p2_start);
-        OE_TEST(m->end == p2_end);
-        m = m->next;
-        OE_TEST(m->start == p1_start);
-        OE_TEST(m->end == p1_end);
-    }
+    OE_TEST(_get_mappings() == 2);
+    OE_TEST(_mappings[0].start == p1_start);
+    OE_TEST(_mappings[0].end == start);
+    OE_TEST(_mappings[1].start == end);
+    OE_TEST(_mappings[1].end == p2_end);
 
     // Do an unmap till the start.
     // This ought to delete one mapping completely.
     OE_TEST(munmap((void*)OE_PAGE_SIZE, start - OE_PAGE_SIZE) == 0);
     OE_TEST(errno == 0);
-    m = oe_test_get_mappings();
-    OE_TEST(m->next == NULL);
+    OE_TEST(_get_mappings() == 1);
+    OE_TEST(_mappings[0].start == end);
 
     // Do another unmapping that spans entire enclave memory.
     // This ought to get rid of all mappings.
@@ -142,19 +135,59 @@ static void _test_partial_unmapping(void)
     }
     OE_TEST(munmap(0, (1L << 62)) == 0);
     OE_TEST(errno == 0);
-    OE_TEST(oe_test_get_mappings() == NULL);
+    OE_TEST(_get_mappings() == 0);
 
-    // Test unmapping a mapping in small chunks.
+    // Test unmapping a mapping in small chunks. Unmapping the middle page
+    // splits the mapping in two.
     start = (uint64_t)mmap(
         NULL, 3 * OE_PAGE_SIZE, PROT_READ, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
-    OE_TEST(oe_test_get_mappings() != NULL);
+    OE_TEST(_get_mappings() == 1);
 
     OE_TEST(munmap((void*)(start + OE_PAGE_SIZE), 1) == 0);
-    OE_TEST(oe_test_get_mappings() != NULL);
+    OE_TEST(_get_mappings() == 2);
+    OE_TEST(_mappings[0].start == start);
+    OE_TEST(_mappings[0].end == start + OE_PAGE_SIZE);
+    OE_TEST(_mappings[1].start == start + 2 * OE_PAGE_SIZE);
+    OE_TEST(_mappings[1].end == start + 3 * OE_PAGE_SIZE);
     OE_TEST(munmap((void*)(start + 2 * OE_PAGE_SIZE), 1) == 0);
-    OE_TEST(oe_test_get_mappings() != NULL);
+    OE_TEST(_get_mappings() == 1);
     OE_TEST(munmap((void*)start, 1) == 0);
-    OE_TEST(oe_test_get_mappings() == NULL);
+    OE_TEST(_get_mappings() == 0);
+}
+
+static void _test_page_reuse(void)
+{
+    const size_t length = 2 * OE_PAGE_SIZE;
+    const int flags = MAP_ANONYMOUS | MAP_PRIVATE;
+    const int prot = PROT_READ | PROT_WRITE;
+    uint8_t* p1 = (uint8_t*)mmap(NULL, length, prot, flags, -1, 0);
+    uint8_t* p2 = (uint8_t*)mmap(NULL, length, prot, flags, -1, 0);
+    uint8_t* p3;
+
+    OE_TEST(p1 != MAP_FAILED && p2 != MAP_FAILED);
+    memset(p1, 0xAB, length);
+    memset(p2, 0xCD, length);
+
+    // Unmapped pages are reused, and zeroed again.
+    OE_TEST(munmap(p1, length) == 0);
+    p3 = (uint8_t*)mmap(NULL, length, prot, flags, -1, 0);
+    OE_TEST(p3 == p1);
+
+    for (size_t i = 0; i < length; ++i)
+        OE_TEST(p3[i] == 0);
+
+    // Adjacent free pages are coalesced, so a mapping of both fits there.
+    OE_TEST(munmap(p3, length) == 0);
+    OE_TEST(munmap(p2, length) == 0);
+
+    if (p2 == p1 + length)
+    {
+        p3 = (uint8_t*)mmap(NULL, 2 * length, prot, flags, -1, 0);
+        OE_TEST(p3 == p1);
+        OE_TEST(munmap(p3, 2 * length) == 0);
+    }
+
+    OE_TEST(_get_mappings() == 0);
 }
 
 static void _test_mmap_params(void)
@@ -368,6 +401,7 @@ int enc_main()
 {
     _test_basic();
     _test_partial_unmapping();
+    _test_page_reuse();
     _test_mmap_params();
     _test_unmap_params();
     return 0;
@@ -8,8 +8,10 @@
 #include <openenclave/internal/calls.h>
 #include <openenclave/internal/fault.h>
 #include <openenclave/internal/globals.h>
+#include <openenclave/internal/sgx/ecall_context.h>
 #include <openenclave/internal/tests.h>
 #include <openenclave/internal/thread.h>
+#include <stdlib.h>
 #include "ocall_t.h"
 
 uint64_t enc_test2(uint64_t val)
@@ -96,6 +98,35 @@ void enc_test_reentrancy()
     OE_TEST(OE_OK == result);
 }
 
+void enc_test_large_ocalls(size_t size, size_t count, bool expect_growth)
+{
+    uint8_t* buffer = (uint8_t*)malloc(size);
+    uint64_t expected = 0;
+
+    OE_TEST(buffer != NULL);
+
+    for (size_t i = 0; i < size; i++)
+    {
+        buffer[i] = (uint8_t)i;
+        expected += buffer[i];
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t sum = 0;
+        OE_TEST(host_large_ocall(&sum, buffer, size) == OE_OK);
+        OE_TEST(sum == expected);
+
+        /* The host grows the ocall buffer during the first large ocall, so
+         * that subsequent ones are marshaled into it directly */
+        OE_TEST(
+            (oe_ecall_context_get_ocall_buffer(size) != NULL) ==
+            expect_growth);
+    }
+
+    free(buffer);
+}
+
 OE_SET_ENCLAVE_SGX(
     1,    /* ProductID */
     1,    /* SecurityVersion */
@@ -32,6 +32,40 @@ void host_test_reentrancy()
     g_reentrancy_tested = true;
 }
 
+uint64_t host_large_ocall(const void* buffer, size_t size)
+{
+    const uint8_t* bytes = (const uint8_t*)buffer;
+    uint64_t sum = 0;
+
+    for (size_t i = 0; i < size; i++)
+        sum += bytes[i];
+
+    return sum;
+}
+
+static void _test_ocall_buffer_limit(const char* path, uint32_t flags)
+{
+    oe_enclave_t* enclave = NULL;
+    oe_enclave_setting_ocall_buffer_t ocall_buffer_setting = {64 * 1024};
+    oe_enclave_setting_t setting;
+
+    setting.setting_type = OE_ENCLAVE_SETTING_OCALL_BUFFER;
+    setting.u.ocall_buffer_setting = &ocall_buffer_setting;
+
+    OE_TEST(
+        oe_create_ocall_enclave(
+            path, OE_ENCLAVE_TYPE_SGX, flags, &setting, 1, &enclave) ==
+        OE_OK);
+
+    /* Ocalls within the limit grow the buffer */
+    OE_TEST(enc_test_large_ocalls(enclave, 48 * 1024, 4, true) == OE_OK);
+
+    /* Ocalls beyond the limit keep allocating their own buffers */
+    OE_TEST(enc_test_large_ocalls(enclave, 256 * 1024, 4, false) == OE_OK);
+
+    oe_terminate_enclave(enclave);
+}
+
 int main(int argc, const char* argv[])
 {
     if (argc != 2)
@@ -116,8 +150,16 @@ int main(int argc, const char* argv[])
         OE_TEST(g_reentrancy_tested);
     }
 
+    /* Call enc_test_large_ocalls */
+    {
+        result = enc_test_large_ocalls(enclave, 256 * 1024, 8, true);
+        OE_TEST(OE_OK == result);
+    }
+
     oe_terminate_enclave(enclave);
 
+    _test_ocall_buffer_limit(argv[1], flags);
+
     printf("=== passed all tests (%s)\n", argv[0]);
 
     return 0;
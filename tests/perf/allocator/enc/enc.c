@@ -0,0 +1,95 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/advanced/mallinfo.h>
+#include <openenclave/enclave.h>
+#include <openenclave/internal/tests.h>
+#include <stdlib.h>
+#include "allocator_t.h"
+
+#define BURST_SIZE 16
+#define MAX_LIVE 1024
+
+static uint64_t _next_random(uint64_t* state)
+{
+    /* xorshift64 */
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+void enc_malloc_free(uint64_t count, size_t size)
+{
+    void* blocks[BURST_SIZE];
+
+    for (uint64_t i = 0; i < count; i++)
+    {
+        for (size_t j = 0; j < BURST_SIZE; j++)
+            OE_TEST((blocks[j] = malloc(size)) != NULL);
+
+        for (size_t j = 0; j < BURST_SIZE; j++)
+            free(blocks[j]);
+    }
+}
+
+uint64_t enc_churn(
+    uint64_t count,
+    size_t num_live,
+    size_t max_size,
+    uint64_t seed)
+{
+    void* blocks[MAX_LIVE];
+    size_t sizes[MAX_LIVE];
+    uint64_t state = seed | 1;
+    uint64_t live = 0;
+    uint64_t peak_live = 0;
+
+    OE_TEST(num_live > 0 && num_live <= MAX_LIVE && max_size > 0);
+
+    for (size_t i = 0; i < num_live; i++)
+    {
+        sizes[i] = 1 + _next_random(&state) % max_size;
+        OE_TEST((blocks[i] = malloc(sizes[i])) != NULL);
+        live += sizes[i];
+    }
+
+    peak_live = live;
+
+    for (uint64_t i = 0; i < count; i++)
+    {
+        size_t j = _next_random(&state) % num_live;
+
+        free(blocks[j]);
+        live -= sizes[j];
+
+        sizes[j] = 1 + _next_random(&state) % max_size;
+        OE_TEST((blocks[j] = malloc(sizes[j])) != NULL);
+        live += sizes[j];
+
+        if (live > peak_live)
+            peak_live = live;
+    }
+
+    for (size_t i = 0; i < num_live; i++)
+        free(blocks[i]);
+
+    return peak_live;
+}
+
+uint64_t enc_get_peak_heap_size(void)
+{
+    oe_mallinfo_t info;
+
+    OE_TEST(oe_allocator_mallinfo(&info) == OE_OK);
+
+    return info.peak_allocated_heap_size;
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,     /* ProductID */
+    1,     /* SecurityVersion */
+    true,  /* Debug */
+    16384, /* NumHeapPages */
+    64,    /* NumStackPages */
+    16);   /* NumTCS */
@@ -0,0 +1,230 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/error.h>
+#include <openenclave/internal/tests.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "../../common/benchmark.h"
+#include "allocator_u.h"
+
+#define MAX_THREADS 8
+
+/* Each sample of malloc_free times BATCH_SIZE bursts of 16 malloc() and
+ * free() pairs made by one ECALL */
+#define BATCH_SIZE 64
+#define BURST_SIZE 16
+
+/* Each sample of churn times CHURN_COUNT replacements of one of CHURN_LIVE
+ * live blocks of up to CHURN_MAX_SIZE bytes */
+#define CHURN_COUNT 1024
+#define CHURN_LIVE 256
+#define CHURN_MAX_SIZE 4096
+
+/* Below, within and above the range of sizes cached per thread */
+static const size_t _payload_sizes[] = {16, 256, 4096};
+
+struct options
+{
+    const char* enclave_path = nullptr;
+    const char* output_path = nullptr;
+    const char* allocator = "default";
+    size_t iterations = 100;
+    size_t max_threads = 4;
+    bool simulate = false;
+};
+
+static oe_enclave_t* _create_enclave(const options& opts)
+{
+    oe_result_t result;
+    oe_enclave_t* enclave = nullptr;
+    uint32_t flags = oe_get_create_flags();
+
+    if (opts.simulate)
+        flags |= OE_ENCLAVE_FLAG_SIMULATE;
+
+    if ((result = oe_create_allocator_enclave(
+             opts.enclave_path,
+             OE_ENCLAVE_TYPE_SGX,
+             flags,
+             nullptr,
+             0,
+             &enclave)) != OE_OK)
+        oe_put_err("oe_create_allocator_enclave(): result=%u", result);
+
+    return enclave;
+}
+
+/* Runs malloc() and free() pairs of each payload size with 1, 2, 4, ... up
+ * to opts.max_threads host threads */
+static void _run_malloc_free(oe_perf::report& report, const options& opts)
+{
+    std::string name = std::string(opts.allocator) + "_malloc_free";
+    oe_enclave_t* enclave = _create_enclave(opts);
+
+    for (size_t size : _payload_sizes)
+    {
+        for (size_t threads = 1; threads <= opts.max_threads; threads *= 2)
+        {
+            std::vector<uint64_t> samples;
+
+            /* Warm up, e.g., grow the heap and bind the TCSs */
+            oe_perf::run_threads(
+                threads, samples, [&](size_t, std::vector<uint64_t>&) {
+                    OE_TEST(
+                        enc_malloc_free(enclave, BATCH_SIZE, size) == OE_OK);
+                });
+            samples.clear();
+
+            uint64_t wall_nsec = oe_perf::run_threads(
+                threads, samples, [&](size_t, std::vector<uint64_t>& out) {
+                    out.reserve(opts.iterations);
+
+                    for (size_t i = 0; i < opts.iterations; i++)
+                    {
+                        auto start = oe_perf::clock_type::now();
+                        OE_TEST(
+                            enc_malloc_free(enclave, BATCH_SIZE, size) ==
+                            OE_OK);
+                        out.push_back(
+                            oe_perf::elapsed_nsec(start) /
+                            (BATCH_SIZE * BURST_SIZE));
+                    }
+                });
+
+            report.add(
+                name.c_str(),
+                size,
+                threads,
+                samples,
+                (uint64_t)threads * opts.iterations * BATCH_SIZE * BURST_SIZE,
+                wall_nsec);
+        }
+    }
+
+    OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+}
+
+/* Replaces live blocks of random sizes with 1, 2, 4, ... up to
+ * opts.max_threads host threads. Each thread count uses a new enclave so
+ * that the peak heap size only reflects its own run. */
+static void _run_churn(oe_perf::report& report, const options& opts)
+{
+    std::string name = std::string(opts.allocator) + "_churn";
+
+    for (size_t threads = 1; threads <= opts.max_threads; threads *= 2)
+    {
+        oe_enclave_t* enclave = _create_enclave(opts);
+        std::vector<uint64_t> samples;
+        std::vector<uint64_t> peak_live(threads);
+        uint64_t peak_heap = 0;
+
+        uint64_t wall_nsec = oe_perf::run_threads(
+            threads, samples, [&](size_t t, std::vector<uint64_t>& out) {
+                out.reserve(opts.iterations);
+
+                for (size_t i = 0; i < opts.iterations; i++)
+                {
+                    uint64_t live = 0;
+                    auto start = oe_perf::clock_type::now();
+
+                    OE_TEST(
+                        enc_churn(
+                            enclave,
+                            &live,
+                            CHURN_COUNT,
+                            CHURN_LIVE,
+                            CHURN_MAX_SIZE,
+                            t * opts.iterations + i + 1) == OE_OK);
+                    out.push_back(
+                        oe_perf::elapsed_nsec(start) /
+                        (CHURN_COUNT + CHURN_LIVE));
+
+                    if (live > peak_live[t])
+                        peak_live[t] = live;
+                }
+            });
+
+        OE_TEST(enc_get_peak_heap_size(enclave, &peak_heap) == OE_OK);
+        OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+
+        oe_perf::result& r = report.add(
+            name.c_str(),
+            CHURN_MAX_SIZE,
+            threads,
+            samples,
+            (uint64_t)threads * opts.iterations * (CHURN_COUNT + CHURN_LIVE),
+            wall_nsec);
+
+        /* The threads run at the same time, so their peaks add up */
+        for (uint64_t live : peak_live)
+            r.peak_live_bytes += live;
+        r.peak_heap_bytes = peak_heap;
+
+        printf(
+            "%-24s peak heap=%llu bytes peak live=%llu bytes (%.2fx)\n",
+            name.c_str(),
+            (unsigned long long)r.peak_heap_bytes,
+            (unsigned long long)r.peak_live_bytes,
+            (double)r.peak_heap_bytes / (double)r.peak_live_bytes);
+    }
+}
+
+static void _usage(const char* program)
+{
+    fprintf(
+        stderr,
+        "Usage: %s ENCLAVE_PATH [--allocator NAME] [--iterations N] "
+        "[--max-threads N] [--output FILE] [--simulate]\n",
+        program);
+    exit(1);
+}
+
+int main(int argc, const char* argv[])
+{
+    options opts;
+
+    if (argc < 2)
+        _usage(argv[0]);
+
+    opts.enclave_path = argv[1];
+
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--simulate") == 0)
+            opts.simulate = true;
+        else if (i + 1 == argc)
+            _usage(argv[0]);
+        else if (strcmp(argv[i], "--allocator") == 0)
+            opts.allocator = argv[++i];
+        else if (strcmp(argv[i], "--iterations") == 0)
+            opts.iterations = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "--max-threads") == 0)
+            opts.max_threads = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "--output") == 0)
+            opts.output_path = argv[++i];
+        else
+            _usage(argv[0]);
+    }
+
+    if (opts.iterations == 0 || opts.max_threads == 0 ||
+        opts.max_threads > MAX_THREADS)
+        _usage(argv[0]);
+
+    oe_perf::report report(
+        "allocator",
+        opts.simulate || (oe_get_create_flags() & OE_ENCLAVE_FLAG_SIMULATE));
+
+    _run_malloc_free(report, opts);
+    _run_churn(report, opts);
+
+    OE_TEST(report.write(opts.output_path));
+
+    printf("=== passed all tests (allocator)\n");
+
+    return 0;
+}
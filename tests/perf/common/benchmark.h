@@ -0,0 +1,244 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#ifndef _OE_TESTS_PERF_BENCHMARK_H
+#define _OE_TESTS_PERF_BENCHMARK_H
+
+/*
+**==============================================================================
+**
+** benchmark.h:
+**
+**     Helpers shared by the host side of the benchmarks under tests/perf.
+**     A benchmark collects per-operation latency samples for each
+**     configuration it runs and writes a JSON report of the form:
+**
+**         {
+**           "benchmark": "transitions",
+**           "simulation": true,
+**           "results": [
+**             {
+**               "name": "ecall",
+**               "payload_size": 0,
+**               "threads": 1,
+**               "operations": 10000,
+**               "p50_nsec": 1234,
+**               "p99_nsec": 2345,
+**               "ops_per_sec": 801234
+**             }, ...
+**           ]
+**         }
+**
+**==============================================================================
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace oe_perf
+{
+typedef std::chrono::steady_clock clock_type;
+
+inline uint64_t elapsed_nsec(clock_type::time_point start)
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            clock_type::now() - start)
+            .count());
+}
+
+struct result
+{
+    std::string name;
+    size_t payload_size;
+    size_t threads;
+    uint64_t operations;
+    uint64_t p50_nsec;
+    uint64_t p99_nsec;
+    double ops_per_sec;
+
+    // Only reported by benchmarks that measure heap fragmentation, if not 0
+    uint64_t peak_heap_bytes;
+    uint64_t peak_live_bytes;
+};
+
+class report
+{
+  public:
+    report(const char* benchmark, bool simulation)
+        : _benchmark(benchmark), _simulation(simulation)
+    {
+    }
+
+    // Summarizes the latency samples of one configuration. wall_nsec is the
+    // time it took all threads to perform all operations.
+    result& add(
+        const char* name,
+        size_t payload_size,
+        size_t threads,
+        std::vector<uint64_t>& samples,
+        uint64_t operations,
+        uint64_t wall_nsec)
+    {
+        result r;
+
+        std::sort(samples.begin(), samples.end());
+        r.name = name;
+        r.payload_size = payload_size;
+        r.threads = threads;
+        r.operations = operations;
+        r.p50_nsec = _percentile(samples, 50);
+        r.p99_nsec = _percentile(samples, 99);
+        r.ops_per_sec =
+            wall_nsec ? (double)operations * 1e9 / (double)wall_nsec : 0;
+        r.peak_heap_bytes = 0;
+        r.peak_live_bytes = 0;
+
+        printf(
+            "%-24s size=%-8zu threads=%-3zu p50=%llu ns p99=%llu ns "
+            "%.0f ops/s\n",
+            name,
+            payload_size,
+            threads,
+            (unsigned long long)r.p50_nsec,
+            (unsigned long long)r.p99_nsec,
+            r.ops_per_sec);
+
+        _results.push_back(r);
+        return _results.back();
+    }
+
+    // Writes the JSON report to path, or to stdout if path is null.
+    bool write(const char* path) const
+    {
+        FILE* stream = stdout;
+
+#ifdef _MSC_VER
+        if (path && fopen_s(&stream, path, "w") != 0)
+            return false;
+#else
+        if (path && !(stream = fopen(path, "w")))
+            return false;
+#endif
+
+        fprintf(stream, "{\n");
+        fprintf(stream, "  \"benchmark\": \"%s\",\n", _benchmark.c_str());
+        fprintf(
+            stream,
+            "  \"simulation\": %s,\n",
+            _simulation ? "true" : "false");
+        fprintf(stream, "  \"results\": [");
+
+        for (size_t i = 0; i < _results.size(); i++)
+        {
+            const result& r = _results[i];
+
+            fprintf(stream, "%s\n    {\n", i ? "," : "");
+            fprintf(stream, "      \"name\": \"%s\",\n", r.name.c_str());
+            fprintf(stream, "      \"payload_size\": %zu,\n", r.payload_size);
+            fprintf(stream, "      \"threads\": %zu,\n", r.threads);
+            fprintf(
+                stream,
+                "      \"operations\": %llu,\n",
+                (unsigned long long)r.operations);
+            fprintf(
+                stream,
+                "      \"p50_nsec\": %llu,\n",
+                (unsigned long long)r.p50_nsec);
+            fprintf(
+                stream,
+                "      \"p99_nsec\": %llu,\n",
+                (unsigned long long)r.p99_nsec);
+            fprintf(stream, "      \"ops_per_sec\": %.0f", r.ops_per_sec);
+
+            if (r.peak_live_bytes)
+            {
+                fprintf(
+                    stream,
+                    ",\n      \"peak_heap_bytes\": %llu",
+                    (unsigned long long)r.peak_heap_bytes);
+                fprintf(
+                    stream,
+                    ",\n      \"peak_live_bytes\": %llu",
+                    (unsigned long long)r.peak_live_bytes);
+            }
+
+            fprintf(stream, "\n");
+            fprintf(stream, "    }");
+        }
+
+        fprintf(stream, "\n  ]\n}\n");
+
+        if (stream != stdout)
+            fclose(stream);
+
+        return true;
+    }
+
+  private:
+    static uint64_t _percentile(
+        const std::vector<uint64_t>& sorted,
+        size_t percent)
+    {
+        if (sorted.empty())
+            return 0;
+
+        return sorted[(sorted.size() - 1) * percent / 100];
+    }
+
+    std::string _benchmark;
+    bool _simulation;
+    std::vector<result> _results;
+};
+
+// Runs body(thread_index, samples) on num_threads threads that start at the
+// same time. Each thread appends its latency samples to its own vector,
+// which are merged into samples. Returns the wall time in nanoseconds.
+template <typename body_type>
+uint64_t run_threads(
+    size_t num_threads,
+    std::vector<uint64_t>& samples,
+    body_type body)
+{
+    std::vector<std::vector<uint64_t>> thread_samples(num_threads);
+    std::vector<std::thread> threads;
+    std::atomic<size_t> ready(0);
+    std::atomic<bool> go(false);
+    clock_type::time_point start;
+
+    for (size_t i = 0; i < num_threads; i++)
+    {
+        threads.push_back(std::thread([&, i]() {
+            ready++;
+            while (!go)
+                std::this_thread::yield();
+            body(i, thread_samples[i]);
+        }));
+    }
+
+    while (ready != num_threads)
+        std::this_thread::yield();
+
+    start = clock_type::now();
+    go = true;
+
+    for (auto& t : threads)
+        t.join();
+
+    uint64_t wall_nsec = elapsed_nsec(start);
+
+    for (auto& s : thread_samples)
+        samples.insert(samples.end(), s.begin(), s.end());
+
+    return wall_nsec;
+}
+
+} // namespace oe_perf
+
+#endif /* _OE_TESTS_PERF_BENCHMARK_H */
@@ -0,0 +1,49 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/advanced/allocator.h>
+#include <openenclave/corelibc/stdlib.h>
+#include <openenclave/enclave.h>
+#include <openenclave/internal/tests.h>
+#include <stdlib.h>
+#include "debugmalloc_t.h"
+
+#define BURST_SIZE 16
+
+void enc_malloc_free(uint64_t count, size_t size, bool debug)
+{
+    void* blocks[BURST_SIZE];
+
+    for (uint64_t i = 0; i < count; i++)
+    {
+        if (debug)
+        {
+            for (size_t j = 0; j < BURST_SIZE; j++)
+                OE_TEST((blocks[j] = malloc(size)) != NULL);
+
+            for (size_t j = 0; j < BURST_SIZE; j++)
+                free(blocks[j]);
+        }
+        else
+        {
+            for (size_t j = 0; j < BURST_SIZE; j++)
+                OE_TEST((blocks[j] = oe_allocator_malloc(size)) != NULL);
+
+            for (size_t j = 0; j < BURST_SIZE; j++)
+                oe_allocator_free(blocks[j]);
+        }
+    }
+}
+
+void enc_set_backtrace_size_classes(uint64_t size_classes)
+{
+    oe_debug_malloc_backtrace_size_classes = size_classes;
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,    /* ProductID */
+    1,    /* SecurityVersion */
+    true, /* Debug */
+    4096, /* NumHeapPages */
+    64,   /* NumStackPages */
+    8);   /* NumTCS */
@@ -0,0 +1,187 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/error.h>
+#include <openenclave/internal/tests.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "../../common/benchmark.h"
+#include "debugmalloc_u.h"
+
+#define MAX_THREADS 8
+
+/* Each sample times BATCH_SIZE bursts of 16 malloc() and free() pairs made
+ * by one ECALL */
+#define BATCH_SIZE 64
+#define BURST_SIZE 16
+
+/* Within the smallest size class of most allocators and a page */
+static const size_t _payload_sizes[] = {64, 4096};
+
+struct options
+{
+    const char* enclave_path = nullptr;
+    const char* output_path = nullptr;
+    const char* variant = "sharded";
+    size_t iterations = 100;
+    size_t max_threads = 4;
+    bool simulate = false;
+};
+
+/* How the blocks are allocated */
+struct mode
+{
+    const char* name;
+    bool debug;
+    uint64_t backtrace_size_classes;
+};
+
+static const mode _modes[] = {
+    {"allocator", false, UINT64_MAX},
+    {"debugmalloc", true, UINT64_MAX},
+    {"debugmalloc_no_backtrace", true, 0},
+};
+
+/* Runs malloc() and free() pairs with the given number of host threads and
+ * returns the pairs per second */
+static double _run(
+    oe_perf::report& report,
+    const options& opts,
+    oe_enclave_t* enclave,
+    const mode& m,
+    size_t size,
+    size_t threads)
+{
+    std::string name = std::string(opts.variant) + "_" + m.name;
+    std::vector<uint64_t> samples;
+
+    OE_TEST(
+        enc_set_backtrace_size_classes(enclave, m.backtrace_size_classes) ==
+        OE_OK);
+
+    /* Warm up, e.g., grow the heap and bind the TCSs */
+    oe_perf::run_threads(threads, samples, [&](size_t, std::vector<uint64_t>&) {
+        OE_TEST(enc_malloc_free(enclave, BATCH_SIZE, size, m.debug) == OE_OK);
+    });
+    samples.clear();
+
+    uint64_t wall_nsec = oe_perf::run_threads(
+        threads, samples, [&](size_t, std::vector<uint64_t>& out) {
+            out.reserve(opts.iterations);
+
+            for (size_t i = 0; i < opts.iterations; i++)
+            {
+                auto start = oe_perf::clock_type::now();
+                OE_TEST(
+                    enc_malloc_free(enclave, BATCH_SIZE, size, m.debug) ==
+                    OE_OK);
+                out.push_back(
+                    oe_perf::elapsed_nsec(start) / (BATCH_SIZE * BURST_SIZE));
+            }
+        });
+
+    return report
+        .add(
+            name.c_str(),
+            size,
+            threads,
+            samples,
+            (uint64_t)threads * opts.iterations * BATCH_SIZE * BURST_SIZE,
+            wall_nsec)
+        .ops_per_sec;
+}
+
+static void _usage(const char* program)
+{
+    fprintf(
+        stderr,
+        "Usage: %s ENCLAVE_PATH [--variant NAME] [--iterations N] "
+        "[--max-threads N] [--output FILE] [--simulate]\n",
+        program);
+    exit(1);
+}
+
+int main(int argc, const char* argv[])
+{
+    options opts;
+    oe_result_t result;
+    oe_enclave_t* enclave = nullptr;
+    uint32_t flags = oe_get_create_flags();
+
+    if (argc < 2)
+        _usage(argv[0]);
+
+    opts.enclave_path = argv[1];
+
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--simulate") == 0)
+            opts.simulate = true;
+        else if (i + 1 == argc)
+            _usage(argv[0]);
+        else if (strcmp(argv[i], "--variant") == 0)
+            opts.variant = argv[++i];
+        else if (strcmp(argv[i], "--iterations") == 0)
+            opts.iterations = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "--max-threads") == 0)
+            opts.max_threads = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "--output") == 0)
+            opts.output_path = argv[++i];
+        else
+            _usage(argv[0]);
+    }
+
+    if (opts.iterations == 0 || opts.max_threads == 0 ||
+        opts.max_threads > MAX_THREADS)
+        _usage(argv[0]);
+
+    if (opts.simulate)
+        flags |= OE_ENCLAVE_FLAG_SIMULATE;
+
+    if ((result = oe_create_debugmalloc_enclave(
+             opts.enclave_path,
+             OE_ENCLAVE_TYPE_SGX,
+             flags,
+             nullptr,
+             0,
+             &enclave)) != OE_OK)
+        oe_put_err("oe_create_debugmalloc_enclave(): result=%u", result);
+
+    oe_perf::report report(
+        "debugmalloc", (flags & OE_ENCLAVE_FLAG_SIMULATE) != 0);
+
+    for (size_t size : _payload_sizes)
+    {
+        for (size_t threads = 1; threads <= opts.max_threads; threads *= 2)
+        {
+            double ops_per_sec[OE_COUNTOF(_modes)];
+
+            for (size_t i = 0; i < OE_COUNTOF(_modes); i++)
+                ops_per_sec[i] =
+                    _run(report, opts, enclave, _modes[i], size, threads);
+
+            /* How many times slower debug malloc is than the allocator
+             * underneath it with the same number of threads */
+            printf(
+                "%-24s size=%-8zu threads=%-3zu slowdown=%.1fx "
+                "(%.1fx without backtraces)\n",
+                opts.variant,
+                size,
+                threads,
+                ops_per_sec[0] / ops_per_sec[1],
+                ops_per_sec[0] / ops_per_sec[2]);
+        }
+    }
+
+    OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+
+    OE_TEST(report.write(opts.output_path));
+
+    printf("=== passed all tests (debugmalloc)\n");
+
+    return 0;
+}
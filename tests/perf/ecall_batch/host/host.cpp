@@ -0,0 +1,197 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/edger8r/host.h>
+#include <openenclave/host.h>
+#include <openenclave/internal/error.h>
+#include <openenclave/internal/tests.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "../../common/benchmark.h"
+#include "ecall_batch_args.h"
+#include "ecall_batch_u.h"
+
+#define MAX_THREADS 16
+
+/* Number of ECALLs per call of oe_call_enclave_function_batch() */
+static const size_t _batch_sizes[] = {1, 4, 16, 64, 256};
+
+/* Marshaling buffer of enc_empty(), which has neither parameters nor a
+ * return value. Its size must be a multiple of OE_EDGER8R_BUFFER_ALIGNMENT */
+typedef struct _empty_buffer
+{
+    enc_empty_args_t args;
+} OE_ALIGNED(OE_EDGER8R_BUFFER_ALIGNMENT) empty_buffer_t;
+
+static uint64_t _empty_global_id = OE_GLOBAL_ECALL_ID_NULL;
+
+struct options
+{
+    const char* enclave_path = nullptr;
+    const char* output_path = nullptr;
+    size_t iterations = 100;
+    size_t max_threads = 4;
+    bool simulate = false;
+};
+
+/* A batch of enc_empty() calls with the buffers of each call */
+struct batch
+{
+    std::vector<oe_enclave_function_call_t> calls;
+    std::vector<empty_buffer_t> inputs;
+    std::vector<empty_buffer_t> outputs;
+
+    explicit batch(size_t size) : calls(size), inputs(size), outputs(size)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            oe_enclave_function_call_t& call = calls[i];
+
+            call.global_id = &_empty_global_id;
+            call.name = "enc_empty";
+            call.input_buffer = &inputs[i];
+            call.input_buffer_size = sizeof(empty_buffer_t);
+            call.output_buffer = &outputs[i];
+            call.output_buffer_size = sizeof(empty_buffer_t);
+            call.output_bytes_written = 0;
+            call.result = OE_UNEXPECTED;
+        }
+    }
+};
+
+/* Runs op, which makes ecalls_per_op ECALLs, with 1, 2, 4, ... up to
+ * opts.max_threads host threads. Each sample is the mean of an op. */
+template <typename op_type>
+static void _run(
+    oe_perf::report& report,
+    const options& opts,
+    const char* name,
+    size_t ecalls_per_op,
+    op_type op)
+{
+    for (size_t threads = 1; threads <= opts.max_threads; threads *= 2)
+    {
+        std::vector<uint64_t> samples;
+
+        /* Warm up, e.g., bind the TCSs and look up the ECALL id */
+        oe_perf::run_threads(
+            threads, samples, [&](size_t, std::vector<uint64_t>&) { op(); });
+        samples.clear();
+
+        uint64_t wall_nsec = oe_perf::run_threads(
+            threads, samples, [&](size_t, std::vector<uint64_t>& out) {
+                out.reserve(opts.iterations);
+
+                for (size_t i = 0; i < opts.iterations; i++)
+                {
+                    auto start = oe_perf::clock_type::now();
+                    op();
+                    out.push_back(
+                        oe_perf::elapsed_nsec(start) / ecalls_per_op);
+                }
+            });
+
+        report.add(
+            name,
+            0,
+            threads,
+            samples,
+            (uint64_t)threads * opts.iterations * ecalls_per_op,
+            wall_nsec);
+    }
+}
+
+static void _usage(const char* program)
+{
+    fprintf(
+        stderr,
+        "Usage: %s ENCLAVE_PATH [--iterations N] [--max-threads N] "
+        "[--output FILE] [--simulate]\n",
+        program);
+    exit(1);
+}
+
+int main(int argc, const char* argv[])
+{
+    options opts;
+    oe_result_t result;
+    oe_enclave_t* enclave = nullptr;
+    uint32_t flags = oe_get_create_flags();
+
+    if (argc < 2)
+        _usage(argv[0]);
+
+    opts.enclave_path = argv[1];
+
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--simulate") == 0)
+            opts.simulate = true;
+        else if (i + 1 == argc)
+            _usage(argv[0]);
+        else if (strcmp(argv[i], "--iterations") == 0)
+            opts.iterations = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "--max-threads") == 0)
+            opts.max_threads = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "--output") == 0)
+            opts.output_path = argv[++i];
+        else
+            _usage(argv[0]);
+    }
+
+    if (opts.iterations == 0 || opts.max_threads == 0 ||
+        opts.max_threads > MAX_THREADS)
+        _usage(argv[0]);
+
+    if (opts.simulate)
+        flags |= OE_ENCLAVE_FLAG_SIMULATE;
+
+    if ((result = oe_create_ecall_batch_enclave(
+             opts.enclave_path,
+             OE_ENCLAVE_TYPE_SGX,
+             flags,
+             nullptr,
+             0,
+             &enclave)) != OE_OK)
+        oe_put_err("oe_create_ecall_batch_enclave(): result=%u", result);
+
+    oe_perf::report report(
+        "ecall_batch", (flags & OE_ENCLAVE_FLAG_SIMULATE) != 0);
+
+    _run(report, opts, "ecall", 1, [&]() {
+        OE_TEST(enc_empty(enclave) == OE_OK);
+    });
+
+    for (size_t size : _batch_sizes)
+    {
+        std::string name = "ecall_batch_" + std::to_string(size);
+
+        _run(report, opts, name.c_str(), size, [&]() {
+            /* Each thread makes its own calls */
+            thread_local std::vector<batch> batches;
+
+            if (batches.empty() || batches.back().calls.size() != size)
+                batches.emplace_back(size);
+
+            batch& b = batches.back();
+
+            OE_TEST(
+                oe_call_enclave_function_batch(
+                    enclave, b.calls.data(), size) == OE_OK);
+
+            for (const oe_enclave_function_call_t& call : b.calls)
+                OE_TEST(call.result == OE_OK);
+        });
+    }
+
+    OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+
+    OE_TEST(report.write(opts.output_path));
+
+    printf("=== passed all tests (ecall_batch)\n");
+
+    return 0;
+}
@@ -0,0 +1,158 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/error.h>
+#include <openenclave/internal/tests.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include "../../common/benchmark.h"
+#include "ecall_ids_u.h"
+
+/* The host calls the first and the last of the generated ECALLs by name */
+#if NUM_ECALLS != 1024
+#error "NUM_ECALLS must match the ECALLs called below"
+#endif
+
+#define MAX_THREADS 16
+
+struct options
+{
+    const char* enclave_path = nullptr;
+    const char* output_path = nullptr;
+    size_t iterations = 10;
+    size_t max_threads = 4;
+    bool simulate = false;
+};
+
+static oe_enclave_t* _create_enclave(const options& opts)
+{
+    oe_result_t result;
+    oe_enclave_t* enclave = nullptr;
+    uint32_t flags = oe_get_create_flags();
+
+    if (opts.simulate)
+        flags |= OE_ENCLAVE_FLAG_SIMULATE;
+
+    if ((result = oe_create_ecall_ids_enclave(
+             opts.enclave_path,
+             OE_ENCLAVE_TYPE_SGX,
+             flags,
+             nullptr,
+             0,
+             &enclave)) != OE_OK)
+        oe_put_err("oe_create_ecall_ids_enclave(): result=%u", result);
+
+    return enclave;
+}
+
+/* Creating an enclave assigns a global id to each of its ECALL names (the
+ * first time) or looks them up (every later time). */
+static void _benchmark_create(oe_perf::report& report, const options& opts)
+{
+    std::string name = "create_enclave_" + std::to_string(NUM_ECALLS);
+
+    for (size_t threads = 1; threads <= opts.max_threads; threads *= 2)
+    {
+        std::vector<uint64_t> samples;
+        uint64_t wall_nsec = oe_perf::run_threads(
+            threads, samples, [&](size_t, std::vector<uint64_t>& out) {
+                for (size_t i = 0; i < opts.iterations; i++)
+                {
+                    auto start = oe_perf::clock_type::now();
+                    oe_enclave_t* enclave = _create_enclave(opts);
+                    out.push_back(oe_perf::elapsed_nsec(start));
+
+                    OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+                }
+            });
+
+        report.add(
+            name.c_str(),
+            0,
+            threads,
+            samples,
+            threads * opts.iterations,
+            wall_nsec);
+    }
+}
+
+/* ECALLs whose global ids have already been assigned */
+static void _benchmark_ecalls(oe_perf::report& report, const options& opts)
+{
+    oe_enclave_t* enclave = _create_enclave(opts);
+    std::vector<uint64_t> samples;
+    size_t count = opts.iterations * 100;
+
+    OE_TEST(enc_ecall_0(enclave) == OE_OK);
+    OE_TEST(enc_ecall_1023(enclave) == OE_OK);
+
+    uint64_t wall_nsec = oe_perf::run_threads(
+        1, samples, [&](size_t, std::vector<uint64_t>& out) {
+            for (size_t i = 0; i < count; i++)
+            {
+                auto start = oe_perf::clock_type::now();
+                OE_TEST(enc_ecall_1023(enclave) == OE_OK);
+                out.push_back(oe_perf::elapsed_nsec(start));
+            }
+        });
+
+    report.add("ecall", 0, 1, samples, count, wall_nsec);
+
+    OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+}
+
+static void _usage(const char* program)
+{
+    fprintf(
+        stderr,
+        "Usage: %s ENCLAVE_PATH [--iterations N] [--max-threads N] "
+        "[--output FILE] [--simulate]\n",
+        program);
+    exit(1);
+}
+
+int main(int argc, const char* argv[])
+{
+    options opts;
+
+    if (argc < 2)
+        _usage(argv[0]);
+
+    opts.enclave_path = argv[1];
+
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--simulate") == 0)
+            opts.simulate = true;
+        else if (i + 1 == argc)
+            _usage(argv[0]);
+        else if (strcmp(argv[i], "--iterations") == 0)
+            opts.iterations = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "--max-threads") == 0)
+            opts.max_threads = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "--output") == 0)
+            opts.output_path = argv[++i];
+        else
+            _usage(argv[0]);
+    }
+
+    if (opts.iterations == 0 || opts.max_threads == 0 ||
+        opts.max_threads > MAX_THREADS)
+        _usage(argv[0]);
+
+    oe_perf::report report(
+        "ecall_ids",
+        opts.simulate || (oe_get_create_flags() & OE_ENCLAVE_FLAG_SIMULATE));
+
+    _benchmark_create(report, opts);
+    _benchmark_ecalls(report, opts);
+
+    OE_TEST(report.write(opts.output_path));
+
+    printf("=== passed all tests (ecall_ids)\n");
+
+    return 0;
+}
@@ -0,0 +1,99 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/enclave.h>
+#include <openenclave/internal/tests.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "mman_t.h"
+
+#define MAX_LIVE 1024
+
+static uint64_t _next_random(uint64_t* state)
+{
+    /* xorshift64 */
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/* Returns zeroed pages, like mmap(), with mmap() or posix_memalign() */
+static void* _map(size_t size, bool use_mmap)
+{
+    void* ptr = NULL;
+
+    if (use_mmap)
+    {
+        ptr = mmap(
+            NULL,
+            size,
+            PROT_READ | PROT_WRITE,
+            MAP_ANONYMOUS | MAP_PRIVATE,
+            -1,
+            0);
+        OE_TEST(ptr != MAP_FAILED);
+    }
+    else
+    {
+        OE_TEST(posix_memalign(&ptr, OE_PAGE_SIZE, size) == 0);
+        memset(ptr, 0, size);
+    }
+
+    return ptr;
+}
+
+static void _unmap(void* ptr, size_t size, bool use_mmap)
+{
+    if (use_mmap)
+        OE_TEST(munmap(ptr, size) == 0);
+    else
+        free(ptr);
+}
+
+void enc_map_unmap(uint64_t count, size_t size, bool use_mmap)
+{
+    for (uint64_t i = 0; i < count; i++)
+        _unmap(_map(size, use_mmap), size, use_mmap);
+}
+
+void enc_churn(
+    uint64_t count,
+    size_t num_live,
+    size_t max_pages,
+    uint64_t seed,
+    bool use_mmap)
+{
+    void* blocks[MAX_LIVE];
+    size_t sizes[MAX_LIVE];
+    uint64_t state = seed | 1;
+
+    OE_TEST(num_live > 0 && num_live <= MAX_LIVE && max_pages > 0);
+
+    for (size_t i = 0; i < num_live; i++)
+    {
+        sizes[i] = (1 + _next_random(&state) % max_pages) * OE_PAGE_SIZE;
+        blocks[i] = _map(sizes[i], use_mmap);
+    }
+
+    for (uint64_t i = 0; i < count; i++)
+    {
+        size_t j = _next_random(&state) % num_live;
+
+        _unmap(blocks[j], sizes[j], use_mmap);
+        sizes[j] = (1 + _next_random(&state) % max_pages) * OE_PAGE_SIZE;
+        blocks[j] = _map(sizes[j], use_mmap);
+    }
+
+    for (size_t i = 0; i < num_live; i++)
+        _unmap(blocks[i], sizes[i], use_mmap);
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,     /* ProductID */
+    1,     /* SecurityVersion */
+    true,  /* Debug */
+    16384, /* NumHeapPages */
+    64,    /* NumStackPages */
+    16);   /* NumTCS */
@@ -0,0 +1,222 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/error.h>
+#include <openenclave/internal/tests.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "../../common/benchmark.h"
+#include "mman_u.h"
+
+#define MAX_THREADS 8
+
+/* Each sample of map_unmap times BATCH_SIZE pairs made by one ECALL */
+#define BATCH_SIZE 64
+
+/* Each sample of churn times CHURN_COUNT replacements of one of the live
+ * blocks of up to CHURN_MAX_PAGES pages */
+#define CHURN_COUNT 1024
+#define CHURN_MAX_PAGES 4
+
+/* A page, a typical arena of a language runtime and a large buffer */
+static const size_t _payload_sizes[] = {4096, 64 * 1024, 1024 * 1024};
+
+/* Few mappings and as many as a garbage collected runtime may keep */
+static const size_t _live_counts[] = {16, 256};
+
+struct options
+{
+    const char* enclave_path = nullptr;
+    const char* output_path = nullptr;
+    size_t iterations = 100;
+    size_t max_threads = 4;
+    bool simulate = false;
+};
+
+/* How the pages are mapped */
+struct mode
+{
+    const char* name;
+    bool use_mmap;
+};
+
+static const mode _modes[] = {
+    {"mmap", true},
+    {"memalign", false},
+};
+
+/* Runs mapping and unmapping pairs of each payload size with 1, 2, 4, ...
+ * up to opts.max_threads host threads */
+static void _run_map_unmap(
+    oe_perf::report& report,
+    const options& opts,
+    oe_enclave_t* enclave,
+    const mode& m)
+{
+    std::string name = std::string(m.name) + "_map_unmap";
+
+    for (size_t size : _payload_sizes)
+    {
+        for (size_t threads = 1; threads <= opts.max_threads; threads *= 2)
+        {
+            std::vector<uint64_t> samples;
+
+            /* Warm up, e.g., grow the heap and bind the TCSs */
+            oe_perf::run_threads(
+                threads, samples, [&](size_t, std::vector<uint64_t>&) {
+                    OE_TEST(
+                        enc_map_unmap(enclave, BATCH_SIZE, size, m.use_mmap) ==
+                        OE_OK);
+                });
+            samples.clear();
+
+            uint64_t wall_nsec = oe_perf::run_threads(
+                threads, samples, [&](size_t, std::vector<uint64_t>& out) {
+                    out.reserve(opts.iterations);
+
+                    for (size_t i = 0; i < opts.iterations; i++)
+                    {
+                        auto start = oe_perf::clock_type::now();
+                        OE_TEST(
+                            enc_map_unmap(
+                                enclave, BATCH_SIZE, size, m.use_mmap) ==
+                            OE_OK);
+                        out.push_back(
+                            oe_perf::elapsed_nsec(start) / BATCH_SIZE);
+                    }
+                });
+
+            report.add(
+                name.c_str(),
+                size,
+                threads,
+                samples,
+                (uint64_t)threads * opts.iterations * BATCH_SIZE,
+                wall_nsec);
+        }
+    }
+}
+
+/* Replaces live blocks of random sizes with 1, 2, 4, ... up to
+ * opts.max_threads host threads */
+static void _run_churn(
+    oe_perf::report& report,
+    const options& opts,
+    oe_enclave_t* enclave,
+    const mode& m)
+{
+    for (size_t live : _live_counts)
+    {
+        std::string name =
+            std::string(m.name) + "_churn_" + std::to_string(live);
+
+        for (size_t threads = 1; threads <= opts.max_threads; threads *= 2)
+        {
+            std::vector<uint64_t> samples;
+
+            uint64_t wall_nsec = oe_perf::run_threads(
+                threads, samples, [&](size_t t, std::vector<uint64_t>& out) {
+                    out.reserve(opts.iterations);
+
+                    for (size_t i = 0; i < opts.iterations; i++)
+                    {
+                        auto start = oe_perf::clock_type::now();
+                        OE_TEST(
+                            enc_churn(
+                                enclave,
+                                CHURN_COUNT,
+                                live,
+                                CHURN_MAX_PAGES,
+                                t * opts.iterations + i + 1,
+                                m.use_mmap) == OE_OK);
+                        out.push_back(
+                            oe_perf::elapsed_nsec(start) /
+                            (CHURN_COUNT + live));
+                    }
+                });
+
+            report.add(
+                name.c_str(),
+                CHURN_MAX_PAGES * 4096,
+                threads,
+                samples,
+                (uint64_t)threads * opts.iterations * (CHURN_COUNT + live),
+                wall_nsec);
+        }
+    }
+}
+
+static void _usage(const char* program)
+{
+    fprintf(
+        stderr,
+        "Usage: %s ENCLAVE_PATH [--iterations N] [--max-threads N] "
+        "[--output FILE] [--simulate]\n",
+        program);
+    exit(1);
+}
+
+int main(int argc, const char* argv[])
+{
+    options opts;
+    oe_result_t result;
+    oe_enclave_t* enclave = nullptr;
+    uint32_t flags = oe_get_create_flags();
+
+    if (argc < 2)
+        _usage(argv[0]);
+
+    opts.enclave_path = argv[1];
+
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--simulate") == 0)
+            opts.simulate = true;
+        else if (i + 1 == argc)
+            _usage(argv[0]);
+        else if (strcmp(argv[i], "--iterations") == 0)
+            opts.iterations = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "--max-threads") == 0)
+            opts.max_threads = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "--output") == 0)
+            opts.output_path = argv[++i];
+        else
+            _usage(argv[0]);
+    }
+
+    if (opts.iterations == 0 || opts.max_threads == 0 ||
+        opts.max_threads > MAX_THREADS)
+        _usage(argv[0]);
+
+    if (opts.simulate)
+        flags |= OE_ENCLAVE_FLAG_SIMULATE;
+
+    if ((result = oe_create_mman_enclave(
+             opts.enclave_path,
+             OE_ENCLAVE_TYPE_SGX,
+             flags,
+             nullptr,
+             0,
+             &enclave)) != OE_OK)
+        oe_put_err("oe_create_mman_enclave(): result=%u", result);
+
+    oe_perf::report report("mman", (flags & OE_ENCLAVE_FLAG_SIMULATE) != 0);
+
+    for (const mode& m : _modes)
+    {
+        _run_map_unmap(report, opts, enclave, m);
+        _run_churn(report, opts, enclave, m);
+    }
+
+    OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+
+    OE_TEST(report.write(opts.output_path));
+
+    printf("=== passed all tests (mman)\n");
+
+    return 0;
+}
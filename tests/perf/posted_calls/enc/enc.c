@@ -0,0 +1,61 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/edger8r/enclave.h>
+#include <openenclave/enclave.h>
+#include <openenclave/internal/calls.h>
+#include <openenclave/internal/tests.h>
+#include <string.h>
+#include "posted_calls_args.h"
+#include "posted_calls_t.h"
+
+/* oe_post_host_function() is internal and has no edger8r support, so the
+ * call is marshaled by hand, like in tests/posted_calls.
+ * posted_calls_fcn_id_host_value is defined in posted_calls_t.c, must be
+ * kept in sync */
+static const size_t posted_calls_fcn_id_host_value = 0;
+
+/* Marshaling buffer of host_value(). Its size must be a multiple of
+ * OE_EDGER8R_BUFFER_ALIGNMENT */
+typedef struct _value_buffer
+{
+    host_value_args_t args;
+} OE_ALIGNED(OE_EDGER8R_BUFFER_ALIGNMENT) value_buffer_t;
+
+void enc_run(posted_calls_benchmark_t benchmark, uint64_t count)
+{
+    value_buffer_t buffer;
+
+    memset(&buffer, 0, sizeof(buffer));
+
+    for (uint64_t i = 0; i < count; i++)
+    {
+        switch (benchmark)
+        {
+            case BENCHMARK_OCALL:
+                OE_TEST(host_value(i) == OE_OK);
+                break;
+
+            case BENCHMARK_POSTED_OCALL:
+                buffer.args.value = i;
+                OE_TEST(
+                    oe_post_host_function(
+                        posted_calls_fcn_id_host_value,
+                        &buffer,
+                        sizeof(buffer),
+                        sizeof(buffer)) == OE_OK);
+                break;
+
+            default:
+                oe_abort();
+        }
+    }
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,    /* ProductID */
+    1,    /* SecurityVersion */
+    true, /* Debug */
+    1024, /* NumHeapPages */
+    16,   /* NumStackPages */
+    16);  /* NumTCS */
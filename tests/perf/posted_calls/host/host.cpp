@@ -0,0 +1,144 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/error.h>
+#include <openenclave/internal/tests.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "../../common/benchmark.h"
+#include "posted_calls_u.h"
+
+#define MAX_THREADS 16
+
+/* Number of OCALLs made by each ECALL. Posted calls are performed when the
+ * ECALL returns, so each sample includes them. It stays below the number of
+ * calls that fit into the queue of posted calls. */
+#define BATCH_SIZE 64
+
+struct options
+{
+    const char* enclave_path = nullptr;
+    const char* output_path = nullptr;
+    size_t iterations = 100;
+    size_t max_threads = 4;
+    bool simulate = false;
+};
+
+void host_value(uint64_t value)
+{
+    OE_UNUSED(value);
+}
+
+/* Runs the benchmark with 1, 2, 4, ... up to opts.max_threads host threads.
+ * Each sample is the mean of the OCALLs of an ECALL. */
+static void _run(
+    oe_perf::report& report,
+    const options& opts,
+    oe_enclave_t* enclave,
+    const char* name,
+    posted_calls_benchmark_t benchmark)
+{
+    for (size_t threads = 1; threads <= opts.max_threads; threads *= 2)
+    {
+        std::vector<uint64_t> samples;
+
+        /* Warm up, e.g., bind the TCSs */
+        oe_perf::run_threads(
+            threads, samples, [&](size_t, std::vector<uint64_t>&) {
+                OE_TEST(enc_run(enclave, benchmark, BATCH_SIZE) == OE_OK);
+            });
+        samples.clear();
+
+        uint64_t wall_nsec = oe_perf::run_threads(
+            threads, samples, [&](size_t, std::vector<uint64_t>& out) {
+                out.reserve(opts.iterations);
+
+                for (size_t i = 0; i < opts.iterations; i++)
+                {
+                    auto start = oe_perf::clock_type::now();
+                    OE_TEST(enc_run(enclave, benchmark, BATCH_SIZE) == OE_OK);
+                    out.push_back(oe_perf::elapsed_nsec(start) / BATCH_SIZE);
+                }
+            });
+
+        report.add(
+            name,
+            0,
+            threads,
+            samples,
+            (uint64_t)threads * opts.iterations * BATCH_SIZE,
+            wall_nsec);
+    }
+}
+
+static void _usage(const char* program)
+{
+    fprintf(
+        stderr,
+        "Usage: %s ENCLAVE_PATH [--iterations N] [--max-threads N] "
+        "[--output FILE] [--simulate]\n",
+        program);
+    exit(1);
+}
+
+int main(int argc, const char* argv[])
+{
+    options opts;
+    oe_result_t result;
+    oe_enclave_t* enclave = nullptr;
+    uint32_t flags = oe_get_create_flags();
+
+    if (argc < 2)
+        _usage(argv[0]);
+
+    opts.enclave_path = argv[1];
+
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--simulate") == 0)
+            opts.simulate = true;
+        else if (i + 1 == argc)
+            _usage(argv[0]);
+        else if (strcmp(argv[i], "--iterations") == 0)
+            opts.iterations = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "--max-threads") == 0)
+            opts.max_threads = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "--output") == 0)
+            opts.output_path = argv[++i];
+        else
+            _usage(argv[0]);
+    }
+
+    if (opts.iterations == 0 || opts.max_threads == 0 ||
+        opts.max_threads > MAX_THREADS)
+        _usage(argv[0]);
+
+    if (opts.simulate)
+        flags |= OE_ENCLAVE_FLAG_SIMULATE;
+
+    if ((result = oe_create_posted_calls_enclave(
+             opts.enclave_path,
+             OE_ENCLAVE_TYPE_SGX,
+             flags,
+             nullptr,
+             0,
+             &enclave)) != OE_OK)
+        oe_put_err("oe_create_posted_calls_enclave(): result=%u", result);
+
+    oe_perf::report report(
+        "posted_calls", (flags & OE_ENCLAVE_FLAG_SIMULATE) != 0);
+
+    _run(report, opts, enclave, "ocall", BENCHMARK_OCALL);
+    _run(report, opts, enclave, "posted_ocall", BENCHMARK_POSTED_OCALL);
+
+    OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+
+    OE_TEST(report.write(opts.output_path));
+
+    printf("=== passed all tests (posted_calls)\n");
+
+    return 0;
+}
@@ -0,0 +1,27 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/enclave.h>
+#include <openenclave/internal/tests.h>
+#include "switchless_affinity_t.h"
+
+#define MAX_PAYLOAD_SIZE (4 * 1024)
+
+/* Only ever read, so all threads share it */
+static uint8_t _payload[MAX_PAYLOAD_SIZE];
+
+void enc_run(uint64_t count, size_t size)
+{
+    OE_TEST(size <= MAX_PAYLOAD_SIZE);
+
+    for (uint64_t i = 0; i < count; i++)
+        OE_TEST(host_in_switchless(_payload, size) == OE_OK);
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,    /* ProductID */
+    1,    /* SecurityVersion */
+    true, /* Debug */
+    1024, /* NumHeapPages */
+    64,   /* NumStackPages */
+    16);  /* NumTCS */
@@ -0,0 +1,262 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/error.h>
+#include <openenclave/internal/tests.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <functional>
+#include <vector>
+#include "../../../../host/hostthread.h"
+#include "../../common/benchmark.h"
+#include "switchless_affinity_u.h"
+
+#define MAX_PAYLOAD_SIZE (4 * 1024)
+#define MAX_THREADS 8
+#define MAX_NODE_CPUS 4096
+#define MAX_NODES 64
+
+/* Each sample times a batch of switchless OCALLs made by one ECALL */
+#define BATCH_SIZE 16
+
+static const size_t _payload_sizes[] = {0, 64, 4096};
+
+struct options
+{
+    const char* enclave_path = nullptr;
+    const char* output_path = nullptr;
+    size_t iterations = 1000;
+    size_t max_threads = 4;
+    bool simulate = false;
+};
+
+void host_in_switchless(const void* buffer, size_t size)
+{
+    OE_UNUSED(buffer);
+    OE_UNUSED(size);
+}
+
+static std::vector<uint32_t> _get_node_cpus(int node)
+{
+    std::vector<uint32_t> cpus(MAX_NODE_CPUS);
+    size_t num_cpus = cpus.size();
+
+    if (node < 0 || oe_get_numa_node_cpus(node, cpus.data(), &num_cpus) != 0)
+        num_cpus = 0;
+
+    cpus.resize(num_cpus);
+    return cpus;
+}
+
+/* Returns the CPUs of a NUMA node other than node, if there is one */
+static std::vector<uint32_t> _get_far_cpus(int node)
+{
+    for (int other = 0; other < MAX_NODES; other++)
+    {
+        if (other == node)
+            continue;
+
+        std::vector<uint32_t> cpus = _get_node_cpus(other);
+
+        if (!cpus.empty())
+            return cpus;
+    }
+
+    return std::vector<uint32_t>();
+}
+
+static oe_enclave_t* _create_enclave(
+    const options& opts,
+    oe_switchless_affinity_t affinity,
+    const std::vector<uint32_t>& host_worker_cpus)
+{
+    oe_result_t result;
+    oe_enclave_t* enclave = nullptr;
+    uint32_t flags = oe_get_create_flags();
+    oe_enclave_setting_context_switchless_t switchless_setting = {
+        opts.max_threads, 0};
+    oe_enclave_setting_t setting;
+
+    switchless_setting.worker_affinity = affinity;
+    switchless_setting.host_worker_cpus = host_worker_cpus.data();
+    switchless_setting.num_host_worker_cpus = host_worker_cpus.size();
+
+    setting.setting_type = OE_ENCLAVE_SETTING_CONTEXT_SWITCHLESS;
+    setting.u.context_switchless_setting = &switchless_setting;
+
+    if (opts.simulate)
+        flags |= OE_ENCLAVE_FLAG_SIMULATE;
+
+    if ((result = oe_create_switchless_affinity_enclave(
+             opts.enclave_path,
+             OE_ENCLAVE_TYPE_SGX,
+             flags,
+             &setting,
+             1,
+             &enclave)) != OE_OK)
+        oe_put_err(
+            "oe_create_switchless_affinity_enclave(): result=%u", result);
+
+    return enclave;
+}
+
+/* Runs the switchless OCALLs with each payload size and 1, 2, 4, ... up to
+ * opts.max_threads host threads. Host thread i runs on caller_cpus[i], if
+ * there are that many. */
+static void _run(
+    oe_perf::report& report,
+    const options& opts,
+    const char* name,
+    oe_enclave_t* enclave,
+    const std::vector<uint32_t>& caller_cpus)
+{
+    auto pin = [&](size_t thread) {
+        if (thread < caller_cpus.size())
+            oe_thread_set_affinity(&caller_cpus[thread], 1);
+    };
+
+    for (size_t size : _payload_sizes)
+    {
+        for (size_t threads = 1; threads <= opts.max_threads; threads *= 2)
+        {
+            std::vector<uint64_t> samples;
+
+            /* Warm up, e.g., bind the TCSs and wake up the workers */
+            oe_perf::run_threads(
+                threads, samples, [&](size_t i, std::vector<uint64_t>&) {
+                    pin(i);
+                    OE_TEST(enc_run(enclave, BATCH_SIZE, size) == OE_OK);
+                });
+            samples.clear();
+
+            uint64_t wall_nsec = oe_perf::run_threads(
+                threads, samples, [&](size_t i, std::vector<uint64_t>& out) {
+                    pin(i);
+                    out.reserve(opts.iterations);
+
+                    for (size_t j = 0; j < opts.iterations; j++)
+                    {
+                        auto start = oe_perf::clock_type::now();
+                        OE_TEST(enc_run(enclave, BATCH_SIZE, size) == OE_OK);
+                        out.push_back(
+                            oe_perf::elapsed_nsec(start) / BATCH_SIZE);
+                    }
+                });
+
+            report.add(
+                name,
+                size,
+                threads,
+                samples,
+                (uint64_t)threads * opts.iterations * BATCH_SIZE,
+                wall_nsec);
+        }
+    }
+}
+
+static void _run_benchmarks(oe_perf::report& report, const options& opts)
+{
+    int node = oe_thread_get_numa_node();
+    std::vector<uint32_t> node_cpus = _get_node_cpus(node);
+    std::vector<uint32_t> far_cpus = _get_far_cpus(node);
+    std::vector<uint32_t> caller_cpus;
+    std::vector<uint32_t> worker_cpus;
+    const std::vector<uint32_t> no_cpus;
+    oe_enclave_t* enclave;
+
+    /* The callers run on the first CPUs of the node of the main thread, and
+     * pinned workers on the next ones */
+    caller_cpus.assign(
+        node_cpus.begin(),
+        node_cpus.begin() +
+            (ptrdiff_t)(opts.max_threads < node_cpus.size()
+                            ? opts.max_threads
+                            : node_cpus.size()));
+
+    if (node_cpus.size() >= 2 * opts.max_threads)
+        worker_cpus.assign(
+            node_cpus.begin() + (ptrdiff_t)opts.max_threads,
+            node_cpus.begin() + (ptrdiff_t)(2 * opts.max_threads));
+
+    if (!caller_cpus.empty())
+        oe_thread_set_affinity(caller_cpus.data(), caller_cpus.size());
+
+    enclave = _create_enclave(opts, OE_SWITCHLESS_AFFINITY_NONE, no_cpus);
+    _run(report, opts, "switchless_ocall_default", enclave, caller_cpus);
+    OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+
+    enclave =
+        _create_enclave(opts, OE_SWITCHLESS_AFFINITY_CREATOR_NODE, no_cpus);
+    _run(report, opts, "switchless_ocall_same_node", enclave, caller_cpus);
+    OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+
+    if (!worker_cpus.empty())
+    {
+        enclave =
+            _create_enclave(opts, OE_SWITCHLESS_AFFINITY_CPUS, worker_cpus);
+        _run(report, opts, "switchless_ocall_pinned", enclave, caller_cpus);
+        OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+    }
+
+    /* Only on machines with more than one NUMA node */
+    if (!far_cpus.empty())
+    {
+        enclave = _create_enclave(opts, OE_SWITCHLESS_AFFINITY_CPUS, far_cpus);
+        _run(report, opts, "switchless_ocall_far_node", enclave, caller_cpus);
+        OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+    }
+}
+
+static void _usage(const char* program)
+{
+    fprintf(
+        stderr,
+        "Usage: %s ENCLAVE_PATH [--iterations N] [--max-threads N] "
+        "[--output FILE] [--simulate]\n",
+        program);
+    exit(1);
+}
+
+int main(int argc, const char* argv[])
+{
+    options opts;
+
+    if (argc < 2)
+        _usage(argv[0]);
+
+    opts.enclave_path = argv[1];
+
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--simulate") == 0)
+            opts.simulate = true;
+        else if (i + 1 == argc)
+            _usage(argv[0]);
+        else if (strcmp(argv[i], "--iterations") == 0)
+            opts.iterations = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "--max-threads") == 0)
+            opts.max_threads = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "--output") == 0)
+            opts.output_path = argv[++i];
+        else
+            _usage(argv[0]);
+    }
+
+    if (opts.iterations == 0 || opts.max_threads == 0 ||
+        opts.max_threads > MAX_THREADS)
+        _usage(argv[0]);
+
+    oe_perf::report report(
+        "switchless_affinity",
+        opts.simulate || (oe_get_create_flags() & OE_ENCLAVE_FLAG_SIMULATE));
+
+    _run_benchmarks(report, opts);
+
+    OE_TEST(report.write(opts.output_path));
+
+    printf("=== passed all tests (switchless_affinity)\n");
+
+    return 0;
+}
@@ -0,0 +1,195 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/error.h>
+#include <openenclave/internal/tests.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <functional>
+#include <string>
+#include "../../common/benchmark.h"
+#include "switchless_ecalls_u.h"
+
+#define MAX_PAYLOAD_SIZE (64 * 1024)
+#define MAX_THREADS 16
+#define MAX_WORKERS 8
+
+static const size_t _payload_sizes[] = {0, 64, 4096, 64 * 1024};
+
+static uint8_t _payload[MAX_PAYLOAD_SIZE];
+
+struct options
+{
+    const char* enclave_path = nullptr;
+    const char* output_path = nullptr;
+    size_t iterations = 1000;
+    size_t max_threads = 4;
+    size_t max_workers = 2;
+    size_t max_size = MAX_PAYLOAD_SIZE;
+    bool simulate = false;
+};
+
+static oe_enclave_t* _create_enclave(
+    const options& opts,
+    size_t num_enclave_workers)
+{
+    oe_result_t result;
+    oe_enclave_t* enclave = nullptr;
+    uint32_t flags = oe_get_create_flags();
+    oe_enclave_setting_context_switchless_t switchless_setting = {
+        0, num_enclave_workers};
+    oe_enclave_setting_t setting;
+
+    setting.setting_type = OE_ENCLAVE_SETTING_CONTEXT_SWITCHLESS;
+    setting.u.context_switchless_setting = &switchless_setting;
+
+    if (opts.simulate)
+        flags |= OE_ENCLAVE_FLAG_SIMULATE;
+
+    if ((result = oe_create_switchless_ecalls_enclave(
+             opts.enclave_path,
+             OE_ENCLAVE_TYPE_SGX,
+             flags,
+             num_enclave_workers ? &setting : nullptr,
+             num_enclave_workers ? 1 : 0,
+             &enclave)) != OE_OK)
+        oe_put_err("oe_create_switchless_ecalls_enclave(): result=%u", result);
+
+    return enclave;
+}
+
+/* Runs op with each payload size and 1, 2, 4, ... up to opts.max_threads
+ * host threads. */
+static void _run(
+    oe_perf::report& report,
+    const options& opts,
+    const char* name,
+    const std::function<void(size_t)>& op)
+{
+    for (size_t size : _payload_sizes)
+    {
+        if (size > opts.max_size)
+            break;
+
+        for (size_t threads = 1; threads <= opts.max_threads; threads *= 2)
+        {
+            std::vector<uint64_t> samples;
+
+            /* Warm up, e.g., bind the TCSs and wake up the workers */
+            oe_perf::run_threads(
+                threads, samples, [&](size_t, std::vector<uint64_t>&) {
+                    op(size);
+                });
+            samples.clear();
+
+            uint64_t wall_nsec = oe_perf::run_threads(
+                threads, samples, [&](size_t, std::vector<uint64_t>& out) {
+                    out.reserve(opts.iterations);
+
+                    for (size_t i = 0; i < opts.iterations; i++)
+                    {
+                        auto start = oe_perf::clock_type::now();
+                        op(size);
+                        out.push_back(oe_perf::elapsed_nsec(start));
+                    }
+                });
+
+            report.add(
+                name,
+                size,
+                threads,
+                samples,
+                (uint64_t)threads * opts.iterations,
+                wall_nsec);
+        }
+    }
+}
+
+static void _run_benchmarks(oe_perf::report& report, const options& opts)
+{
+    oe_enclave_t* enclave = _create_enclave(opts, 0);
+
+    _run(report, opts, "ecall", [&](size_t n) {
+        OE_TEST(enc_in(enclave, _payload, n) == OE_OK);
+    });
+
+    /* Without enclave workers, switchless ECALLs fall back to regular ones */
+    _run(report, opts, "switchless_ecall_fallback", [&](size_t n) {
+        OE_TEST(enc_in_switchless(enclave, _payload, n) == OE_OK);
+    });
+
+    OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+
+    for (size_t workers = 1; workers <= opts.max_workers; workers *= 2)
+    {
+        std::string name =
+            "switchless_ecall_" + std::to_string(workers) + "_workers";
+
+        enclave = _create_enclave(opts, workers);
+
+        _run(report, opts, name.c_str(), [&](size_t n) {
+            OE_TEST(enc_in_switchless(enclave, _payload, n) == OE_OK);
+        });
+
+        OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+    }
+}
+
+static void _usage(const char* program)
+{
+    fprintf(
+        stderr,
+        "Usage: %s ENCLAVE_PATH [--iterations N] [--max-threads N] "
+        "[--max-workers N] [--max-size BYTES] [--output FILE] [--simulate]\n",
+        program);
+    exit(1);
+}
+
+int main(int argc, const char* argv[])
+{
+    options opts;
+
+    if (argc < 2)
+        _usage(argv[0]);
+
+    opts.enclave_path = argv[1];
+
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--simulate") == 0)
+            opts.simulate = true;
+        else if (i + 1 == argc)
+            _usage(argv[0]);
+        else if (strcmp(argv[i], "--iterations") == 0)
+            opts.iterations = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "--max-threads") == 0)
+            opts.max_threads = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "--max-workers") == 0)
+            opts.max_workers = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "--max-size") == 0)
+            opts.max_size = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "--output") == 0)
+            opts.output_path = argv[++i];
+        else
+            _usage(argv[0]);
+    }
+
+    if (opts.iterations == 0 || opts.max_threads == 0 ||
+        opts.max_threads > MAX_THREADS || opts.max_workers == 0 ||
+        opts.max_workers > MAX_WORKERS || opts.max_size > MAX_PAYLOAD_SIZE)
+        _usage(argv[0]);
+
+    oe_perf::report report(
+        "switchless_ecalls",
+        opts.simulate || (oe_get_create_flags() & OE_ENCLAVE_FLAG_SIMULATE));
+
+    _run_benchmarks(report, opts);
+
+    OE_TEST(report.write(opts.output_path));
+
+    printf("=== passed all tests (switchless_ecalls)\n");
+
+    return 0;
+}
@@ -0,0 +1,65 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/enclave.h>
+#include <openenclave/internal/tests.h>
+#include "transitions_t.h"
+
+#define MAX_PAYLOAD_SIZE (1024 * 1024)
+
+/* Only ever read, so all threads share it */
+static uint8_t _payload[MAX_PAYLOAD_SIZE];
+
+void enc_empty()
+{
+}
+
+void enc_in(const void* buffer, size_t size)
+{
+    OE_UNUSED(buffer);
+    OE_UNUSED(size);
+}
+
+void enc_out(void* buffer, size_t size)
+{
+    OE_UNUSED(buffer);
+    OE_UNUSED(size);
+}
+
+void enc_run(transitions_benchmark_t benchmark, uint64_t count, size_t size)
+{
+    OE_TEST(size <= MAX_PAYLOAD_SIZE);
+
+    for (uint64_t i = 0; i < count; i++)
+    {
+        switch (benchmark)
+        {
+            case BENCHMARK_OCALL:
+                OE_TEST(host_in(_payload, size) == OE_OK);
+                break;
+
+            case BENCHMARK_SWITCHLESS_OCALL:
+                OE_TEST(host_in_switchless(_payload, size) == OE_OK);
+                break;
+
+            case BENCHMARK_HOST_MALLOC:
+            {
+                void* ptr = oe_host_malloc(size);
+                OE_TEST(ptr || size == 0);
+                oe_host_free(ptr);
+                break;
+            }
+
+            default:
+                oe_abort();
+        }
+    }
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,    /* ProductID */
+    1,    /* SecurityVersion */
+    true, /* Debug */
+    8192, /* NumHeapPages */
+    64,   /* NumStackPages */
+    16);  /* NumTCS */
@@ -0,0 +1,257 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/error.h>
+#include <openenclave/internal/tests.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <functional>
+#include <vector>
+#include "../../common/benchmark.h"
+#include "transitions_u.h"
+
+#define MAX_PAYLOAD_SIZE (1024 * 1024)
+#define MAX_THREADS 16
+
+/* Operations that are started inside the enclave are timed in batches, so
+ * that the ECALL that starts them does not dominate the samples. */
+#define BATCH_SIZE 16
+
+static const size_t _payload_sizes[] = {0, 64, 4096, 64 * 1024, 1024 * 1024};
+
+static uint8_t _payload[MAX_PAYLOAD_SIZE];
+
+struct options
+{
+    const char* enclave_path = nullptr;
+    const char* output_path = nullptr;
+    size_t iterations = 1000;
+    size_t max_threads = 4;
+    size_t max_size = MAX_PAYLOAD_SIZE;
+    bool simulate = false;
+};
+
+void host_in(const void* buffer, size_t size)
+{
+    OE_UNUSED(buffer);
+    OE_UNUSED(size);
+}
+
+void host_in_switchless(const void* buffer, size_t size)
+{
+    OE_UNUSED(buffer);
+    OE_UNUSED(size);
+}
+
+static oe_enclave_t* _create_enclave(
+    const options& opts,
+    size_t num_host_workers)
+{
+    oe_result_t result;
+    oe_enclave_t* enclave = nullptr;
+    uint32_t flags = oe_get_create_flags();
+    oe_enclave_setting_context_switchless_t switchless_setting = {
+        num_host_workers, 0};
+    oe_enclave_setting_t setting;
+
+    setting.setting_type = OE_ENCLAVE_SETTING_CONTEXT_SWITCHLESS;
+    setting.u.context_switchless_setting = &switchless_setting;
+
+    if (opts.simulate)
+        flags |= OE_ENCLAVE_FLAG_SIMULATE;
+
+    if ((result = oe_create_transitions_enclave(
+             opts.enclave_path,
+             OE_ENCLAVE_TYPE_SGX,
+             flags,
+             num_host_workers ? &setting : nullptr,
+             num_host_workers ? 1 : 0,
+             &enclave)) != OE_OK)
+        oe_put_err("oe_create_transitions_enclave(): result=%u", result);
+
+    return enclave;
+}
+
+/* Runs op, which performs ops_per_call operations of the given payload size,
+ * with 1, 2, 4, ... up to opts.max_threads threads. */
+static void _run(
+    oe_perf::report& report,
+    const options& opts,
+    const char* name,
+    size_t size,
+    size_t ops_per_call,
+    const std::function<void(size_t)>& op)
+{
+    for (size_t threads = 1; threads <= opts.max_threads; threads *= 2)
+    {
+        std::vector<uint64_t> samples;
+        size_t calls = (opts.iterations + ops_per_call - 1) / ops_per_call;
+
+        /* Warm up, e.g., bind the TCSs and fault in the ocall buffers */
+        oe_perf::run_threads(
+            threads, samples, [&](size_t, std::vector<uint64_t>&) {
+                op(size);
+            });
+        samples.clear();
+
+        uint64_t wall_nsec = oe_perf::run_threads(
+            threads, samples, [&](size_t, std::vector<uint64_t>& out) {
+                out.reserve(calls);
+
+                for (size_t i = 0; i < calls; i++)
+                {
+                    auto start = oe_perf::clock_type::now();
+                    op(size);
+                    out.push_back(
+                        oe_perf::elapsed_nsec(start) / ops_per_call);
+                }
+            });
+
+        report.add(
+            name,
+            size,
+            threads,
+            samples,
+            (uint64_t)threads * calls * ops_per_call,
+            wall_nsec);
+    }
+}
+
+static void _run_enclave_benchmark(
+    oe_perf::report& report,
+    const options& opts,
+    oe_enclave_t* enclave,
+    const char* name,
+    transitions_benchmark_t benchmark,
+    size_t ops_per_call)
+{
+    for (size_t size : _payload_sizes)
+    {
+        if (size > opts.max_size)
+            break;
+
+        _run(report, opts, name, size, ops_per_call, [&](size_t n) {
+            OE_TEST(enc_run(enclave, benchmark, ops_per_call, n) == OE_OK);
+        });
+    }
+}
+
+static void _run_benchmarks(oe_perf::report& report, const options& opts)
+{
+    oe_enclave_t* enclave = _create_enclave(opts, 0);
+
+    _run(report, opts, "ecall", 0, 1, [&](size_t) {
+        OE_TEST(enc_empty(enclave) == OE_OK);
+    });
+
+    for (size_t size : _payload_sizes)
+    {
+        if (size > opts.max_size)
+            break;
+
+        _run(report, opts, "ecall_in", size, 1, [&](size_t n) {
+            OE_TEST(enc_in(enclave, _payload, n) == OE_OK);
+        });
+
+        /* The host buffer is written, so each thread has its own */
+        _run(report, opts, "ecall_out", size, 1, [&](size_t n) {
+            thread_local std::vector<uint8_t> output(MAX_PAYLOAD_SIZE);
+            OE_TEST(enc_out(enclave, output.data(), n) == OE_OK);
+        });
+    }
+
+    /* An ECALL that makes a single OCALL, timed from the host */
+    _run_enclave_benchmark(
+        report, opts, enclave, "ecall_ocall", BENCHMARK_OCALL, 1);
+
+    _run_enclave_benchmark(
+        report, opts, enclave, "ocall", BENCHMARK_OCALL, BATCH_SIZE);
+
+    /* Without host workers, switchless OCALLs fall back to regular ones */
+    _run_enclave_benchmark(
+        report,
+        opts,
+        enclave,
+        "switchless_ocall_miss",
+        BENCHMARK_SWITCHLESS_OCALL,
+        BATCH_SIZE);
+
+    _run_enclave_benchmark(
+        report,
+        opts,
+        enclave,
+        "host_malloc_free",
+        BENCHMARK_HOST_MALLOC,
+        BATCH_SIZE);
+
+    OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+
+    /* One host worker per enclave thread, so that every call is a hit */
+    enclave = _create_enclave(opts, opts.max_threads);
+
+    _run_enclave_benchmark(
+        report,
+        opts,
+        enclave,
+        "switchless_ocall_hit",
+        BENCHMARK_SWITCHLESS_OCALL,
+        BATCH_SIZE);
+
+    OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+}
+
+static void _usage(const char* program)
+{
+    fprintf(
+        stderr,
+        "Usage: %s ENCLAVE_PATH [--iterations N] [--max-threads N] "
+        "[--max-size BYTES] [--output FILE] [--simulate]\n",
+        program);
+    exit(1);
+}
+
+int main(int argc, const char* argv[])
+{
+    options opts;
+
+    if (argc < 2)
+        _usage(argv[0]);
+
+    opts.enclave_path = argv[1];
+
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--simulate") == 0)
+            opts.simulate = true;
+        else if (i + 1 == argc)
+            _usage(argv[0]);
+        else if (strcmp(argv[i], "--iterations") == 0)
+            opts.iterations = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "--max-threads") == 0)
+            opts.max_threads = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "--max-size") == 0)
+            opts.max_size = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "--output") == 0)
+            opts.output_path = argv[++i];
+        else
+            _usage(argv[0]);
+    }
+
+    if (opts.iterations == 0 || opts.max_threads == 0 ||
+        opts.max_threads > MAX_THREADS || opts.max_size > MAX_PAYLOAD_SIZE)
+        _usage(argv[0]);
+
+    oe_perf::report report(
+        "transitions",
+        opts.simulate || (oe_get_create_flags() & OE_ENCLAVE_FLAG_SIMULATE));
+
+    _run_benchmarks(report, opts);
+
+    OE_TEST(report.write(opts.output_path));
+
+    printf("=== passed all tests (transitions)\n");
+
+    return 0;
+}
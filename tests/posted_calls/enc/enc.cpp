@@ -0,0 +1,108 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/edger8r/enclave.h>
+#include <openenclave/enclave.h>
+#include <openenclave/internal/calls.h>
+#include <openenclave/internal/tests.h>
+#include <string.h>
+#include "posted_calls_args.h"
+#include "posted_calls_t.h"
+
+/* oe_post_host_function() is internal and has no edger8r support, so the
+ * call is marshaled by hand, like in tests/abi.
+ * posted_calls_fcn_id_host_record is defined in posted_calls_t.c, must be
+ * kept in sync */
+static const size_t posted_calls_fcn_id_host_record = 0;
+
+/* Marshaling buffer of host_record(). Its size must be a multiple of
+ * OE_EDGER8R_BUFFER_ALIGNMENT */
+typedef struct _record_buffer
+{
+    host_record_args_t args;
+} OE_ALIGNED(OE_EDGER8R_BUFFER_ALIGNMENT) record_buffer_t;
+
+static oe_result_t _post_record(uint64_t value)
+{
+    record_buffer_t buffer;
+
+    memset(&buffer, 0, sizeof(buffer));
+    buffer.args.value = value;
+
+    return oe_post_host_function(
+        posted_calls_fcn_id_host_record,
+        &buffer,
+        sizeof(buffer),
+        sizeof(buffer));
+}
+
+oe_result_t enc_post_records(uint64_t first, uint64_t count)
+{
+    for (uint64_t i = 0; i < count; i++)
+    {
+        oe_result_t result = _post_record(first + i);
+        if (result != OE_OK)
+            return result;
+    }
+
+    return OE_OK;
+}
+
+oe_result_t enc_call_records(uint64_t first, uint64_t count)
+{
+    for (uint64_t i = 0; i < count; i++)
+    {
+        oe_result_t result = host_record(first + i);
+        if (result != OE_OK)
+            return result;
+    }
+
+    return OE_OK;
+}
+
+oe_result_t enc_post_then_call(uint64_t first)
+{
+    oe_result_t result;
+
+    if ((result = _post_record(first)) != OE_OK)
+        return result;
+
+    if ((result = _post_record(first + 1)) != OE_OK)
+        return result;
+
+    return host_record(first + 2);
+}
+
+void enc_host_free(uint64_t count)
+{
+    for (uint64_t i = 0; i < count; i++)
+    {
+        void* ptr = oe_host_malloc(64);
+        OE_TEST(ptr != NULL);
+        oe_host_free(ptr);
+    }
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,    /* ProductID */
+    1,    /* SecurityVersion */
+    true, /* Debug */
+    128,  /* NumHeapPages */
+    16,   /* NumStackPages */
+    1);   /* NumTCS */
+
+#define TA_UUID                                            \
+    { /* 5d0c7a92-3e18-4b6f-a1d4-8c2e9f07b356 */           \
+        0x5d0c7a92, 0x3e18, 0x4b6f,                        \
+        {                                                  \
+            0xa1, 0xd4, 0x8c, 0x2e, 0x9f, 0x07, 0xb3, 0x56 \
+        }                                                  \
+    }
+
+OE_SET_ENCLAVE_OPTEE(
+    TA_UUID,
+    1 * 1024 * 1024,
+    64 * 1024,
+    0,
+    "1.0.0",
+    "Posted calls test")
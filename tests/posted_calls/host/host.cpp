@@ -0,0 +1,85 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/error.h>
+#include <openenclave/internal/tests.h>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "posted_calls_u.h"
+
+static std::vector<uint64_t> _records;
+
+void host_record(uint64_t value)
+{
+    _records.push_back(value);
+}
+
+static void _check_records(uint64_t first, uint64_t count)
+{
+    OE_TEST(_records.size() == count);
+
+    for (uint64_t i = 0; i < count; i++)
+        OE_TEST(_records[i] == first + i);
+
+    _records.clear();
+}
+
+static void _test_posted_calls(oe_enclave_t* enclave)
+{
+    oe_result_t result = OE_UNEXPECTED;
+
+    /* Posted calls are performed by the time the ECALL returns */
+    OE_TEST(enc_post_records(enclave, &result, 100, 10) == OE_OK);
+    OE_TEST(result == OE_OK);
+    _check_records(100, 10);
+
+    /* Posted calls precede a subsequent synchronous OCALL */
+    OE_TEST(enc_post_then_call(enclave, &result, 200) == OE_OK);
+    OE_TEST(result == OE_OK);
+    _check_records(200, 3);
+
+    /* More calls than fit into the queue are performed synchronously, in
+     * order */
+    OE_TEST(enc_post_records(enclave, &result, 0, 5000) == OE_OK);
+    OE_TEST(result == OE_OK);
+    _check_records(0, 5000);
+
+    /* Regular OCALLs are made as before */
+    OE_TEST(enc_call_records(enclave, &result, 300, 10) == OE_OK);
+    OE_TEST(result == OE_OK);
+    _check_records(300, 10);
+
+    /* oe_host_free() is posted as well */
+    OE_TEST(enc_host_free(enclave, 1000) == OE_OK);
+}
+
+int main(int argc, const char* argv[])
+{
+    oe_result_t result;
+    oe_enclave_t* enclave = NULL;
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s ENCLAVE\n", argv[0]);
+        exit(1);
+    }
+
+    const uint32_t flags = oe_get_create_flags();
+
+    result = oe_create_posted_calls_enclave(
+        argv[1], OE_ENCLAVE_TYPE_SGX, flags, NULL, 0, &enclave);
+    if (result != OE_OK)
+        oe_put_err("oe_create_posted_calls_enclave(): result=%u", result);
+
+    _test_posted_calls(enclave);
+
+    result = oe_terminate_enclave(enclave);
+    if (result != OE_OK)
+        oe_put_err("oe_terminate_enclave(): result=%u", result);
+
+    printf("=== passed all tests (posted_calls)\n");
+
+    return 0;
+}
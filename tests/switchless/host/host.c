@@ -210,6 +210,90 @@ void test_switchless_ocalls(
         (double)regular_microseconds / switchless_max);
 }
 
+static void check_pool_statistics(
+    oe_enclave_t* enclave,
+    uint64_t num_enclave_threads)
+{
+    oe_switchless_pool_statistics_t stats;
+
+    OE_TEST(oe_get_switchless_pool_statistics(enclave, &stats) == OE_OK);
+    printf(
+        "Host workers: %zu of [%zu, %zu], grew %" PRIu64
+        " times, shrank %" PRIu64 " times\n",
+        stats.num_host_workers,
+        stats.min_host_workers,
+        stats.max_host_workers,
+        stats.num_grows,
+        stats.num_shrinks);
+
+    OE_TEST(stats.num_host_workers >= stats.min_host_workers);
+    OE_TEST(stats.num_host_workers <= stats.max_host_workers);
+    OE_TEST(
+        stats.num_grows - stats.num_shrinks ==
+        stats.num_host_workers - stats.min_host_workers);
+    OE_TEST(
+        stats.num_calls + stats.num_fallbacks >=
+        num_enclave_threads * NUM_OCALLS);
+}
+
+static void check_switchless_statistics(
+    oe_enclave_t* enclave,
+    bool test_ecalls,
+    uint64_t num_calls)
+{
+    oe_switchless_statistics_t stats;
+    oe_switchless_worker_statistics_t workers[NUM_TCS * 2];
+    size_t num_workers = 0;
+    uint64_t num_worker_calls = 0;
+    uint64_t num_worker_wakes = 0;
+
+    OE_TEST(
+        oe_get_switchless_statistics(enclave, &stats, NULL, &num_workers) ==
+        OE_BUFFER_TOO_SMALL);
+    OE_TEST(num_workers == stats.num_host_workers + stats.num_enclave_workers);
+    OE_TEST(num_workers <= OE_COUNTOF(workers));
+    OE_TEST(
+        oe_get_switchless_statistics(enclave, &stats, workers, &num_workers) ==
+        OE_OK);
+
+    printf(
+        "Switchless: %" PRIu64 " ocall posts, %" PRIu64 " misses, %" PRIu64
+        " wake ocalls, %" PRIu64 " ecall posts, %" PRIu64 " misses\n",
+        stats.num_ocall_posts,
+        stats.num_ocall_misses,
+        stats.num_wake_ocalls,
+        stats.num_ecall_posts,
+        stats.num_ecall_misses);
+
+    for (size_t i = 0; i < num_workers; i++)
+    {
+        printf(
+            "%s worker %zu: %" PRIu64 " calls, %" PRIu64 " spins, %" PRIu64
+            " parks, %" PRIu64 " wakes\n",
+            i < stats.num_host_workers ? "Host" : "Enclave",
+            i,
+            workers[i].num_calls,
+            workers[i].num_spins,
+            workers[i].num_parks,
+            workers[i].num_wakes);
+
+        if (i < stats.num_host_workers)
+        {
+            num_worker_calls += workers[i].num_calls;
+            num_worker_wakes += workers[i].num_wakes;
+        }
+    }
+
+    // The workers may still be counting the calls that they handled last.
+    OE_TEST(num_worker_calls <= stats.num_ocall_posts);
+    OE_TEST(num_worker_wakes == stats.num_wake_ocalls);
+
+    if (test_ecalls)
+        OE_TEST(stats.num_ecall_posts + stats.num_ecall_misses >= num_calls);
+    else
+        OE_TEST(stats.num_ocall_posts + stats.num_ocall_misses >= num_calls);
+}
+
 int host_test_echo_switchless(
     oe_enclave_t* enclave,
     const char* in,
@@ -433,7 +517,7 @@ int main(int argc, const char* argv[])
         fprintf(
             stderr,
             "Usage: %s ENCLAVE_PATH [--host-threads n] [--enclave-threads n] "
-            "[--ecalls]\n",
+            "[--ecalls] [--slots] [--spin-count n] [--min-host-threads n]\n",
             argv[0]);
         return 1;
     }
@@ -441,6 +525,9 @@ int main(int argc, const char* argv[])
     uint64_t num_host_threads = 1;
     uint64_t num_enclave_threads = 2;
     bool test_ecalls = false;
+    bool use_slots = false;
+    uint64_t spin_count = 0;
+    uint64_t min_host_threads = 0;
 
     {
         int i = 2;
@@ -462,6 +549,22 @@ int main(int argc, const char* argv[])
             {
                 test_ecalls = true;
             }
+            else if (strcmp(argv[i], "--slots") == 0)
+            {
+                use_slots = true;
+            }
+            else if (strcmp(argv[i], "--spin-count") == 0)
+            {
+                if (++i == argc)
+                    goto print_usage;
+                sscanf_s(argv[i], "%" SCNu64, &spin_count);
+            }
+            else if (strcmp(argv[i], "--min-host-threads") == 0)
+            {
+                if (++i == argc)
+                    goto print_usage;
+                sscanf_s(argv[i], "%" SCNu64, &min_host_threads);
+            }
             else
                 goto print_usage;
 
@@ -479,15 +582,38 @@ int main(int argc, const char* argv[])
     // Enable switchless and configure host
     oe_enclave_setting_context_switchless_t switchless_setting = {0, 0};
 
+    if (use_slots)
+        switchless_setting.ocall_transport =
+            OE_SWITCHLESS_OCALL_TRANSPORT_SLOTS;
+
     if (test_ecalls)
         switchless_setting.max_enclave_workers = num_enclave_threads;
     else
+    {
         switchless_setting.max_host_workers = num_host_threads;
+        switchless_setting.min_host_workers = min_host_threads;
+    }
 
     oe_enclave_setting_t settings[] = {
         {.setting_type = OE_ENCLAVE_SETTING_CONTEXT_SWITCHLESS,
          .u.context_switchless_setting = &switchless_setting}};
 
+    // The spin count bounds must not be inverted.
+    switchless_setting.min_spin_count = 2;
+    switchless_setting.max_spin_count = 1;
+    OE_TEST(
+        oe_create_switchless_test_enclave(
+            argv[1],
+            OE_ENCLAVE_TYPE_SGX,
+            flags,
+            settings,
+            OE_COUNTOF(settings),
+            &enclave_switchless) == OE_INVALID_PARAMETER);
+
+    // Pin the spin count to the given value, or let the workers adapt it.
+    switchless_setting.min_spin_count = spin_count;
+    switchless_setting.max_spin_count = spin_count;
+
     if ((result = oe_create_switchless_test_enclave(
              argv[1],
              OE_ENCLAVE_TYPE_SGX,
@@ -503,11 +629,20 @@ int main(int argc, const char* argv[])
         oe_put_err("oe_create_enclave(): result=%u", result);
 
     if (test_ecalls)
+    {
         test_switchless_ecalls(
             enclave_switchless, enclave_normal, num_host_threads);
+        check_switchless_statistics(
+            enclave_switchless, true, num_host_threads * NUM_ECALLS);
+    }
     else
+    {
         test_switchless_ocalls(
             enclave_switchless, enclave_normal, num_enclave_threads);
+        check_pool_statistics(enclave_switchless, num_enclave_threads);
+        check_switchless_statistics(
+            enclave_switchless, false, num_enclave_threads * NUM_OCALLS);
+    }
 
     OE_TEST(enc_test_large_switchless_ocall(enclave_switchless) == OE_OK);
 
@@ -0,0 +1,249 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/edger8r/enclave.h>
+#include <openenclave/enclave.h>
+#include <openenclave/internal/sgx/td.h>
+#include <openenclave/internal/tests.h>
+#include <string.h>
+#include "switchless_async_args.h"
+#include "switchless_async_t.h"
+
+#define MAX_CALLS 32
+
+/* switchless_async_fcn_id_host_sleep_and_double is defined in
+ * switchless_async_t.c, must be kept in sync */
+static const size_t switchless_async_fcn_id_host_sleep_and_double = 0;
+
+/* Marshaling buffer of host_sleep_and_double(). Its size must be a multiple
+ * of OE_EDGER8R_BUFFER_ALIGNMENT */
+typedef struct _sleep_buffer
+{
+    host_sleep_and_double_args_t args;
+} OE_ALIGNED(OE_EDGER8R_BUFFER_ALIGNMENT) sleep_buffer_t;
+
+typedef struct _async_call
+{
+    sleep_buffer_t* input;
+    sleep_buffer_t* output;
+    oe_switchless_call_t* handle;
+} async_call_t;
+
+static oe_result_t _start_call(
+    async_call_t* call,
+    uint64_t value,
+    uint64_t msec)
+{
+    call->input = (sleep_buffer_t*)oe_allocate_switchless_ocall_buffer(
+        sizeof(sleep_buffer_t));
+    call->output = (sleep_buffer_t*)oe_allocate_switchless_ocall_buffer(
+        sizeof(sleep_buffer_t));
+
+    if (!call->input || !call->output)
+        return OE_OUT_OF_MEMORY;
+
+    memset(call->input, 0, sizeof(sleep_buffer_t));
+    memset(call->output, 0, sizeof(sleep_buffer_t));
+    call->input->args.value = value;
+    call->input->args.msec = msec;
+
+    return oe_switchless_call_host_function_async(
+        switchless_async_fcn_id_host_sleep_and_double,
+        call->input,
+        sizeof(sleep_buffer_t),
+        call->output,
+        sizeof(sleep_buffer_t),
+        &call->handle);
+}
+
+static oe_result_t _finish_call(async_call_t* call, uint64_t* retval)
+{
+    oe_result_t result;
+    size_t output_bytes_written = 0;
+
+    result = oe_switchless_call_wait(call->handle, &output_bytes_written);
+
+    if (result == OE_OK)
+        result = call->output->args._result;
+
+    if (result == OE_OK)
+        *retval = call->output->args._retval;
+
+    oe_free_switchless_ocall_buffer(call->output);
+    oe_free_switchless_ocall_buffer(call->input);
+
+    return result;
+}
+
+oe_result_t enc_test_async(uint64_t num_calls, uint64_t msec)
+{
+    async_call_t calls[MAX_CALLS];
+    uint64_t num_completed = 0;
+
+    OE_TEST(num_calls <= MAX_CALLS);
+
+    for (uint64_t i = 0; i < num_calls; i++)
+        OE_TEST(_start_call(&calls[i], i, msec) == OE_OK);
+
+    /* Poll until all calls have completed */
+    while (num_completed < num_calls)
+    {
+        num_completed = 0;
+
+        for (uint64_t i = 0; i < num_calls; i++)
+        {
+            bool completed = false;
+            OE_TEST(
+                oe_switchless_call_test(calls[i].handle, &completed) ==
+                OE_OK);
+            num_completed += completed;
+        }
+    }
+
+    /* Complete the calls in reverse order, which frees their buffers out of
+     * the order they were allocated in */
+    for (uint64_t i = num_calls; i > 0; i--)
+    {
+        uint64_t retval = 0;
+        OE_TEST(_finish_call(&calls[i - 1], &retval) == OE_OK);
+        OE_TEST(retval == 2 * (i - 1));
+    }
+
+    /* The arena is reusable once all buffers have been freed */
+    OE_TEST(_start_call(&calls[0], 21, 0) == OE_OK);
+    {
+        uint64_t retval = 0;
+        OE_TEST(_finish_call(&calls[0], &retval) == OE_OK);
+        OE_TEST(retval == 42);
+    }
+
+    /* Invalid parameters */
+    OE_TEST(oe_switchless_call_test(NULL, NULL) == OE_INVALID_PARAMETER);
+    OE_TEST(
+        oe_switchless_call_host_function_async(
+            switchless_async_fcn_id_host_sleep_and_double,
+            NULL,
+            0,
+            NULL,
+            0,
+            &calls[0].handle) == OE_INVALID_PARAMETER);
+
+    return OE_OK;
+}
+
+oe_result_t enc_test_abandon(uint64_t msec)
+{
+    async_call_t call;
+
+    /* The call and its buffers are released when the ECALL returns */
+    OE_TEST(_start_call(&call, 1, msec) == OE_OK);
+
+    return OE_OK;
+}
+
+oe_result_t enc_test_sync(uint64_t num_calls, uint64_t msec)
+{
+    for (uint64_t i = 0; i < num_calls; i++)
+    {
+        uint64_t retval = 0;
+        OE_TEST(host_sleep_and_double(&retval, i, msec) == OE_OK);
+        OE_TEST(retval == 2 * i);
+    }
+
+    return OE_OK;
+}
+
+static uint8_t* _alloc(size_t size)
+{
+    uint8_t* buffer = (uint8_t*)oe_allocate_switchless_ocall_buffer(size);
+
+    OE_TEST(buffer != NULL);
+    OE_TEST(oe_is_outside_enclave(buffer, size));
+    return buffer;
+}
+
+/* The capacity of the first segment of the arena in enc_test_arena() */
+static uint64_t _arena_capacity;
+
+oe_result_t enc_test_arena(void)
+{
+    /* The arena of this thread, which is reset at the end of each ECALL */
+    const oe_shared_memory_arena_t* arena = &oe_sgx_get_td()->arena;
+    uint8_t* buffers[8];
+    uint8_t *a, *b, *c, *d;
+    uint64_t capacity;
+
+    /* Nested buffers are adjacent, and a LIFO free reuses the memory */
+    a = _alloc(64);
+    b = _alloc(64);
+    OE_TEST(b == a + 64);
+    oe_free_switchless_ocall_buffer(b);
+    c = _alloc(64);
+    OE_TEST(c == b);
+
+    /* An object freed out of order is reclaimed with the newer ones */
+    oe_free_switchless_ocall_buffer(a);
+    d = _alloc(16);
+    OE_TEST(d == c + 64);
+    OE_TEST(arena->num_objects == 3);
+    oe_free_switchless_ocall_buffer(c);
+    OE_TEST(arena->num_objects == 3);
+    oe_free_switchless_ocall_buffer(d);
+    OE_TEST(arena->num_objects == 0);
+    OE_TEST(arena->used == 0);
+    OE_TEST(arena->max_num_objects == 3);
+    OE_TEST(arena->max_used == 144);
+
+    /* The arena starts small and chains a larger segment when it is full */
+    capacity = arena->capacity;
+    OE_TEST(capacity > 0 && capacity < 1024 * 1024);
+
+    for (size_t i = 0; i < OE_COUNTOF(buffers); i++)
+        buffers[i] = _alloc(capacity / 4);
+
+    OE_TEST(arena->num_grows == 1);
+    OE_TEST(arena->capacity == 3 * capacity);
+    OE_TEST(arena->used == 2 * capacity);
+
+    for (size_t i = OE_COUNTOF(buffers); i > 0; i--)
+        oe_free_switchless_ocall_buffer(buffers[i - 1]);
+
+    /* Once empty, the arena only keeps its largest segment */
+    OE_TEST(arena->num_objects == 0);
+    OE_TEST(arena->capacity == 2 * capacity);
+    OE_TEST(arena->max_used == 2 * capacity);
+
+    /* Buffers that do not belong to the arena are freed as host memory */
+    a = (uint8_t*)oe_host_malloc(64);
+    OE_TEST(a != NULL);
+    oe_free_switchless_ocall_buffer(a);
+
+    _arena_capacity = capacity;
+
+    return OE_OK;
+}
+
+oe_result_t enc_test_arena_statistics(void)
+{
+    oe_switchless_arena_statistics_t statistics;
+
+    OE_TEST(oe_get_switchless_arena_statistics(NULL) == OE_INVALID_PARAMETER);
+
+    /* The arena of enc_test_arena() has been torn down and this thread's
+     * arena is empty, but the statistics are kept */
+    OE_TEST(oe_sgx_get_td()->arena.max_num_objects == 0);
+    OE_TEST(oe_get_switchless_arena_statistics(&statistics) == OE_OK);
+    OE_TEST(statistics.max_used >= 2 * _arena_capacity);
+    OE_TEST(statistics.max_num_objects >= 8);
+    OE_TEST(statistics.num_grows >= 1);
+
+    return OE_OK;
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,    /* ProductID */
+    1,    /* SecurityVersion */
+    true, /* Debug */
+    1024, /* NumHeapPages */
+    64,   /* NumStackPages */
+    2);   /* NumTCS */
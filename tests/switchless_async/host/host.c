@@ -0,0 +1,131 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/atomic.h>
+#include <openenclave/internal/error.h>
+#include <openenclave/internal/tests.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "switchless_async_u.h"
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#define NUM_HOST_WORKERS 4
+#define SLEEP_MSEC 50
+
+static void _sleep_msec(uint64_t msec)
+{
+#if defined(_WIN32)
+    Sleep((DWORD)msec);
+#else
+    usleep((useconds_t)(msec * 1000));
+#endif
+}
+
+static double _get_msec(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+}
+
+/* Number of completed calls of host_sleep_and_double() */
+static volatile uint64_t _num_completed_calls;
+
+uint64_t host_sleep_and_double(uint64_t value, uint64_t msec)
+{
+    _sleep_msec(msec);
+    oe_atomic_increment(&_num_completed_calls);
+    return 2 * value;
+}
+
+int main(int argc, const char* argv[])
+{
+    oe_result_t result;
+    oe_result_t return_value = OE_UNEXPECTED;
+    oe_enclave_t* enclave = NULL;
+    double start, sync_msec, async_msec;
+    oe_switchless_pool_statistics_t statistics;
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s ENCLAVE_PATH\n", argv[0]);
+        return 1;
+    }
+
+    const uint32_t flags = oe_get_create_flags();
+
+    oe_enclave_setting_context_switchless_t switchless_setting = {
+        NUM_HOST_WORKERS, 0};
+    oe_enclave_setting_t settings[] = {
+        {.setting_type = OE_ENCLAVE_SETTING_CONTEXT_SWITCHLESS,
+         .u.context_switchless_setting = &switchless_setting}};
+
+    if ((result = oe_create_switchless_async_enclave(
+             argv[1],
+             OE_ENCLAVE_TYPE_SGX,
+             flags,
+             settings,
+             OE_COUNTOF(settings),
+             &enclave)) != OE_OK)
+        oe_put_err("oe_create_enclave(): result=%u", result);
+
+    start = _get_msec();
+    OE_TEST(
+        enc_test_sync(enclave, &return_value, NUM_HOST_WORKERS, SLEEP_MSEC) ==
+        OE_OK);
+    OE_TEST(return_value == OE_OK);
+    sync_msec = _get_msec() - start;
+
+    /* The enclave thread sleeps rather than spins through the long calls */
+    OE_TEST(oe_get_switchless_pool_statistics(enclave, &statistics) == OE_OK);
+    OE_TEST(statistics.num_calls > 0);
+    OE_TEST(statistics.num_parked_waits == statistics.num_calls);
+
+    start = _get_msec();
+    OE_TEST(
+        enc_test_async(enclave, &return_value, NUM_HOST_WORKERS, SLEEP_MSEC) ==
+        OE_OK);
+    OE_TEST(return_value == OE_OK);
+    async_msec = _get_msec() - start;
+
+    /* The calls of the host workers overlap */
+    OE_TEST(async_msec < sync_msec);
+
+    /* More calls than host workers: the rest is performed synchronously */
+    OE_TEST(
+        enc_test_async(enclave, &return_value, 4 * NUM_HOST_WORKERS, 1) ==
+        OE_OK);
+    OE_TEST(return_value == OE_OK);
+
+    /* A call that the enclave does not wait for has completed by the time
+     * the ECALL returns, and the enclave keeps working */
+    {
+        uint64_t num_completed_calls = oe_atomic_load(&_num_completed_calls);
+
+        OE_TEST(
+            enc_test_abandon(enclave, &return_value, SLEEP_MSEC) == OE_OK);
+        OE_TEST(return_value == OE_OK);
+        OE_TEST(
+            oe_atomic_load(&_num_completed_calls) == num_completed_calls + 1);
+    }
+
+    OE_TEST(enc_test_arena(enclave, &return_value) == OE_OK);
+    OE_TEST(return_value == OE_OK);
+
+    OE_TEST(enc_test_arena_statistics(enclave, &return_value) == OE_OK);
+    OE_TEST(return_value == OE_OK);
+
+    result = oe_terminate_enclave(enclave);
+    OE_TEST(result == OE_OK);
+
+    printf("=== passed all tests (switchless_async)\n");
+
+    return 0;
+}
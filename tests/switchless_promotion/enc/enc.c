@@ -0,0 +1,47 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/enclave.h>
+#include <openenclave/internal/tests.h>
+#include "switchless_promotion_t.h"
+
+uint64_t enc_count_switchless_calls(
+    uint32_t function_id,
+    uint64_t num_calls,
+    uint64_t main_thread)
+{
+    uint64_t num_switchless = 0;
+
+    for (uint64_t i = 0; i < num_calls; i++)
+    {
+        uint64_t thread = 0;
+
+        switch (function_id)
+        {
+            case 0:
+                OE_TEST(host_get_thread_id(&thread) == OE_OK);
+                break;
+            case 1:
+                OE_TEST(host_get_thread_id_always(&thread) == OE_OK);
+                break;
+            case 2:
+                OE_TEST(host_get_thread_id_never(&thread) == OE_OK);
+                break;
+            default:
+                OE_TEST(false);
+        }
+
+        if (thread != main_thread)
+            num_switchless++;
+    }
+
+    return num_switchless;
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,    /* ProductID */
+    1,    /* SecurityVersion */
+    true, /* Debug */
+    1024, /* NumHeapPages */
+    64,   /* NumStackPages */
+    2);   /* NumTCS */
@@ -0,0 +1,191 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/error.h>
+#include <openenclave/internal/tests.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "switchless_promotion_u.h"
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#define NUM_HOST_WORKERS 2
+#define NUM_CALLS 1000
+#define MAX_PROMOTION_MSEC 10000
+
+/* The ids of the host functions in switchless_promotion_u.c, must be kept in
+ * sync */
+#define HOST_GET_THREAD_ID 0
+#define HOST_GET_THREAD_ID_ALWAYS 1
+#define HOST_GET_THREAD_ID_NEVER 2
+
+static double _get_msec(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+}
+
+static uint64_t _get_thread_id(void)
+{
+#if defined(_WIN32)
+    return (uint64_t)GetCurrentThreadId();
+#else
+    return (uint64_t)pthread_self();
+#endif
+}
+
+uint64_t host_get_thread_id(void)
+{
+    return _get_thread_id();
+}
+
+uint64_t host_get_thread_id_always(void)
+{
+    return _get_thread_id();
+}
+
+uint64_t host_get_thread_id_never(void)
+{
+    return _get_thread_id();
+}
+
+static oe_result_t _create_enclave(
+    const char* path,
+    oe_switchless_promotion_t promotion,
+    const oe_switchless_ocall_promotion_t* overrides,
+    size_t num_overrides,
+    oe_enclave_t** enclave)
+{
+    oe_enclave_setting_context_switchless_t switchless_setting = {
+        NUM_HOST_WORKERS, 0};
+    oe_enclave_setting_t settings[] = {
+        {.setting_type = OE_ENCLAVE_SETTING_CONTEXT_SWITCHLESS,
+         .u.context_switchless_setting = &switchless_setting}};
+
+    switchless_setting.ocall_promotion = promotion;
+    switchless_setting.ocall_promotion_overrides = overrides;
+    switchless_setting.num_ocall_promotion_overrides = num_overrides;
+
+    return oe_create_switchless_promotion_enclave(
+        path,
+        OE_ENCLAVE_TYPE_SGX,
+        oe_get_create_flags(),
+        settings,
+        OE_COUNTOF(settings),
+        enclave);
+}
+
+static uint64_t _count_switchless_calls(
+    oe_enclave_t* enclave,
+    uint32_t function_id)
+{
+    uint64_t num_switchless = 0;
+
+    OE_TEST(
+        enc_count_switchless_calls(
+            enclave,
+            &num_switchless,
+            function_id,
+            NUM_CALLS,
+            _get_thread_id()) == OE_OK);
+
+    return num_switchless;
+}
+
+/* Call the host function until its calls are made as switchless calls.
+ * Returns false if it is not promoted within MAX_PROMOTION_MSEC. */
+static bool _wait_for_promotion(oe_enclave_t* enclave, uint32_t function_id)
+{
+    double start = _get_msec();
+
+    while (_get_msec() - start < MAX_PROMOTION_MSEC)
+    {
+        if (_count_switchless_calls(enclave, function_id) > 0)
+            return true;
+    }
+
+    return false;
+}
+
+int main(int argc, const char* argv[])
+{
+    oe_result_t result;
+    oe_enclave_t* enclave = NULL;
+    oe_switchless_pool_statistics_t statistics;
+    const oe_switchless_ocall_promotion_t overrides[] = {
+        {HOST_GET_THREAD_ID_ALWAYS, OE_SWITCHLESS_PROMOTION_ALWAYS},
+        {HOST_GET_THREAD_ID_NEVER, OE_SWITCHLESS_PROMOTION_NEVER}};
+    const oe_switchless_ocall_promotion_t invalid_overrides[] = {
+        {UINT32_MAX, OE_SWITCHLESS_PROMOTION_ALWAYS}};
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s ENCLAVE_PATH\n", argv[0]);
+        return 1;
+    }
+
+    /* Only single host functions can always be promoted */
+    OE_TEST(
+        _create_enclave(
+            argv[1], OE_SWITCHLESS_PROMOTION_ALWAYS, NULL, 0, &enclave) ==
+        OE_INVALID_PARAMETER);
+    OE_TEST(
+        _create_enclave(
+            argv[1],
+            OE_SWITCHLESS_PROMOTION_AUTO,
+            invalid_overrides,
+            OE_COUNTOF(invalid_overrides),
+            &enclave) == OE_INVALID_PARAMETER);
+
+    /* With the policy turned off, calls are never promoted */
+    if ((result = _create_enclave(
+             argv[1], OE_SWITCHLESS_PROMOTION_NEVER, NULL, 0, &enclave)) !=
+        OE_OK)
+        oe_put_err("oe_create_enclave(): result=%u", result);
+
+    for (size_t i = 0; i < 10; i++)
+        OE_TEST(_count_switchless_calls(enclave, HOST_GET_THREAD_ID) == 0);
+
+    OE_TEST(oe_get_switchless_pool_statistics(enclave, &statistics) == OE_OK);
+    OE_TEST(statistics.num_promoted_ocalls == 0);
+    OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+
+    if ((result = _create_enclave(
+             argv[1],
+             OE_SWITCHLESS_PROMOTION_AUTO,
+             overrides,
+             OE_COUNTOF(overrides),
+             &enclave)) != OE_OK)
+        oe_put_err("oe_create_enclave(): result=%u", result);
+
+    /* Calls of host functions that are always promoted are switchless from
+     * the start, and those of host functions that are never promoted are
+     * regular */
+    OE_TEST(
+        _count_switchless_calls(enclave, HOST_GET_THREAD_ID_ALWAYS) ==
+        NUM_CALLS);
+    for (size_t i = 0; i < 10; i++)
+        OE_TEST(
+            _count_switchless_calls(enclave, HOST_GET_THREAD_ID_NEVER) == 0);
+
+    /* A short host function that is called often gets promoted */
+    OE_TEST(_wait_for_promotion(enclave, HOST_GET_THREAD_ID));
+
+    OE_TEST(oe_get_switchless_pool_statistics(enclave, &statistics) == OE_OK);
+    OE_TEST(statistics.num_promoted_ocalls >= 2);
+    OE_TEST(statistics.num_calls >= NUM_CALLS);
+
+    result = oe_terminate_enclave(enclave);
+    OE_TEST(result == OE_OK);
+
+    printf("=== passed all tests (switchless_promotion)\n");
+
+    return 0;
+}